@@ -0,0 +1,174 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <string.h>
+
+/* The instruction is used through the intrinsics of GCC, which only lets 
+   the functions that ask for SSE 4.2 use it, so the rest of the program
+   still runs on processors without it. */
+#if defined __GNUC__ && ( defined __x86_64__ || defined __i386__ )
+   #include <nmmintrin.h>
+   #define CRC_HAS_INSTRUCTION
+   #define CRC_TARGET __attribute__( ( target( "sse4.2" ) ) )
+#endif
+
+#include "crc32c.h"
+
+/* Private prototypes: */
+static void CrcSetUp( void );
+static unsigned int CrcUpdateTables( unsigned int crc, const Byte *data,
+   size_t size );
+#ifdef CRC_HAS_INSTRUCTION
+static CRC_TARGET unsigned int CrcUpdateInstruction( unsigned int crc, 
+   const Byte *data, size_t size );
+#endif
+
+/* Table N gives the CRC of a byte followed by N zero bytes, so 8 bytes can
+   be taken in at once by looking up each of them in its own table. */
+static unsigned int crcTables[ 8 ][ 256 ];
+static Bool isSetUp = FALSE;
+static Bool hasInstruction = FALSE;
+
+void CrcSetUp( void ) {
+   unsigned int byte;
+
+   for ( byte = 0; byte < 256; byte += 1 ) {
+      unsigned int crc = byte;
+      int bit;
+
+      for ( bit = 0; bit < 8; bit += 1 ) {
+         crc = ( crc >> 1 ) ^ ( ( crc & 1 ) ? CRC32C_POLYNOMIAL : 0 );
+      }
+
+      crcTables[ 0 ][ byte ] = crc;
+   }
+
+   for ( byte = 0; byte < 256; byte += 1 ) {
+      int table;
+
+      for ( table = 1; table < 8; table += 1 ) {
+         const unsigned int crc = crcTables[ table - 1 ][ byte ];
+         crcTables[ table ][ byte ] = ( crc >> 8 ) ^ 
+            crcTables[ 0 ][ crc & 0xFF ];
+      }
+   }
+
+#ifdef CRC_HAS_INSTRUCTION
+   hasInstruction = __builtin_cpu_supports( "sse4.2" );
+#endif
+   isSetUp = TRUE;
+}
+
+unsigned int Crc32cUpdate( unsigned int checksum, const void *data, 
+   size_t size ) {
+   const Byte *bytes = ( const Byte * ) data;
+
+   if ( ! isSetUp ) {
+      CrcSetUp();
+   }
+
+   /* The CRC is kept inverted while it's worked on. */
+#ifdef CRC_HAS_INSTRUCTION
+   if ( hasInstruction ) {
+      return ~CrcUpdateInstruction( ~checksum, bytes, size );
+   }
+#endif
+
+   return ~CrcUpdateTables( ~checksum, bytes, size );
+}
+
+/* The bytes are put together one by one, so this works the same way on 
+   processors of either byte order. */
+unsigned int CrcUpdateTables( unsigned int crc, const Byte *data, 
+   size_t size ) {
+   while ( size >= 8 ) {
+      const unsigned int low = crc ^ ( ( unsigned int ) data[ 0 ] | 
+         ( ( unsigned int ) data[ 1 ] << 8 ) | 
+         ( ( unsigned int ) data[ 2 ] << 16 ) | 
+         ( ( unsigned int ) data[ 3 ] << 24 ) );
+      const unsigned int high = ( unsigned int ) data[ 4 ] | 
+         ( ( unsigned int ) data[ 5 ] << 8 ) | 
+         ( ( unsigned int ) data[ 6 ] << 16 ) | 
+         ( ( unsigned int ) data[ 7 ] << 24 );
+
+      crc = crcTables[ 7 ][ low & 0xFF ] ^ 
+         crcTables[ 6 ][ ( low >> 8 ) & 0xFF ] ^
+         crcTables[ 5 ][ ( low >> 16 ) & 0xFF ] ^ 
+         crcTables[ 4 ][ low >> 24 ] ^
+         crcTables[ 3 ][ high & 0xFF ] ^ 
+         crcTables[ 2 ][ ( high >> 8 ) & 0xFF ] ^
+         crcTables[ 1 ][ ( high >> 16 ) & 0xFF ] ^ 
+         crcTables[ 0 ][ high >> 24 ];
+
+      data += 8;
+      size -= 8;
+   }
+
+   while ( size > 0 ) {
+      crc = ( crc >> 8 ) ^ crcTables[ 0 ][ ( crc ^ *data ) & 0xFF ];
+      data += 1;
+      size -= 1;
+   }
+
+   return crc;
+}
+
+#ifdef CRC_HAS_INSTRUCTION
+
+/* On 64-bit processors, the instruction takes in 8 bytes at a time. */
+unsigned int CrcUpdateInstruction( unsigned int crc, const Byte *data,
+   size_t size ) {
+#if defined __x86_64__
+   unsigned long long wideCrc = crc;
+
+   while ( size >= 8 ) {
+      unsigned long long word;
+      memcpy( &word, data, sizeof( word ) );
+      wideCrc = _mm_crc32_u64( wideCrc, word );
+      data += 8;
+      size -= 8;
+   }
+
+   crc = ( unsigned int ) wideCrc;
+#endif
+
+   while ( size >= 4 ) {
+      unsigned int word;
+      memcpy( &word, data, sizeof( word ) );
+      crc = _mm_crc32_u32( crc, word );
+      data += 4;
+      size -= 4;
+   }
+
+   while ( size > 0 ) {
+      crc = _mm_crc32_u8( crc, *data );
+      data += 1;
+      size -= 1;
+   }
+
+   return crc;
+}
+
+#endif
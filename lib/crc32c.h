@@ -0,0 +1,52 @@
+/*
+
+   CRC-32C, the 32-bit CRC with the Castagnoli polynomial, for finding out
+   whether data read back is the data that was written. Processors with
+   SSE 4.2 have an instruction that computes this CRC, which is used where
+   it's there. Elsewhere, the CRC is computed 8 bytes at a time with 
+   tables, the method known as slicing-by-8.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+
+#include "gentype.h"
+
+/* Checksum of no data, to start from. */
+#define CRC32C_INITIAL 0
+/* The polynomial, with its bits reversed. */
+#define CRC32C_POLYNOMIAL 0x82F63B78u
+
+/* Returns the checksum of the data that came before, whose checksum is 
+   given, followed by the given data. The tables are made, and the 
+   processor is looked at, on the first call, so the first call must not be
+   made by two threads at once. */
+unsigned int Crc32cUpdate( unsigned int checksum, const void *data, 
+   size_t size );
+
+#endif
@@ -22,6 +22,14 @@
 
 */
 
+#include <stdlib.h>
+#include <string.h>
+
+#if ! ( defined _WIN32 || defined _WIN64 )
+   #include <fcntl.h>
+   #include <unistd.h>
+#endif
+
 #include "fileutil.h"
 
 const char *FileBasename( const char *filePath ) {
@@ -37,3 +45,48 @@ const char *FileBasename( const char *filePath ) {
 
    return basename;
 }
+
+#if ! ( defined _WIN32 || defined _WIN64 )
+
+Bool FileLink( const char *filePath, const char *linkPath ) {
+   return ( link( filePath, linkPath ) == 0 );
+}
+
+void FileSyncDirectory( const char *filePath ) {
+   const char *basename = FileBasename( filePath );
+   const size_t directoryLength = ( size_t ) ( basename - filePath );
+   char *directory;
+   int directoryHandle;
+
+   /* A path without a directory is in the current directory. */
+   if ( directoryLength == 0 ) {
+      directoryHandle = open( ".", O_RDONLY );
+   }
+   else {
+      directory = ( char * ) malloc( directoryLength + 1 );
+      if ( directory == NULL ) {
+         return;
+      }
+
+      memcpy( directory, filePath, directoryLength );
+      directory[ directoryLength ] = '\0';
+      directoryHandle = open( directory, O_RDONLY );
+      free( ( void * ) directory );
+   }
+
+   if ( directoryHandle >= 0 ) {
+      fsync( directoryHandle );
+      close( directoryHandle );
+   }
+}
+
+#else
+
+Bool FileLink( const char *filePath, const char *linkPath ) {
+   return FALSE;
+}
+
+void FileSyncDirectory( const char *filePath ) {
+}
+
+#endif
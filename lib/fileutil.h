@@ -29,6 +29,8 @@
 #ifndef FILEUTIL_H
 #define FILEUTIL_H
 
+#include "gentype.h"
+
 #ifdef _WIN32
    #define FILE_PATH_SEPARATOR '\\'
 #else
@@ -37,5 +39,12 @@
 
 /* Function to fine the basename of a file path. */
 const char *FileBasename( const char *filePath );
+/* Gives a file a second name, without copying its data. Returns false if 
+   the link can't be made, or if the system has no links. */
+Bool FileLink( const char *filePath, const char *linkPath );
+/* Makes sure that files created, renamed or removed in the directory of the
+   given file stay that way after a crash. Where the system gives no such
+   control, this does nothing. */
+void FileSyncDirectory( const char *filePath );
 
 #endif
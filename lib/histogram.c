@@ -0,0 +1,171 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <string.h>
+
+#include "histogram.h"
+
+/* Private prototypes: */
+static unsigned int HistogramFindBucket( unsigned long value );
+static unsigned long HistogramGetBucketTop( unsigned int bucket );
+
+void HistogramInit( Histogram *histogram ) {
+   memset( histogram->counts, 0, sizeof( histogram->counts ) );
+   histogram->totalCount = 0;
+   histogram->minValue = 0;
+   histogram->maxValue = 0;
+   histogram->totalValue = 0;
+}
+
+unsigned int HistogramFindBucket( unsigned long value ) {
+   unsigned int shift = 0;
+
+   while ( ( value >> shift ) >= HISTOGRAM_SUB_BUCKETS ) {
+      shift += 1;
+   }
+
+   if ( shift == 0 ) {
+      return ( unsigned int ) value;
+   }
+   else if ( shift > HISTOGRAM_TOTAL_SHIFTS ) {
+      return HISTOGRAM_TOTAL_BUCKETS - 1;
+   }
+
+   /* The value shifted down lands in the upper half of the first buckets,
+      as the lower half is already covered by the doubling below. */
+   return HISTOGRAM_SUB_BUCKETS + ( shift - 1 ) * HISTOGRAM_HALF_BUCKETS +
+      ( unsigned int ) ( value >> shift ) - HISTOGRAM_HALF_BUCKETS;
+}
+
+unsigned long HistogramGetBucketTop( unsigned int bucket ) {
+   unsigned int shift;
+   unsigned long subBucket;
+
+   if ( bucket < HISTOGRAM_SUB_BUCKETS ) {
+      return bucket;
+   }
+
+   shift = ( bucket - HISTOGRAM_SUB_BUCKETS ) / HISTOGRAM_HALF_BUCKETS + 1;
+   subBucket = ( bucket - HISTOGRAM_SUB_BUCKETS ) % HISTOGRAM_HALF_BUCKETS +
+      HISTOGRAM_HALF_BUCKETS;
+
+   return ( ( subBucket + 1 ) << shift ) - 1;
+}
+
+void HistogramAdd( Histogram *histogram, unsigned long value ) {
+   histogram->counts[ HistogramFindBucket( value ) ] += 1;
+
+   if ( histogram->totalCount == 0 || value < histogram->minValue ) {
+      histogram->minValue = value;
+   }
+
+   if ( value > histogram->maxValue ) {
+      histogram->maxValue = value;
+   }
+
+   histogram->totalCount += 1;
+   histogram->totalValue += value;
+}
+
+void HistogramMerge( Histogram *histogram, const Histogram *other ) {
+   unsigned int bucket;
+
+   if ( other->totalCount == 0 ) {
+      return;
+   }
+
+   for ( bucket = 0; bucket < HISTOGRAM_TOTAL_BUCKETS; bucket += 1 ) {
+      histogram->counts[ bucket ] += other->counts[ bucket ];
+   }
+
+   if ( histogram->totalCount == 0 || other->minValue < histogram->minValue ) {
+      histogram->minValue = other->minValue;
+   }
+
+   if ( other->maxValue > histogram->maxValue ) {
+      histogram->maxValue = other->maxValue;
+   }
+
+   histogram->totalCount += other->totalCount;
+   histogram->totalValue += other->totalValue;
+}
+
+unsigned long HistogramGetPercentile( const Histogram *histogram, 
+   double percent ) {
+   unsigned long wantedCount;
+   unsigned long countSoFar = 0;
+   unsigned int bucket;
+
+   if ( histogram->totalCount == 0 ) {
+      return 0;
+   }
+
+   /* The number of values that need to be at or below the percentile,
+      rounded up, and at least one. */
+   wantedCount = ( unsigned long ) ( percent / 100 * histogram->totalCount );
+   if ( wantedCount < percent / 100 * histogram->totalCount ) {
+      wantedCount += 1;
+   }
+
+   if ( wantedCount == 0 ) {
+      wantedCount = 1;
+   }
+
+   for ( bucket = 0; bucket < HISTOGRAM_TOTAL_BUCKETS; bucket += 1 ) {
+      countSoFar += histogram->counts[ bucket ];
+      if ( countSoFar >= wantedCount ) {
+         break;
+      }
+   }
+
+   /* The top of a bucket can be past the largest value in it, and the last
+      bucket has no top. */
+   if ( bucket >= HISTOGRAM_TOTAL_BUCKETS - 1 || 
+      HistogramGetBucketTop( bucket ) > histogram->maxValue ) {
+      return histogram->maxValue;
+   }
+
+   return HistogramGetBucketTop( bucket );
+}
+
+unsigned long HistogramGetCount( const Histogram *histogram ) {
+   return histogram->totalCount;
+}
+
+unsigned long HistogramGetMin( const Histogram *histogram ) {
+   return histogram->minValue;
+}
+
+unsigned long HistogramGetMax( const Histogram *histogram ) {
+   return histogram->maxValue;
+}
+
+double HistogramGetMean( const Histogram *histogram ) {
+   if ( histogram->totalCount == 0 ) {
+      return 0;
+   }
+
+   return histogram->totalValue / histogram->totalCount;
+}
@@ -0,0 +1,73 @@
+/*
+
+   A latency histogram in the style of HdrHistogram. Values up to a small
+   limit each get a bucket of their own. Above that, every doubling of the
+   value range is split into the same number of buckets, so a value is 
+   always counted with the same relative precision, no matter how large it
+   is. Adding a value takes constant time and never allocates memory, and
+   percentiles are found with one pass over the buckets.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "gentype.h"
+
+/* With 32 buckets per doubling, a value is counted to within about 3% of
+   what it was. */
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_SUB_BUCKETS ( 1 << HISTOGRAM_SUB_BITS )
+#define HISTOGRAM_HALF_BUCKETS ( HISTOGRAM_SUB_BUCKETS / 2 )
+/* Number of doublings above the first buckets. Larger values are counted 
+   in the last bucket, which with microseconds is a day and a half. */
+#define HISTOGRAM_TOTAL_SHIFTS 32
+#define HISTOGRAM_TOTAL_BUCKETS \
+   ( HISTOGRAM_SUB_BUCKETS + HISTOGRAM_TOTAL_SHIFTS * HISTOGRAM_HALF_BUCKETS )
+
+typedef struct {
+   unsigned long counts[ HISTOGRAM_TOTAL_BUCKETS ];
+   unsigned long totalCount;
+   unsigned long minValue;
+   unsigned long maxValue;
+   /* Sum of the values, for the mean. */
+   double totalValue;
+} Histogram;
+
+void HistogramInit( Histogram *histogram );
+void HistogramAdd( Histogram *histogram, unsigned long value );
+/* Adds the values counted in another histogram. */
+void HistogramMerge( Histogram *histogram, const Histogram *other );
+/* Returns the value that the given percent of the values are at or below,
+   like 99.9 for the 99.9th percentile. The value is the highest one that
+   is counted in the same bucket. Returns 0 when the histogram is empty. */
+unsigned long HistogramGetPercentile( const Histogram *histogram, 
+   double percent );
+unsigned long HistogramGetCount( const Histogram *histogram );
+unsigned long HistogramGetMin( const Histogram *histogram );
+unsigned long HistogramGetMax( const Histogram *histogram );
+double HistogramGetMean( const Histogram *histogram );
+
+#endif
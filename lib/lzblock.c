@@ -0,0 +1,256 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "lzblock.h"
+
+/* Private prototypes: */
+static unsigned int LzRead32( const Byte *data );
+static unsigned int LzHash( unsigned int sequence );
+static Bool LzWriteLength( Byte *output, size_t outputCapacity, 
+   size_t *outputPos, size_t length );
+static Bool LzWriteSequence( Byte *output, size_t outputCapacity, 
+   size_t *outputPos, const Byte *literals, size_t literalLength,
+   size_t offset, size_t matchLength );
+static Bool LzReadLength( const Byte *input, size_t inputSize, 
+   size_t *inputPos, size_t *length );
+
+unsigned int LzRead32( const Byte *data ) {
+   unsigned int value;
+   memcpy( &value, data, sizeof( value ) );
+   return value;
+}
+
+unsigned int LzHash( unsigned int sequence ) {
+   return ( sequence * 2654435761u ) >> ( 32 - LZ_HASH_BITS );
+}
+
+size_t LzBlockBound( size_t size ) {
+   /* Data that doesn't compress at all takes one more byte for every 255
+      literals, plus the token of the sequence. */
+   return size + size / 255 + 16;
+}
+
+size_t LzBlockCompress( const Byte *input, size_t inputSize, Byte *output,
+   size_t outputCapacity ) {
+   /* Position of the last time each hash was seen. */
+   size_t table[ 1 << LZ_HASH_BITS ];
+   size_t outputPos = 0;
+   size_t anchor = 0;
+   size_t inputPos = 0;
+
+   memset( table, 0, sizeof( table ) );
+
+   if ( inputSize > LZ_MATCH_LIMIT ) {
+      const size_t matchStartLimit = inputSize - LZ_MATCH_LIMIT;
+      const size_t matchEndLimit = inputSize - LZ_LAST_LITERALS;
+
+      while ( inputPos < matchStartLimit ) {
+         const unsigned int sequence = LzRead32( input + inputPos );
+         const unsigned int hash = LzHash( sequence );
+         const size_t candidate = table[ hash ];
+
+         table[ hash ] = inputPos;
+
+         if ( candidate < inputPos && 
+            inputPos - candidate <= LZ_MAX_OFFSET &&
+            LzRead32( input + candidate ) == sequence ) {
+            size_t matchLength = LZ_MIN_MATCH;
+
+            while ( inputPos + matchLength < matchEndLimit &&
+               input[ candidate + matchLength ] == 
+                  input[ inputPos + matchLength ] ) {
+               matchLength += 1;
+            }
+
+            if ( ! LzWriteSequence( output, outputCapacity, &outputPos,
+               input + anchor, inputPos - anchor, inputPos - candidate,
+               matchLength ) ) {
+               return 0;
+            }
+
+            inputPos += matchLength;
+            anchor = inputPos;
+         }
+         else {
+            inputPos += 1;
+         }
+      }
+   }
+
+   /* The rest of the block goes into the last sequence, which has no
+      match. */
+   if ( ! LzWriteSequence( output, outputCapacity, &outputPos, 
+      input + anchor, inputSize - anchor, 0, 0 ) ) {
+      return 0;
+   }
+
+   return outputPos;
+}
+
+/* Lengths that don't fit in their half of the token carry on in bytes of
+   their own. Each 255 byte means there's another byte. */
+Bool LzWriteLength( Byte *output, size_t outputCapacity, size_t *outputPos,
+   size_t length ) {
+   while ( length >= 255 ) {
+      if ( *outputPos >= outputCapacity ) {
+         return FALSE;
+      }
+
+      output[ ( *outputPos )++ ] = 255;
+      length -= 255;
+   }
+
+   if ( *outputPos >= outputCapacity ) {
+      return FALSE;
+   }
+
+   output[ ( *outputPos )++ ] = ( Byte ) length;
+   return TRUE;
+}
+
+/* A match length of 0 makes the last sequence, which only has 
+   literals. */
+Bool LzWriteSequence( Byte *output, size_t outputCapacity, 
+   size_t *outputPos, const Byte *literals, size_t literalLength,
+   size_t offset, size_t matchLength ) {
+   const size_t matchCode = ( matchLength > 0 ) ? 
+      matchLength - LZ_MIN_MATCH : 0;
+   Byte token = 0;
+
+   token |= ( Byte ) ( ( literalLength < 15 ? literalLength : 15 ) << 4 );
+   token |= ( Byte ) ( matchCode < 15 ? matchCode : 15 );
+
+   if ( *outputPos >= outputCapacity ) {
+      return FALSE;
+   }
+   output[ ( *outputPos )++ ] = token;
+
+   if ( literalLength >= 15 && ! LzWriteLength( output, outputCapacity, 
+      outputPos, literalLength - 15 ) ) {
+      return FALSE;
+   }
+
+   if ( literalLength > outputCapacity - *outputPos ) {
+      return FALSE;
+   }
+   memcpy( output + *outputPos, literals, literalLength );
+   *outputPos += literalLength;
+
+   if ( matchLength == 0 ) {
+      return TRUE;
+   }
+
+   if ( outputCapacity - *outputPos < 2 ) {
+      return FALSE;
+   }
+   output[ ( *outputPos )++ ] = ( Byte ) ( offset & 0xFF );
+   output[ ( *outputPos )++ ] = ( Byte ) ( offset >> 8 );
+
+   if ( matchCode >= 15 && ! LzWriteLength( output, outputCapacity, 
+      outputPos, matchCode - 15 ) ) {
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+Bool LzBlockDecompress( const Byte *input, size_t inputSize, Byte *output,
+   size_t outputSize ) {
+   size_t inputPos = 0;
+   size_t outputPos = 0;
+
+   while ( inputPos < inputSize ) {
+      const Byte token = input[ inputPos++ ];
+      size_t literalLength = token >> 4;
+      size_t matchLength = token & 15;
+      size_t offset;
+
+      if ( literalLength == 15 && ! LzReadLength( input, inputSize, 
+         &inputPos, &literalLength ) ) {
+         return FALSE;
+      }
+
+      if ( literalLength > inputSize - inputPos || 
+         literalLength > outputSize - outputPos ) {
+         return FALSE;
+      }
+
+      memcpy( output + outputPos, input + inputPos, literalLength );
+      inputPos += literalLength;
+      outputPos += literalLength;
+
+      /* The last sequence ends the block. */
+      if ( inputPos == inputSize ) {
+         break;
+      }
+
+      if ( inputSize - inputPos < 2 ) {
+         return FALSE;
+      }
+      offset = input[ inputPos ] | ( input[ inputPos + 1 ] << 8 );
+      inputPos += 2;
+
+      if ( offset == 0 || offset > outputPos ) {
+         return FALSE;
+      }
+
+      if ( matchLength == 15 && ! LzReadLength( input, inputSize, 
+         &inputPos, &matchLength ) ) {
+         return FALSE;
+      }
+      matchLength += LZ_MIN_MATCH;
+
+      if ( matchLength > outputSize - outputPos ) {
+         return FALSE;
+      }
+
+      /* The match can overlap the bytes it writes, so it's copied one byte
+         at a time. */
+      while ( matchLength > 0 ) {
+         output[ outputPos ] = output[ outputPos - offset ];
+         outputPos += 1;
+         matchLength -= 1;
+      }
+   }
+
+   return ( outputPos == outputSize );
+}
+
+Bool LzReadLength( const Byte *input, size_t inputSize, size_t *inputPos,
+   size_t *length ) {
+   Byte lengthByte;
+
+   do {
+      if ( *inputPos >= inputSize ) {
+         return FALSE;
+      }
+
+      lengthByte = input[ ( *inputPos )++ ];
+      *length += lengthByte;
+   } while ( lengthByte == 255 );
+
+   return TRUE;
+}
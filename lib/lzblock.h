@@ -0,0 +1,66 @@
+/*
+
+   A fast block compressor of the LZ77 family, writing the LZ4 block format.
+   It's meant for data with a lot of repeated strings, like the keys of the
+   records in a database file. It trades some compression for speed: both
+   compressing and decompressing go through the data in a single pass.
+
+   A compressed block is a series of sequences. Each sequence has a number
+   of literal bytes, which are copied as they are, followed by a match, which
+   copies bytes that were already written. The last sequence has no match.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef LZBLOCK_H
+#define LZBLOCK_H
+
+#include <stdlib.h>
+
+#include "gentype.h"
+
+/* A match copies at least this many bytes. */
+#define LZ_MIN_MATCH 4
+/* Matches can copy from at most this many bytes back. */
+#define LZ_MAX_OFFSET 65535
+/* The last bytes of a block are always literals, and no match starts in 
+   the last few bytes, like the LZ4 format asks for. */
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_LIMIT 12
+/* Number of bits of the hash used to find matches. The hash table has an
+   entry for each hash value. */
+#define LZ_HASH_BITS 12
+
+/* Largest size of the compressed data of a block of the given size. */
+size_t LzBlockBound( size_t size );
+/* Compresses a block. Returns the size of the compressed data, or 0 if it
+   doesn't fit in the output buffer. */
+size_t LzBlockCompress( const Byte *input, size_t inputSize, Byte *output,
+   size_t outputCapacity );
+/* Decompresses a block. Returns false if the compressed data is malformed
+   or doesn't decompress to exactly the given size. */
+Bool LzBlockDecompress( const Byte *input, size_t inputSize, Byte *output,
+   size_t outputSize );
+
+#endif
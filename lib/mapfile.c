@@ -0,0 +1,127 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <stdio.h>
+
+#if ! ( defined _WIN32 || defined _WIN64 )
+   #include <fcntl.h>
+   #include <unistd.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+#endif
+
+#include "memfile.h"
+#include "mapfile.h"
+
+void MapFileInit( MapFile *file ) {
+   file->data = NULL;
+   file->size = 0;
+   file->isOpen = FALSE;
+   file->isMapped = FALSE;
+}
+
+#if ! ( defined _WIN32 || defined _WIN64 )
+
+int MapFileOpen( MapFile *file, const char *filePath ) {
+   struct stat fileInfo;
+   void *data;
+   int fileHandle;
+
+   MapFileInit( file );
+
+   fileHandle = open( filePath, O_RDONLY );
+   if ( fileHandle < 0 ) {
+      return MF_ERR_BAD_PATH;
+   }
+
+   if ( fstat( fileHandle, &fileInfo ) != 0 ) {
+      close( fileHandle );
+      return MF_ERR_FILE_READ;
+   }
+
+   /* Empty files can't be mapped, but there is nothing to read anyway. */
+   if ( fileInfo.st_size > 0 ) {
+      data = mmap( NULL, ( size_t ) fileInfo.st_size, PROT_READ, MAP_PRIVATE,
+         fileHandle, 0 );
+      if ( data == MAP_FAILED ) {
+         close( fileHandle );
+         return MF_ERR_FILE_READ;
+      }
+
+      file->data = ( const Byte * ) data;
+      file->size = ( size_t ) fileInfo.st_size;
+      file->isMapped = TRUE;
+   }
+
+   /* The mapping stays valid after the file is closed, and even after the
+      file is replaced on disk. */
+   close( fileHandle );
+
+   file->isOpen = TRUE;
+   return 0;
+}
+
+#else
+
+int MapFileOpen( MapFile *file, const char *filePath ) {
+   MemFile contents;
+   int bytesAdded;
+
+   MapFileInit( file );
+   MemFileInit( &contents );
+
+   bytesAdded = MemFileAddFile( &contents, filePath );
+   if ( bytesAdded < 0 ) {
+      MemFileClose( &contents );
+      return bytesAdded;
+   }
+
+   /* The memory file hands its data over to us. */
+   file->data = contents.data;
+   file->size = contents.size;
+   file->isOpen = TRUE;
+   return 0;
+}
+
+#endif
+
+Bool MapFileIsOpen( const MapFile *file ) {
+   return file->isOpen;
+}
+
+void MapFileClose( MapFile *file ) {
+   if ( ! file->isOpen ) {
+      return;
+   }
+
+#if ! ( defined _WIN32 || defined _WIN64 )
+   if ( file->isMapped ) {
+      munmap( ( void * ) file->data, file->size );
+   }
+#else
+   free( ( void * ) file->data );
+#endif
+
+   MapFileInit( file );
+}
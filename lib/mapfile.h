@@ -0,0 +1,55 @@
+/*
+
+   A read-only view of a whole file. Where the system supports it, the file
+   is mapped into memory, so only the parts that are actually read get
+   loaded, and only when they are read. Elsewhere, the file is read into
+   memory in full.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stdlib.h>
+
+#include "gentype.h"
+
+typedef struct {
+   const Byte *data;
+   size_t size;
+   Bool isOpen;
+   /* Whether the data is mapped or was read into memory. */
+   Bool isMapped;
+} MapFile;
+
+void MapFileInit( MapFile *file );
+/* Opens the file at the given path. Returns one of the MF_ERR_* error codes
+   of the memory files on failure, otherwise 0. The size of the file, which
+   may not fit in an int, is left in the size field. */
+int MapFileOpen( MapFile *file, const char *filePath );
+Bool MapFileIsOpen( const MapFile *file );
+void MapFileClose( MapFile *file );
+
+#endif
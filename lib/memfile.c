@@ -34,6 +34,13 @@ void MemFileInit( MemFile *memFile ) {
    memFile->pos = 0;
 }
 
+void MemFileInitView( MemFile *memFile, const void *data, size_t size ) {
+   memFile->data = ( Byte * ) data;
+   memFile->memoryAllocated = 0;
+   memFile->size = size;
+   memFile->pos = 0;
+}
+
 int MemFileAdd( MemFile *memFile, const void *data, size_t numberOfBytes ) {
    /* If adding the new data will go over the currently allocated memory, we 
       need to reallocate before proceeding. */
@@ -144,7 +151,7 @@ int MemFileSetPosition( MemFile *memFile, size_t newPosition ) {
       including the data size. */
    if ( newPosition <= memFile->size ) {
       memFile->pos = newPosition;
-      return newPosition;
+      return 0;
    }
    else {
       return MF_ERR_INVALID_POSITION;
@@ -163,6 +170,15 @@ void MemFileRewind( MemFile *memFile ) {
    MemFileSetPosition( memFile, 0 );
 }
 
+void MemFileTruncate( MemFile *memFile, size_t newSize ) {
+   if ( newSize < memFile->size ) {
+      memFile->size = newSize;
+      if ( memFile->pos > newSize ) {
+         memFile->pos = newSize;
+      }
+   }
+}
+
 const char *MemFileGetErrorCodeMessage( int errorCode ) {
    switch ( errorCode ) {
       case MF_ERR_BAD_PATH: return "Invalid path given";
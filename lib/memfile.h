@@ -59,6 +59,10 @@ typedef struct {
 } MemFile;
 
 void MemFileInit( MemFile *memFile );
+/* Sets up a memory file for reading data that it doesn't own, such as a
+   mapped file. Nothing may be added to such a memory file, and it must not
+   be closed. */
+void MemFileInitView( MemFile *memFile, const void *data, size_t size );
 int MemFileAdd( MemFile *memFile, const void *data, size_t numberOfBytes );
 int MemFileAddFile( MemFile *memFile, const char *filePath );
 int MemFileAddMemFile( MemFile *memFile, const MemFile *otherMemFile );
@@ -68,6 +72,9 @@ int MemFileSetPosition( MemFile *memFile, size_t newPosition );
 size_t MemFileGetPosition( const MemFile *memFile );
 size_t MemFileGetSize( const MemFile *memFile );
 void MemFileRewind( MemFile *memFile );
+/* Drops the data past the given size. The position moves back to the new
+   end of the data if it was past it. */
+void MemFileTruncate( MemFile *memFile, size_t newSize );
 const char *MemFileGetErrorCodeMessage( int errorCode );
 void MemFilePrint( const MemFile *memFile, Bool printData );
 void MemFileClose( MemFile *memFile );
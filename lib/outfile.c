@@ -0,0 +1,308 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Lets files grow past 2 GB on 32-bit systems too. */
+#define _FILE_OFFSET_BITS 64
+
+#include <errno.h>
+#include <string.h>
+
+#if ! ( defined _WIN32 || defined _WIN64 )
+   #include <fcntl.h>
+   #include <unistd.h>
+   #include <sys/types.h>
+   #include <sys/uio.h>
+#else
+   #include <io.h>
+#endif
+
+#include "crc32c.h"
+#include "outfile.h"
+
+/* Private prototypes: */
+static int OutFileWrite( OutFile *file, const void *data, 
+   size_t numberOfBytes );
+static int OutFileWriteBytesAt( OutFile *file, size_t position, 
+   const void *data, size_t numberOfBytes );
+static void OutFileCloseHandle( OutFile *file );
+
+#if ! ( defined _WIN32 || defined _WIN64 )
+
+int OutFileOpen( OutFile *file, const char *filePath ) {
+   file->buffered = 0;
+   file->size = 0;
+   file->error = 0;
+   file->checksum = CRC32C_INITIAL;
+   file->buffer = ( Byte * ) malloc( OF_BUFFER_SIZE );
+   if ( file->buffer == NULL ) {
+      file->handle = -1;
+      file->error = MF_ERR_OUT_OF_MEMORY;
+      return file->error;
+   }
+
+   file->handle = open( filePath, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+   if ( file->handle < 0 ) {
+      free( ( void * ) file->buffer );
+      file->buffer = NULL;
+      file->error = MF_ERR_BAD_PATH;
+      return file->error;
+   }
+
+   return 0;
+}
+
+/* Writes out the buffer, followed by the given bytes. */
+int OutFileWrite( OutFile *file, const void *data, size_t numberOfBytes ) {
+   struct iovec pieces[ 2 ];
+   int firstPiece = 0;
+   int totalPieces = 0;
+
+   if ( file->buffered > 0 ) {
+      pieces[ totalPieces ].iov_base = file->buffer;
+      pieces[ totalPieces ].iov_len = file->buffered;
+      totalPieces += 1;
+   }
+
+   if ( numberOfBytes > 0 ) {
+      pieces[ totalPieces ].iov_base = ( void * ) data;
+      pieces[ totalPieces ].iov_len = numberOfBytes;
+      totalPieces += 1;
+   }
+
+   while ( firstPiece < totalPieces ) {
+      ssize_t bytesWritten = writev( file->handle, pieces + firstPiece,
+         totalPieces - firstPiece );
+
+      if ( bytesWritten < 0 ) {
+         if ( errno == EINTR ) {
+            continue;
+         }
+
+         return MF_ERR_FILE_WRITE;
+      }
+
+      /* Pick up where a short write left off. */
+      while ( firstPiece < totalPieces && 
+         ( size_t ) bytesWritten >= pieces[ firstPiece ].iov_len ) {
+         bytesWritten -= pieces[ firstPiece ].iov_len;
+         firstPiece += 1;
+      }
+
+      if ( firstPiece < totalPieces ) {
+         pieces[ firstPiece ].iov_base = 
+            ( Byte * ) pieces[ firstPiece ].iov_base + bytesWritten;
+         pieces[ firstPiece ].iov_len -= bytesWritten;
+      }
+   }
+
+   file->buffered = 0;
+   return 0;
+}
+
+int OutFileWriteBytesAt( OutFile *file, size_t position, const void *data,
+   size_t numberOfBytes ) {
+   const Byte *bytes = ( const Byte * ) data;
+
+   while ( numberOfBytes > 0 ) {
+      const ssize_t bytesWritten = pwrite( file->handle, bytes, 
+         numberOfBytes, ( off_t ) position );
+
+      if ( bytesWritten < 0 ) {
+         if ( errno == EINTR ) {
+            continue;
+         }
+
+         return MF_ERR_FILE_WRITE;
+      }
+
+      bytes += bytesWritten;
+      position += bytesWritten;
+      numberOfBytes -= bytesWritten;
+   }
+
+   return 0;
+}
+
+void OutFileCloseHandle( OutFile *file ) {
+   if ( file->handle >= 0 && close( file->handle ) != 0 && 
+      file->error == 0 ) {
+      file->error = MF_ERR_FILE_WRITE;
+   }
+
+   file->handle = -1;
+}
+
+void OutFileSync( OutFile *file ) {
+   if ( file->error == 0 ) {
+      file->error = OutFileWrite( file, NULL, 0 );
+   }
+
+   if ( file->error == 0 && fsync( file->handle ) != 0 ) {
+      file->error = MF_ERR_FILE_WRITE;
+   }
+}
+
+#else
+
+int OutFileOpen( OutFile *file, const char *filePath ) {
+   file->buffered = 0;
+   file->size = 0;
+   file->error = 0;
+   file->checksum = CRC32C_INITIAL;
+   file->buffer = ( Byte * ) malloc( OF_BUFFER_SIZE );
+   if ( file->buffer == NULL ) {
+      file->handle = NULL;
+      file->error = MF_ERR_OUT_OF_MEMORY;
+      return file->error;
+   }
+
+   file->handle = fopen( filePath, "wb" );
+   if ( file->handle == NULL ) {
+      free( ( void * ) file->buffer );
+      file->buffer = NULL;
+      file->error = MF_ERR_BAD_PATH;
+      return file->error;
+   }
+
+   return 0;
+}
+
+int OutFileWrite( OutFile *file, const void *data, size_t numberOfBytes ) {
+   if ( fwrite( file->buffer, 1, file->buffered, file->handle ) != 
+      file->buffered ||
+      fwrite( data, 1, numberOfBytes, file->handle ) != numberOfBytes ) {
+      return MF_ERR_FILE_WRITE;
+   }
+
+   file->buffered = 0;
+   return 0;
+}
+
+int OutFileWriteBytesAt( OutFile *file, size_t position, const void *data,
+   size_t numberOfBytes ) {
+   if ( _fseeki64( file->handle, ( __int64 ) position, SEEK_SET ) != 0 ||
+      fwrite( data, 1, numberOfBytes, file->handle ) != numberOfBytes ||
+      fseek( file->handle, 0, SEEK_END ) != 0 ) {
+      return MF_ERR_FILE_WRITE;
+   }
+
+   return 0;
+}
+
+void OutFileSync( OutFile *file ) {
+   if ( file->error == 0 ) {
+      file->error = OutFileWrite( file, NULL, 0 );
+   }
+
+   if ( file->error == 0 && ( fflush( file->handle ) != 0 || 
+      _commit( _fileno( file->handle ) ) != 0 ) ) {
+      file->error = MF_ERR_FILE_WRITE;
+   }
+}
+
+void OutFileCloseHandle( OutFile *file ) {
+   if ( file->handle != NULL && fclose( file->handle ) != 0 && 
+      file->error == 0 ) {
+      file->error = MF_ERR_FILE_WRITE;
+   }
+
+   file->handle = NULL;
+}
+
+#endif
+
+void OutFileAdd( OutFile *file, const void *data, size_t numberOfBytes ) {
+   if ( file->error != 0 ) {
+      return;
+   }
+
+   /* Small pieces are gathered in the buffer. A piece that doesn't fit 
+      goes out straight away, along with what is in the buffer. */
+   if ( file->buffered + numberOfBytes <= OF_BUFFER_SIZE ) {
+      memcpy( file->buffer + file->buffered, data, numberOfBytes );
+      file->buffered += numberOfBytes;
+   }
+   else {
+      file->error = OutFileWrite( file, data, numberOfBytes );
+   }
+
+   file->size += numberOfBytes;
+   file->checksum = Crc32cUpdate( file->checksum, data, numberOfBytes );
+}
+
+void OutFileAddMemFile( OutFile *file, const MemFile *memFile ) {
+   OutFileAdd( file, memFile->data, MemFileGetSize( memFile ) );
+}
+
+void OutFileWriteAt( OutFile *file, size_t position, const void *data,
+   size_t numberOfBytes ) {
+   const size_t bufferStart = file->size - file->buffered;
+
+   if ( file->error != 0 ) {
+      return;
+   }
+
+   if ( position + numberOfBytes > file->size ) {
+      file->error = MF_ERR_INVALID_POSITION;
+      return;
+   }
+
+   /* Bytes that haven't been written yet are changed in the buffer. */
+   if ( position >= bufferStart ) {
+      memcpy( file->buffer + ( position - bufferStart ), data, 
+         numberOfBytes );
+   }
+   else {
+      file->error = OutFileWrite( file, NULL, 0 );
+      if ( file->error == 0 ) {
+         file->error = OutFileWriteBytesAt( file, position, data, 
+            numberOfBytes );
+      }
+   }
+}
+
+size_t OutFileGetPosition( const OutFile *file ) {
+   return file->size;
+}
+
+void OutFileResetChecksum( OutFile *file ) {
+   file->checksum = CRC32C_INITIAL;
+}
+
+unsigned int OutFileGetChecksum( const OutFile *file ) {
+   return file->checksum;
+}
+
+int OutFileClose( OutFile *file ) {
+   if ( file->error == 0 && file->buffered > 0 ) {
+      file->error = OutFileWrite( file, NULL, 0 );
+   }
+
+   OutFileCloseHandle( file );
+   free( ( void * ) file->buffer );
+   file->buffer = NULL;
+   file->buffered = 0;
+
+   return file->error;
+}
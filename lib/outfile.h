@@ -0,0 +1,89 @@
+/*
+
+   A file that is written from start to end through a buffer, so a large
+   file can be put together piece by piece without ever being held in memory
+   as a whole. Bytes that were already added can still be overwritten, which
+   is how a header gets filled in once the rest of the file is known.
+
+   Where the system supports it, a piece that doesn't fit into the buffer is
+   written out together with the buffer in a single gathering write, without
+   being copied into the buffer first, and overwriting is done with
+   positioned writes. Elsewhere, the standard I/O functions are used.
+
+   Once a write fails, the file ignores everything that is added to it, and
+   the error is reported when the file is closed, so the caller doesn't need
+   to check every addition.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef OUTFILE_H
+#define OUTFILE_H
+
+#include <stdio.h>
+
+#include "gentype.h"
+#include "memfile.h"
+
+#define OF_BUFFER_SIZE 65536
+
+typedef struct {
+#if ! ( defined _WIN32 || defined _WIN64 )
+   int handle;
+#else
+   FILE *handle;
+#endif
+   Byte *buffer;
+   /* Number of bytes in the buffer that are yet to be written. */
+   size_t buffered;
+   /* Size of the file, counting the bytes still in the buffer. */
+   size_t size;
+   /* First error encountered, using the memory file error codes, or 0. */
+   int error;
+   /* CRC-32C of the bytes added since the checksum was last reset. */
+   unsigned int checksum;
+} OutFile;
+
+/* Creates the file, or empties it if it already exists. Returns 0 on 
+   success or an error code. A file that couldn't be opened doesn't need to
+   be closed. */
+int OutFileOpen( OutFile *file, const char *filePath );
+void OutFileAdd( OutFile *file, const void *data, size_t numberOfBytes );
+void OutFileAddMemFile( OutFile *file, const MemFile *memFile );
+/* Overwrites bytes that were already added to the file. */
+void OutFileWriteAt( OutFile *file, size_t position, const void *data,
+   size_t numberOfBytes );
+size_t OutFileGetPosition( const OutFile *file );
+/* The checksum covers the bytes added to the file, not the ones that are
+   overwritten. */
+void OutFileResetChecksum( OutFile *file );
+unsigned int OutFileGetChecksum( const OutFile *file );
+/* Writes out what is left in the buffer and waits until everything written
+   so far is on the disk. */
+void OutFileSync( OutFile *file );
+/* Writes out what is left in the buffer and closes the file. Returns 0 if 
+   the whole file was written, or the code of the first error otherwise. */
+int OutFileClose( OutFile *file );
+
+#endif
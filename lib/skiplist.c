@@ -0,0 +1,318 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <stdlib.h>
+
+#include "skiplist.h"
+
+/* Private prototypes: */
+static SkipListNode *SkipListCreateNode( int level, const void *key,
+   void *value );
+static int SkipListRandomLevel( SkipList *list );
+static SkipListNode *SkipListSearch( const SkipList *list, const void *key,
+   Bool inclusive );
+static int SkipListCompareStr( const void *first, const void *second );
+
+SkipListNode *SkipListCreateNode( int level, const void *key, void *value ) {
+   /* The node struct already has room for one link. */
+   const size_t nodeSize = sizeof( SkipListNode ) +
+      ( level - 1 ) * sizeof( SkipListLink );
+   SkipListNode *node = ( SkipListNode * ) malloc( nodeSize );
+
+   if ( node != NULL ) {
+      int link;
+
+      node->key = key;
+      node->value = value;
+      node->level = level;
+
+      for ( link = 0; link < level; link += 1 ) {
+         node->links[ link ].next = NULL;
+         node->links[ link ].span = 0;
+      }
+   }
+
+   return node;
+}
+
+int SkipListCompareStr( const void *first, const void *second ) {
+   return StrCompare( ( const Str * ) first, ( const Str * ) second );
+}
+
+void SkipListInit( SkipList *list ) {
+   SkipListInitWithCompare( list, SkipListCompareStr );
+}
+
+void SkipListInitWithCompare( SkipList *list, SkipListCompare compare ) {
+   list->head = SkipListCreateNode( SL_MAX_LEVEL, NULL, NULL );
+   list->compare = compare;
+   list->level = 1;
+   list->size = 0;
+   list->seed = 2463534242u;
+}
+
+int SkipListRandomLevel( SkipList *list ) {
+   int level = 1;
+
+   /* Use our own xorshift generator so we don't disturb the state of
+      rand() for anyone else. */
+   list->seed ^= list->seed << 13;
+   list->seed ^= list->seed >> 17;
+   list->seed ^= list->seed << 5;
+
+   /* Each pair of bits gives a 1/4 chance of going up one level. */
+   while ( level < SL_MAX_LEVEL &&
+      ( ( list->seed >> ( level * 2 ) ) & 3 ) == 0 ) {
+      level += 1;
+   }
+
+   return level;
+}
+
+Bool SkipListInsert( SkipList *list, const void *key, void *value ) {
+   SkipListNode *update[ SL_MAX_LEVEL ];
+   /* Position of the update node on each level. */
+   unsigned int position[ SL_MAX_LEVEL ];
+   SkipListNode *node = list->head;
+   SkipListNode *newNode;
+   int level;
+
+   /* Find the last node before the key on each level. */
+   for ( level = list->level - 1; level >= 0; level -= 1 ) {
+      position[ level ] = 
+         ( level == list->level - 1 ) ? 0 : position[ level + 1 ];
+
+      while ( node->links[ level ].next != NULL &&
+         list->compare( node->links[ level ].next->key, key ) < 0 ) {
+         position[ level ] += node->links[ level ].span;
+         node = node->links[ level ].next;
+      }
+
+      update[ level ] = node;
+   }
+
+   /* Replace the value of an existing key. */
+   node = node->links[ 0 ].next;
+   if ( node != NULL && list->compare( node->key, key ) == 0 ) {
+      node->key = key;
+      node->value = value;
+      return TRUE;
+   }
+
+   newNode = SkipListCreateNode( SkipListRandomLevel( list ), key, value );
+   if ( newNode == NULL ) {
+      return FALSE;
+   }
+
+   /* Levels that were not in use yet start from the head, which skips over
+      the whole list on those levels. */
+   while ( list->level < newNode->level ) {
+      update[ list->level ] = list->head;
+      position[ list->level ] = 0;
+      list->head->links[ list->level ].span = list->size;
+      list->level += 1;
+   }
+
+   for ( level = 0; level < newNode->level; level += 1 ) {
+      SkipListLink *link = &update[ level ]->links[ level ];
+      /* Number of nodes between the update node and the new node. */
+      const unsigned int distance = position[ 0 ] - position[ level ];
+
+      newNode->links[ level ].next = link->next;
+      newNode->links[ level ].span = link->span - distance;
+      link->next = newNode;
+      link->span = distance + 1;
+   }
+
+   /* The links above the new node now skip over one more node. */
+   for ( level = newNode->level; level < list->level; level += 1 ) {
+      update[ level ]->links[ level ].span += 1;
+   }
+
+   list->size += 1;
+   return TRUE;
+}
+
+void *SkipListRemove( SkipList *list, const void *key ) {
+   SkipListNode *update[ SL_MAX_LEVEL ];
+   SkipListNode *node = list->head;
+   void *value;
+   int level;
+
+   for ( level = list->level - 1; level >= 0; level -= 1 ) {
+      while ( node->links[ level ].next != NULL &&
+         list->compare( node->links[ level ].next->key, key ) < 0 ) {
+         node = node->links[ level ].next;
+      }
+
+      update[ level ] = node;
+   }
+
+   node = node->links[ 0 ].next;
+   if ( node == NULL || list->compare( node->key, key ) != 0 ) {
+      return NULL;
+   }
+
+   for ( level = 0; level < list->level; level += 1 ) {
+      SkipListLink *link = &update[ level ]->links[ level ];
+
+      if ( link->next == node ) {
+         link->span += node->links[ level ].span - 1;
+         link->next = node->links[ level ].next;
+      }
+      else {
+         link->span -= 1;
+      }
+   }
+
+   /* Drop the levels that no longer have any nodes. */
+   while ( list->level > 1 &&
+      list->head->links[ list->level - 1 ].next == NULL ) {
+      list->level -= 1;
+   }
+
+   value = node->value;
+   free( ( void * ) node );
+   list->size -= 1;
+
+   return value;
+}
+
+SkipListNode *SkipListSearch( const SkipList *list, const void *key,
+   Bool inclusive ) {
+   SkipListNode *node = list->head;
+   int level;
+
+   for ( level = list->level - 1; level >= 0; level -= 1 ) {
+      while ( node->links[ level ].next != NULL ) {
+         const int result = 
+            list->compare( node->links[ level ].next->key, key );
+         if ( result < 0 || ( result == 0 && ! inclusive ) ) {
+            node = node->links[ level ].next;
+         }
+         else {
+            break;
+         }
+      }
+   }
+
+   return node->links[ 0 ].next;
+}
+
+SkipListNode *SkipListFind( const SkipList *list, const void *key ) {
+   SkipListNode *node = SkipListSearch( list, key, TRUE );
+
+   if ( node != NULL && list->compare( node->key, key ) == 0 ) {
+      return node;
+   }
+   else {
+      return NULL;
+   }
+}
+
+SkipListNode *SkipListLowerBound( const SkipList *list, const void *key ) {
+   return SkipListSearch( list, key, TRUE );
+}
+
+SkipListNode *SkipListUpperBound( const SkipList *list, const void *key ) {
+   return SkipListSearch( list, key, FALSE );
+}
+
+unsigned int SkipListGetRank( const SkipList *list, const void *key ) {
+   SkipListNode *node = list->head;
+   unsigned int rank = 0;
+   int level;
+
+   for ( level = list->level - 1; level >= 0; level -= 1 ) {
+      while ( node->links[ level ].next != NULL &&
+         list->compare( node->links[ level ].next->key, key ) <= 0 ) {
+         rank += node->links[ level ].span;
+         node = node->links[ level ].next;
+      }
+
+      /* We're done as soon as we land on the key itself. */
+      if ( node != list->head && list->compare( node->key, key ) == 0 ) {
+         return rank;
+      }
+   }
+
+   return 0;
+}
+
+SkipListNode *SkipListGetByRank( const SkipList *list, unsigned int rank ) {
+   SkipListNode *node = list->head;
+   unsigned int traversed = 0;
+   int level;
+
+   if ( rank == 0 || rank > list->size ) {
+      return NULL;
+   }
+
+   for ( level = list->level - 1; level >= 0; level -= 1 ) {
+      while ( node->links[ level ].next != NULL &&
+         traversed + node->links[ level ].span <= rank ) {
+         traversed += node->links[ level ].span;
+         node = node->links[ level ].next;
+      }
+
+      if ( traversed == rank ) {
+         return node;
+      }
+   }
+
+   return NULL;
+}
+
+SkipListNode *SkipListFirst( const SkipList *list ) {
+   return list->head->links[ 0 ].next;
+}
+
+SkipListNode *SkipListNext( const SkipListNode *node ) {
+   return node->links[ 0 ].next;
+}
+
+unsigned int SkipListGetSize( const SkipList *list ) {
+   return list->size;
+}
+
+void SkipListDestroy( SkipList *list ) {
+   SkipListNode *node;
+   SkipListNode *nextNode;
+
+   if ( list->head == NULL ) {
+      return;
+   }
+
+   node = list->head->links[ 0 ].next;
+   while ( node != NULL ) {
+      nextNode = node->links[ 0 ].next;
+      free( ( void * ) node );
+      node = nextNode;
+   }
+
+   free( ( void * ) list->head );
+   list->head = NULL;
+   list->level = 1;
+   list->size = 0;
+}
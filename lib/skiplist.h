@@ -0,0 +1,106 @@
+/*
+
+   A skip list that keeps keys in sorted order. It's used where we need
+   to walk through keys in order or find the first key after a given one,
+   which a hash table cannot do for us. By default, the keys are Str strings,
+   but any kind of key can be used by giving the list a compare function.
+
+   Every link also remembers how many nodes it skips over, so the position
+   of a key in the list, and the key at a given position, can be found
+   without walking the whole list.
+
+   The list does not own the keys or the values. The caller must make sure
+   a key stays alive, and doesn't change its order, for as long as it is in
+   the list.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include "gentype.h"
+#include "strutil.h"
+
+/* With a promotion chance of 1/4, 16 levels are enough for well over
+   a million keys. */
+#define SL_MAX_LEVEL 16
+
+/* Function to order two keys, similar to strcmp(). */
+typedef int ( *SkipListCompare )( const void *first, const void *second );
+
+typedef struct SkipListLink {
+   struct SkipListNode *next;
+   /* Number of nodes between this node and the next one on this level,
+      counting the next one. */
+   unsigned int span;
+} SkipListLink;
+
+typedef struct SkipListNode {
+   const void *key;
+   void *value;
+   int level;
+   /* Links to the next node on each level. Only @level links are
+      allocated. */
+   SkipListLink links[ 1 ];
+} SkipListNode;
+
+typedef struct {
+   SkipListNode *head;
+   SkipListCompare compare;
+   int level;
+   unsigned int size;
+   unsigned int seed;
+} SkipList;
+
+/* Prepares a list for Str keys. */
+void SkipListInit( SkipList *list );
+void SkipListInitWithCompare( SkipList *list, SkipListCompare compare );
+/* Inserts a key with its value. If the key is already in the list, only the
+   value is replaced. Returns false on allocation failure. */
+Bool SkipListInsert( SkipList *list, const void *key, void *value );
+/* Removes the node with the given key. Returns the value of the removed
+   node, or NULL if there was no such key. */
+void *SkipListRemove( SkipList *list, const void *key );
+SkipListNode *SkipListFind( const SkipList *list, const void *key );
+/* Returns the first node whose key is equal to or greater than the given
+   key, or NULL if no such node exists. */
+SkipListNode *SkipListLowerBound( const SkipList *list, const void *key );
+/* Returns the first node whose key is strictly greater than the given
+   key, or NULL if no such node exists. */
+SkipListNode *SkipListUpperBound( const SkipList *list, const void *key );
+/* Returns the position of the key in the list, starting from 1, or 0 if
+   the key is not in the list. */
+unsigned int SkipListGetRank( const SkipList *list, const void *key );
+/* Returns the node at the given position, starting from 1, or NULL if the
+   position is outside of the list. */
+SkipListNode *SkipListGetByRank( const SkipList *list, unsigned int rank );
+SkipListNode *SkipListFirst( const SkipList *list );
+SkipListNode *SkipListNext( const SkipListNode *node );
+unsigned int SkipListGetSize( const SkipList *list );
+/* Frees all the nodes of the list. The list needs to be initialized again
+   before it can be reused. */
+void SkipListDestroy( SkipList *list );
+
+#endif
@@ -274,3 +274,45 @@ Bool StrIsEqual( const Str *first, const Str *second ) {
       return FALSE;
    }
 }
+
+int StrCompare( const Str *first, const Str *second ) {
+   const unsigned int length = first->length < second->length ?
+      first->length : second->length;
+   int result = memcmp( first->value, second->value, length );
+
+   /* When one string is the start of the other, the shorter one is
+      considered smaller. */
+   if ( result == 0 ) {
+      if ( first->length < second->length ) {
+         result = -1;
+      }
+      else if ( first->length > second->length ) {
+         result = 1;
+      }
+   }
+
+   return result;
+}
+
+Bool StrHasPrefix( const Str *string, const Str *prefix ) {
+   if ( prefix->length <= string->length &&
+      memcmp( string->value, prefix->value, prefix->length ) == 0 ) {
+      return TRUE;
+   }
+   else {
+      return FALSE;
+   }
+}
+
+unsigned int StrHash( const Str *string ) {
+   /* 32-bit FNV-1a. */
+   unsigned int hash = 2166136261u;
+   unsigned int character;
+
+   for ( character = 0; character < string->length; character += 1 ) {
+      hash ^= ( unsigned char ) string->value[ character ];
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
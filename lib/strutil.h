@@ -93,4 +93,14 @@ Str *StrConcat( const Str *first, const Str *second  );
 /* Comparison function, similar to strcmp() == 0 */
 Bool StrIsEqual( const Str *first, const Str *second );
 
+/* Ordering function, similar to strcmp(), but works on the full length of
+   the strings, so embedded NULL characters are compared too. */
+int StrCompare( const Str *first, const Str *second );
+
+/* Returns true if @string starts with @prefix. */
+Bool StrHasPrefix( const Str *string, const Str *prefix );
+
+/* Hash function for using strings as keys in hash tables. */
+unsigned int StrHash( const Str *string );
+
 #endif
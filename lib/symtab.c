@@ -0,0 +1,167 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "symtab.h"
+
+/* Private prototypes: */
+static Bool SymbolTableGrow( SymbolTable *table );
+
+void SymbolTableInit( SymbolTable *table ) {
+   table->buckets = NULL;
+   table->totalBuckets = 0;
+   table->totalSymbols = 0;
+}
+
+Symbol *SymbolTableFind( const SymbolTable *table, const Str *name ) {
+   unsigned int hash;
+   Symbol *symbol;
+
+   if ( table->totalBuckets == 0 ) {
+      return NULL;
+   }
+
+   hash = StrHash( name );
+   symbol = table->buckets[ hash & ( table->totalBuckets - 1 ) ];
+   while ( symbol != NULL ) {
+      if ( symbol->hash == hash && symbol->name->length == name->length &&
+         memcmp( symbol->name->value, name->value, name->length ) == 0 ) {
+         break;
+      }
+
+      symbol = symbol->nextInBucket;
+   }
+
+   return symbol;
+}
+
+Symbol *SymbolTableIntern( SymbolTable *table, const Str *name ) {
+   Symbol *symbol = SymbolTableFind( table, name );
+   Symbol **bucket;
+
+   if ( symbol != NULL ) {
+      symbol->references += 1;
+      return symbol;
+   }
+
+   /* The first string sets up the buckets. Later on, we can live with 
+      longer chains if there's no memory to grow the table. */
+   if ( table->totalSymbols >= table->totalBuckets &&
+      ! SymbolTableGrow( table ) && table->totalBuckets == 0 ) {
+      return NULL;
+   }
+
+   symbol = ( Symbol * ) malloc( sizeof( Symbol ) );
+   if ( symbol == NULL ) {
+      return NULL;
+   }
+
+   symbol->name = StrNewEmpty( name->length );
+   if ( symbol->name == NULL ) {
+      free( ( void * ) symbol );
+      return NULL;
+   }
+
+   memcpy( symbol->name->value, name->value, name->length );
+   symbol->hash = StrHash( name );
+   symbol->references = 1;
+
+   bucket = &table->buckets[ symbol->hash & ( table->totalBuckets - 1 ) ];
+   symbol->nextInBucket = *bucket;
+   *bucket = symbol;
+   table->totalSymbols += 1;
+
+   return symbol;
+}
+
+void SymbolTableRelease( SymbolTable *table, Symbol *symbol ) {
+   Symbol **link;
+
+   symbol->references -= 1;
+   if ( symbol->references > 0 ) {
+      return;
+   }
+
+   link = &table->buckets[ symbol->hash & ( table->totalBuckets - 1 ) ];
+   while ( *link != symbol ) {
+      link = &( *link )->nextInBucket;
+   }
+   *link = symbol->nextInBucket;
+
+   StrDel( symbol->name );
+   free( ( void * ) symbol );
+   table->totalSymbols -= 1;
+}
+
+Bool SymbolTableGrow( SymbolTable *table ) {
+   /* The bucket count is always a power of two so we can mask the hash. */
+   const unsigned int totalBuckets = ( table->totalBuckets > 0 ) ?
+      table->totalBuckets * 2 : SYMTAB_INITIAL_BUCKETS;
+   Symbol **buckets = ( Symbol ** ) calloc( totalBuckets, 
+      sizeof( Symbol * ) );
+   unsigned int bucketNum;
+
+   if ( buckets == NULL ) {
+      return FALSE;
+   }
+
+   for ( bucketNum = 0; bucketNum < table->totalBuckets; bucketNum += 1 ) {
+      Symbol *symbol = table->buckets[ bucketNum ];
+      while ( symbol != NULL ) {
+         Symbol *nextSymbol = symbol->nextInBucket;
+         Symbol **bucket = &buckets[ symbol->hash & ( totalBuckets - 1 ) ];
+         symbol->nextInBucket = *bucket;
+         *bucket = symbol;
+         symbol = nextSymbol;
+      }
+   }
+
+   free( ( void * ) table->buckets );
+   table->buckets = buckets;
+   table->totalBuckets = totalBuckets;
+   return TRUE;
+}
+
+unsigned int SymbolTableGetSize( const SymbolTable *table ) {
+   return table->totalSymbols;
+}
+
+void SymbolTableDestroy( SymbolTable *table ) {
+   unsigned int bucketNum;
+
+   for ( bucketNum = 0; bucketNum < table->totalBuckets; bucketNum += 1 ) {
+      Symbol *symbol = table->buckets[ bucketNum ];
+      while ( symbol != NULL ) {
+         Symbol *nextSymbol = symbol->nextInBucket;
+         StrDel( symbol->name );
+         free( ( void * ) symbol );
+         symbol = nextSymbol;
+      }
+   }
+
+   free( ( void * ) table->buckets );
+   SymbolTableInit( table );
+}
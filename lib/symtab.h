@@ -0,0 +1,73 @@
+/*
+
+   A table of interned strings. Each distinct string is stored once, as a
+   symbol, and everyone holding the same string holds the same symbol. Two
+   interned strings are equal exactly when their symbols are the same, so
+   they can be compared without looking at their characters, and their hash
+   is worked out only once, when the string is first interned.
+
+   Symbols count their references. Every call to SymbolTableIntern() adds a
+   reference, which is given back with SymbolTableRelease(). A symbol is 
+   freed when its last reference is given back.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef SYMTAB_H
+#define SYMTAB_H
+
+#include "gentype.h"
+#include "strutil.h"
+
+/* The table starts with this many buckets once the first string is 
+   interned. The bucket table doubles in size whenever the symbols outnumber
+   the buckets. */
+#define SYMTAB_INITIAL_BUCKETS 64
+
+typedef struct Symbol {
+   Str *name;
+   unsigned int hash;
+   unsigned int references;
+   struct Symbol *nextInBucket;
+} Symbol;
+
+typedef struct {
+   Symbol **buckets;
+   unsigned int totalBuckets;
+   unsigned int totalSymbols;
+} SymbolTable;
+
+void SymbolTableInit( SymbolTable *table );
+/* Returns the symbol of the string, or NULL if the string isn't interned.
+   No reference is added. */
+Symbol *SymbolTableFind( const SymbolTable *table, const Str *name );
+/* Returns the symbol of the string, interning the string if needed, and
+   adds a reference to it. Returns NULL on allocation failure. */
+Symbol *SymbolTableIntern( SymbolTable *table, const Str *name );
+void SymbolTableRelease( SymbolTable *table, Symbol *symbol );
+unsigned int SymbolTableGetSize( const SymbolTable *table );
+/* Frees all the symbols, whether they're still referenced or not. */
+void SymbolTableDestroy( SymbolTable *table );
+
+#endif
@@ -0,0 +1,187 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <stdlib.h>
+
+#include "timerwheel.h"
+
+/* Private prototypes: */
+static void TimerWheelPlace( TimerWheel *wheel, TimerWheelNode *node,
+   Bool isCascading );
+static void TimerWheelUnlink( TimerWheelNode *node );
+static void TimerWheelCascade( TimerWheel *wheel, int level );
+
+void TimerWheelInit( TimerWheel *wheel, TimerWheelTick startTick ) {
+   int level;
+   int slot;
+
+   for ( level = 0; level < TW_LEVELS; level += 1 ) {
+      for ( slot = 0; slot < TW_SLOTS; slot += 1 ) {
+         TimerWheelNode *head = &wheel->slots[ level ][ slot ];
+         head->prev = head;
+         head->next = head;
+      }
+   }
+
+   wheel->currentTick = startTick;
+   wheel->totalTimers = 0;
+}
+
+void TimerWheelNodeInit( TimerWheelNode *node, void *data ) {
+   node->prev = NULL;
+   node->next = NULL;
+   node->expiry = 0;
+   node->data = data;
+}
+
+Bool TimerWheelIsScheduled( const TimerWheelNode *node ) {
+   return ( node->next != NULL );
+}
+
+void TimerWheelSchedule( TimerWheel *wheel, TimerWheelNode *node,
+   TimerWheelTick expiry ) {
+   if ( TimerWheelIsScheduled( node ) ) {
+      TimerWheelCancel( wheel, node );
+   }
+
+   node->expiry = expiry;
+   TimerWheelPlace( wheel, node, FALSE );
+   wheel->totalTimers += 1;
+}
+
+void TimerWheelPlace( TimerWheel *wheel, TimerWheelNode *node,
+   Bool isCascading ) {
+   /* A cascade happens before the slot of the current tick is drained, so
+      the timers it moves down can still go off on the current tick. */
+   const TimerWheelTick dueTick = 
+      isCascading ? wheel->currentTick : wheel->currentTick + 1;
+   TimerWheelTick expiry = node->expiry;
+   TimerWheelTick delta;
+   TimerWheelNode *head;
+   int level = 0;
+
+   /* Timers that are already due go off on the next tick they can. */
+   if ( expiry < dueTick ) {
+      expiry = dueTick;
+   }
+
+   delta = expiry - wheel->currentTick;
+
+   /* Find the lowest level that can hold the timer. */
+   while ( level < TW_LEVELS - 1 &&
+      delta >= ( ( TimerWheelTick ) 1 << ( ( level + 1 ) * TW_SLOT_BITS ) ) ) {
+      level += 1;
+   }
+
+   /* Timers too far ahead for the top level are parked in its furthest
+      slot. They get placed again when that slot is cascaded. */
+   if ( delta >= ( ( TimerWheelTick ) 1 << ( TW_LEVELS * TW_SLOT_BITS ) ) ) {
+      expiry = wheel->currentTick +
+         ( ( TimerWheelTick ) 1 << ( TW_LEVELS * TW_SLOT_BITS ) ) - 1;
+   }
+
+   head = &wheel->slots[ level ][
+      ( expiry >> ( level * TW_SLOT_BITS ) ) & TW_SLOT_MASK ];
+
+   node->prev = head->prev;
+   node->next = head;
+   head->prev->next = node;
+   head->prev = node;
+}
+
+void TimerWheelUnlink( TimerWheelNode *node ) {
+   node->prev->next = node->next;
+   node->next->prev = node->prev;
+   node->prev = NULL;
+   node->next = NULL;
+}
+
+void TimerWheelCancel( TimerWheel *wheel, TimerWheelNode *node ) {
+   if ( TimerWheelIsScheduled( node ) ) {
+      TimerWheelUnlink( node );
+      wheel->totalTimers -= 1;
+   }
+}
+
+void TimerWheelCascade( TimerWheel *wheel, int level ) {
+   const int slot =
+      ( wheel->currentTick >> ( level * TW_SLOT_BITS ) ) & TW_SLOT_MASK;
+   TimerWheelNode *head = &wheel->slots[ level ][ slot ];
+   TimerWheelNode pending;
+
+   /* The slot above is cascaded first when this slot is the first one of
+      its level, so this level gets refilled before it's emptied. */
+   if ( slot == 0 && level + 1 < TW_LEVELS ) {
+      TimerWheelCascade( wheel, level + 1 );
+   }
+
+   if ( head->next == head ) {
+      return;
+   }
+
+   /* Take the whole list out of the slot, then place every timer again
+      relative to the current tick. */
+   pending.next = head->next;
+   pending.prev = head->prev;
+   pending.next->prev = &pending;
+   pending.prev->next = &pending;
+   head->next = head;
+   head->prev = head;
+
+   while ( pending.next != &pending ) {
+      TimerWheelNode *node = pending.next;
+      TimerWheelUnlink( node );
+      TimerWheelPlace( wheel, node, TRUE );
+   }
+}
+
+int TimerWheelAdvance( TimerWheel *wheel, TimerWheelTick tick,
+   TimerWheelHandler handler ) {
+   int timersFired = 0;
+
+   while ( wheel->currentTick < tick ) {
+      TimerWheelNode *head;
+      int slot;
+
+      wheel->currentTick += 1;
+      slot = wheel->currentTick & TW_SLOT_MASK;
+
+      /* At the start of every turn of the first level, move the timers of
+         the next slot of the level above down. */
+      if ( slot == 0 ) {
+         TimerWheelCascade( wheel, 1 );
+      }
+
+      head = &wheel->slots[ 0 ][ slot ];
+      while ( head->next != head ) {
+         TimerWheelNode *node = head->next;
+         TimerWheelUnlink( node );
+         wheel->totalTimers -= 1;
+         timersFired += 1;
+         handler( node );
+      }
+   }
+
+   return timersFired;
+}
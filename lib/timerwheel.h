@@ -0,0 +1,88 @@
+/*
+
+   A hierarchical timer wheel, for keeping track of a large number of timers
+   that go off at whole ticks. Scheduling and cancelling a timer takes
+   constant time, and so does each tick, no matter how many timers there are.
+
+   The first level of the wheel has a slot for each of the next few ticks.
+   Each higher level has slots that span a whole turn of the level below it.
+   When a lower level completes a turn, the timers in the next slot of the
+   level above it are moved down into it.
+
+   The timer nodes are owned by the caller, who would usually embed them in
+   the structures that need timing.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "gentype.h"
+
+/* With 4 levels of 64 slots, timers can be set up to 2^24 ticks ahead
+   before they need to go around the top level again. With one second
+   ticks, that is a little over 194 days. */
+#define TW_LEVELS 4
+#define TW_SLOT_BITS 6
+#define TW_SLOTS ( 1 << TW_SLOT_BITS )
+#define TW_SLOT_MASK ( TW_SLOTS - 1 )
+
+typedef unsigned long TimerWheelTick;
+
+typedef struct TimerWheelNode {
+   struct TimerWheelNode *prev;
+   struct TimerWheelNode *next;
+   TimerWheelTick expiry;
+   void *data;
+} TimerWheelNode;
+
+typedef struct {
+   /* Each slot is the head of a circular list of timer nodes. */
+   TimerWheelNode slots[ TW_LEVELS ][ TW_SLOTS ];
+   TimerWheelTick currentTick;
+   unsigned int totalTimers;
+} TimerWheel;
+
+/* Function called for every timer that goes off. The node is already
+   taken out of the wheel when the function is called, so it can be freed
+   or scheduled again. */
+typedef void ( *TimerWheelHandler )( TimerWheelNode *node );
+
+void TimerWheelInit( TimerWheel *wheel, TimerWheelTick startTick );
+void TimerWheelNodeInit( TimerWheelNode *node, void *data );
+/* Schedules a timer to go off at the given tick. A timer that is already
+   scheduled is moved. Timers set for a tick that has already passed go off
+   on the next tick. */
+void TimerWheelSchedule( TimerWheel *wheel, TimerWheelNode *node,
+   TimerWheelTick expiry );
+void TimerWheelCancel( TimerWheel *wheel, TimerWheelNode *node );
+Bool TimerWheelIsScheduled( const TimerWheelNode *node );
+/* Moves the wheel forward, one tick at a time, up to the given tick, and
+   calls the handler for every timer that goes off on the way. Returns the
+   number of timers that went off. */
+int TimerWheelAdvance( TimerWheel *wheel, TimerWheelTick tick,
+   TimerWheelHandler handler );
+
+#endif
@@ -0,0 +1,114 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#if ! ( defined _WIN32 || defined _WIN64 )
+   #include <pthread.h>
+   #include <unistd.h>
+#endif
+
+#include "workpool.h"
+
+/* Private prototypes: */
+static void *WorkPoolWork( void *range );
+
+void WorkPoolRun( WorkPoolTask task, void *context, unsigned int totalItems,
+   unsigned int minThreadItems ) {
+#if ! ( defined _WIN32 || defined _WIN64 )
+   pthread_t threads[ WP_MAX_THREADS ];
+   WorkPoolRange ranges[ WP_MAX_THREADS ];
+   unsigned int totalThreads = WorkPoolGetMaxThreads();
+   unsigned int threadsStarted = 0;
+   unsigned int threadItems;
+   unsigned int threadNum;
+
+   if ( minThreadItems == 0 ) {
+      minThreadItems = 1;
+   }
+
+   if ( totalThreads > totalItems / minThreadItems ) {
+      totalThreads = totalItems / minThreadItems;
+   }
+
+   if ( totalThreads <= 1 ) {
+      task( context, 0, totalItems );
+      return;
+   }
+
+   /* The runs are as even as they can be. The first run, which the caller
+      works on, takes what is left over. */
+   threadItems = totalItems / totalThreads;
+   for ( threadNum = 0; threadNum < totalThreads; threadNum += 1 ) {
+      ranges[ threadNum ].task = task;
+      ranges[ threadNum ].context = context;
+      ranges[ threadNum ].lastItem = totalItems - 
+         ( totalThreads - threadNum - 1 ) * threadItems;
+      ranges[ threadNum ].firstItem = ( threadNum == 0 ) ? 0 :
+         ranges[ threadNum - 1 ].lastItem;
+   }
+
+   for ( threadNum = 1; threadNum < totalThreads; threadNum += 1 ) {
+      if ( pthread_create( &threads[ threadNum ], NULL, WorkPoolWork,
+         &ranges[ threadNum ] ) != 0 ) {
+         break;
+      }
+
+      threadsStarted += 1;
+   }
+
+   WorkPoolWork( &ranges[ 0 ] );
+
+   /* The runs whose threads didn't start are left to the caller. */
+   if ( threadsStarted + 1 < totalThreads ) {
+      task( context, ranges[ threadsStarted + 1 ].firstItem, totalItems );
+   }
+
+   for ( threadNum = 1; threadNum <= threadsStarted; threadNum += 1 ) {
+      pthread_join( threads[ threadNum ], NULL );
+   }
+#else
+   ( void ) minThreadItems;
+   task( context, 0, totalItems );
+#endif
+}
+
+void *WorkPoolWork( void *range ) {
+   WorkPoolRange *items = ( WorkPoolRange * ) range;
+   items->task( items->context, items->firstItem, items->lastItem );
+   return NULL;
+}
+
+unsigned int WorkPoolGetMaxThreads( void ) {
+#if ! ( defined _WIN32 || defined _WIN64 ) && defined _SC_NPROCESSORS_ONLN
+   const long totalProcessors = sysconf( _SC_NPROCESSORS_ONLN );
+
+   if ( totalProcessors < 1 ) {
+      return 1;
+   }
+
+   return ( totalProcessors > WP_MAX_THREADS ) ? WP_MAX_THREADS :
+      ( unsigned int ) totalProcessors;
+#else
+   return 1;
+#endif
+}
@@ -0,0 +1,64 @@
+/*
+
+   Spreads a range of items over a few worker threads, for work on items
+   that don't depend on each other. Each thread is given a run of items in
+   a row, and the caller works on the first run itself. The call returns
+   once all the items are done.
+
+   Where there are no POSIX threads, or no threads can be started, the
+   caller works on all the items.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include "gentype.h"
+
+/* Most threads used for a single run, the caller included. */
+#define WP_MAX_THREADS 16
+
+/* Function that works on the items from the first item up to, but not
+   including, the last item. It's called from more than one thread at 
+   once, so it must only change what belongs to its own items. */
+typedef void ( *WorkPoolTask )( void *context, unsigned int firstItem,
+   unsigned int lastItem );
+
+/* Run of items given to one thread. */
+typedef struct {
+   WorkPoolTask task;
+   void *context;
+   unsigned int firstItem;
+   unsigned int lastItem;
+} WorkPoolRange;
+
+/* Works on all the items, giving each thread at least the given number of
+   items, so small runs don't pay for starting threads. */
+void WorkPoolRun( WorkPoolTask task, void *context, unsigned int totalItems,
+   unsigned int minThreadItems );
+/* Returns the number of threads a run can use, the caller included. */
+unsigned int WorkPoolGetMaxThreads( void );
+
+#endif
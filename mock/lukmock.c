@@ -0,0 +1,717 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "gentype.h"
+#include "strutil.h"
+#include "progargs.h"
+#include "huffman.h"
+#include "md5.h"
+
+#include "server.h"
+#include "socket.h"
+#include "platform.h"
+#include "print.h"
+#include "lukmock.h"
+
+/* Private prototypes: */
+static Bool LukMockReadOptions( void );
+static Bool LukMockReadMix( const char *mixArg );
+static Bool LukMockOpenSocket( int port );
+static void LukMockSend( Byte header, const void *body, unsigned int length );
+static Bool LukMockReceive( RconResponse *response, 
+   unsigned long long timeout );
+static Bool LukMockLogIn( void );
+static Bool LukMockWaitForSystem( void );
+static void LukMockRun( void );
+static void LukMockSendQuery( unsigned long long now );
+static void LukMockHandleResponse( const RconResponse *response );
+static void LukMockReadReply( const char *command );
+static void LukMockDrain( void );
+static void LukMockChangeMap( void );
+static void LukMockMakePasswordHash( const char *salt, char *hash );
+static unsigned int LukMockRandom( void );
+static void LukMockPrintProgress( const Histogram *latency, 
+   unsigned long totalSent );
+static void LukMockPrintReport( double runTime );
+static void LukMockPrintLatency( const char *name, unsigned long totalSent,
+   const Histogram *latency );
+static void LukMockPrintHelpMenu( const char *programPath );
+
+/* The queries the mock can send. The names are used in the mix option. */
+static const LukMockQueryType queryTypes[] = {
+   { "store", "STORE k%u v%u", FALSE },
+   { "retrieve", "RETRIEVE k%u", TRUE },
+   { "store_p", "STORE_P p%u score %u", FALSE },
+   { "retrieve_p", "RETRIEVE_P p%u score", TRUE },
+   { "store_date", "STORE_DATE d%u", FALSE },
+   { "retrieve_date", "RETRIEVE_DATE d%u", TRUE },
+   { NULL, NULL, FALSE }
+};
+
+#define LUKMOCK_TOTAL_QUERY_TYPES \
+   ( sizeof( queryTypes ) / sizeof( queryTypes[ 0 ] ) - 1 )
+
+static LukMockMixEntry mix[ LUKMOCK_TOTAL_QUERY_TYPES ];
+static unsigned int totalMixWeight = 0;
+
+static LukMockPending pending[ LUKMOCK_MAX_PENDING ];
+static unsigned long totalPending = 0;
+static unsigned long totalReplies = 0;
+static unsigned long totalLost = 0;
+static unsigned long totalUnmatched = 0;
+static Histogram intervalLatency;
+
+static Socket mockSocket = SOCKET_FAIL;
+static struct sockaddr_in clientAddress;
+static Bool isClientKnown = FALSE;
+static Bool isClientGone = FALSE;
+static Bool isSystemOn = FALSE;
+
+static query_id_t lastQueryId = 0;
+static unsigned int mapNumber = 1;
+static unsigned int seed = 2463534242u;
+
+/* Options: */
+static int port = LUKMOCK_DEFAULT_PORT;
+static const char *password = "";
+static unsigned long rate = LUKMOCK_DEFAULT_RATE;
+static unsigned long duration = LUKMOCK_DEFAULT_DURATION;
+static unsigned int totalKeys = LUKMOCK_DEFAULT_KEYS;
+static unsigned long mapTime = 0;
+
+int main( int argc, char *argv[] ) {
+   unsigned long long startTime;
+
+   PROGA_Init( argv );
+   ( void ) argc;
+
+   if ( PROGA_FindArg( "-h" ) ) {
+      LukMockPrintHelpMenu( argv[ 0 ] );
+      exit( EXIT_SUCCESS );
+   }
+
+   if ( ! LukMockReadOptions() || ! LukMockOpenSocket( port ) ) {
+      exit( EXIT_FAILURE );
+   }
+
+   PrintMessage( "Waiting for luk to log in on port: %d\n", port );
+   if ( ! LukMockLogIn() || ! LukMockWaitForSystem() ) {
+      SocketDestroy( &mockSocket );
+      exit( EXIT_FAILURE );
+   }
+
+   PrintMessage( "Sending %lu queries per second for %lu seconds\n", 
+      rate, duration );
+
+   startTime = getMicroseconds();
+   LukMockRun();
+   LukMockPrintReport( ( getMicroseconds() - startTime ) / 1000000.0 );
+
+   SocketDestroy( &mockSocket );
+   SocketShutdown();
+   return EXIT_SUCCESS;
+}
+
+Bool LukMockReadOptions( void ) {
+   const char *mixArg = LUKMOCK_DEFAULT_MIX;
+   const char *arg;
+
+   if ( PROGA_FindArg( "-p" ) && ( arg = PROGA_NextArg() ) != NULL ) {
+      port = atoi( arg );
+   }
+
+   if ( PROGA_FindArg( "-w" ) && ( arg = PROGA_NextArg() ) != NULL ) {
+      password = arg;
+   }
+
+   if ( PROGA_FindArg( "-r" ) && ( arg = PROGA_NextArg() ) != NULL ) {
+      rate = strtoul( arg, NULL, 10 );
+   }
+
+   if ( PROGA_FindArg( "-t" ) && ( arg = PROGA_NextArg() ) != NULL ) {
+      duration = strtoul( arg, NULL, 10 );
+   }
+
+   if ( PROGA_FindArg( "-k" ) && ( arg = PROGA_NextArg() ) != NULL ) {
+      totalKeys = ( unsigned int ) strtoul( arg, NULL, 10 );
+   }
+
+   if ( PROGA_FindArg( "-c" ) && ( arg = PROGA_NextArg() ) != NULL ) {
+      mapTime = strtoul( arg, NULL, 10 );
+   }
+
+   if ( PROGA_FindArg( "-m" ) && ( arg = PROGA_NextArg() ) != NULL ) {
+      mixArg = arg;
+   }
+
+   if ( port <= 0 || rate == 0 || totalKeys == 0 ) {
+      PrintError( "The port, rate and number of keys must be above 0\n" );
+      return FALSE;
+   }
+
+   return LukMockReadMix( mixArg );
+}
+
+/* The mix is a list of query types and their weights, like 
+   "retrieve:60,store:40". */
+Bool LukMockReadMix( const char *mixArg ) {
+   const char *mixPos = mixArg;
+   unsigned int type;
+
+   for ( type = 0; type < LUKMOCK_TOTAL_QUERY_TYPES; type += 1 ) {
+      mix[ type ].weight = 0;
+      mix[ type ].totalSent = 0;
+      HistogramInit( &mix[ type ].latency );
+   }
+
+   while ( *mixPos != '\0' ) {
+      const char *nameEnd = strchr( mixPos, ':' );
+      const char *weightEnd;
+      unsigned long weight;
+
+      if ( nameEnd == NULL ) {
+         PrintError( "Missing weight in query mix: %s\n", mixPos );
+         return FALSE;
+      }
+
+      for ( type = 0; type < LUKMOCK_TOTAL_QUERY_TYPES; type += 1 ) {
+         if ( strlen( queryTypes[ type ].name ) == ( size_t ) 
+            ( nameEnd - mixPos ) && strncmp( queryTypes[ type ].name, 
+            mixPos, nameEnd - mixPos ) == 0 ) {
+            break;
+         }
+      }
+
+      if ( type == LUKMOCK_TOTAL_QUERY_TYPES ) {
+         PrintError( "Unknown query type in query mix: %s\n", mixPos );
+         return FALSE;
+      }
+
+      weight = strtoul( nameEnd + 1, ( char ** ) &weightEnd, 10 );
+      if ( weightEnd == nameEnd + 1 || 
+         ( *weightEnd != ',' && *weightEnd != '\0' ) ) {
+         PrintError( "Invalid weight in query mix: %s\n", nameEnd + 1 );
+         return FALSE;
+      }
+
+      mix[ type ].weight = ( unsigned int ) weight;
+      totalMixWeight += ( unsigned int ) weight;
+      mixPos = ( *weightEnd == ',' ) ? weightEnd + 1 : weightEnd;
+   }
+
+   if ( totalMixWeight == 0 ) {
+      PrintError( "The query mix has no queries\n" );
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+Bool LukMockOpenSocket( int port ) {
+   struct sockaddr_in address;
+
+   HUFFMAN_Construct();
+   SocketInit();
+
+   mockSocket = SocketCreate( AF_INET, SOCK_DGRAM, 0 );
+   if ( mockSocket == SOCKET_FAIL ) {
+      PrintError( "Socket creation failure\n" );
+      return FALSE;
+   }
+
+   memset( &address, 0, sizeof( address ) );
+   address.sin_family = AF_INET;
+   address.sin_port = htons( port );
+   address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+   if ( bind( mockSocket, ( struct sockaddr * ) &address, 
+      sizeof( address ) ) != 0 ) {
+      PrintError( "Failed to listen on port: %d\n", port );
+      SocketDestroy( &mockSocket );
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+void LukMockSend( Byte header, const void *body, unsigned int length ) {
+   RconResponse response;
+   unsigned char encoded[ MAX_RESPONSE_LENGTH ];
+   int encodedLen = MAX_RESPONSE_LENGTH;
+
+   response.header = header;
+   if ( length > 0 ) {
+      memcpy( response.body, body, length );
+   }
+
+   response.bodyLength = length;
+
+   HUFFMAN_Encode( ( unsigned char * ) &response, encoded, 
+      response.bodyLength + 1, &encodedLen );
+
+   sendto( mockSocket, ( const char * ) encoded, encodedLen, 0,
+      ( struct sockaddr * ) &clientAddress, sizeof( clientAddress ) );
+}
+
+/* Waits up to the given number of microseconds for a packet from luk. The
+   first host to send a packet is taken to be luk. */
+Bool LukMockReceive( RconResponse *response, unsigned long long timeout ) {
+   unsigned char encoded[ MAX_RESPONSE_LENGTH ];
+   struct sockaddr_in remoteAddr;
+   socklen_t remoteAddrLen = sizeof( remoteAddr );
+   int encodedLen;
+   int responseLen;
+   struct timeval waitTime;
+   fd_set mockFdSet;
+
+   waitTime.tv_sec = ( long ) ( timeout / 1000000 );
+   waitTime.tv_usec = ( long ) ( timeout % 1000000 );
+
+   FD_ZERO( &mockFdSet );
+   FD_SET( mockSocket, &mockFdSet );
+
+   if ( select( mockSocket + 1, &mockFdSet, NULL, NULL, &waitTime ) <= 0 ) {
+      return FALSE;
+   }
+
+   encodedLen = recvfrom( mockSocket, ( char * ) encoded, sizeof( encoded ),
+      0, ( struct sockaddr * ) &remoteAddr, &remoteAddrLen );
+   if ( encodedLen <= 0 ) {
+      return FALSE;
+   }
+
+   if ( ! isClientKnown ) {
+      clientAddress = remoteAddr;
+      isClientKnown = TRUE;
+   }
+   else if ( memcmp( &remoteAddr, &clientAddress, 
+      sizeof( clientAddress ) ) != 0 ) {
+      return FALSE;
+   }
+
+   responseLen = MAX_RESPONSE_LENGTH - 1;
+   HUFFMAN_Decode( encoded, ( unsigned char * ) response, encodedLen,
+      &responseLen );
+   if ( responseLen <= 0 ) {
+      return FALSE;
+   }
+
+   response->bodyLength = responseLen - 1;
+   response->body[ response->bodyLength ] = 0;
+   return TRUE;
+}
+
+/* Goes through the same steps as a server: the salt is sent in answer to
+   the start of the connection, and the hash of the password that comes 
+   back is checked. */
+Bool LukMockLogIn( void ) {
+   const unsigned long long endTime = 
+      getMicroseconds() + LUKMOCK_LOGIN_WAIT_TIME * 1000000ULL;
+   char salt[ LUKMOCK_SALT_LENGTH + 1 ];
+   Bool isSaltSent = FALSE;
+   RconResponse response;
+   int pos;
+
+   seed ^= ( unsigned int ) time( NULL );
+   for ( pos = 0; pos < LUKMOCK_SALT_LENGTH; pos += 1 ) {
+      salt[ pos ] = "0123456789abcdefghijklmnopqrstuvwxyz"[ 
+         LukMockRandom() % 36 ];
+   }
+
+   salt[ LUKMOCK_SALT_LENGTH ] = '\0';
+
+   while ( getMicroseconds() < endTime ) {
+      if ( ! LukMockReceive( &response, 1000000 ) ) {
+         continue;
+      }
+
+      if ( response.header == CLRC_BEGINCONNECTION ) {
+         if ( response.bodyLength < 1 || 
+            response.body[ 0 ] < RCON_VERSION_SUPPORTED ) {
+            LukMockSend( SVRC_OLDPROTOCOL, NULL, 0 );
+            continue;
+         }
+
+         LukMockSend( SVRC_SALT, salt, LUKMOCK_SALT_LENGTH + 1 );
+         isSaltSent = TRUE;
+      }
+      else if ( response.header == CLRC_PASSWORD && isSaltSent ) {
+         char hash[ MD5_HASH_LENGTH + 1 ];
+         Byte body[ 64 ];
+         unsigned int bodyLength = 0;
+         char map[ 16 ];
+
+         LukMockMakePasswordHash( salt, hash );
+         if ( strcmp( ( const char * ) response.body, hash ) != 0 ) {
+            LukMockSend( SVRC_INVALIDPASSWORD, NULL, 0 );
+            PrintError( "luk gave the wrong password\n" );
+            return FALSE;
+         }
+
+         /* Protocol, hostname, then the updates: no players, no admins,
+            and the map. The recent console lines come last. */
+         sprintf( map, LUKMOCK_MAP_LAYOUT, mapNumber );
+         body[ bodyLength++ ] = RCON_VERSION_SUPPORTED;
+         memcpy( body + bodyLength, LUKMOCK_HOSTNAME, 
+            sizeof( LUKMOCK_HOSTNAME ) );
+         bodyLength += sizeof( LUKMOCK_HOSTNAME );
+         body[ bodyLength++ ] = 3;
+         body[ bodyLength++ ] = SVRCU_PLAYERDATA;
+         body[ bodyLength++ ] = 0;
+         body[ bodyLength++ ] = SVRCU_ADMINCOUNT;
+         body[ bodyLength++ ] = 0;
+         body[ bodyLength++ ] = SVRCU_MAP;
+         memcpy( body + bodyLength, map, strlen( map ) + 1 );
+         bodyLength += strlen( map ) + 1;
+         body[ bodyLength++ ] = 0;
+
+         LukMockSend( SVRC_LOGGEDIN, body, bodyLength );
+         PrintMessage( "luk logged in from: %s:%d\n", 
+            inet_ntoa( clientAddress.sin_addr ), 
+            ntohs( clientAddress.sin_port ) );
+         return TRUE;
+      }
+   }
+
+   PrintError( "luk didn't log in\n" );
+   return FALSE;
+}
+
+/* luk turns on its system on the server once it's ready for queries. */
+Bool LukMockWaitForSystem( void ) {
+   const unsigned long long endTime = 
+      getMicroseconds() + LUKMOCK_LOGIN_WAIT_TIME * 1000000ULL;
+   RconResponse response;
+
+   while ( ! isSystemOn && ! isClientGone && getMicroseconds() < endTime ) {
+      if ( LukMockReceive( &response, 1000000 ) ) {
+         LukMockHandleResponse( &response );
+      }
+   }
+
+   if ( ! isSystemOn ) {
+      PrintError( "luk didn't turn on its system\n" );
+   }
+
+   return isSystemOn;
+}
+
+/* Sends the queries at an even pace, and reads the replies in between. */
+void LukMockRun( void ) {
+   const double queryInterval = 1000000.0 / rate;
+   const unsigned long long startTime = getMicroseconds();
+   const unsigned long long endTime = startTime + duration * 1000000ULL;
+   unsigned long long nextReportTime = startTime + 1000000;
+   unsigned long long nextMapTime = startTime + mapTime * 1000000ULL;
+   double nextSendTime = ( double ) startTime;
+   unsigned long intervalSent = 0;
+   unsigned long long now = startTime;
+
+   HistogramInit( &intervalLatency );
+
+   while ( now < endTime && ! isClientGone ) {
+      RconResponse response;
+      int burst = 0;
+      unsigned long long waitTime = 0;
+
+      while ( nextSendTime <= now && burst < LUKMOCK_MAX_BURST ) {
+         LukMockSendQuery( now );
+         nextSendTime += queryInterval;
+         intervalSent += 1;
+         burst += 1;
+      }
+
+      /* luk starts the query IDs over on a new map, so the replies to the
+         queries of the old map are waited for first. The time spent 
+         waiting isn't made up for. */
+      if ( mapTime > 0 && now >= nextMapTime ) {
+         LukMockDrain();
+         LukMockChangeMap();
+         nextMapTime += mapTime * 1000000ULL;
+         nextSendTime = ( double ) getMicroseconds();
+      }
+
+      if ( nextSendTime > now ) {
+         waitTime = ( unsigned long long ) nextSendTime - now;
+         if ( waitTime > nextReportTime - now ) {
+            waitTime = nextReportTime - now;
+         }
+      }
+
+      if ( LukMockReceive( &response, waitTime ) ) {
+         LukMockHandleResponse( &response );
+      }
+
+      now = getMicroseconds();
+      if ( now >= nextReportTime ) {
+         LukMockPrintProgress( &intervalLatency, intervalSent );
+         HistogramInit( &intervalLatency );
+         intervalSent = 0;
+         nextReportTime += 1000000;
+      }
+   }
+
+   LukMockDrain();
+}
+
+void LukMockSendQuery( unsigned long long now ) {
+   char message[ LUKMOCK_MAX_CARGO_LENGTH ];
+   char cargo[ LUKMOCK_MAX_CARGO_LENGTH / 2 ];
+   unsigned int pick = LukMockRandom() % totalMixWeight;
+   unsigned int type = 0;
+   LukMockPending *slot;
+
+   while ( pick >= mix[ type ].weight ) {
+      pick -= mix[ type ].weight;
+      type += 1;
+   }
+
+   sprintf( cargo, queryTypes[ type ].layout, LukMockRandom() % totalKeys,
+      LukMockRandom() );
+
+   lastQueryId += 1;
+   sprintf( message, "\b%s %u %s\b", QUERY_PREFIX, lastQueryId, cargo );
+   LukMockSend( SVRC_MESSAGE, message, strlen( message ) + 1 );
+   mix[ type ].totalSent += 1;
+
+   if ( ! queryTypes[ type ].isReplied ) {
+      return;
+   }
+
+   slot = &pending[ lastQueryId % LUKMOCK_MAX_PENDING ];
+   if ( slot->isWaiting ) {
+      totalLost += 1;
+      totalPending -= 1;
+   }
+
+   slot->queryId = lastQueryId;
+   slot->sendTime = now;
+   slot->mixEntry = ( int ) type;
+   slot->isWaiting = TRUE;
+   totalPending += 1;
+}
+
+void LukMockHandleResponse( const RconResponse *response ) {
+   const char *command = ( const char * ) response->body;
+
+   switch ( response->header ) {
+      case CLRC_COMMAND:
+         if ( strcmp( command, "set luk_system 1" ) == 0 ) {
+            isSystemOn = TRUE;
+         }
+         else if ( strcmp( command, "set luk_system 0" ) == 0 ) {
+            PrintMessage( "luk turned off its system\n" );
+            isClientGone = TRUE;
+         }
+         else {
+            LukMockReadReply( command );
+         }
+
+         break;
+
+      case CLRC_DISCONNECT:
+         PrintMessage( "luk disconnected\n" );
+         isClientGone = TRUE;
+         break;
+   }
+}
+
+/* A reply sets the reply console variables, one of which holds the query 
+   ID. */
+void LukMockReadReply( const char *command ) {
+   const char *idText = strstr( command, "luk_qid \"" );
+   query_id_t queryId;
+   LukMockPending *slot;
+   unsigned long latency;
+
+   if ( idText == NULL ) {
+      return;
+   }
+
+   queryId = ( query_id_t ) strtoul( idText + 9, NULL, 10 );
+   slot = &pending[ queryId % LUKMOCK_MAX_PENDING ];
+
+   if ( ! slot->isWaiting || slot->queryId != queryId ) {
+      totalUnmatched += 1;
+      return;
+   }
+
+   latency = ( unsigned long ) ( getMicroseconds() - slot->sendTime );
+   HistogramAdd( &mix[ slot->mixEntry ].latency, latency );
+   HistogramAdd( &intervalLatency, latency );
+
+   slot->isWaiting = FALSE;
+   totalPending -= 1;
+   totalReplies += 1;
+}
+
+/* Waits for the replies still on their way. Queries that haven't been
+   answered by then are counted as lost. */
+void LukMockDrain( void ) {
+   const unsigned long long endTime = 
+      getMicroseconds() + LUKMOCK_DRAIN_TIME * 1000000ULL;
+   RconResponse response;
+   unsigned long long now;
+
+   while ( totalPending > 0 && ! isClientGone &&
+      ( now = getMicroseconds() ) < endTime ) {
+      if ( LukMockReceive( &response, endTime - now ) ) {
+         LukMockHandleResponse( &response );
+      }
+   }
+
+   if ( totalPending > 0 ) {
+      unsigned int slot;
+
+      for ( slot = 0; slot < LUKMOCK_MAX_PENDING; slot += 1 ) {
+         pending[ slot ].isWaiting = FALSE;
+      }
+
+      totalLost += totalPending;
+      totalPending = 0;
+   }
+}
+
+void LukMockChangeMap( void ) {
+   char body[ 16 ];
+
+   mapNumber += 1;
+   body[ 0 ] = SVRCU_MAP;
+   sprintf( body + 1, LUKMOCK_MAP_LAYOUT, mapNumber );
+   LukMockSend( SVRC_UPDATE, body, strlen( body ) + 1 );
+
+   lastQueryId = 0;
+   PrintMessage( "Changed the map to: %s\n", body + 1 );
+}
+
+void LukMockMakePasswordHash( const char *salt, char *hash ) {
+   md5_byte_t digest[ 16 ];
+   md5_state_t state;
+   int digit;
+
+   md5_init( &state );
+   md5_append( &state, ( const md5_byte_t * ) salt, ( int ) strlen( salt ) );
+   md5_append( &state, ( const md5_byte_t * ) password, 
+      ( int ) strlen( password ) );
+   md5_finish( &state, digest );
+
+   for ( digit = 0; digit < 16; digit += 1 ) {
+      sprintf( hash + digit * 2, "%02x", digest[ digit ] );
+   }
+}
+
+unsigned int LukMockRandom( void ) {
+   /* Same xorshift generator as the skip lists. */
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+   return seed;
+}
+
+void LukMockPrintProgress( const Histogram *latency, 
+   unsigned long totalSent ) {
+   PrintMessage( "Sent: %lu, replies: %lu, waiting: %lu, lost: %lu, "
+      "p50: %lu us, p99: %lu us, max: %lu us\n", totalSent, 
+      HistogramGetCount( latency ), totalPending, totalLost,
+      HistogramGetPercentile( latency, 50 ), 
+      HistogramGetPercentile( latency, 99 ), HistogramGetMax( latency ) );
+}
+
+void LukMockPrintReport( double runTime ) {
+   Histogram allLatency;
+   unsigned long totalSent = 0;
+   unsigned int type;
+
+   HistogramInit( &allLatency );
+   for ( type = 0; type < LUKMOCK_TOTAL_QUERY_TYPES; type += 1 ) {
+      HistogramMerge( &allLatency, &mix[ type ].latency );
+      totalSent += mix[ type ].totalSent;
+   }
+
+   PrintHeader( "Results" );
+   PrintMessage( "Queries sent: %lu in %.1f seconds, %.0f per second\n",
+      totalSent, runTime, ( runTime > 0 ) ? totalSent / runTime : 0.0 );
+   PrintMessage( "Replies: %lu, lost: %lu, unmatched: %lu\n", totalReplies,
+      totalLost, totalUnmatched );
+   PrintMessage( "Reply latency, in microseconds:\n" );
+
+   for ( type = 0; type < LUKMOCK_TOTAL_QUERY_TYPES; type += 1 ) {
+      if ( mix[ type ].totalSent > 0 ) {
+         LukMockPrintLatency( queryTypes[ type ].name, 
+            mix[ type ].totalSent, &mix[ type ].latency );
+      }
+   }
+
+   LukMockPrintLatency( "all", totalSent, &allLatency );
+}
+
+void LukMockPrintLatency( const char *name, unsigned long totalSent,
+   const Histogram *latency ) {
+   PrintMessage( "   %-14s sent: %-8lu replies: %-8lu p50: %-6lu "
+      "p90: %-6lu p99: %-6lu p99.9: %-6lu max: %-6lu mean: %.0f\n", name,
+      totalSent, HistogramGetCount( latency ), 
+      HistogramGetPercentile( latency, 50 ), 
+      HistogramGetPercentile( latency, 90 ),
+      HistogramGetPercentile( latency, 99 ), 
+      HistogramGetPercentile( latency, 99.9 ), HistogramGetMax( latency ),
+      HistogramGetMean( latency ) );
+}
+
+void LukMockPrintHelpMenu( const char *programPath ) {
+   printf( 
+      "luk-mock stands in for a server, to load a luk running on the same\n"
+      "machine with queries and time the replies.\n\n"
+
+      /* Usage information. */
+      "Usage: \n"
+      "  %s [ options ]\n\n", 
+      programPath 
+   );
+
+   printf(
+      /* Command-line options. */
+      "Options: \n"
+      "  -p <port>\t\tPort to listen on. Default: %d\n"
+      "  -w <password>\t\tRCON password luk logs in with\n"
+      "  -r <rate>\t\tQueries sent per second. Default: %d\n"
+      "  -t <seconds>\t\tHow long to send queries for. Default: %d\n"
+      "  -k <keys>\t\tNumber of different keys and players.\n"
+      "  \t\t\tDefault: %d\n"
+      "  -c <seconds>\t\tChange the map this often\n"
+      "  -m <mix>\t\tQuery types and their weights.\n"
+      "  \t\t\tDefault: %s\n"
+      "  -h\t\t\tDisplay this help menu\n\n"
+      "  Query types: store, retrieve, store_p, retrieve_p, store_date,\n"
+      "  retrieve_date. Only the retrieving queries get replies, so only\n"
+      "  they are timed.\n",
+      LUKMOCK_DEFAULT_PORT, LUKMOCK_DEFAULT_RATE, LUKMOCK_DEFAULT_DURATION,
+      LUKMOCK_DEFAULT_KEYS, LUKMOCK_DEFAULT_MIX
+   );
+}
@@ -0,0 +1,84 @@
+/*
+
+   luk-mock stands in for a Skulltag server, so luk can be run and loaded
+   without one. It speaks the RCON protocol from the server side: it lets
+   luk log in, sends it queries as console messages at a steady rate, and
+   tells it about map changes. The replies luk sends back are matched to 
+   their queries, and the time each query took to be answered is counted
+   in a latency histogram. The mock only listens on the loopback address.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef LUKMOCK_H
+#define LUKMOCK_H
+
+#include "gentype.h"
+#include "histogram.h"
+#include "query.h"
+
+#define LUKMOCK_DEFAULT_PORT 10666
+#define LUKMOCK_DEFAULT_RATE 1000  /* Queries per second. */
+#define LUKMOCK_DEFAULT_DURATION 10  /* In seconds. */
+#define LUKMOCK_DEFAULT_KEYS 1000
+#define LUKMOCK_DEFAULT_MIX "retrieve:50,store:40,retrieve_p:5,store_p:5"
+#define LUKMOCK_HOSTNAME "luk-mock"
+#define LUKMOCK_MAP_LAYOUT "MAP%02u"
+#define LUKMOCK_SALT_LENGTH 32
+/* How long to wait for luk to log in and turn on its system. */
+#define LUKMOCK_LOGIN_WAIT_TIME 60  /* In seconds. */
+/* How long to wait for the replies still on their way, after the last
+   query is sent, and before the map is changed. */
+#define LUKMOCK_DRAIN_TIME 1  /* In seconds. */
+/* Most queries sent in one go, when the mock falls behind the rate. */
+#define LUKMOCK_MAX_BURST 64
+/* Most queries that can wait for a reply. A query that is still waiting
+   when its slot is needed again is counted as lost. */
+#define LUKMOCK_MAX_PENDING 65536
+#define LUKMOCK_MAX_CARGO_LENGTH 256
+
+typedef struct {
+   const char *name;
+   /* Layout of the cargo, which is given the key number and the value. */
+   const char *layout;
+   /* Whether luk sends back a reply for the query. Only those queries can
+      be timed. */
+   Bool isReplied;
+} LukMockQueryType;
+
+typedef struct {
+   unsigned int weight;
+   unsigned long totalSent;
+   Histogram latency;
+} LukMockMixEntry;
+
+typedef struct {
+   query_id_t queryId;
+   unsigned long long sendTime;
+   /* Position of the query type in the mix. */
+   int mixEntry;
+   Bool isWaiting;
+} LukMockPending;
+
+#endif
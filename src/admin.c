@@ -0,0 +1,962 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#if ! ( defined _WIN32 || defined _WIN64 )
+   #include <errno.h>
+   #include <fcntl.h>
+   #include <sys/stat.h>
+   #include <sys/un.h>
+#endif
+
+#include "fileutil.h"
+
+#include "admin.h"
+#include "command.h"
+#include "database.h"
+#include "lukd.h"
+#include "print.h"
+#include "stats.h"
+
+/* Windows: */
+#if defined _WIN32 || defined _WIN64
+
+/* The admin socket is a local socket, which the supported versions of 
+   Windows don't have. */
+Bool AdminInit( const char *socketPath ) {
+   ( void ) socketPath;
+   PrintWarning( "The admin socket is not supported on this system\n" );
+   return FALSE;
+}
+
+void AdminShutdown( void ) {
+}
+
+void AdminAddSockets( fd_set *readSockets, fd_set *writeSockets, 
+   Socket *maxSocket ) {
+   ( void ) readSockets;
+   ( void ) writeSockets;
+   ( void ) maxSocket;
+}
+
+void AdminService( const fd_set *readSockets, const fd_set *writeSockets ) {
+   ( void ) readSockets;
+   ( void ) writeSockets;
+}
+
+/* Linux: */
+#else
+
+/* Writing to a client that went away shouldn't end luk with a signal. */
+#ifdef MSG_NOSIGNAL
+   #define ADMIN_SEND_FLAGS MSG_NOSIGNAL
+#else
+   #define ADMIN_SEND_FLAGS 0
+#endif
+
+/* Private prototypes: */
+static Bool AdminClearPath( const char *socketPath, 
+   const struct sockaddr_un *address );
+static Bool AdminSetNonBlocking( Socket socket );
+static void AdminAccept( void );
+static void AdminServiceClient( AdminClient *client, Bool isReadable );
+static Bool AdminReceive( AdminClient *client );
+static void AdminProcessInput( AdminClient *client );
+static Bool AdminFlush( AdminClient *client );
+static void AdminCloseClient( AdminClient *client );
+static void AdminExecute( AdminClient *client, const char *line );
+static void AdminUnescapeLine( char *line );
+static Str *AdminNextWord( const char **linePos );
+static void AdminReply( AdminClient *client, const char *status, 
+   const char *first, const char *second );
+static void AdminAddEscaped( AdminClient *client, const char *text );
+static void AdminReplyEntry( AdminClient *client, const Str *name,
+   const char *value );
+static void AdminReplyNumber( AdminClient *client, const char *name,
+   unsigned long number );
+static void AdminStartListing( AdminClient *client, AdminListing listing,
+   Str *map, Str *prefix );
+static void AdminContinueListing( AdminClient *client );
+static void AdminContinueDump( AdminClient *client );
+static void AdminEndListing( AdminClient *client );
+static Bool AdminSaveDatabase( AdminClient *client );
+static void AdminCommandHelp( AdminClient *client, const char *args );
+static void AdminCommandGet( AdminClient *client, const char *args );
+static void AdminCommandSet( AdminClient *client, const char *args );
+static void AdminCommandDelete( AdminClient *client, const char *args );
+static void AdminCommandMaps( AdminClient *client, const char *args );
+static void AdminCommandRecords( AdminClient *client, const char *args );
+static void AdminCommandDump( AdminClient *client, const char *args );
+static void AdminCommandStats( AdminClient *client, const char *args );
+static void AdminReplyStatsLine( void *context, const char *name, 
+   const char *text );
+static void AdminCommandSave( AdminClient *client, const char *args );
+static void AdminCommandSnapshot( AdminClient *client, const char *args );
+static void AdminCommandQuit( AdminClient *client, const char *args );
+
+static AdminServer admin;
+
+static const AdminCommand adminCommands[] = {
+   { "help", AdminCommandHelp, "help" },
+   { "get", AdminCommandGet, "get <map> <key>" },
+   { "set", AdminCommandSet, "set <map> <key> <value>" },
+   { "del", AdminCommandDelete, "del <map> <key>" },
+   { "maps", AdminCommandMaps, "maps" },
+   { "records", AdminCommandRecords, "records <map> [<key prefix>]" },
+   { "dump", AdminCommandDump, "dump [<map>]" },
+   { "stats", AdminCommandStats, "stats" },
+   { "save", AdminCommandSave, "save" },
+   { "snapshot", AdminCommandSnapshot, "snapshot <path>" },
+   { "quit", AdminCommandQuit, "quit" },
+   { NULL, NULL, NULL }
+};
+
+Bool AdminInit( const char *socketPath ) {
+   struct sockaddr_un address;
+   mode_t oldMask;
+   Bool isBound;
+   int client;
+
+   if ( strlen( socketPath ) >= sizeof( address.sun_path ) ) {
+      PrintError( "Admin socket path is too long: %s\n", socketPath );
+      return FALSE;
+   }
+
+   memset( &address, 0, sizeof( address ) );
+   address.sun_family = AF_UNIX;
+   strcpy( address.sun_path, socketPath );
+
+   if ( ! AdminClearPath( socketPath, &address ) ) {
+      return FALSE;
+   }
+
+   admin.socket = SocketCreate( AF_UNIX, SOCK_STREAM, 0 );
+   if ( admin.socket == SOCKET_FAIL ) {
+      PrintError( "Admin socket creation failure\n" );
+      return FALSE;
+   }
+
+   /* Anyone who can use the socket can change the records, so only the 
+      user running luk gets to use it. The socket is made that way, so 
+      nobody else can get in before its mode is set. */
+   oldMask = umask( S_IRWXG | S_IRWXO );
+   isBound = ( bind( admin.socket, ( struct sockaddr * ) &address, 
+      sizeof( address ) ) == 0 );
+   umask( oldMask );
+
+   if ( ! isBound || listen( admin.socket, ADMIN_MAX_CLIENTS ) != 0 ||
+      ! AdminSetNonBlocking( admin.socket ) ) {
+      PrintError( "Failed to set up the admin socket at path: %s\n",
+         socketPath );
+      SocketDestroy( &admin.socket );
+      remove( socketPath );
+      return FALSE;
+   }
+
+   for ( client = 0; client < ADMIN_MAX_CLIENTS; client += 1 ) {
+      admin.clients[ client ].socket = SOCKET_FAIL;
+   }
+
+   admin.path = StrNew( socketPath );
+   admin.isActive = TRUE;
+
+   PrintMessage( "Admin socket listening at path: %s\n", socketPath );
+   return TRUE;
+}
+
+/* A socket is left behind when luk doesn't get to shut down. It's only
+   replaced if nothing answers on it anymore, and other files are left 
+   alone. */
+Bool AdminClearPath( const char *socketPath, 
+   const struct sockaddr_un *address ) {
+   struct stat fileStatus;
+   Socket probe;
+   Bool isInUse;
+
+   if ( lstat( socketPath, &fileStatus ) != 0 ) {
+      return TRUE;
+   }
+
+   if ( ! S_ISSOCK( fileStatus.st_mode ) ) {
+      PrintError( "Admin socket path is taken by another file: %s\n",
+         socketPath );
+      return FALSE;
+   }
+
+   probe = SocketCreate( AF_UNIX, SOCK_STREAM, 0 );
+   if ( probe == SOCKET_FAIL ) {
+      return FALSE;
+   }
+
+   isInUse = ( connect( probe, ( const struct sockaddr * ) address, 
+      sizeof( *address ) ) == 0 );
+   SocketDestroy( &probe );
+
+   if ( isInUse ) {
+      PrintError( "Admin socket is already in use at path: %s\n",
+         socketPath );
+      return FALSE;
+   }
+
+   return ( remove( socketPath ) == 0 );
+}
+
+Bool AdminSetNonBlocking( Socket socket ) {
+   const int flags = fcntl( socket, F_GETFL, 0 );
+   return ( flags != -1 && fcntl( socket, F_SETFL, flags | O_NONBLOCK ) != -1 );
+}
+
+void AdminShutdown( void ) {
+   int client;
+
+   if ( ! admin.isActive ) {
+      return;
+   }
+
+   for ( client = 0; client < ADMIN_MAX_CLIENTS; client += 1 ) {
+      if ( admin.clients[ client ].socket != SOCKET_FAIL ) {
+         AdminCloseClient( &admin.clients[ client ] );
+      }
+   }
+
+   SocketDestroy( &admin.socket );
+   remove( admin.path->value );
+   StrDel( admin.path );
+   admin.path = NULL;
+   admin.isActive = FALSE;
+}
+
+void AdminAddSockets( fd_set *readSockets, fd_set *writeSockets, 
+   Socket *maxSocket ) {
+   int slot;
+
+   if ( ! admin.isActive ) {
+      return;
+   }
+
+   FD_SET( admin.socket, readSockets );
+   if ( admin.socket > *maxSocket ) {
+      *maxSocket = admin.socket;
+   }
+
+   for ( slot = 0; slot < ADMIN_MAX_CLIENTS; slot += 1 ) {
+      const AdminClient *client = &admin.clients[ slot ];
+
+      if ( client->socket == SOCKET_FAIL ) {
+         continue;
+      }
+
+      /* No more lines are taken in while a listing is under way, so a
+         client can't make the replies pile up. */
+      if ( ! client->isInputDone && ! client->isClosing &&
+         client->listing == ADMIN_LISTING_NONE &&
+         client->inputSize < ADMIN_MAX_LINE_LENGTH ) {
+         FD_SET( client->socket, readSockets );
+      }
+
+      if ( client->outputSent < MemFileGetSize( &client->output ) ||
+         client->listing != ADMIN_LISTING_NONE ) {
+         FD_SET( client->socket, writeSockets );
+      }
+
+      if ( client->socket > *maxSocket ) {
+         *maxSocket = client->socket;
+      }
+   }
+}
+
+void AdminService( const fd_set *readSockets, const fd_set *writeSockets ) {
+   int slot;
+
+   if ( ! admin.isActive ) {
+      return;
+   }
+
+   if ( FD_ISSET( admin.socket, readSockets ) ) {
+      AdminAccept();
+   }
+
+   for ( slot = 0; slot < ADMIN_MAX_CLIENTS; slot += 1 ) {
+      AdminClient *client = &admin.clients[ slot ];
+
+      if ( client->socket != SOCKET_FAIL && 
+         ( FD_ISSET( client->socket, readSockets ) || 
+            FD_ISSET( client->socket, writeSockets ) ) ) {
+         AdminServiceClient( client, 
+            FD_ISSET( client->socket, readSockets ) );
+      }
+   }
+}
+
+void AdminAccept( void ) {
+   const Socket socket = accept( admin.socket, NULL, NULL );
+   AdminClient *client = NULL;
+   int slot;
+
+   if ( socket == SOCKET_FAIL ) {
+      return;
+   }
+
+   for ( slot = 0; slot < ADMIN_MAX_CLIENTS && client == NULL; slot += 1 ) {
+      if ( admin.clients[ slot ].socket == SOCKET_FAIL ) {
+         client = &admin.clients[ slot ];
+      }
+   }
+
+   if ( client == NULL || ! AdminSetNonBlocking( socket ) ) {
+      const char *refusal = "ERR Too many clients\n";
+      send( socket, refusal, strlen( refusal ), ADMIN_SEND_FLAGS );
+      SocketDestroy( &socket );
+      return;
+   }
+
+   client->socket = socket;
+   client->inputSize = 0;
+   MemFileInit( &client->output );
+   client->outputSent = 0;
+   client->listing = ADMIN_LISTING_NONE;
+   client->listingMap = NULL;
+   client->listingPrefix = NULL;
+   client->listingCursor = NULL;
+   client->totalListed = 0;
+   client->isInputDone = FALSE;
+   client->isClosing = FALSE;
+}
+
+void AdminServiceClient( AdminClient *client, Bool isReadable ) {
+   if ( isReadable && ! AdminReceive( client ) ) {
+      AdminCloseClient( client );
+      return;
+   }
+
+   /* Lines that came in during a listing are taken up once it's done. */
+   AdminContinueListing( client );
+   AdminProcessInput( client );
+
+   /* A client that is done sending gets the replies to all of its lines
+      before it's let go. */
+   if ( client->isInputDone && client->listing == ADMIN_LISTING_NONE ) {
+      client->isClosing = TRUE;
+   }
+
+   if ( ! AdminFlush( client ) || ( client->isClosing &&
+      client->outputSent == MemFileGetSize( &client->output ) ) ) {
+      AdminCloseClient( client );
+   }
+}
+
+Bool AdminReceive( AdminClient *client ) {
+   const int received = recv( client->socket, 
+      client->input + client->inputSize, 
+      ADMIN_MAX_LINE_LENGTH - client->inputSize, 0 );
+
+   if ( received > 0 ) {
+      client->inputSize += received;
+      return TRUE;
+   }
+   else if ( received == 0 ) {
+      /* The last line doesn't need to be ended. */
+      if ( client->inputSize > 0 && 
+         client->input[ client->inputSize - 1 ] != '\n' &&
+         client->inputSize < ADMIN_MAX_LINE_LENGTH ) {
+         client->input[ client->inputSize ] = '\n';
+         client->inputSize += 1;
+      }
+
+      client->isInputDone = TRUE;
+      return TRUE;
+   }
+   else {
+      return ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR );
+   }
+}
+
+void AdminProcessInput( AdminClient *client ) {
+   while ( client->listing == ADMIN_LISTING_NONE && ! client->isClosing ) {
+      char *lineEnd = ( char * ) memchr( client->input, '\n', 
+         client->inputSize );
+      size_t lineSize;
+
+      if ( lineEnd == NULL ) {
+         if ( client->inputSize == ADMIN_MAX_LINE_LENGTH ) {
+            AdminReply( client, "ERR", "Line too long", NULL );
+            client->isClosing = TRUE;
+         }
+
+         break;
+      }
+
+      lineSize = lineEnd - client->input + 1;
+      *lineEnd = '\0';
+      if ( lineEnd > client->input && *( lineEnd - 1 ) == '\r' ) {
+         *( lineEnd - 1 ) = '\0';
+      }
+
+      AdminUnescapeLine( client->input );
+      AdminExecute( client, client->input );
+
+      client->inputSize -= lineSize;
+      memmove( client->input, client->input + lineSize, client->inputSize );
+   }
+}
+
+Bool AdminFlush( AdminClient *client ) {
+   const size_t outputSize = MemFileGetSize( &client->output );
+
+   while ( client->outputSent < outputSize ) {
+      const int sent = send( client->socket, 
+         client->output.data + client->outputSent,
+         outputSize - client->outputSent, ADMIN_SEND_FLAGS );
+
+      if ( sent > 0 ) {
+         client->outputSent += sent;
+      }
+      else if ( sent == -1 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+         return TRUE;
+      }
+      else if ( sent == -1 && errno == EINTR ) {
+         continue;
+      }
+      else {
+         return FALSE;
+      }
+   }
+
+   /* Everything is sent, so the memory can be given back. */
+   MemFileClose( &client->output );
+   MemFileInit( &client->output );
+   client->outputSent = 0;
+
+   return TRUE;
+}
+
+void AdminCloseClient( AdminClient *client ) {
+   AdminEndListing( client );
+   MemFileClose( &client->output );
+   SocketDestroy( &client->socket );
+   client->socket = SOCKET_FAIL;
+}
+
+void AdminExecute( AdminClient *client, const char *line ) {
+   const char *linePos = line;
+   Str *name = AdminNextWord( &linePos );
+   const AdminCommand *command = adminCommands;
+
+   /* Empty lines are let through without a reply. */
+   if ( name == NULL ) {
+      return;
+   }
+
+   while ( command->name != NULL && strcmp( command->name, name->value ) ) {
+      command += 1;
+   }
+
+   if ( command->name != NULL ) {
+      command->handler( client, linePos );
+   }
+   else {
+      AdminReply( client, "ERR", "Unknown command:", name->value );
+   }
+
+   StrDel( name );
+}
+
+/* Lines go both ways with their newlines and backslashes escaped, as \n 
+   and \\, so records with newlines in them fit on one line. Carriage 
+   returns are escaped as \r. Other backslashes are left as they are. */
+void AdminUnescapeLine( char *line ) {
+   const char *linePos = line;
+   char *output = line;
+
+   while ( *linePos != '\0' ) {
+      if ( *linePos == '\\' && linePos[ 1 ] == 'n' ) {
+         *output = '\n';
+         linePos += 2;
+      }
+      else if ( *linePos == '\\' && linePos[ 1 ] == 'r' ) {
+         *output = '\r';
+         linePos += 2;
+      }
+      else if ( *linePos == '\\' && linePos[ 1 ] == '\\' ) {
+         *output = '\\';
+         linePos += 2;
+      }
+      else {
+         *output = *linePos;
+         linePos += 1;
+      }
+
+      output += 1;
+   }
+
+   *output = '\0';
+}
+
+/* Returns the next word of the line and moves past it, or returns NULL if
+   the line has no more words. A word with spaces in it is put in braces, 
+   like the arguments of the commands from the game. */
+Str *AdminNextWord( const char **linePos ) {
+   const char *wordStart = *linePos;
+   const char *wordEnd;
+
+   while ( isspace( *wordStart ) ) {
+      wordStart += 1;
+   }
+
+   if ( *wordStart == '{' ) {
+      wordStart += 1;
+      wordEnd = wordStart;
+      while ( *wordEnd != '\0' && *wordEnd != '}' ) {
+         wordEnd += 1;
+      }
+
+      *linePos = ( *wordEnd == '}' ) ? wordEnd + 1 : wordEnd;
+      return StrNewSub( wordStart, wordEnd - wordStart );
+   }
+
+   wordEnd = wordStart;
+   while ( *wordEnd != '\0' && ! isspace( *wordEnd ) ) {
+      wordEnd += 1;
+   }
+
+   *linePos = wordEnd;
+
+   if ( wordEnd == wordStart ) {
+      return NULL;
+   }
+
+   return StrNewSub( wordStart, wordEnd - wordStart );
+}
+
+/* Adds a line to the replies: the status, followed by the parts that are
+   given. Lines that start with "=" carry the entries of a listing, and
+   every command is answered with a last line starting with "OK" or 
+   "ERR". */
+void AdminReply( AdminClient *client, const char *status, 
+   const char *first, const char *second ) {
+   MemFileAdd( &client->output, status, strlen( status ) );
+
+   if ( first != NULL ) {
+      MemFileAdd( &client->output, " ", 1 );
+      AdminAddEscaped( client, first );
+   }
+
+   if ( second != NULL ) {
+      MemFileAdd( &client->output, " ", 1 );
+      AdminAddEscaped( client, second );
+   }
+
+   MemFileAdd( &client->output, "\n", 1 );
+}
+
+void AdminAddEscaped( AdminClient *client, const char *text ) {
+   const char *textPos = text;
+
+   while ( *textPos != '\0' ) {
+      const size_t plainLength = strcspn( textPos, "\\\n\r" );
+
+      MemFileAdd( &client->output, textPos, plainLength );
+      textPos += plainLength;
+
+      if ( *textPos == '\\' ) {
+         MemFileAdd( &client->output, "\\\\", 2 );
+         textPos += 1;
+      }
+      else if ( *textPos == '\n' ) {
+         MemFileAdd( &client->output, "\\n", 2 );
+         textPos += 1;
+      }
+      else if ( *textPos == '\r' ) {
+         MemFileAdd( &client->output, "\\r", 2 );
+         textPos += 1;
+      }
+   }
+}
+
+/* Adds an entry of a listing. The name is written like a word of a command
+   line, so the client can tell where it ends. */
+void AdminReplyEntry( AdminClient *client, const Str *name, 
+   const char *value ) {
+   MemFile nameText;
+
+   MemFileInit( &nameText );
+   CommandAddArgument( &nameText, name );
+   MemFileAdd( &nameText, "", 1 );
+
+   AdminReply( client, "=", ( const char * ) nameText.data, value );
+   MemFileClose( &nameText );
+}
+
+void AdminReplyNumber( AdminClient *client, const char *name,
+   unsigned long number ) {
+   char numberText[ 32 ];
+
+   sprintf( numberText, "%lu", number );
+   AdminReply( client, "=", name, numberText );
+}
+
+/* Takes ownership of the map name and the prefix. */
+void AdminStartListing( AdminClient *client, AdminListing listing,
+   Str *map, Str *prefix ) {
+   client->listing = listing;
+   client->listingMap = map;
+   client->listingPrefix = prefix;
+   client->listingCursor = NULL;
+   client->totalListed = 0;
+
+   AdminContinueListing( client );
+}
+
+/* Adds the next page of the listing, once the last one has been sent. */
+void AdminContinueListing( AdminClient *client ) {
+   Str *names[ ADMIN_PAGE_SIZE ];
+   int entriesListed;
+   int entry;
+
+   if ( client->listing == ADMIN_LISTING_NONE ||
+      client->outputSent < MemFileGetSize( &client->output ) ) {
+      return;
+   }
+
+   if ( client->listing == ADMIN_LISTING_DUMP ) {
+      AdminContinueDump( client );
+      return;
+   }
+
+   if ( client->listing == ADMIN_LISTING_MAPS ) {
+      entriesListed = DatabaseListMaps( client->listingCursor, names, 
+         ADMIN_PAGE_SIZE );
+   }
+   else {
+      entriesListed = DatabaseListMapKeys( client->listingMap, 
+         client->listingPrefix, client->listingCursor, names, 
+         ADMIN_PAGE_SIZE );
+   }
+
+   if ( entriesListed < 0 ) {
+      AdminReply( client, "ERR", ( client->listingCursor == NULL ) ?
+         "No such map" : "Map removed during the listing", NULL );
+      AdminEndListing( client );
+      return;
+   }
+
+   for ( entry = 0; entry < entriesListed; entry += 1 ) {
+      Str *name = names[ entry ];
+
+      if ( client->listing == ADMIN_LISTING_MAPS ) {
+         AdminReplyEntry( client, name, NULL );
+         client->totalListed += 1;
+      }
+      else {
+         /* Records that have expired but are not removed yet are left 
+            out. */
+         const Str *value = DatabaseRetrieveFromMap( client->listingMap, 
+            name );
+         if ( value != NULL ) {
+            AdminReplyEntry( client, name, value->value );
+            client->totalListed += 1;
+         }
+      }
+
+      StrDel( client->listingCursor );
+      client->listingCursor = name;
+   }
+
+   /* A short page is the last one. The listing ends with the number of
+      entries listed. */
+   if ( entriesListed < ADMIN_PAGE_SIZE ) {
+      char totalText[ 32 ];
+
+      sprintf( totalText, "%u", client->totalListed );
+      AdminReply( client, "OK", totalText, NULL );
+      AdminEndListing( client );
+   }
+}
+
+/* The lines of the dump are sent as the entries of the listing. It ends
+   with the number of records dumped. */
+void AdminContinueDump( AdminClient *client ) {
+   MemFile page;
+   Bool isDumping;
+   char *line;
+   char *pageEnd;
+
+   MemFileInit( &page );
+   isDumping = DatabaseContinueDump( &client->dump, &page, ADMIN_PAGE_SIZE );
+
+   line = ( char * ) page.data;
+   pageEnd = line + MemFileGetSize( &page );
+   while ( line < pageEnd ) {
+      char *lineEnd = ( char * ) memchr( line, '\n', pageEnd - line );
+
+      *lineEnd = '\0';
+      AdminReply( client, "=", line, NULL );
+      line = lineEnd + 1;
+   }
+
+   MemFileClose( &page );
+
+   if ( ! isDumping ) {
+      char totalText[ 32 ];
+
+      sprintf( totalText, "%u", client->dump.totalRecords );
+      AdminReply( client, "OK", totalText, NULL );
+      AdminEndListing( client );
+   }
+}
+
+void AdminEndListing( AdminClient *client ) {
+   if ( client->listing == ADMIN_LISTING_DUMP ) {
+      DatabaseEndDump( &client->dump );
+   }
+
+   StrDel( client->listingMap );
+   StrDel( client->listingPrefix );
+   StrDel( client->listingCursor );
+   client->listingMap = NULL;
+   client->listingPrefix = NULL;
+   client->listingCursor = NULL;
+   client->listing = ADMIN_LISTING_NONE;
+}
+
+/* Saves the changes made since the last save, if there are any. */
+Bool AdminSaveDatabase( AdminClient *client ) {
+   const Str *filePath = DatabaseGetFilePath();
+
+   if ( filePath == NULL ) {
+      AdminReply( client, "ERR", "No database file", NULL );
+      return FALSE;
+   }
+
+   if ( DatabaseIsSaveNeeded() && ! DatabaseSave( filePath->value ) ) {
+      AdminReply( client, "ERR", "Failed to save the database", NULL );
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+void AdminCommandHelp( AdminClient *client, const char *args ) {
+   const AdminCommand *command;
+
+   ( void ) args;
+
+   for ( command = adminCommands; command->name != NULL; command += 1 ) {
+      AdminReply( client, "=", command->usage, NULL );
+   }
+
+   AdminReply( client, "OK", NULL, NULL );
+}
+
+void AdminCommandGet( AdminClient *client, const char *args ) {
+   Str *map = AdminNextWord( &args );
+   Str *key = AdminNextWord( &args );
+
+   if ( key == NULL ) {
+      AdminReply( client, "ERR", "Usage: get <map> <key>", NULL );
+   }
+   else {
+      const Str *value = DatabaseRetrieveFromMap( map, key );
+
+      if ( value != NULL ) {
+         AdminReply( client, "OK", value->value, NULL );
+      }
+      else {
+         AdminReply( client, "ERR", "No such record", NULL );
+      }
+   }
+
+   StrDel( map );
+   StrDel( key );
+}
+
+void AdminCommandSet( AdminClient *client, const char *args ) {
+   Str *map = AdminNextWord( &args );
+   Str *key = AdminNextWord( &args );
+   Str *value;
+
+   if ( key == NULL ) {
+      AdminReply( client, "ERR", "Usage: set <map> <key> <value>", NULL );
+      StrDel( map );
+      return;
+   }
+
+   /* The value is the rest of the line, so it can have spaces in it. */
+   while ( isspace( *args ) ) {
+      args += 1;
+   }
+
+   value = StrNew( args );
+
+   /* Map names have to fit in the database file. */
+   if ( map->length > LUKD_MAX_MAP_LENGTH ) {
+      AdminReply( client, "ERR", "Map name too long", NULL );
+   }
+   else if ( ! DatabaseIsRecordName( key ) ) {
+      AdminReply( client, "ERR", "Record names should begin with a letter",
+         NULL );
+   }
+   else if ( DatabaseStoreInMap( map, key, value ) ) {
+      AdminReply( client, "OK", NULL, NULL );
+   }
+   else {
+      AdminReply( client, "ERR", "Failed to store the record", NULL );
+   }
+
+   StrDel( map );
+   StrDel( key );
+   StrDel( value );
+}
+
+void AdminCommandDelete( AdminClient *client, const char *args ) {
+   Str *map = AdminNextWord( &args );
+   Str *key = AdminNextWord( &args );
+
+   if ( key == NULL ) {
+      AdminReply( client, "ERR", "Usage: del <map> <key>", NULL );
+   }
+   else if ( DatabaseRemoveFromMap( map, key ) ) {
+      AdminReply( client, "OK", NULL, NULL );
+   }
+   else {
+      AdminReply( client, "ERR", "No such record", NULL );
+   }
+
+   StrDel( map );
+   StrDel( key );
+}
+
+void AdminCommandMaps( AdminClient *client, const char *args ) {
+   ( void ) args;
+   AdminStartListing( client, ADMIN_LISTING_MAPS, NULL, NULL );
+}
+
+void AdminCommandRecords( AdminClient *client, const char *args ) {
+   Str *map = AdminNextWord( &args );
+   Str *prefix = AdminNextWord( &args );
+
+   if ( map == NULL ) {
+      AdminReply( client, "ERR", "Usage: records <map> [<key prefix>]", 
+         NULL );
+      return;
+   }
+
+   /* Without a prefix, all of the keys are listed. */
+   if ( prefix == NULL ) {
+      prefix = StrNew( "" );
+   }
+
+   AdminStartListing( client, ADMIN_LISTING_RECORDS, map, prefix );
+}
+
+void AdminCommandDump( AdminClient *client, const char *args ) {
+   Str *map = AdminNextWord( &args );
+
+   DatabaseStartDump( &client->dump, map );
+   StrDel( map );
+
+   AdminStartListing( client, ADMIN_LISTING_DUMP, NULL, NULL );
+}
+
+void AdminCommandStats( AdminClient *client, const char *args ) {
+   DatabaseStats stats;
+   unsigned long totalClients = 0;
+   int slot;
+
+   ( void ) args;
+
+   DatabaseGetStats( &stats );
+   for ( slot = 0; slot < ADMIN_MAX_CLIENTS; slot += 1 ) {
+      if ( admin.clients[ slot ].socket != SOCKET_FAIL ) {
+         totalClients += 1;
+      }
+   }
+
+   AdminReplyNumber( client, "maps", stats.totalMaps );
+   AdminReplyNumber( client, "loaded_maps", stats.loadedMaps );
+   AdminReplyNumber( client, "loaded_records", stats.totalRecords );
+   AdminReplyNumber( client, "temporary_records", 
+      stats.totalTemporaryRecords );
+   AdminReplyNumber( client, "keys", stats.totalKeys );
+   AdminReplyNumber( client, "memory_used", 
+      ( unsigned long ) stats.memoryUsed );
+   AdminReplyNumber( client, "memory_budget", 
+      ( unsigned long ) stats.memoryBudget );
+   AdminReplyNumber( client, "unsaved_updates", stats.updatesSinceLastSave );
+   AdminReplyNumber( client, "admin_clients", totalClients );
+   StatsReport( AdminReplyStatsLine, client );
+   AdminReply( client, "OK", NULL, NULL );
+}
+
+void AdminReplyStatsLine( void *context, const char *name, 
+   const char *text ) {
+   AdminReply( ( AdminClient * ) context, "=", name, text );
+}
+
+void AdminCommandSave( AdminClient *client, const char *args ) {
+   ( void ) args;
+
+   if ( AdminSaveDatabase( client ) ) {
+      AdminReply( client, "OK", NULL, NULL );
+   }
+}
+
+void AdminCommandSnapshot( AdminClient *client, const char *args ) {
+   Str *snapshotPath = AdminNextWord( &args );
+
+   if ( snapshotPath == NULL ) {
+      AdminReply( client, "ERR", "Usage: snapshot <path>", NULL );
+      return;
+   }
+
+   /* A save never writes over the database file, it replaces it, so the 
+      snapshot can be a second name for the saved file rather than a 
+      copy of it. */
+   if ( AdminSaveDatabase( client ) ) {
+      if ( FileLink( DatabaseGetFilePath()->value, snapshotPath->value ) ) {
+         PrintMessage( "Database snapshot taken at path: %s\n",
+            snapshotPath->value );
+         AdminReply( client, "OK", NULL, NULL );
+      }
+      else {
+         AdminReply( client, "ERR", "Failed to create the snapshot file",
+            NULL );
+      }
+   }
+
+   StrDel( snapshotPath );
+}
+
+void AdminCommandQuit( AdminClient *client, const char *args ) {
+   ( void ) args;
+   AdminReply( client, "OK", NULL, NULL );
+   client->isClosing = TRUE;
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+
+   Admin socket, through which the records of a running luk can be looked
+   at and changed without going through the wad or restarting luk. It's a
+   local stream socket that takes one command per line, and is serviced by
+   the main loop along with the RCON server.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef ADMIN_H
+#define ADMIN_H
+
+#include "gentype.h"
+#include "strutil.h"
+#include "memfile.h"
+
+#include "socket.h"
+#include "database.h"
+
+#define ADMIN_MAX_CLIENTS 4
+/* Longest command line a client can send, which leaves room for a record
+   value of the maximum size. */
+#define ADMIN_MAX_LINE_LENGTH 2048
+/* Number of entries a listing adds to the output at a time. The next page
+   is only made once the client has taken in the one before it, so a long 
+   listing doesn't hold up the main loop or pile up in memory. */
+#define ADMIN_PAGE_SIZE 64
+
+typedef enum {
+   ADMIN_LISTING_NONE,
+   ADMIN_LISTING_MAPS,
+   ADMIN_LISTING_RECORDS,
+   ADMIN_LISTING_DUMP
+} AdminListing;
+
+typedef struct {
+   Socket socket;
+   /* Received data that doesn't make up a whole command line yet, or lines
+      waiting for a listing to finish. */
+   char input[ ADMIN_MAX_LINE_LENGTH ];
+   size_t inputSize;
+   /* Replies not yet sent. */
+   MemFile output;
+   size_t outputSent;
+   /* Listing under way. It picks up after the last entry listed, so the
+      records can change between pages. */
+   AdminListing listing;
+   Str *listingMap;
+   Str *listingPrefix;
+   Str *listingCursor;
+   unsigned int totalListed;
+   DatabaseDump dump;
+   /* The client has sent all it's going to send. */
+   Bool isInputDone;
+   /* The client is let go once the replies are sent. */
+   Bool isClosing;
+} AdminClient;
+
+typedef void ( *AdminCommandHandler )( AdminClient *client, 
+   const char *args );
+
+typedef struct {
+   const char *name;
+   AdminCommandHandler handler;
+   const char *usage;
+} AdminCommand;
+
+typedef struct {
+   Bool isActive;
+   Socket socket;
+   Str *path;
+   /* Unused slots have no socket. */
+   AdminClient clients[ ADMIN_MAX_CLIENTS ];
+} AdminServer;
+
+/* Public prototypes: */
+/* Creates the socket at the given path. A stale socket left at the path by
+   an earlier run is replaced. */
+Bool AdminInit( const char *socketPath );
+void AdminShutdown( void );
+/* Adds the sockets the admin socket is waiting on to the sets passed to
+   select(), and raises the highest socket if needed. */
+void AdminAddSockets( fd_set *readSockets, fd_set *writeSockets, 
+   Socket *maxSocket );
+/* Services the sockets that select() found ready. */
+void AdminService( const fd_set *readSockets, const fd_set *writeSockets );
+
+#endif
@@ -31,6 +31,9 @@
 #include "reply.h"
 #include "command.h"
 #include "handler.h"
+#include "database.h"
+#include "stats.h"
+#include "platform.h"
 #include "print.h"
 
 /* Nice little database to organize available commands. The command names
@@ -43,8 +46,16 @@ static const command_info_t commandsDatabase[] = {
    { "RETRIEVE_DATE", HandlerRetrieveDate },
    { "RETRIEVE_STRING_INITIATE", HandlerRetrieveStringInit },
    { "RETRIEVE_STRING_SEGMENT", HandlerRetrieveStringSegment },
+   { "RETRIEVE_RANGE", HandlerRetrieveRange },
+   { "RETRIEVE_PREFIX", HandlerRetrievePrefix },
+   { "RETRIEVE_RANK", HandlerRetrieveRank },
+   { "RETRIEVE_TOP", HandlerRetrieveTop },
+   { "STORE_P", HandlerStorePlayer },
+   { "RETRIEVE_P", HandlerRetrievePlayer },
+   { "DELETE_P", HandlerDeletePlayer },
    { "PRINT_DATABASE", HandlerPrintDatabase },
    { "PRINT", HandlerPrint },
+   { "STATS", HandlerPrintStats },
    /* This statement must be present and should be the last statement
       in this database because it indicates the end of the database
       to the functions that use it. */
@@ -54,6 +65,8 @@ static const command_info_t commandsDatabase[] = {
 /* Private prototypes: */
 void CommandBuildArguments( command_t *command, const char *argData, 
    const Str *action );
+const char *CommandBuildFlags( command_t *command, const char *flagData,
+   const Str *action );
 const command_info_t *CommandGetInfo( const Str *name );
 
 command_t *CommandCreate( const Str *commandData ) {
@@ -78,7 +91,10 @@ command_t *CommandCreate( const Str *commandData ) {
       command = ( command_t * ) malloc( sizeof( command_t ) );
       if ( command != NULL ) {
          command->handler = commandInfo->handler;
+         command->action = commandInfo->action;
          command->argsCount = 0;
+         command->flags = 0;
+         commandPos = CommandBuildFlags( command, commandPos, action );
          CommandBuildArguments( command, commandPos, action );
       }
    }
@@ -86,6 +102,7 @@ command_t *CommandCreate( const Str *commandData ) {
    else {
       PrintNotice( "Unknown action: %s. Discarding...\n", 
          action->value );
+      StatsCount( STATS_DROPS );
    }
 
    StrDel( action );
@@ -106,6 +123,33 @@ const command_info_t *CommandGetInfo( const Str *action ) {
    return commandInfo;
 }
 
+const char *CommandBuildFlags( command_t *command, const char *flagData,
+   const Str *action ) {
+   const char *flagPos = flagData;
+
+   if ( *flagPos != CMD_FLAG_SEPARATOR ) {
+      return flagPos;
+   }
+
+   flagPos += 1;
+   while ( isalpha( *flagPos ) ) {
+      switch ( toupper( *flagPos ) ) {
+         case 'G':
+            command->flags |= CMD_FLAG_GLOBAL;
+            break;
+
+         default:
+            PrintNotice( "Unknown flag %c for command: %s. Ignoring...\n",
+               *flagPos, action->value );
+            break;
+      }
+
+      flagPos += 1;
+   }
+
+   return flagPos;
+}
+
 void CommandBuildArguments( command_t *command, const char *argData, 
    const Str *action ) {
    const char *argPos = argData;
@@ -170,7 +214,19 @@ void CommandBuildArguments( command_t *command, const char *argData,
 }
 
 void CommandExecute( const command_t *command ) {
-   command->handler( command );
+   const unsigned long long startTime = getMicroseconds();
+
+   /* The scope only lasts for the command. */
+   if ( command->flags & CMD_FLAG_GLOBAL ) {
+      DatabaseSetScope( DB_SCOPE_GLOBAL );
+      command->handler( command );
+      DatabaseSetScope( DB_SCOPE_MAP );
+   }
+   else {
+      command->handler( command );
+   }
+
+   StatsAddCommandTime( command->action, startTime );
 }
 
 void CommandDestroy( command_t *command ) {
@@ -184,3 +240,26 @@ void CommandDestroy( command_t *command ) {
       free( command );
    }
 }
+
+/* A string from a brace argument can't hold a closing brace, and a string
+   from any other argument can't hold a space, so every string that came
+   in as an argument can be written back. */
+void CommandAddArgument( MemFile *output, const Str *argument ) {
+   Bool isBraced = ( argument->length == 0 || argument->value[ 0 ] == '{' );
+   unsigned int charNum;
+
+   for ( charNum = 0; charNum < argument->length && ! isBraced; 
+      charNum += 1 ) {
+      isBraced = ( isspace( argument->value[ charNum ] ) != 0 );
+   }
+
+   if ( isBraced ) {
+      MemFileAdd( output, "{", 1 );
+   }
+
+   MemFileAdd( output, argument->value, argument->length );
+
+   if ( isBraced ) {
+      MemFileAdd( output, "}", 1 );
+   }
+}
@@ -34,6 +34,7 @@
 
 #include "gentype.h"
 #include "strutil.h"
+#include "memfile.h"
 
 #define LUK_PRINT_ERROR_MESSAGES FALSE
 #define LUK_PRINT_MESSAGES TRUE
@@ -41,10 +42,20 @@
 /* We will put a static argument limit for now. */
 #define LUK_COMMAND_MAXIMUM_ARGUMENTS 5
 
+/* Flags are written right after the action, following a colon, like in
+   STORE:G. Each letter is a flag. */
+#define CMD_FLAG_SEPARATOR ':'
+/* G: Work on the global records instead of the records of the current 
+   map. */
+#define CMD_FLAG_GLOBAL 0x1
+
 typedef struct command_struct_t {
    void ( *handler ) ( const struct command_struct_t *command );
+   /* Name of the action, as it's found in the command database. */
+   const char *action;
    const Str *args[ LUK_COMMAND_MAXIMUM_ARGUMENTS ];
    int argsCount;
+   int flags;
 } command_t;
 
 /* This struct is used for convenience to centralize the name and handler
@@ -57,5 +68,8 @@ typedef struct {
 command_t *CommandCreate( const Str *commandData );
 void CommandExecute( const command_t *command );
 void CommandDestroy( command_t *command );
+/* Adds a string to the output the way it would be written as an argument,
+   in braces when it has to be, so it's read back the same way. */
+void CommandAddArgument( MemFile *output, const Str *argument );
 
 #endif
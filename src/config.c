@@ -40,6 +40,15 @@ static ConfigParameter parameters[] = {
    { "server_password", NULL, TRUE },
    { "database_path", NULL, TRUE },
    { "database_save_on_store", NULL, FALSE },
+   { "database_ranked_keys", NULL, FALSE },
+   { "database_memory_budget", NULL, FALSE },
+   { "database_compression", NULL, FALSE },
+   { "database_backups", NULL, FALSE },
+   { "database_dump_path", NULL, FALSE },
+   { "admin_socket_path", NULL, FALSE },
+   { "log_level", NULL, FALSE },
+   { "query_log_path", NULL, FALSE },
+   { "stats_interval", NULL, FALSE },
    { NULL, NULL, FALSE },
 };
 
@@ -24,6 +24,9 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+
+#include "memfile.h"
 
 #include "database.h"
 #include "lukd.h"
@@ -32,19 +35,112 @@
 /* Private functions */
 static void DatabaseAppendMapEntry( DatabaseMapEntry *entry );
 static DatabaseMapEntry *DatabaseCreateMapEntry( const Str *mapName );
-static Bool DatabaseAppendRecord( DatabaseRecord *record );
+static DatabaseMapEntry *DatabaseFindMapEntry( const Str *mapName );
+static DatabaseMapEntry *DatabaseFindTargetMap( void );
+static DatabaseMapEntry *DatabaseGetTargetMap( void );
+static const Str *DatabaseRetrieveFromFile( const DatabaseMapEntry *entry,
+   const Str *player, const Str *name );
+static void DatabaseLoadMapEntry( DatabaseMapEntry *entry );
+static void DatabaseUnloadMapEntry( DatabaseMapEntry *entry );
+static void DatabaseEvictMapEntry( DatabaseMapEntry *entry );
+static void DatabaseEnforceMemoryBudget( void );
+static void DatabaseSaveToUnload( void );
+static void DatabaseTouchMapEntry( DatabaseMapEntry *entry );
+static void DatabaseUnlinkMapEntry( DatabaseMapEntry *entry );
+static void DatabaseMarkDirty( DatabaseMapEntry *entry );
+static void DatabaseAccountRecord( const DatabaseRecord *record, 
+   Bool isAdded );
+static void DatabaseDestroyFileSections( DatabaseFileSection *section );
+static DatabaseRecord *DatabaseAllocateRecord( DatabaseRecordStore *store );
+static void DatabaseFreeRecord( DatabaseRecordStore *store,
+   DatabaseRecord *record );
+static Bool DatabaseAppendRecord( DatabaseRecordStore *store,
+   DatabaseRecord *record );
+static Bool DatabaseSetRecordValue( DatabaseRecord *record, 
+   const Str *value );
 static void DatabaseDestroyMapEntry( DatabaseMapEntry *entry );
+static void DatabaseInitRecordStore( DatabaseRecordStore *store );
+static void DatabaseDestroyRecordStore( DatabaseRecordStore *store );
+static DatabaseRecordStore *DatabaseGetRecordStore( 
+   DatabaseRecord *record );
+static DatabaseRecord *DatabaseFindRecord( const DatabaseRecordStore *store,
+   const Symbol *key );
+static Bool DatabaseIndexRecord( DatabaseRecordStore *store,
+   DatabaseRecord *record );
+static void DatabaseUnindexRecord( DatabaseRecordStore *store,
+   const DatabaseRecord *record );
+static void DatabaseGrowBuckets( DatabaseRecordStore *store );
+static DatabasePlayerEntry *DatabaseFindPlayer( const DatabaseMapEntry *entry,
+   const Str *name, unsigned int hash );
+static DatabasePlayerEntry *DatabaseAddPlayer( DatabaseMapEntry *entry,
+   const Str *name );
+static void DatabaseGrowPlayerBuckets( DatabaseMapEntry *entry );
+static void DatabaseDestroyPlayer( DatabasePlayerEntry *player );
+static void DatabaseRemoveExpiredRecords( void );
+static int DatabaseListKeys( const SkipListNode *node, const Str *last,
+   const Str *prefix, Str **keys, int limit );
+static int DatabaseFindRanking( const Str *key );
+static void DatabaseRankRecord( DatabaseMapEntry *entry, 
+   DatabaseRecord *record );
+static int DatabaseCompareRanked( const void *first, const void *second );
+static void DatabaseShutdownRankings( void );
+static DatabaseRecord *DatabaseStoreRecord( DatabaseMapEntry *entry,
+   DatabasePlayerEntry *player, const Str *name, const Str *value );
+static Bool DatabaseSetRecordExpiry( DatabaseRecordStore *store, 
+   const Str *name, time_t expiresAt );
+static void DatabaseClearExpiry( DatabaseRecord *record );
+static const Str *DatabaseRetrieveRecord( const DatabaseRecordStore *store,
+   const Str *name );
+static void DatabaseRemoveRecord( DatabaseRecord *record );
+static void DatabaseDestroyRecord( DatabaseRecord *record );
+static void DatabaseExpireRecord( TimerWheelNode *node );
+static int DatabaseCalculateStoreSize( const DatabaseRecordStore *store );
+static DatabaseMapEntry *DatabaseUseMapEntry( const Str *mapName,
+   Bool isCreated );
+static void DatabaseDumpHeader( DatabaseDump *dump, MemFile *output );
+static void DatabaseDumpMapEntry( DatabaseDump *dump, 
+   const DatabaseMapEntry *entry, MemFile *output );
+static int DatabaseDumpRecords( DatabaseDump *dump, 
+   const DatabaseRecordStore *store, int limit, MemFile *output );
+static int DatabaseDumpNextPlayer( DatabaseDump *dump, 
+   const DatabaseMapEntry *entry, MemFile *output );
+static void DatabaseDumpNextMap( DatabaseDump *dump, 
+   const DatabaseMapEntry *entry );
+static void DatabaseDumpText( MemFile *output, const char *label, 
+   const char *text );
+static void DatabaseDumpNumber( MemFile *output, const char *label, 
+   unsigned long number, const char *unit );
 
 /* Database variable: */
 static Database database;
 
+/* Rankings are set up before the database is loaded, so they live outside
+   of the database variable. */
+static DatabaseRanking rankings[ DATABASE_MAX_RANKINGS ];
+static int totalRankings = 0;
+
 void DatabaseInitialize( void ) {
    database.firstMap = NULL;
    database.currentMap = NULL;
+   database.globalMap = NULL;
+   database.scope = DB_SCOPE_MAP;
    database.totalMaps = 0;
    database.totalRecords = 0;
    database.isOperational = TRUE;
    database.updatesSinceLastSave = 0;
+   database.memoryBudget = 0;
+   database.isFileCompressed = FALSE;
+   database.totalBackups = DATABASE_DEFAULT_BACKUPS;
+   database.memoryUsed = 0;
+   database.lruFirst = NULL;
+   database.lruLast = NULL;
+   database.nextSaveTime = 0;
+   database.saveRetryDelay = 0;
+   database.filePath = NULL;
+   database.isReadOnly = FALSE;
+   database.fileValue = NULL;
+   TimerWheelInit( &database.expiryWheel, ( TimerWheelTick ) time( NULL ) );
+   SymbolTableInit( &database.keys );
 }
 
 int DatabaseInitializeFile( const char *pathToStorage ) {
@@ -52,6 +148,7 @@ int DatabaseInitializeFile( const char *pathToStorage ) {
 
    /* Initialize the necessary fields. */
    DatabaseInitialize();
+   database.filePath = StrNew( pathToStorage );
 
    /* Get previous records from database file. */
    isImported = LukdImportDatabase( pathToStorage );
@@ -69,44 +166,42 @@ int DatabaseInitializeFile( const char *pathToStorage ) {
 }
 
 Bool DatabaseIsSaveNeeded( void ) {
-   return ( database.updatesSinceLastSave > 0 );
+   return ( database.updatesSinceLastSave > 0 && ! database.isReadOnly );
 }
 
 Bool DatabaseChangeMap( const Str *newCurrentMapName ) {
    Str *mapName = StrDown( newCurrentMapName );
    DatabaseMapEntry *newMapEntry;
 
-   /* If the database has no map entries, we create a new entry for
-      this map and set it as the current map. */
-   if ( database.totalMaps == 0 ) {
-      newMapEntry = DatabaseCreateMapEntry( mapName );
-      DatabaseAppendMapEntry( newMapEntry );
-   }
    /* Bail out if the new map name is the same name as that
       of the current map. */
-   else if ( StrIsEqual( mapName, database.currentMap->name ) ) {
+   if ( database.currentMap != NULL && 
+      StrIsEqual( mapName, database.currentMap->name ) ) {
       StrDel( mapName );
       return FALSE;
    }
-   /* Otherwise, search the existing map series. */
-   else {
-      newMapEntry = database.firstMap;
-      while ( newMapEntry != NULL && 
-         ! StrIsEqual( newMapEntry->name, mapName ) ) {
-         newMapEntry = newMapEntry->nextEntry;
-      }
 
-      /* If the search is successful at locating an entry with the same name
-         as the one given, make the entry the current entry. Otherwise, make
-         a new entry with the given name and then make it current. */
-      if ( newMapEntry == NULL ) {
-         newMapEntry = DatabaseCreateMapEntry( mapName );
-         DatabaseAppendMapEntry( newMapEntry );
-      }
+   /* Search the existing map series. If the search is successful at
+      locating an entry with the same name as the one given, make the entry
+      the current entry. Otherwise, make a new entry with the given name
+      and then make it current. */
+   newMapEntry = DatabaseFindMapEntry( mapName );
+   if ( newMapEntry == NULL ) {
+      newMapEntry = DatabaseCreateMapEntry( mapName );
+      DatabaseAppendMapEntry( newMapEntry );
    }
+   else if ( ! newMapEntry->isLoaded ) {
+      DatabaseLoadMapEntry( newMapEntry );
+   }
+
+   DatabaseTouchMapEntry( newMapEntry );
 
    database.currentMap = newMapEntry;
    StrDel( mapName );
+
+   /* Make room for the new map by unloading the maps played the longest
+      time ago. */
+   DatabaseEnforceMemoryBudget();
    /* PrintMessage( "Map: %s\n", mapName->value ); */
 
    return TRUE;
@@ -115,258 +210,1780 @@ Bool DatabaseChangeMap( const Str *newCurrentMapName ) {
 DatabaseMapEntry *DatabaseCreateMapEntry( const Str *mapName ) {
    DatabaseMapEntry *mapEntry = 
       ( DatabaseMapEntry * ) malloc( sizeof( DatabaseMapEntry ) );
+   int ranking;
 
    mapEntry->name = StrCopy( mapName );
    mapEntry->nextEntry = NULL;
-   mapEntry->totalRecords = 0;
-   mapEntry->firstRecord = NULL;
+   mapEntry->isLoaded = TRUE;
+   mapEntry->fileSections = NULL;
+   mapEntry->savedSections = NULL;
+   mapEntry->isDirty = FALSE;
+   mapEntry->memoryUsed = 0;
+   mapEntry->lruPrev = NULL;
+   mapEntry->lruNext = NULL;
+   DatabaseInitRecordStore( &mapEntry->records );
+
+   for ( ranking = 0; ranking < DATABASE_MAX_RANKINGS; ranking += 1 ) {
+      mapEntry->rankedRecords[ ranking ].head = NULL;
+   }
+
+   mapEntry->firstPlayer = NULL;
+   mapEntry->totalPlayers = 0;
+   mapEntry->totalPlayerBuckets = DATABASE_INITIAL_PLAYER_BUCKETS;
+   mapEntry->playerBuckets = ( DatabasePlayerEntry ** ) calloc(
+      mapEntry->totalPlayerBuckets, sizeof( DatabasePlayerEntry * ) );
 
    return mapEntry;
 }
 
+void DatabaseInitRecordStore( DatabaseRecordStore *store ) {
+   store->firstBlock = NULL;
+   store->lastBlock = NULL;
+   store->freeRecords = NULL;
+   store->totalRecords = 0;
+   store->totalBuckets = DATABASE_INITIAL_BUCKETS;
+   store->buckets = ( DatabaseRecordBucket * ) calloc( store->totalBuckets,
+      sizeof( DatabaseRecordBucket ) );
+   SkipListInit( &store->orderedKeys );
+}
+
+DatabaseRecordStore *DatabaseGetRecordStore( DatabaseRecord *record ) {
+   if ( record->player != NULL ) {
+      return &record->player->records;
+   }
+   else {
+      return &record->mapEntry->records;
+   }
+}
+
 void DatabaseAppendMapEntry( DatabaseMapEntry *entry ) {
    entry->nextEntry = database.firstMap;
    database.firstMap = entry;
    database.totalMaps += 1;
 }
 
+DatabaseMapEntry *DatabaseFindMapEntry( const Str *mapName ) {
+   DatabaseMapEntry *entry = database.firstMap;
+
+   while ( entry != NULL && ! StrIsEqual( entry->name, mapName ) ) {
+      entry = entry->nextEntry;
+   }
+
+   return entry;
+}
+
 const Str *DatabaseGetCurrentMap( void ) {
    return database.currentMap->name;
 }
 
-void DatabaseStore( const Str *name, const Str *value ) {
-   DatabaseRecord *record;
+void DatabaseSetScope( DatabaseScope scope ) {
+   database.scope = scope;
+}
 
-   if ( name == NULL || value == NULL ) {
-      return;
+/* Returns the map the records are read from, which might not be loaded
+   yet, or NULL if the global entry doesn't exist yet. */
+DatabaseMapEntry *DatabaseFindTargetMap( void ) {
+   if ( database.scope != DB_SCOPE_GLOBAL ) {
+      return database.currentMap;
    }
 
-   /* PrintMessage( "Storing: %s = %s\n", name->value, value->value ); */
-
-   /* Search for the record to update. */
-   record = database.currentMap->firstRecord;
-   while ( record != NULL && ! StrIsEqual( record->key, name ) ) {
-      record = record->nextRecord;
+   /* The global entry might have been loaded from the database file, in
+      which case it's already in the map list. */
+   if ( database.globalMap == NULL ) {
+      Str *globalName = StrNew( DATABASE_GLOBAL_MAP );
+      database.globalMap = DatabaseFindMapEntry( globalName );
+      StrDel( globalName );
    }
 
-   /* Update the existing record. */
-   if ( record != NULL ) {
-      StrDel( record->value );
-      record->value = StrCopy( value );
+   return database.globalMap;
+}
+
+DatabaseMapEntry *DatabaseGetTargetMap( void ) {
+   if ( database.scope != DB_SCOPE_GLOBAL ) {
+      return database.currentMap;
    }
-   /* Otherwise, create a new record for the map if one wasn't found with
-      the given key or there are no records for the map at all. */
-   else {
-      record = ( DatabaseRecord * ) malloc( sizeof( DatabaseRecord ) );
-      if ( record == NULL ) {
-         return;
-      }
 
-      record->key = StrCopy( name );
-      record->value = StrCopy( value );
+   if ( DatabaseFindTargetMap() == NULL ) {
+      Str *globalName = StrNew( DATABASE_GLOBAL_MAP );
+      database.globalMap = DatabaseCreateMapEntry( globalName );
+      DatabaseAppendMapEntry( database.globalMap );
+      StrDel( globalName );
+   }
 
-      /* If we failed to append the record, get rid of it. */
-      if ( ! DatabaseAppendRecord( record ) ) {
-         StrDel( record->key );
-         StrDel( record->value );
-         free( ( void * ) record );
-      }
+   if ( ! database.globalMap->isLoaded ) {
+      DatabaseLoadMapEntry( database.globalMap );
    }
 
-   /* Indicate an update was made to the database. */
-   database.updatesSinceLastSave += 1;
+   DatabaseTouchMapEntry( database.globalMap );
+   return database.globalMap;
 }
 
-Bool DatabaseAppendRecord( DatabaseRecord *record ) {
-   /* Only append the record if we haven't gone over the limit of
-      maximum records to store. */
-   if ( database.totalRecords < DATABASE_MAX_ENTRIES ) {
-      DatabaseMapEntry *mapEntry = database.currentMap;
+DatabaseFileSection *DatabaseAddFileSection( const Str *mapName, 
+   const Str *player, size_t firstRecord, unsigned int totalRecords ) {
+   Str *name = StrDown( mapName );
+   DatabaseMapEntry *entry = DatabaseFindMapEntry( name );
+   DatabaseFileSection *section;
 
-      record->nextRecord = mapEntry->firstRecord;
-      mapEntry->firstRecord = record;
-      mapEntry->totalRecords += 1;
+   if ( entry == NULL ) {
+      entry = DatabaseCreateMapEntry( name );
+      entry->isLoaded = FALSE;
+      DatabaseAppendMapEntry( entry );
+   }
 
-      database.totalRecords += 1;
+   StrDel( name );
 
-      return TRUE;
+   /* A map that is already loaded has its records in memory. */
+   if ( entry->isLoaded ) {
+      return NULL;
    }
-   else {
-      PrintWarning( "Record limit of %d has been reached. Cannot add "
-         "anymore records\n", DATABASE_MAX_ENTRIES );
-      return FALSE;
+
+   section = ( DatabaseFileSection * ) malloc( 
+      sizeof( DatabaseFileSection ) );
+   if ( section == NULL ) {
+      return NULL;
    }
+
+   section->player = ( player != NULL ) ? StrCopy( player ) : NULL;
+   section->firstRecord = firstRecord;
+   section->totalRecords = totalRecords;
+   section->firstIndexSlot = 0;
+   section->totalIndexSlots = 0;
+   section->filter = NULL;
+   section->firstFilterByte = 0;
+   section->filterSize = 0;
+   section->isCompressed = FALSE;
+   section->firstBlock = 0;
+   section->totalBlocks = 0;
+   section->size = 0;
+   section->checksum = 0;
+   section->isChecked = FALSE;
+   section->isDamaged = FALSE;
+   section->nextExpiry = 0;
+   section->isExpiryKnown = FALSE;
+   section->nextSection = entry->fileSections;
+   entry->fileSections = section;
+   return section;
 }
 
-const Str *DatabaseRetrieve( const Str *name ) {
-   DatabaseRecord *record = database.currentMap->firstRecord;
-   while ( record != NULL ) {
-      if ( record->key->length == name->length &&
-         StrIsEqual( record->key, name ) ) {
-         break;
+DatabaseFileSection *DatabaseAddSavedSection( DatabaseMapEntry *entry, 
+   const Str *player, size_t firstRecord, unsigned int totalRecords ) {
+   DatabaseFileSection *section = ( DatabaseFileSection * ) malloc( 
+      sizeof( DatabaseFileSection ) );
+
+   if ( section == NULL ) {
+      return NULL;
+   }
+
+   section->player = ( player != NULL ) ? StrCopy( player ) : NULL;
+   section->firstRecord = firstRecord;
+   section->totalRecords = totalRecords;
+   section->firstIndexSlot = 0;
+   section->totalIndexSlots = 0;
+   section->filter = NULL;
+   section->firstFilterByte = 0;
+   section->filterSize = 0;
+   section->isCompressed = FALSE;
+   section->firstBlock = 0;
+   section->totalBlocks = 0;
+   section->size = 0;
+   section->checksum = 0;
+   section->isChecked = FALSE;
+   section->isDamaged = FALSE;
+   section->nextExpiry = 0;
+   section->isExpiryKnown = FALSE;
+   section->nextSection = entry->savedSections;
+   entry->savedSections = section;
+   return section;
+}
+
+void DatabaseCommitFileSections( Bool isSaved ) {
+   DatabaseMapEntry *entry = database.firstMap;
+
+   while ( entry != NULL ) {
+      if ( isSaved ) {
+         DatabaseDestroyFileSections( entry->fileSections );
+         entry->fileSections = entry->savedSections;
+         entry->isDirty = FALSE;
+      }
+      else {
+         DatabaseDestroyFileSections( entry->savedSections );
       }
 
-      record = record->nextRecord;
+      entry->savedSections = NULL;
+      entry = entry->nextEntry;
    }
+}
 
-   if ( record != NULL ) {
-      return record->value;
+void DatabaseLoadMapEntry( DatabaseMapEntry *entry ) {
+   /* Loading records from the file is not a change to the database. */
+   const unsigned int updatesSinceLastSave = database.updatesSinceLastSave;
+
+   entry->isLoaded = TRUE;
+
+   /* The damaged records stay in the database file, and are saved along 
+      with the records that could be loaded. */
+   if ( ! LukdLoadMapEntry( entry ) ) {
+      PrintWarning( "Could not load all records of map: %s\n", 
+         entry->name->value );
    }
-   else {
-      return NULL;
+
+   entry->isDirty = FALSE;
+   database.updatesSinceLastSave = updatesSinceLastSave;
+}
+
+void DatabaseDestroyFileSections( DatabaseFileSection *section ) {
+   DatabaseFileSection *nextSection;
+
+   while ( section != NULL ) {
+      nextSection = section->nextSection;
+      StrDel( section->player );
+      free( ( void * ) section->filter );
+      free( ( void * ) section );
+      section = nextSection;
    }
 }
 
-Bool DatabaseSave( const char *databaseOutPath ) {
-   Bool isSaved = LukdExportDatabase( &database, databaseOutPath );
+void DatabaseSetMemoryBudget( size_t memoryBudget ) {
+   database.memoryBudget = memoryBudget;
+   DatabaseEnforceMemoryBudget();
+}
 
-   if ( isSaved ) {
-      database.updatesSinceLastSave = 0;
+void DatabaseSetFileCompression( Bool isFileCompressed ) {
+   database.isFileCompressed = isFileCompressed;
+}
+
+void DatabaseSetBackupCount( unsigned int totalBackups ) {
+   database.totalBackups = totalBackups;
+}
+
+void DatabaseSetReadOnly( Bool isReadOnly ) {
+   database.isReadOnly = isReadOnly;
+}
+
+void DatabaseEnforceMemoryBudget( void ) {
+   DatabaseMapEntry *entry = database.lruLast;
+   Bool isSaveAttempted = FALSE;
+
+   if ( database.memoryBudget == 0 ) {
+      return;
    }
 
-   return isSaved;
+   while ( entry != NULL && database.memoryUsed > database.memoryBudget ) {
+      DatabaseMapEntry *prevEntry = entry->lruPrev;
+
+      /* The maps in use stay loaded, even if they go over the budget on 
+         their own. */
+      if ( entry != database.currentMap && entry != database.globalMap ) {
+         /* Changes have to be in the file before the records can be let go.
+            A single save takes care of all the maps. Maps with changes 
+            stay loaded if the database can't be saved. */
+         if ( entry->isDirty && ! isSaveAttempted ) {
+            DatabaseSaveToUnload();
+            isSaveAttempted = TRUE;
+         }
+
+         if ( ! entry->isDirty ) {
+            DatabaseEvictMapEntry( entry );
+         }
+      }
+
+      entry = prevEntry;
+   }
 }
 
-void DatabaseShutdown( void ) {
-   DatabaseMapEntry *entry;
-   DatabaseMapEntry *nextEntry;
+/* Each save writes out the whole file, so after a failure the saves are 
+   put off for a while, rather than tried again on every change. */
+void DatabaseSaveToUnload( void ) {
+   if ( database.filePath == NULL || database.isReadOnly || 
+      time( NULL ) < database.nextSaveTime ) {
+      return;
+   }
 
-   /* Destroy all map entries. */
-   entry = database.firstMap;
-   while ( entry != NULL ) {
-      /* Hold on to the next entry so we can delete the current one. */
-      nextEntry = entry->nextEntry;
-      DatabaseDestroyMapEntry( entry );
-      entry = nextEntry;
+   if ( DatabaseSave( database.filePath->value ) ) {
+      return;
    }
 
-   database.updatesSinceLastSave = 0;
-   database.isOperational = FALSE;
+   database.saveRetryDelay = ( database.saveRetryDelay == 0 ) ?
+      DATABASE_SAVE_RETRY_DELAY : database.saveRetryDelay * 2;
+   if ( database.saveRetryDelay > DATABASE_MAX_SAVE_RETRY_DELAY ) {
+      database.saveRetryDelay = DATABASE_MAX_SAVE_RETRY_DELAY;
+   }
+
+   database.nextSaveTime = time( NULL ) + database.saveRetryDelay;
+   PrintWarning( "Could not save the database to unload maps. Trying again "
+      "in %d seconds\n", database.saveRetryDelay );
 }
 
-void DatabaseDestroyMapEntry( DatabaseMapEntry *entry ) {
-   DatabaseRecord *record = entry->firstRecord;
-   DatabaseRecord *nextRecord;
+void DatabaseEvictMapEntry( DatabaseMapEntry *entry ) {
+   PrintMessage( "Unloading map to stay within memory budget: %s\n",
+      entry->name->value );
 
-   /* Destroy the records from first. */
-   while ( record != NULL ) {
-      nextRecord = record->nextRecord;
+   DatabaseUnloadMapEntry( entry );
+   DatabaseInitRecordStore( &entry->records );
+   memset( entry->playerBuckets, 0, 
+      entry->totalPlayerBuckets * sizeof( DatabasePlayerEntry * ) );
+   entry->isLoaded = FALSE;
+}
 
-      StrDel( record->key );
-      StrDel( record->value );
-      database.totalRecords -= 1;
-      free( ( void * ) record );
+/* Frees all the records and players of a map entry. */
+void DatabaseUnloadMapEntry( DatabaseMapEntry *entry ) {
+   DatabasePlayerEntry *player = entry->firstPlayer;
+   DatabasePlayerEntry *nextPlayer;
+   int ranking;
 
-      record = nextRecord;
+   while ( player != NULL ) {
+      nextPlayer = player->nextEntry;
+      DatabaseDestroyPlayer( player );
+      player = nextPlayer;
    }
 
-   StrDel( entry->name );
-   free( ( void * ) entry );
+   entry->firstPlayer = NULL;
+   entry->totalPlayers = 0;
 
-   database.totalMaps -= 1;
+   DatabaseDestroyRecordStore( &entry->records );
+   for ( ranking = 0; ranking < DATABASE_MAX_RANKINGS; ranking += 1 ) {
+      SkipListDestroy( &entry->rankedRecords[ ranking ] );
+   }
+
+   DatabaseUnlinkMapEntry( entry );
 }
 
-int DatabaseCalculateRecordsTotalSize( void ) {
-   int size = 0;
+/* Moves a map entry to the front of the recently used list. */
+void DatabaseTouchMapEntry( DatabaseMapEntry *entry ) {
+   if ( database.lruFirst == entry ) {
+      return;
+   }
 
-   DatabaseMapEntry *entry;
-   DatabaseRecord *record;
+   DatabaseUnlinkMapEntry( entry );
 
-   entry = database.firstMap;
-   while ( entry != NULL ) {
-      record = entry->firstRecord;
+   entry->lruNext = database.lruFirst;
+   if ( database.lruFirst != NULL ) {
+      database.lruFirst->lruPrev = entry;
+   }
+   else {
+      database.lruLast = entry;
+   }
+   database.lruFirst = entry;
+}
+
+void DatabaseUnlinkMapEntry( DatabaseMapEntry *entry ) {
+   /* Entries that are not in the list have no links and aren't the first
+      entry of the list. */
+   if ( entry->lruPrev == NULL && database.lruFirst != entry ) {
+      return;
+   }
+
+   if ( entry->lruPrev != NULL ) {
+      entry->lruPrev->lruNext = entry->lruNext;
+   }
+   else {
+      database.lruFirst = entry->lruNext;
+   }
+
+   if ( entry->lruNext != NULL ) {
+      entry->lruNext->lruPrev = entry->lruPrev;
+   }
+   else {
+      database.lruLast = entry->lruPrev;
+   }
 
-      while ( record != NULL ) {
-         size += record->key->length + record->value->length;
-         record = record->nextRecord;
+   entry->lruPrev = NULL;
+   entry->lruNext = NULL;
+}
+
+void DatabaseMarkDirty( DatabaseMapEntry *entry ) {
+   entry->isDirty = TRUE;
+   database.updatesSinceLastSave += 1;
+}
+
+void DatabaseAccountRecord( const DatabaseRecord *record, Bool isAdded ) {
+   /* This is only an estimate. It counts the record, its value, its bucket
+      and its node in the ordered index, but not the unused space in the
+      blocks and buckets or what the allocator adds. The key
+      is shared with the other records that have it, so it isn't counted. */
+   const size_t memory = sizeof( DatabaseRecord ) + 
+      sizeof( DatabaseRecordBucket ) + sizeof( SkipListNode ) + 
+      record->value.length + 1;
+
+   if ( isAdded ) {
+      record->mapEntry->memoryUsed += memory;
+      database.memoryUsed += memory;
+   }
+   else {
+      record->mapEntry->memoryUsed -= memory;
+      database.memoryUsed -= memory;
+   }
+}
+
+void DatabaseLoadRecord( DatabaseMapEntry *entry, const Str *player,
+   const Str *name, const Str *value ) {
+   DatabasePlayerEntry *playerEntry = NULL;
+
+   if ( player != NULL ) {
+      playerEntry = DatabaseAddPlayer( entry, player );
+      if ( playerEntry == NULL ) {
+         return;
       }
+   }
 
-      entry = entry->nextEntry;
+   DatabaseClearExpiry( DatabaseStoreRecord( entry, playerEntry, name, 
+      value ) );
+}
+
+void DatabaseLoadExpiry( DatabaseMapEntry *entry, const Str *player,
+   const Str *name, time_t expiresAt ) {
+   DatabaseRecordStore *store = &entry->records;
+
+   if ( player != NULL ) {
+      DatabasePlayerEntry *playerEntry = 
+         DatabaseFindPlayer( entry, player, StrHash( player ) );
+      if ( playerEntry == NULL ) {
+         return;
+      }
+
+      store = &playerEntry->records;
    }
 
-   return size;
+   DatabaseSetRecordExpiry( store, name, expiresAt );
 }
 
-Bool DatabaseDelete( const Str *mapName ) {
-   DatabaseMapEntry *prevEntry = database.firstMap;
-   DatabaseMapEntry *currEntry = database.firstMap;
+/* A key that was never interned isn't the key of any record, so callers
+   can pass the result of SymbolTableFind() as it is. */
+DatabaseRecord *DatabaseFindRecord( const DatabaseRecordStore *store,
+   const Symbol *key ) {
+   const unsigned int mask = store->totalBuckets - 1;
+   unsigned int bucket;
 
-   while ( currEntry != NULL && ! StrIsEqual( currEntry->name, mapName ) ) {
-      prevEntry = currEntry;
-      currEntry = currEntry->nextEntry;
+   if ( key == NULL ) {
+      return NULL;
    }
 
-   if ( currEntry != NULL ) {
-		/* If found entry isn't first entry, link next entry to previous one. */
-      if ( currEntry != database.firstMap ) {	
-         prevEntry->nextEntry = currEntry->nextEntry;
-	   }
-	   /* Otherwise, make next entry the first entry. */
-	   else {
-		   database.firstMap = currEntry->nextEntry;
-		}
-	   
-      DatabaseDestroyMapEntry( currEntry );
-      database.updatesSinceLastSave += 1;
+   /* There is always an empty bucket to stop at. */
+   bucket = key->hash & mask;
+   while ( store->buckets[ bucket ].record != NULL && 
+      store->buckets[ bucket ].key != key ) {
+      bucket = ( bucket + 1 ) & mask;
+   }
 
-      return TRUE;
+   return store->buckets[ bucket ].record;
+}
+
+void DatabaseStore( const Str *name, const Str *value ) {
+   DatabaseClearExpiry( 
+      DatabaseStoreRecord( DatabaseGetTargetMap(), NULL, name, value ) );
+   DatabaseEnforceMemoryBudget();
+}
+
+void DatabaseStoreTemporary( const Str *name, const Str *value, int ttl ) {
+   if ( DatabaseStoreRecord( DatabaseGetTargetMap(), NULL, name, value ) != 
+      NULL ) {
+      DatabaseSetExpiry( name, time( NULL ) + ttl );
    }
-   else {
-      return FALSE;
+
+   DatabaseEnforceMemoryBudget();
+}
+
+void DatabaseClearExpiry( DatabaseRecord *record ) {
+   /* Storing a temporary record without an expiry time makes it 
+      permanent. */
+   if ( record != NULL && record->expiresAt != 0 ) {
+      TimerWheelCancel( &database.expiryWheel, &record->expiryTimer );
+      record->expiresAt = 0;
    }
 }
 
-void DatabasePrint( const Str *selectedMap ) {
-   DatabaseMapEntry *map;
+DatabaseRecord *DatabaseStoreRecord( DatabaseMapEntry *entry,
+   DatabasePlayerEntry *player, const Str *name, const Str *value ) {
+   DatabaseRecordStore *store;
+   DatabaseRecord *record;
+
+   if ( name == NULL || value == NULL ) {
+      return NULL;
+   }
+
+   /* PrintMessage( "Storing: %s = %s\n", name->value, value->value ); */
+
+   /* Search for the record to update. */
+   store = ( player != NULL ) ? &player->records : &entry->records;
+   record = DatabaseFindRecord( store, 
+      SymbolTableFind( &database.keys, name ) );
+
+   /* Update the existing record. */
+   if ( record != NULL ) {
+      Bool isUpdated;
+
+      DatabaseAccountRecord( record, FALSE );
+      isUpdated = DatabaseSetRecordValue( record, value );
+      DatabaseAccountRecord( record, TRUE );
 
-   PrintMessage( "----- Database -----\n" );
-   PrintMessage( "Map entries: %d\n", database.totalMaps );
-   PrintMessage( "Records: %d\n", database.totalRecords );
-   PrintMessage( "\n" );
+      if ( ! isUpdated ) {
+         return NULL;
+      }
 
-   map = database.firstMap;
+      DatabaseRankRecord( entry, record );
+   }
+   /* Otherwise, create a new record for the map if one wasn't found with
+      the given key or there are no records for the map at all. */
+   else {
+      record = DatabaseAllocateRecord( store );
+      if ( record == NULL ) {
+         return NULL;
+      }
 
-   /* Print records for single map. */
-   if ( selectedMap != NULL ) {
-      while ( map != NULL && ! StrIsEqual( selectedMap, map->name ) ) {
-         map = map->nextEntry;
+      record->key = SymbolTableIntern( &database.keys, name );
+      if ( record->key == NULL ) {
+         DatabaseFreeRecord( store, record );
+         return NULL;
       }
 
-      if ( map != NULL ) {
-         DatabasePrintMapEntry( map );
+      record->value.length = 0;
+      record->value.value = NULL;
+      if ( ! DatabaseSetRecordValue( record, value ) ) {
+         SymbolTableRelease( &database.keys, record->key );
+         DatabaseFreeRecord( store, record );
+         return NULL;
       }
-      else {
-         PrintMessage( "No such map in database: %s\n", 
-            selectedMap->value );
+
+      record->mapEntry = entry;
+      record->player = player;
+      /* Player records are left out of the rankings. */
+      record->ranking = ( player == NULL ) ? DatabaseFindRanking( name ) : -1;
+      record->isRanked = FALSE;
+      record->expiresAt = 0;
+      TimerWheelNodeInit( &record->expiryTimer, record );
+
+      if ( ! DatabaseAppendRecord( store, record ) ) {
+         SymbolTableRelease( &database.keys, record->key );
+         free( ( void * ) record->value.value );
+         DatabaseFreeRecord( store, record );
+         return NULL;
       }
+
+      DatabaseRankRecord( entry, record );
+   }
+
+   /* Indicate an update was made to the database. */
+   DatabaseMarkDirty( entry );
+   return record;
+}
+
+Bool DatabaseSetExpiry( const Str *name, time_t expiresAt ) {
+   return DatabaseSetRecordExpiry( &DatabaseGetTargetMap()->records, name,
+      expiresAt );
+}
+
+Bool DatabaseSetRecordExpiry( DatabaseRecordStore *store, const Str *name,
+   time_t expiresAt ) {
+   DatabaseRecord *record = DatabaseFindRecord( store, 
+      SymbolTableFind( &database.keys, name ) );
+
+   if ( record == NULL ) {
+      return FALSE;
+   }
+
+   if ( expiresAt <= time( NULL ) ) {
+      DatabaseRemoveRecord( record );
    }
-   /* Print records for all maps. */
    else {
-      while ( map != NULL ) {
-         DatabasePrintMapEntry( map );
-         map = map->nextEntry;
-      }
+      record->expiresAt = expiresAt;
+      TimerWheelSchedule( &database.expiryWheel, &record->expiryTimer,
+         ( TimerWheelTick ) expiresAt );
    }
+
+   return TRUE;
 }
 
-void DatabasePrintMapEntry( const DatabaseMapEntry *entry ) {
-   DatabaseRecord *record;
+Bool DatabaseIsExpired( const DatabaseRecord *record, time_t now ) {
+   return ( record->expiresAt != 0 && record->expiresAt <= now );
+}
+
+int DatabaseExpireRecords( time_t now ) {
+   return TimerWheelAdvance( &database.expiryWheel, ( TimerWheelTick ) now,
+      DatabaseExpireRecord );
+}
 
-   PrintMessage( "\tName: %s\n", entry->name->value );
-   PrintMessage( "\tTotal records: %d\n", ( int ) entry->totalRecords );
-   PrintMessage( "\n" );
+void DatabaseExpireRecord( TimerWheelNode *node ) {
+   DatabaseRemoveRecord( ( DatabaseRecord * ) node->data );
+}
 
-   /* Print records of the map entry: */
-   record = entry->firstRecord;
+void DatabaseRemoveRecord( DatabaseRecord *record ) {
+   DatabaseMapEntry *entry = record->mapEntry;
+   DatabaseRecordStore *store = DatabaseGetRecordStore( record );
 
-   while ( record != NULL ) {
-      DatabasePrintRecord( record );
-      record = record->nextRecord;
+   /* Take the record out of the indexes. */
+   DatabaseUnindexRecord( store, record );
+   SkipListRemove( &store->orderedKeys, record->key->name );
+   if ( record->isRanked ) {
+      SkipListRemove( &entry->rankedRecords[ record->ranking ], record );
    }
+
+   store->totalRecords -= 1;
+   database.totalRecords -= 1;
+   DatabaseMarkDirty( entry );
+
+   DatabaseDestroyRecord( record );
+   DatabaseFreeRecord( store, record );
 }
 
-void DatabasePrintRecord( const DatabaseRecord *record ) {
-   PrintMessage( "\t\tKey: %s\n", record->key->value );
-   PrintMessage( "\t\tValue: %s\n", record->value->value );
-   PrintMessage( "\n" );
+/* Frees what the record holds, but not the record itself, which belongs to
+   a block of its store. */
+void DatabaseDestroyRecord( DatabaseRecord *record ) {
+   DatabaseAccountRecord( record, FALSE );
+   TimerWheelCancel( &database.expiryWheel, &record->expiryTimer );
+   SymbolTableRelease( &database.keys, record->key );
+   free( ( void * ) record->value.value );
+   record->value.value = NULL;
+}
+
+DatabaseRecord *DatabaseAllocateRecord( DatabaseRecordStore *store ) {
+   DatabaseRecordBlock *block = store->lastBlock;
+   DatabaseRecord *record;
+
+   /* Reuse the space of a removed record first. */
+   if ( store->freeRecords != NULL ) {
+      record = store->freeRecords;
+      store->freeRecords = record->nextFree;
+      return record;
+   }
+
+   if ( block == NULL || block->totalRecords == block->size ) {
+      unsigned int size = DATABASE_INITIAL_RECORD_BLOCK;
+
+      if ( block != NULL ) {
+         size = block->size * 2;
+         if ( size > DATABASE_MAX_RECORD_BLOCK ) {
+            size = DATABASE_MAX_RECORD_BLOCK;
+         }
+      }
+
+      /* The block struct already has room for one record. */
+      block = ( DatabaseRecordBlock * ) malloc( sizeof( DatabaseRecordBlock ) +
+         ( size - 1 ) * sizeof( DatabaseRecord ) );
+      if ( block == NULL ) {
+         return NULL;
+      }
+
+      block->nextBlock = NULL;
+      block->size = size;
+      block->totalRecords = 0;
+
+      if ( store->lastBlock != NULL ) {
+         store->lastBlock->nextBlock = block;
+      }
+      else {
+         store->firstBlock = block;
+      }
+      store->lastBlock = block;
+   }
+
+   record = &block->records[ block->totalRecords ];
+   block->totalRecords += 1;
+   return record;
+}
+
+void DatabaseFreeRecord( DatabaseRecordStore *store, 
+   DatabaseRecord *record ) {
+   record->isUsed = FALSE;
+   record->nextFree = store->freeRecords;
+   store->freeRecords = record;
+}
+
+Bool DatabaseSetRecordValue( DatabaseRecord *record, const Str *value ) {
+   char *bytes = ( char * ) malloc( value->length + 1 );
+
+   if ( bytes == NULL ) {
+      return FALSE;
+   }
+
+   memcpy( bytes, value->value, value->length );
+   bytes[ value->length ] = '\0';
+
+   free( ( void * ) record->value.value );
+   record->value.value = bytes;
+   record->value.length = value->length;
+   return TRUE;
+}
+
+Bool DatabaseAppendRecord( DatabaseRecordStore *store, 
+   DatabaseRecord *record ) {
+   /* There is no limit on the number of records. When they take up too
+      much memory, maps get unloaded instead. */
+   if ( ! DatabaseIndexRecord( store, record ) ) {
+      return FALSE;
+   }
+
+   record->isUsed = TRUE;
+   store->totalRecords += 1;
+
+   database.totalRecords += 1;
+   DatabaseAccountRecord( record, TRUE );
+   return TRUE;
+}
+
+Bool DatabaseIndexRecord( DatabaseRecordStore *store, 
+   DatabaseRecord *record ) {
+   unsigned int mask;
+   unsigned int bucket;
+
+   if ( ( store->totalRecords + 1 ) * 4 > store->totalBuckets * 3 ) {
+      DatabaseGrowBuckets( store );
+   }
+
+   /* If the table couldn't grow, it can still take records as long as one
+      bucket stays empty for the lookups to stop at. */
+   if ( store->totalRecords + 1 >= store->totalBuckets ) {
+      return FALSE;
+   }
+
+   mask = store->totalBuckets - 1;
+   bucket = record->key->hash & mask;
+   while ( store->buckets[ bucket ].record != NULL ) {
+      bucket = ( bucket + 1 ) & mask;
+   }
+
+   store->buckets[ bucket ].key = record->key;
+   store->buckets[ bucket ].record = record;
+
+   if ( ! SkipListInsert( &store->orderedKeys, record->key->name, record ) ) {
+      PrintWarning( "Failed to add record to the ordered index: %s\n",
+         record->key->name->value );
+   }
+
+   return TRUE;
+}
+
+void DatabaseUnindexRecord( DatabaseRecordStore *store,
+   const DatabaseRecord *record ) {
+   const unsigned int mask = store->totalBuckets - 1;
+   unsigned int bucket = record->key->hash & mask;
+   unsigned int nextBucket;
+
+   while ( store->buckets[ bucket ].record != record ) {
+      bucket = ( bucket + 1 ) & mask;
+   }
+
+   /* Leaving the bucket empty would cut off the records placed after it
+      that were meant for an earlier bucket. Those are moved back into the
+      gap, one after another, until an empty bucket is reached. */
+   nextBucket = ( bucket + 1 ) & mask;
+   while ( store->buckets[ nextBucket ].record != NULL ) {
+      const unsigned int homeBucket = 
+         store->buckets[ nextBucket ].key->hash & mask;
+
+      if ( ( ( nextBucket - homeBucket ) & mask ) >= 
+         ( ( nextBucket - bucket ) & mask ) ) {
+         store->buckets[ bucket ] = store->buckets[ nextBucket ];
+         bucket = nextBucket;
+      }
+
+      nextBucket = ( nextBucket + 1 ) & mask;
+   }
+
+   store->buckets[ bucket ].key = NULL;
+   store->buckets[ bucket ].record = NULL;
+}
+
+void DatabaseGrowBuckets( DatabaseRecordStore *store ) {
+   /* The bucket count is always a power of two so we can mask the hash. */
+   const unsigned int totalBuckets = store->totalBuckets * 2;
+   const unsigned int mask = totalBuckets - 1;
+   DatabaseRecordBucket *buckets = ( DatabaseRecordBucket * ) calloc( 
+      totalBuckets, sizeof( DatabaseRecordBucket ) );
+   unsigned int oldBucket;
+
+   /* We can live with a fuller table if we're out of memory. */
+   if ( buckets == NULL ) {
+      return;
+   }
+
+   for ( oldBucket = 0; oldBucket < store->totalBuckets; oldBucket += 1 ) {
+      if ( store->buckets[ oldBucket ].record != NULL ) {
+         unsigned int bucket = store->buckets[ oldBucket ].key->hash & mask;
+
+         while ( buckets[ bucket ].record != NULL ) {
+            bucket = ( bucket + 1 ) & mask;
+         }
+
+         buckets[ bucket ] = store->buckets[ oldBucket ];
+      }
+   }
+
+   free( ( void * ) store->buckets );
+   store->buckets = buckets;
+   store->totalBuckets = totalBuckets;
+}
+
+const Str *DatabaseRetrieve( const Str *name ) {
+   const DatabaseMapEntry *entry = DatabaseFindTargetMap();
+
+   if ( entry == NULL ) {
+      return NULL;
+   }
+   else if ( ! entry->isLoaded ) {
+      return DatabaseRetrieveFromFile( entry, NULL, name );
+   }
+   else {
+      return DatabaseRetrieveRecord( &entry->records, name );
+   }
+}
+
+const Str *DatabaseRetrieveFromFile( const DatabaseMapEntry *entry,
+   const Str *player, const Str *name ) {
+   StrDel( database.fileValue );
+   database.fileValue = LukdRetrieveRecord( entry, player, name );
+   return database.fileValue;
+}
+
+const Str *DatabaseRetrieveRecord( const DatabaseRecordStore *store, 
+   const Str *name ) {
+   DatabaseRecord *record = 
+      DatabaseFindRecord( store, SymbolTableFind( &database.keys, name ) );
+
+   /* An expired record might not have been removed yet. */
+   if ( record != NULL && DatabaseIsExpired( record, time( NULL ) ) ) {
+      record = NULL;
+   }
+
+   if ( record != NULL ) {
+      return &record->value;
+   }
+   else {
+      return NULL;
+   }
+}
+
+Bool DatabaseSave( const char *databaseOutPath ) {
+   Bool isSaved;
+
+   if ( database.isReadOnly ) {
+      PrintWarning( "The database is read-only. Not saving to path: %s\n",
+         databaseOutPath );
+      return FALSE;
+   }
+
+   isSaved = LukdExportDatabase( &database, databaseOutPath );
+
+   if ( isSaved ) {
+      database.updatesSinceLastSave = 0;
+      database.nextSaveTime = 0;
+      database.saveRetryDelay = 0;
+   }
+
+   return isSaved;
+}
+
+void DatabaseShutdown( void ) {
+   DatabaseMapEntry *entry;
+   DatabaseMapEntry *nextEntry;
+
+   /* Destroy all map entries. */
+   entry = database.firstMap;
+   while ( entry != NULL ) {
+      /* Hold on to the next entry so we can delete the current one. */
+      nextEntry = entry->nextEntry;
+      DatabaseDestroyMapEntry( entry );
+      entry = nextEntry;
+   }
+
+   DatabaseShutdownRankings();
+   LukdCloseDatabase();
+   SymbolTableDestroy( &database.keys );
+
+   StrDel( database.filePath );
+   database.filePath = NULL;
+   StrDel( database.fileValue );
+   database.fileValue = NULL;
+
+   database.updatesSinceLastSave = 0;
+   database.isOperational = FALSE;
+}
+
+void DatabaseDestroyMapEntry( DatabaseMapEntry *entry ) {
+   DatabaseUnloadMapEntry( entry );
+   DatabaseDestroyFileSections( entry->fileSections );
+   DatabaseDestroyFileSections( entry->savedSections );
+   free( ( void * ) entry->playerBuckets );
+   StrDel( entry->name );
+   free( ( void * ) entry );
+
+   database.totalMaps -= 1;
+}
+
+void DatabaseDestroyRecordStore( DatabaseRecordStore *store ) {
+   DatabaseRecordBlock *block = store->firstBlock;
+   DatabaseRecordBlock *nextBlock;
+
+   while ( block != NULL ) {
+      unsigned int slot;
+
+      for ( slot = 0; slot < block->totalRecords; slot += 1 ) {
+         if ( block->records[ slot ].isUsed ) {
+            database.totalRecords -= 1;
+            DatabaseDestroyRecord( &block->records[ slot ] );
+         }
+      }
+
+      nextBlock = block->nextBlock;
+      free( ( void * ) block );
+      block = nextBlock;
+   }
+
+   SkipListDestroy( &store->orderedKeys );
+   free( ( void * ) store->buckets );
+   store->firstBlock = NULL;
+   store->lastBlock = NULL;
+   store->freeRecords = NULL;
+   store->totalRecords = 0;
+   store->buckets = NULL;
+}
+
+/* Player functions: */
+
+DatabasePlayerEntry *DatabaseFindPlayer( const DatabaseMapEntry *entry,
+   const Str *name, unsigned int hash ) {
+   DatabasePlayerEntry *player = 
+      entry->playerBuckets[ hash & ( entry->totalPlayerBuckets - 1 ) ];
+
+   while ( player != NULL ) {
+      if ( player->hash == hash && StrIsEqual( player->name, name ) ) {
+         break;
+      }
+
+      player = player->nextInBucket;
+   }
+
+   return player;
+}
+
+DatabasePlayerEntry *DatabaseAddPlayer( DatabaseMapEntry *entry,
+   const Str *name ) {
+   const unsigned int hash = StrHash( name );
+   DatabasePlayerEntry *player = DatabaseFindPlayer( entry, name, hash );
+   DatabasePlayerEntry **bucket;
+
+   if ( player != NULL ) {
+      return player;
+   }
+
+   player = ( DatabasePlayerEntry * ) malloc( sizeof( DatabasePlayerEntry ) );
+   if ( player == NULL ) {
+      return NULL;
+   }
+
+   player->name = StrCopy( name );
+   player->hash = hash;
+   DatabaseInitRecordStore( &player->records );
+
+   if ( entry->totalPlayers >= entry->totalPlayerBuckets ) {
+      DatabaseGrowPlayerBuckets( entry );
+   }
+
+   bucket = &entry->playerBuckets[ 
+      hash & ( entry->totalPlayerBuckets - 1 ) ];
+   player->nextInBucket = *bucket;
+   *bucket = player;
+
+   player->nextEntry = entry->firstPlayer;
+   entry->firstPlayer = player;
+   entry->totalPlayers += 1;
+
+   return player;
+}
+
+void DatabaseGrowPlayerBuckets( DatabaseMapEntry *entry ) {
+   const unsigned int totalBuckets = entry->totalPlayerBuckets * 2;
+   DatabasePlayerEntry **buckets = ( DatabasePlayerEntry ** ) calloc(
+      totalBuckets, sizeof( DatabasePlayerEntry * ) );
+   DatabasePlayerEntry *player;
+
+   if ( buckets == NULL ) {
+      return;
+   }
+
+   player = entry->firstPlayer;
+   while ( player != NULL ) {
+      DatabasePlayerEntry **bucket = 
+         &buckets[ player->hash & ( totalBuckets - 1 ) ];
+      player->nextInBucket = *bucket;
+      *bucket = player;
+      player = player->nextEntry;
+   }
+
+   free( ( void * ) entry->playerBuckets );
+   entry->playerBuckets = buckets;
+   entry->totalPlayerBuckets = totalBuckets;
+}
+
+void DatabaseDestroyPlayer( DatabasePlayerEntry *player ) {
+   DatabaseDestroyRecordStore( &player->records );
+   StrDel( player->name );
+   free( ( void * ) player );
+}
+
+void DatabaseStorePlayer( const Str *player, const Str *name, 
+   const Str *value ) {
+   DatabaseMapEntry *entry = DatabaseGetTargetMap();
+   DatabasePlayerEntry *playerEntry = DatabaseAddPlayer( entry, player );
+
+   if ( playerEntry != NULL ) {
+      DatabaseClearExpiry( DatabaseStoreRecord( entry, playerEntry, name,
+         value ) );
+   }
+
+   DatabaseEnforceMemoryBudget();
+}
+
+void DatabaseStorePlayerTemporary( const Str *player, const Str *name,
+   const Str *value, int ttl ) {
+   DatabaseMapEntry *entry = DatabaseGetTargetMap();
+   DatabasePlayerEntry *playerEntry = DatabaseAddPlayer( entry, player );
+
+   if ( playerEntry != NULL && 
+      DatabaseStoreRecord( entry, playerEntry, name, value ) != NULL ) {
+      DatabaseSetRecordExpiry( &playerEntry->records, name, 
+         time( NULL ) + ttl );
+   }
+
+   DatabaseEnforceMemoryBudget();
+}
+
+Bool DatabaseSetPlayerExpiry( const Str *player, const Str *name, 
+   time_t expiresAt ) {
+   DatabasePlayerEntry *playerEntry = DatabaseFindPlayer( 
+      DatabaseGetTargetMap(), player, StrHash( player ) );
+
+   if ( playerEntry != NULL ) {
+      return DatabaseSetRecordExpiry( &playerEntry->records, name, 
+         expiresAt );
+   }
+   else {
+      return FALSE;
+   }
+}
+
+const Str *DatabaseRetrievePlayer( const Str *player, const Str *name ) {
+   const DatabaseMapEntry *entry = DatabaseFindTargetMap();
+   DatabasePlayerEntry *playerEntry;
+
+   if ( entry == NULL ) {
+      return NULL;
+   }
+   else if ( ! entry->isLoaded ) {
+      return DatabaseRetrieveFromFile( entry, player, name );
+   }
+
+   playerEntry = DatabaseFindPlayer( entry, player, StrHash( player ) );
+   if ( playerEntry != NULL ) {
+      return DatabaseRetrieveRecord( &playerEntry->records, name );
+   }
+   else {
+      return NULL;
+   }
+}
+
+Bool DatabaseDeletePlayer( const Str *player ) {
+   DatabaseMapEntry *entry = DatabaseGetTargetMap();
+   const unsigned int hash = StrHash( player );
+   DatabasePlayerEntry *playerEntry = DatabaseFindPlayer( entry, player, 
+      hash );
+   DatabasePlayerEntry **link;
+
+   if ( playerEntry == NULL ) {
+      return FALSE;
+   }
+
+   /* Take the player out of its bucket and out of the player list. */
+   link = &entry->playerBuckets[ hash & ( entry->totalPlayerBuckets - 1 ) ];
+   while ( *link != playerEntry ) {
+      link = &( *link )->nextInBucket;
+   }
+   *link = playerEntry->nextInBucket;
+
+   link = &entry->firstPlayer;
+   while ( *link != playerEntry ) {
+      link = &( *link )->nextEntry;
+   }
+   *link = playerEntry->nextEntry;
+
+   entry->totalPlayers -= 1;
+   DatabaseDestroyPlayer( playerEntry );
+   DatabaseMarkDirty( entry );
+
+   return TRUE;
+}
+
+int DatabaseListKeysInRange( const Str *first, const Str *last,
+   const Str *cursor, Str **keys, int limit ) {
+   const SkipList *orderedKeys;
+   const SkipListNode *node;
+
+   DatabaseRemoveExpiredRecords();
+   orderedKeys = &DatabaseGetTargetMap()->records.orderedKeys;
+
+   /* Start after the cursor if it's further along than the start of 
+      the range. */
+   if ( cursor != NULL && cursor->length > 0 &&
+      StrCompare( cursor, first ) >= 0 ) {
+      node = SkipListUpperBound( orderedKeys, cursor );
+   }
+   else {
+      node = SkipListLowerBound( orderedKeys, first );
+   }
+
+   if ( last != NULL && last->length == 0 ) {
+      last = NULL;
+   }
+
+   return DatabaseListKeys( node, last, NULL, keys, limit );
+}
+
+int DatabaseListKeysWithPrefix( const Str *prefix, const Str *cursor,
+   Str **keys, int limit ) {
+   const SkipList *orderedKeys;
+   const SkipListNode *node;
+
+   DatabaseRemoveExpiredRecords();
+   orderedKeys = &DatabaseGetTargetMap()->records.orderedKeys;
+
+   /* All keys with the prefix are grouped together in the index, with the
+      prefix itself being the smallest of them. */
+   if ( cursor != NULL && cursor->length > 0 &&
+      StrCompare( cursor, prefix ) >= 0 ) {
+      node = SkipListUpperBound( orderedKeys, cursor );
+   }
+   else {
+      node = SkipListLowerBound( orderedKeys, prefix );
+   }
+
+   return DatabaseListKeys( node, NULL, prefix, keys, limit );
+}
+
+/* The ordered keys and the rankings still hold the temporary records that
+   have expired but haven't been removed yet, which are missing to 
+   everything else. The main loop only removes them once a second, and a
+   replay never does, so they're removed before the keys are gone 
+   through. */
+void DatabaseRemoveExpiredRecords( void ) {
+   DatabaseExpireRecords( time( NULL ) );
+}
+
+int DatabaseListKeys( const SkipListNode *node, const Str *last,
+   const Str *prefix, Str **keys, int limit ) {
+   int keysListed = 0;
+
+   while ( node != NULL && keysListed < limit ) {
+      /* Stop at the first key that falls outside of the range. */
+      const Str *key = ( const Str * ) node->key;
+
+      if ( ( last != NULL && StrCompare( key, last ) > 0 ) ||
+         ( prefix != NULL && ! StrHasPrefix( key, prefix ) ) ) {
+         break;
+      }
+
+      keys[ keysListed ] = StrCopy( key );
+      keysListed += 1;
+      node = SkipListNext( node );
+   }
+
+   return keysListed;
+}
+
+Bool DatabaseAddRanking( const Str *pattern ) {
+   DatabaseRanking *ranking;
+
+   if ( pattern->length == 0 ) {
+      return FALSE;
+   }
+
+   if ( totalRankings >= DATABASE_MAX_RANKINGS ) {
+      PrintWarning( "Ranking limit of %d has been reached. Ignoring ranking "
+         "for: %s\n", DATABASE_MAX_RANKINGS, pattern->value );
+      return FALSE;
+   }
+
+   ranking = &rankings[ totalRankings ];
+   ranking->pattern = StrCopy( pattern );
+   ranking->isPrefix = 
+      ( pattern->value[ pattern->length - 1 ] == DATABASE_RANKING_WILDCARD );
+
+   if ( ranking->isPrefix ) {
+      ranking->match = StrSub( pattern, 0, pattern->length - 1 );
+   }
+   else {
+      ranking->match = StrCopy( pattern );
+   }
+
+   totalRankings += 1;
+   return TRUE;
+}
+
+int DatabaseFindRanking( const Str *key ) {
+   int ranking;
+
+   for ( ranking = 0; ranking < totalRankings; ranking += 1 ) {
+      if ( rankings[ ranking ].isPrefix ? 
+         StrHasPrefix( key, rankings[ ranking ].match ) :
+         StrCompare( key, rankings[ ranking ].match ) == 0 ) {
+         return ranking;
+      }
+   }
+
+   return -1;
+}
+
+void DatabaseRankRecord( DatabaseMapEntry *entry, DatabaseRecord *record ) {
+   SkipList *rankedRecords;
+   char *scoreEnd;
+   long score;
+
+   if ( record->ranking < 0 ) {
+      return;
+   }
+
+   rankedRecords = &entry->rankedRecords[ record->ranking ];
+   if ( rankedRecords->head == NULL ) {
+      SkipListInitWithCompare( rankedRecords, DatabaseCompareRanked );
+   }
+
+   /* The record has to be taken out with its old score, before the score 
+      changes, or it won't be found. */
+   if ( record->isRanked ) {
+      SkipListRemove( rankedRecords, record );
+      record->isRanked = FALSE;
+   }
+
+   /* Only numbers can be ranked. */
+   score = strtol( record->value.value, &scoreEnd, 10 );
+   if ( record->value.length > 0 && *scoreEnd == '\0' ) {
+      record->score = score;
+      record->isRanked = SkipListInsert( rankedRecords, record, record );
+   }
+}
+
+int DatabaseCompareRanked( const void *first, const void *second ) {
+   const DatabaseRecord *firstRecord = ( const DatabaseRecord * ) first;
+   const DatabaseRecord *secondRecord = ( const DatabaseRecord * ) second;
+
+   /* Highest scores come first. Records with the same score are ordered
+      by their keys. */
+   if ( firstRecord->score > secondRecord->score ) {
+      return -1;
+   }
+   else if ( firstRecord->score < secondRecord->score ) {
+      return 1;
+   }
+   else {
+      return StrCompare( firstRecord->key->name, secondRecord->key->name );
+   }
+}
+
+unsigned int DatabaseRetrieveRank( const Str *key ) {
+   DatabaseMapEntry *entry;
+   DatabaseRecord *record;
+
+   DatabaseRemoveExpiredRecords();
+   entry = DatabaseGetTargetMap();
+   record = DatabaseFindRecord( &entry->records, 
+      SymbolTableFind( &database.keys, key ) );
+
+   if ( record != NULL && record->isRanked ) {
+      return SkipListGetRank( &entry->rankedRecords[ record->ranking ],
+         record );
+   }
+   else {
+      return 0;
+   }
+}
+
+const Str *DatabaseRetrieveRanked( const Str *pattern, unsigned int rank ) {
+   int ranking;
+
+   DatabaseRemoveExpiredRecords();
+
+   for ( ranking = 0; ranking < totalRankings; ranking += 1 ) {
+      if ( StrCompare( rankings[ ranking ].pattern, pattern ) == 0 ) {
+         const SkipList *rankedRecords = 
+            &DatabaseGetTargetMap()->rankedRecords[ ranking ];
+         const SkipListNode *node;
+
+         if ( rankedRecords->head == NULL ) {
+            return NULL;
+         }
+
+         node = SkipListGetByRank( rankedRecords, rank );
+         if ( node != NULL ) {
+            return ( ( const DatabaseRecord * ) node->value )->key->name;
+         }
+
+         return NULL;
+      }
+   }
+
+   return NULL;
+}
+
+void DatabaseShutdownRankings( void ) {
+   int ranking;
+
+   for ( ranking = 0; ranking < totalRankings; ranking += 1 ) {
+      StrDel( rankings[ ranking ].pattern );
+      StrDel( rankings[ ranking ].match );
+   }
+
+   totalRankings = 0;
+}
+
+int DatabaseCalculateRecordsTotalSize( void ) {
+   int size = 0;
+
+   DatabaseMapEntry *entry;
+   DatabasePlayerEntry *player;
+
+   entry = database.firstMap;
+   while ( entry != NULL ) {
+      size += DatabaseCalculateStoreSize( &entry->records );
+
+      player = entry->firstPlayer;
+      while ( player != NULL ) {
+         size += DatabaseCalculateStoreSize( &player->records );
+         player = player->nextEntry;
+      }
+
+      entry = entry->nextEntry;
+   }
+
+   return size;
+}
+
+int DatabaseCalculateStoreSize( const DatabaseRecordStore *store ) {
+   const DatabaseRecordBlock *block = store->firstBlock;
+   int size = 0;
+
+   while ( block != NULL ) {
+      unsigned int slot;
+
+      for ( slot = 0; slot < block->totalRecords; slot += 1 ) {
+         const DatabaseRecord *record = &block->records[ slot ];
+
+         if ( record->isUsed ) {
+            size += record->key->name->length + record->value.length;
+         }
+      }
+
+      block = block->nextBlock;
+   }
+
+   return size;
+}
+
+/* Finds the entry of a map by name and loads it, as if the map was used.
+   A map without an entry gets one if @isCreated is true. */
+DatabaseMapEntry *DatabaseUseMapEntry( const Str *mapName, Bool isCreated ) {
+   Str *name = StrDown( mapName );
+   DatabaseMapEntry *entry = DatabaseFindMapEntry( name );
+
+   if ( entry == NULL && isCreated ) {
+      entry = DatabaseCreateMapEntry( name );
+      DatabaseAppendMapEntry( entry );
+   }
+   else if ( entry != NULL && ! entry->isLoaded ) {
+      DatabaseLoadMapEntry( entry );
+   }
+
+   if ( entry != NULL ) {
+      DatabaseTouchMapEntry( entry );
+   }
+
+   StrDel( name );
+   return entry;
+}
+
+const Str *DatabaseRetrieveFromMap( const Str *map, const Str *name ) {
+   Str *mapName = StrDown( map );
+   const DatabaseMapEntry *entry = DatabaseFindMapEntry( mapName );
+
+   StrDel( mapName );
+
+   /* Reading a record doesn't need the map to be loaded. */
+   if ( entry == NULL ) {
+      return NULL;
+   }
+   else if ( ! entry->isLoaded ) {
+      return DatabaseRetrieveFromFile( entry, NULL, name );
+   }
+   else {
+      return DatabaseRetrieveRecord( &entry->records, name );
+   }
+}
+
+/* Names that don't begin with a letter are kept for the records the 
+   database makes itself, like the expiry times of temporary records. */
+Bool DatabaseIsRecordName( const Str *name ) {
+   return ( isalpha( name->value[ 0 ] ) != 0 );
+}
+
+Bool DatabaseStoreInMap( const Str *map, const Str *name, const Str *value ) {
+   DatabaseRecord *record;
+
+   if ( ! DatabaseIsRecordName( name ) ) {
+      return FALSE;
+   }
+
+   record = DatabaseStoreRecord( DatabaseUseMapEntry( map, TRUE ), NULL, 
+      name, value );
+
+   DatabaseClearExpiry( record );
+   DatabaseEnforceMemoryBudget();
+
+   return ( record != NULL );
+}
+
+Bool DatabaseRemoveFromMap( const Str *map, const Str *name ) {
+   DatabaseMapEntry *entry = DatabaseUseMapEntry( map, FALSE );
+   DatabaseRecord *record;
+
+   if ( entry == NULL ) {
+      return FALSE;
+   }
+
+   record = DatabaseFindRecord( &entry->records, 
+      SymbolTableFind( &database.keys, name ) );
+   if ( record != NULL ) {
+      DatabaseRemoveRecord( record );
+   }
+
+   DatabaseEnforceMemoryBudget();
+   return ( record != NULL );
+}
+
+int DatabaseListMapKeys( const Str *map, const Str *prefix, 
+   const Str *cursor, Str **keys, int limit ) {
+   const DatabaseMapEntry *entry = DatabaseUseMapEntry( map, FALSE );
+   const SkipListNode *node;
+   int keysListed;
+
+   if ( entry == NULL ) {
+      return -1;
+   }
+
+   DatabaseRemoveExpiredRecords();
+   if ( cursor != NULL && cursor->length > 0 &&
+      StrCompare( cursor, prefix ) >= 0 ) {
+      node = SkipListUpperBound( &entry->records.orderedKeys, cursor );
+   }
+   else {
+      node = SkipListLowerBound( &entry->records.orderedKeys, prefix );
+   }
+
+   /* The keys are copied before the map gets a chance to be unloaded. */
+   keysListed = DatabaseListKeys( node, NULL, prefix, keys, limit );
+   DatabaseEnforceMemoryBudget();
+
+   return keysListed;
+}
+
+int DatabaseListMaps( const Str *cursor, Str **names, int limit ) {
+   const DatabaseMapEntry *entry = database.firstMap;
+   int mapsListed = 0;
+
+   if ( cursor != NULL && cursor->length > 0 ) {
+      entry = DatabaseFindMapEntry( cursor );
+      if ( entry == NULL ) {
+         return -1;
+      }
+
+      entry = entry->nextEntry;
+   }
+
+   while ( entry != NULL && mapsListed < limit ) {
+      names[ mapsListed ] = StrCopy( entry->name );
+      mapsListed += 1;
+      entry = entry->nextEntry;
+   }
+
+   return mapsListed;
+}
+
+void DatabaseGetStats( DatabaseStats *stats ) {
+   const DatabaseMapEntry *entry;
+
+   stats->totalMaps = database.totalMaps;
+   stats->loadedMaps = 0;
+   for ( entry = database.firstMap; entry != NULL; 
+      entry = entry->nextEntry ) {
+      if ( entry->isLoaded ) {
+         stats->loadedMaps += 1;
+      }
+   }
+
+   stats->totalRecords = database.totalRecords;
+   stats->totalKeys = database.keys.totalSymbols;
+   stats->totalTemporaryRecords = database.expiryWheel.totalTimers;
+   stats->updatesSinceLastSave = database.updatesSinceLastSave;
+   stats->memoryUsed = database.memoryUsed;
+   stats->memoryBudget = database.memoryBudget;
+}
+
+const Str *DatabaseGetFilePath( void ) {
+   return database.filePath;
+}
+
+Bool DatabaseDelete( const Str *mapName ) {
+   DatabaseMapEntry *prevEntry = database.firstMap;
+   DatabaseMapEntry *currEntry = database.firstMap;
+
+   while ( currEntry != NULL && ! StrIsEqual( currEntry->name, mapName ) ) {
+      prevEntry = currEntry;
+      currEntry = currEntry->nextEntry;
+   }
+
+   if ( currEntry != NULL ) {
+		/* If found entry isn't first entry, link next entry to previous one. */
+      if ( currEntry != database.firstMap ) {	
+         prevEntry->nextEntry = currEntry->nextEntry;
+	   }
+	   /* Otherwise, make next entry the first entry. */
+	   else {
+		   database.firstMap = currEntry->nextEntry;
+		}
+
+      if ( currEntry == database.globalMap ) {
+         database.globalMap = NULL;
+      }
+	   
+      DatabaseDestroyMapEntry( currEntry );
+      database.updatesSinceLastSave += 1;
+
+      return TRUE;
+   }
+   else {
+      return FALSE;
+   }
+}
+
+void DatabaseStartDump( DatabaseDump *dump, const Str *selectedMap ) {
+   dump->stage = DB_DUMP_HEADER;
+   dump->selectedMap = ( selectedMap != NULL ) ? StrCopy( selectedMap ) : NULL;
+   dump->map = NULL;
+   dump->key = NULL;
+   dump->player = NULL;
+   dump->totalRecords = 0;
+}
+
+Bool DatabaseContinueDump( DatabaseDump *dump, MemFile *output, int limit ) {
+   int recordsLeft = limit;
+
+   while ( dump->stage != DB_DUMP_DONE && recordsLeft > 0 ) {
+      /* The map is looked up again on every step, as it could have been 
+         unloaded since the last one. */
+      DatabaseMapEntry *entry = ( dump->map != NULL ) ? 
+         DatabaseFindMapEntry( dump->map ) : NULL;
+      int recordsDumped = 0;
+
+      if ( dump->stage == DB_DUMP_HEADER ) {
+         DatabaseDumpHeader( dump, output );
+      }
+      else if ( entry == NULL ) {
+         DatabaseDumpText( output, "\tMap removed during the dump: ", 
+            dump->map->value );
+         dump->stage = DB_DUMP_DONE;
+      }
+      else if ( dump->stage == DB_DUMP_MAP ) {
+         DatabaseDumpMapEntry( dump, entry, output );
+      }
+      else if ( ! entry->isLoaded ) {
+         DatabaseDumpText( output, "\tMap unloaded during the dump", "" );
+         DatabaseDumpText( output, "", "" );
+         DatabaseDumpNextMap( dump, entry );
+      }
+      else if ( dump->stage == DB_DUMP_RECORDS ) {
+         recordsDumped = DatabaseDumpRecords( dump, &entry->records, 
+            recordsLeft, output );
+         if ( dump->key == NULL ) {
+            dump->stage = DB_DUMP_PLAYERS;
+         }
+      }
+      else {
+         recordsDumped = DatabaseDumpNextPlayer( dump, entry, output );
+      }
+
+      /* Every step counts as at least one record, so a dump going through
+         many maps that aren't loaded still takes its time. */
+      recordsLeft -= ( recordsDumped > 0 ) ? recordsDumped : 1;
+   }
+
+   return ( dump->stage != DB_DUMP_DONE );
+}
+
+void DatabaseEndDump( DatabaseDump *dump ) {
+   StrDel( dump->selectedMap );
+   StrDel( dump->map );
+   StrDel( dump->key );
+   StrDel( dump->player );
+   dump->selectedMap = NULL;
+   dump->map = NULL;
+   dump->key = NULL;
+   dump->player = NULL;
+   dump->stage = DB_DUMP_DONE;
+}
+
+void DatabaseDumpHeader( DatabaseDump *dump, MemFile *output ) {
+   const DatabaseMapEntry *entry = database.firstMap;
+
+   DatabaseDumpText( output, "----- Database -----", "" );
+   DatabaseDumpNumber( output, "Map entries: ", database.totalMaps, "" );
+   DatabaseDumpNumber( output, "Records: ", database.totalRecords, "" );
+   DatabaseDumpNumber( output, "Memory used: ", database.memoryUsed, 
+      " bytes" );
+   DatabaseDumpText( output, "", "" );
+
+   /* Records for a single map: */
+   if ( dump->selectedMap != NULL ) {
+      while ( entry != NULL && 
+         ! StrIsEqual( dump->selectedMap, entry->name ) ) {
+         entry = entry->nextEntry;
+      }
+
+      if ( entry == NULL ) {
+         DatabaseDumpText( output, "No such map in database: ",
+            dump->selectedMap->value );
+      }
+   }
+
+   if ( entry != NULL ) {
+      dump->map = StrCopy( entry->name );
+      dump->stage = DB_DUMP_MAP;
+   }
+   else {
+      dump->stage = DB_DUMP_DONE;
+   }
+}
+
+void DatabaseDumpMapEntry( DatabaseDump *dump, 
+   const DatabaseMapEntry *entry, MemFile *output ) {
+   DatabaseDumpText( output, "\tName: ", entry->name->value );
+   if ( ! entry->isLoaded ) {
+      DatabaseDumpText( output, "\tNot loaded", "" );
+      DatabaseDumpText( output, "", "" );
+      DatabaseDumpNextMap( dump, entry );
+      return;
+   }
+
+   DatabaseDumpNumber( output, "\tTotal records: ", 
+      entry->records.totalRecords, "" );
+   DatabaseDumpNumber( output, "\tTotal players: ", entry->totalPlayers, 
+      "" );
+   DatabaseDumpText( output, "", "" );
+
+   dump->stage = DB_DUMP_RECORDS;
+}
+
+/* Dumps records of the store in the order of their keys, starting after 
+   the key of the dump, and moves the key along. The key is cleared once 
+   the last record is dumped. Returns the number of records dumped. */
+int DatabaseDumpRecords( DatabaseDump *dump, 
+   const DatabaseRecordStore *store, int limit, MemFile *output ) {
+   const SkipListNode *node;
+   const Str *lastKey = NULL;
+   int recordsDumped = 0;
+
+   if ( dump->key != NULL ) {
+      node = SkipListUpperBound( &store->orderedKeys, dump->key );
+   }
+   else {
+      node = SkipListFirst( &store->orderedKeys );
+   }
+
+   while ( node != NULL && recordsDumped < limit ) {
+      const DatabaseRecord *record = ( const DatabaseRecord * ) node->value;
+
+      DatabaseDumpText( output, "\t\tKey: ", record->key->name->value );
+      DatabaseDumpText( output, "\t\tValue: ", record->value.value );
+      DatabaseDumpText( output, "", "" );
+
+      lastKey = record->key->name;
+      recordsDumped += 1;
+      node = SkipListNext( node );
+   }
+
+   StrDel( dump->key );
+   dump->key = ( node != NULL ) ? StrCopy( lastKey ) : NULL;
+
+   dump->totalRecords += recordsDumped;
+   return recordsDumped;
+}
+
+/* Dumps all the records of the player after the player of the dump, or 
+   moves on to the next map once there are no more players. Returns the
+   number of records dumped. */
+int DatabaseDumpNextPlayer( DatabaseDump *dump, 
+   const DatabaseMapEntry *entry, MemFile *output ) {
+   const DatabasePlayerEntry *player = entry->firstPlayer;
+
+   if ( dump->player != NULL ) {
+      player = DatabaseFindPlayer( entry, dump->player, 
+         StrHash( dump->player ) );
+      if ( player == NULL ) {
+         DatabaseDumpText( output, "\tPlayer removed during the dump: ",
+            dump->player->value );
+         DatabaseDumpText( output, "", "" );
+         DatabaseDumpNextMap( dump, entry );
+         return 0;
+      }
+
+      player = player->nextEntry;
+   }
+
+   if ( player == NULL ) {
+      DatabaseDumpNextMap( dump, entry );
+      return 0;
+   }
+
+   DatabaseDumpText( output, "\tPlayer: ", player->name->value );
+   DatabaseDumpNumber( output, "\tTotal records: ", 
+      player->records.totalRecords, "" );
+   DatabaseDumpText( output, "", "" );
+
+   StrDel( dump->player );
+   dump->player = StrCopy( player->name );
+
+   /* A player has few records, so they're dumped in one go. */
+   return DatabaseDumpRecords( dump, &player->records, 
+      ( int ) player->records.totalRecords, output );
+}
+
+void DatabaseDumpNextMap( DatabaseDump *dump, 
+   const DatabaseMapEntry *entry ) {
+   StrDel( dump->map );
+   StrDel( dump->key );
+   StrDel( dump->player );
+   dump->map = NULL;
+   dump->key = NULL;
+   dump->player = NULL;
+
+   /* New maps go to the front of the list, so they're left out of a dump
+      that is already under way. */
+   if ( dump->selectedMap == NULL && entry->nextEntry != NULL ) {
+      dump->map = StrCopy( entry->nextEntry->name );
+      dump->stage = DB_DUMP_MAP;
+   }
+   else {
+      dump->stage = DB_DUMP_DONE;
+   }
+}
+
+void DatabaseDumpText( MemFile *output, const char *label, 
+   const char *text ) {
+   MemFileAdd( output, label, strlen( label ) );
+   MemFileAdd( output, text, strlen( text ) );
+   MemFileAdd( output, "\n", 1 );
+}
+
+void DatabaseDumpNumber( MemFile *output, const char *label, 
+   unsigned long number, const char *unit ) {
+   char numberText[ 32 ];
+
+   sprintf( numberText, "%lu", number );
+   MemFileAdd( output, label, strlen( label ) );
+   DatabaseDumpText( output, numberText, unit );
 }
@@ -31,18 +31,50 @@
 #define DATABASE_H
 
 #include <stdio.h>
+#include <time.h>
 
 #include "gentype.h"
 #include "strutil.h"
+#include "skiplist.h"
+#include "symtab.h"
+#include "timerwheel.h"
+#include "memfile.h"
 
 #include "luk.h"
 
-/* Even though the lukd file specification sets no limits on the total 
-   records a database file might have, we will set a limit on our database
-   for our purposes. */
-#define DATABASE_MAX_ENTRIES 1024
 #define DATABASE_MAX_RECORDS 1024
 #define DATABASE_RECORD_MAX_SIZE 1024
+/* Every record store starts with this many hash buckets. The bucket table
+   doubles in size whenever it gets three quarters full. */
+#define DATABASE_INITIAL_BUCKETS 16
+/* The player table of a map entry doubles in size whenever the players
+   outnumber its buckets. */
+#define DATABASE_INITIAL_PLAYER_BUCKETS 8
+/* Records are allocated in blocks. The first block of a store has room for
+   this many records, and every next block for twice as many as the one
+   before it, up to the maximum. */
+#define DATABASE_INITIAL_RECORD_BLOCK 8
+#define DATABASE_MAX_RECORD_BLOCK 256
+#define DATABASE_MAX_RANKINGS 8
+/* A key pattern ending with this character matches all keys that start
+   with the rest of the pattern. */
+#define DATABASE_RANKING_WILDCARD '*'
+/* Name of the map entry holding the global records. Lump names can't 
+   contain an asterisk, so no real map can clash with it. */
+#define DATABASE_GLOBAL_MAP "*global"
+/* Number of earlier versions of the database file kept as backups, unless
+   configured otherwise. */
+#define DATABASE_DEFAULT_BACKUPS 1
+/* When a save to unload maps fails, the next one waits this many seconds,
+   doubling with every failure up to the maximum. */
+#define DATABASE_SAVE_RETRY_DELAY 5
+#define DATABASE_MAX_SAVE_RETRY_DELAY 300
+
+/* Keyspaces the record functions can work on. */
+typedef enum {
+   DB_SCOPE_MAP,
+   DB_SCOPE_GLOBAL
+} DatabaseScope;
 
 enum {
    DB_INIT_SUCCESS,
@@ -50,30 +82,237 @@ enum {
    DB_INIT_FAILED
 };
 
-/* We're going to use a linked list for the records. */
+struct DatabaseMapEntry;
+struct DatabasePlayerEntry;
+
+/* The records of a store are kept side by side in blocks of memory, so
+   going through all of them is a sweep over a few arrays rather than a walk
+   down a list. A record never moves once it's created, so the indexes can
+   point at it. On top of the blocks, every record is also found in the hash
+   buckets, for quick lookups by key, and in an ordered index, for walking
+   through the keys in order. */
 typedef struct DatabaseRecord {
-   Str *key;
-   Str *value;
-   struct DatabaseRecord *nextRecord;
+   /* Keys are interned, so all records with the same key share it, and two
+      records have the same key exactly when they have the same symbol. */
+   Symbol *key;
+   Str value;
+   struct DatabaseMapEntry *mapEntry;
+   /* Player the record belongs to, or NULL for records of the map 
+      itself. */
+   struct DatabasePlayerEntry *player;
+   /* Temporary records are removed once their expiry time is reached.
+      Permanent records have an expiry time of 0. */
+   time_t expiresAt;
+   TimerWheelNode expiryTimer;
+   /* Ranking the record belongs to, or -1 if its key matches no ranking.
+      The record is only in the ranking while its value is a number. */
+   int ranking;
+   Bool isRanked;
+   long score;
+   /* Removed records stay in their block, unused, until the space is given
+      to a new record. */
+   Bool isUsed;
+   struct DatabaseRecord *nextFree;
 } DatabaseRecord;
 
+typedef struct DatabaseRecordBlock {
+   struct DatabaseRecordBlock *nextBlock;
+   unsigned int size;
+   /* Number of records taken from the block so far. The records past this
+      one have never been used. */
+   unsigned int totalRecords;
+   /* Only @size records are allocated. */
+   DatabaseRecord records[ 1 ];
+} DatabaseRecordBlock;
+
+/* A hash bucket. The buckets are probed one after another, and the key is
+   kept in the bucket, so a lookup only touches the record it's after. An
+   empty bucket has no record. */
+typedef struct {
+   const Symbol *key;
+   DatabaseRecord *record;
+} DatabaseRecordBucket;
+
+/* A series of records with their own keyspace. */
+typedef struct {
+   DatabaseRecordBlock *firstBlock;
+   DatabaseRecordBlock *lastBlock;
+   DatabaseRecord *freeRecords;
+   unsigned int totalRecords;
+   /* Lookup structures: */
+   DatabaseRecordBucket *buckets;
+   unsigned int totalBuckets;
+   SkipList orderedKeys;
+} DatabaseRecordStore;
+
+/* The records a map keeps for a single player. Each player has a keyspace
+   of its own, so the wad can use the same keys for every player. */
+typedef struct DatabasePlayerEntry {
+   Str *name;
+   unsigned int hash;
+   struct DatabasePlayerEntry *nextEntry;
+   struct DatabasePlayerEntry *nextInBucket;
+   DatabaseRecordStore records;
+} DatabasePlayerEntry;
+
+/* Location of a series of records of a map in the database file. */
+typedef struct DatabaseFileSection {
+   /* Player the records belong to, or NULL for records of the map. */
+   Str *player;
+   size_t firstRecord;
+   unsigned int totalRecords;
+   /* Hash index of the records, which lets a single record be read from
+      the file without loading the others. Files of older versions have no
+      index, in which case the number of slots is 0. */
+   size_t firstIndexSlot;
+   unsigned int totalIndexSlots;
+   /* Bloom filter of the keys of the records, kept in memory, so most keys
+      that aren't in the file are found out without reading it. Files of
+      older versions have no filter, in which case it's NULL. */
+   Byte *filter;
+   size_t firstFilterByte;
+   unsigned int filterSize;
+   /* Compressed records are read from blocks. */
+   Bool isCompressed;
+   size_t firstBlock;
+   unsigned int totalBlocks;
+   /* Checksum of the bytes of the series, which is checked when the 
+      records are first read. Files of older versions have no checksum, in
+      which case the size is 0. */
+   size_t size;
+   unsigned int checksum;
+   Bool isChecked;
+   Bool isDamaged;
+   /* Earliest expiry time of the temporary records of the series, or 0 if
+      it has none. It's known once the records have been read through, or
+      when they were written by this run of luk. */
+   time_t nextExpiry;
+   Bool isExpiryKnown;
+   struct DatabaseFileSection *nextSection;
+} DatabaseFileSection;
+
 typedef struct DatabaseMapEntry {
    Str *name;
    struct DatabaseMapEntry *nextEntry;
-   DatabaseRecord *firstRecord;
-   unsigned int totalRecords;
+   /* The records of a map found in the database file are only loaded once
+      the map is used, and they can be unloaded again when the map hasn't
+      been used for a while. The file sections tell where the records of
+      the map are in the database file. */
+   Bool isLoaded;
+   DatabaseFileSection *fileSections;
+   /* Where the last save put the records. These become the file sections
+      once the saved file replaces the old one. */
+   DatabaseFileSection *savedSections;
+   /* Whether the records in memory differ from those in the file. */
+   Bool isDirty;
+   /* Estimated memory taken up by the records of the map. */
+   size_t memoryUsed;
+   /* Loaded entries, from the most recently used to the least. */
+   struct DatabaseMapEntry *lruPrev;
+   struct DatabaseMapEntry *lruNext;
+   DatabaseRecordStore records;
+   /* Ranked records, ordered from highest to lowest value. A ranking list
+      is only set up once the map gets a record for it. Only the records of
+      the map itself are ranked, not those of its players. */
+   SkipList rankedRecords[ DATABASE_MAX_RANKINGS ];
+   /* Players: */
+   DatabasePlayerEntry *firstPlayer;
+   unsigned int totalPlayers;
+   DatabasePlayerEntry **playerBuckets;
+   unsigned int totalPlayerBuckets;
 } DatabaseMapEntry;
 
+/* A ranking keeps the records whose keys match a pattern ordered by their
+   numeric values, so the wad can ask for the top records or the rank of
+   a record without reading and sorting all of them itself. */
+typedef struct {
+   Str *pattern;
+   /* The pattern without the wildcard: */
+   Str *match;
+   Bool isPrefix;
+} DatabaseRanking;
+
 typedef struct {
    Bool isOperational;
    /* Entries: */
    DatabaseMapEntry *firstMap;
    DatabaseMapEntry *currentMap;
+   /* Entry for the records shared by all maps, found in the map list like
+      any other entry. It's created when first used. */
+   DatabaseMapEntry *globalMap;
+   DatabaseScope scope;
    unsigned int totalMaps;
    unsigned int totalRecords;
    unsigned int updatesSinceLastSave;
+   /* When the records take up more memory than the budget, the least
+      recently used maps are saved and unloaded. A budget of 0 means there
+      is no limit. */
+   size_t memoryBudget;
+   /* Whether the records are compressed when the database is saved. */
+   Bool isFileCompressed;
+   /* Number of backups kept of the database file. The file is backed up
+      when a save first replaces it. */
+   unsigned int totalBackups;
+   size_t memoryUsed;
+   DatabaseMapEntry *lruFirst;
+   DatabaseMapEntry *lruLast;
+   /* A failed save, like on a full disk, is not tried again to unload maps
+      before this time. The delay is 0 while saves succeed. */
+   time_t nextSaveTime;
+   int saveRetryDelay;
+   /* The database file, which is needed to save maps before they are
+      unloaded. */
+   Str *filePath;
+   /* The database file is left as it is. Nothing is saved, so maps with
+      changes stay loaded. */
+   Bool isReadOnly;
+   /* Last value read straight from the database file. It's kept until the
+      next one is read, like the values of records in memory are kept until
+      the records change. */
+   Str *fileValue;
+   /* Expiry timers of the temporary records, ticking once a second. */
+   TimerWheel expiryWheel;
+   /* Keys of the records of all maps. */
+   SymbolTable keys;
 } Database;
 
+typedef enum {
+   DB_DUMP_HEADER,
+   DB_DUMP_MAP,
+   DB_DUMP_RECORDS,
+   DB_DUMP_PLAYERS,
+   DB_DUMP_DONE
+} DatabaseDumpStage;
+
+/* A dump writes out the records of the database as text, a few records at
+   a time, so dumping a large database doesn't hold up luk. The place of
+   the dump is kept by name, so the dump carries on from the right place
+   when records and players change between steps. */
+typedef struct {
+   DatabaseDumpStage stage;
+   /* Only this map is dumped, or all of them if it's NULL. */
+   Str *selectedMap;
+   Str *map;
+   /* Last key dumped of the map or the player being dumped. */
+   Str *key;
+   /* Last player dumped. */
+   Str *player;
+   unsigned int totalRecords;
+} DatabaseDump;
+
+/* Figures about the state of the database. */
+typedef struct {
+   unsigned int totalMaps;
+   unsigned int loadedMaps;
+   /* Records of the loaded maps: */
+   unsigned int totalRecords;
+   unsigned int totalKeys;
+   unsigned int totalTemporaryRecords;
+   unsigned int updatesSinceLastSave;
+   size_t memoryUsed;
+   size_t memoryBudget;
+} DatabaseStats;
+
 /* This is the public interface, containing the functions to be used 
    for communicating with the database storage mechanism. */
 void DatabaseInitialize( void );
@@ -85,15 +324,117 @@ Bool DatabaseSave( const char *databaseOutPath );
 void DatabaseShutdown( void );
 const Str *DatabaseGetCurrentMap( void );
 Bool DatabaseChangeMap( const Str *newCurrentMapName );
+/* Selects the keyspace used by the record functions below, which is the
+   current map unless the global scope is selected. The scope stays in 
+   effect until it's changed again. */
+void DatabaseSetScope( DatabaseScope scope );
+/* Tells the database where to find records of a map in the database file.
+   The map gets an entry if it doesn't have one yet, but its records are
+   only read from the file when the map is first used. Returns the new
+   section, or NULL if the map is already loaded. */
+DatabaseFileSection *DatabaseAddFileSection( const Str *mapName, 
+   const Str *player, size_t firstRecord, unsigned int totalRecords );
+/* Notes down where a save put records of a map. */
+DatabaseFileSection *DatabaseAddSavedSection( DatabaseMapEntry *entry, 
+   const Str *player, size_t firstRecord, unsigned int totalRecords );
+/* Once a save is done, the file sections of all maps are replaced by the
+   saved sections, if the save succeeded, or the saved sections are thrown
+   away otherwise. */
+void DatabaseCommitFileSections( Bool isSaved );
+/* Sets the memory budget, in bytes, and unloads maps if the records 
+   already go over it. */
+void DatabaseSetMemoryBudget( size_t memoryBudget );
+void DatabaseSetFileCompression( Bool isFileCompressed );
+void DatabaseSetBackupCount( unsigned int totalBackups );
+/* Keeps every save, including the ones made to unload maps, from writing
+   the database file. */
+void DatabaseSetReadOnly( Bool isReadOnly );
+/* These functions put records into the given map entry, whether it's the
+   current one or not. They're used to load the records of a map. */
+void DatabaseLoadRecord( DatabaseMapEntry *entry, const Str *player,
+   const Str *name, const Str *value );
+void DatabaseLoadExpiry( DatabaseMapEntry *entry, const Str *player,
+   const Str *name, time_t expiresAt );
+/* Records of maps that aren't loaded are read straight from the database
+   file, without loading the map. */
 const Str *DatabaseRetrieve( const Str *name );
 Bool DatabaseDelete( const Str *map );
+/* The player functions work like their map counterparts, but on the 
+   records the current map keeps for the given player. The player's records
+   are created with its first record and removed together by
+   DatabaseDeletePlayer(). */
+void DatabaseStorePlayer( const Str *player, const Str *name, 
+   const Str *value );
+void DatabaseStorePlayerTemporary( const Str *player, const Str *name,
+   const Str *value, int ttl );
+Bool DatabaseSetPlayerExpiry( const Str *player, const Str *name, 
+   time_t expiresAt );
+const Str *DatabaseRetrievePlayer( const Str *player, const Str *name );
+Bool DatabaseDeletePlayer( const Str *player );
 /* This function either updates an existing record with the same key or 
    appends it as a new record if the key doesn't exist . */
 void DatabaseStore( const Str *name, const Str *value );
+/* Same as DatabaseStore(), but the record is removed after the given number
+   of seconds. */
+void DatabaseStoreTemporary( const Str *name, const Str *value, int ttl );
+/* Sets the time at which a record of the current map expires. A record with
+   an expiry time that has already passed is removed right away. */
+Bool DatabaseSetExpiry( const Str *name, time_t expiresAt );
+Bool DatabaseIsExpired( const DatabaseRecord *record, time_t now );
+/* Removes the temporary records that have expired by the given time. This
+   function should be called regularly, preferably every second. Returns the
+   number of records removed. */
+int DatabaseExpireRecords( time_t now );
+/* These functions put copies of the keys of the current map in @keys, in 
+   order, and return the number of keys listed. The caller deletes the 
+   copies. At most @limit keys are listed, and only keys that come after 
+   @cursor, when a cursor is given, so the caller can page through the keys
+   by passing the last key of the previous page as the cursor. The range is
+   inclusive; an empty @first or @last leaves that end open. */
+int DatabaseListKeysInRange( const Str *first, const Str *last,
+   const Str *cursor, Str **keys, int limit );
+int DatabaseListKeysWithPrefix( const Str *prefix, const Str *cursor,
+   Str **keys, int limit );
+/* Sets up a ranking for the keys matching the given pattern. Rankings need
+   to be added before any records are loaded into the database. */
+Bool DatabaseAddRanking( const Str *pattern );
+/* Returns the rank of the record with the given key in the current map,
+   1 being the highest, or 0 if the record isn't ranked. */
+unsigned int DatabaseRetrieveRank( const Str *key );
+/* Returns the key of the record at the given rank of the ranking with the
+   given pattern, or NULL if there is no such record. */
+const Str *DatabaseRetrieveRanked( const Str *pattern, unsigned int rank );
 int DatabaseCalculateRecordsTotalSize( void );
+/* These functions work on the records of a map given by name, whether it's
+   the current map or not, and leave the current map and scope as they are.
+   They're used for maintenance while luk is running. A map that isn't 
+   loaded is loaded for a change or a listing, like it would be when it's 
+   played, and storing a record in a map without an entry creates one. */
+const Str *DatabaseRetrieveFromMap( const Str *map, const Str *name );
+Bool DatabaseStoreInMap( const Str *map, const Str *name, const Str *value );
+/* Record names begin with a letter. Records with other names can't be
+   stored from outside of the database. */
+Bool DatabaseIsRecordName( const Str *name );
+Bool DatabaseRemoveFromMap( const Str *map, const Str *name );
+/* Works like DatabaseListKeysWithPrefix(), but on the given map. Returns 
+   -1 if the map has no entry. */
+int DatabaseListMapKeys( const Str *map, const Str *prefix, 
+   const Str *cursor, Str **keys, int limit );
+/* Lists copies of the names of the map entries in the same paged manner as
+   the keys. New maps are listed first, so they don't show up in a listing
+   that is already under way. Returns -1 if the cursor map has no entry 
+   anymore. */
+int DatabaseListMaps( const Str *cursor, Str **names, int limit );
+void DatabaseGetStats( DatabaseStats *stats );
+/* Returns the path of the database file, or NULL if there is no file, like
+   in skip mode. */
+const Str *DatabaseGetFilePath( void );
 /* Debug functions */
-void DatabasePrint( const Str *selectedMap );
-void DatabasePrintMapEntry( const DatabaseMapEntry *entry );
-void DatabasePrintRecord( const DatabaseRecord *record );
+void DatabaseStartDump( DatabaseDump *dump, const Str *selectedMap );
+/* Adds the next records of the dump to the output, at most around @limit
+   of them, with maps and players without records counting as one. Returns
+   false once the dump is complete. */
+Bool DatabaseContinueDump( DatabaseDump *dump, MemFile *output, int limit );
+void DatabaseEndDump( DatabaseDump *dump );
 
 #endif
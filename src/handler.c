@@ -23,7 +23,7 @@
 */
 
 #include <stdlib.h>
-#include <ctype.h>
+#include <stdio.h>
 #include <time.h>
 
 #include "strutil.h"
@@ -31,23 +31,51 @@
 #include "handler.h"
 #include "command.h"
 #include "database.h"
+#include "stats.h"
 #include "print.h"
 
 /* Private handler helpers prototypes: */
 static int HandlerEncodeValueInAscii( const char *value, const int vLength );
 static void HandlerEndStringTransmission( void );
+static void HandlerBeginStringTransmission( const Str *value );
+static void HandlerSendKeyList( Str **keys, int totalKeys );
+static int HandlerGetPageSize( const command_t *command, int arg );
+static void HandlerEndDump( void );
 
 /* Setup the structure that will help us with transferring strings. */
 static string_transm_t st = { NULL, 0, 0, FALSE, 0 };
 
+/* Database dump started by PRINT_DATABASE. The dump is written out from 
+   the main loop, so the query itself returns right away. */
+static DatabaseDump dump;
+static FILE *dumpFile = NULL;
+static const Str *dumpPath = NULL;
+
+/* STORE <key> <value> [ttl]
+
+   When a TTL is given, the record is removed after that many seconds. */
 void HandlerStore( const command_t *command ) {
    if ( command->argsCount >= 2 ) {
       /* Record names should begin with a letter. */
-      if ( isalpha( command->args[ 0 ]->value[ 0 ] ) ) {
+      if ( DatabaseIsRecordName( command->args[ 0 ] ) ) {
          const Str *key = command->args[ 0 ];
          const Str *value = command->args[ 1 ];
-         DatabaseStore( key, value );
-         PrintMessage( "Storing \"%s\" in \"%s\"\n", value->value, key->value );
+         int ttl = 0;
+
+         if ( command->argsCount >= 3 ) {
+            ttl = atoi( command->args[ 2 ]->value );
+         }
+
+         if ( ttl > 0 ) {
+            DatabaseStoreTemporary( key, value, ttl );
+            PrintDebug( "Storing \"%s\" in \"%s\" for %d seconds\n", 
+               value->value, key->value, ttl );
+         }
+         else {
+            DatabaseStore( key, value );
+            PrintDebug( "Storing \"%s\" in \"%s\"\n", value->value, 
+               key->value );
+         }
       }
       else {
          PrintNotice( "Record names should begin with a letter\n" );
@@ -59,6 +87,79 @@ void HandlerStore( const command_t *command ) {
    }
 }
 
+/* STORE_P <player> <key> <value> [ttl]
+   RETRIEVE_P <player> <key>
+   DELETE_P <player>
+
+   Same as STORE and RETRIEVE, but the record belongs to a player of the
+   current map. DELETE_P removes all the records of the player. */
+void HandlerStorePlayer( const command_t *command ) {
+   if ( command->argsCount >= 3 ) {
+      if ( DatabaseIsRecordName( command->args[ 1 ] ) ) {
+         const Str *player = command->args[ 0 ];
+         const Str *key = command->args[ 1 ];
+         const Str *value = command->args[ 2 ];
+         int ttl = 0;
+
+         if ( command->argsCount >= 4 ) {
+            ttl = atoi( command->args[ 3 ]->value );
+         }
+
+         if ( ttl > 0 ) {
+            DatabaseStorePlayerTemporary( player, key, value, ttl );
+         }
+         else {
+            DatabaseStorePlayer( player, key, value );
+         }
+
+         PrintDebug( "Storing \"%s\" in \"%s\" of player \"%s\"\n", 
+            value->value, key->value, player->value );
+      }
+      else {
+         PrintNotice( "Record names should begin with a letter\n" );
+      }
+   }
+   else {
+      PrintNotice(
+         "Missing arguments for STORE_P command. Dropping command\n" );
+   }
+}
+
+void HandlerRetrievePlayer( const command_t *command ) {
+   if ( command->argsCount >= 2 ) {
+      const Str *player = command->args[ 0 ];
+      const Str *key = command->args[ 1 ];
+      const Str *value = DatabaseRetrievePlayer( player, key );
+
+      if ( value != NULL ) {
+         ReplySetDataStr( value );
+         ReplySetResult( CMD_RETRIEVE_OK );
+      }
+      else {
+         ReplySetDataInt( 0 );
+         ReplySetResult( CMD_RETRIEVE_FAIL );
+         StatsCount( STATS_MISSES );
+         PrintNotice( "Asked for a non-existant record with key: %s of "
+            "player: %s\n", key->value, player->value );
+      }
+   }
+   else {
+      PrintNotice( "Missing player or key for RETRIEVE_P command\n" );
+   }
+}
+
+void HandlerDeletePlayer( const command_t *command ) {
+   if ( command->argsCount >= 1 ) {
+      if ( DatabaseDeletePlayer( command->args[ 0 ] ) ) {
+         PrintMessage( "Deleted records of player \"%s\"\n", 
+            command->args[ 0 ]->value );
+      }
+   }
+   else {
+      PrintNotice( "Missing player for DELETE_P command\n" );
+   }
+}
+
 void HandlerStoreDate( const command_t *command ) {
 	if ( command->argsCount >= 1 ) {
       /* Because the database only supports the Str datatype as its storage
@@ -116,6 +217,7 @@ void HandlerRetrieveDate( const command_t *command ) {
       else {
          ReplySetDataInt( 0 );
          ReplySetResult( CMD_RETRIEVE_FAIL );
+         StatsCount( STATS_MISSES );
          PrintNotice( "Asked for a non-existant date record with key: %s\n",
             command->args[ 0 ]->value );
       }
@@ -137,6 +239,7 @@ void HandlerRetrieve( const command_t *command ) {
       else {
          ReplySetDataInt( 0 );
          ReplySetResult( CMD_RETRIEVE_FAIL );
+         StatsCount( STATS_MISSES );
          PrintNotice( "Asked for a non-existant record with key: %s\n", 
             key->value );
       }
@@ -149,7 +252,6 @@ void HandlerRetrieve( const command_t *command ) {
 void HandlerRetrieveStringInit( const command_t *command ) {
    const Str *recordName;
    const Str *recordValue;
-   int queriesNeeded;
 
    /* We return an if no argument is given. */
    if ( command->argsCount > 0 ) {
@@ -164,39 +266,189 @@ void HandlerRetrieveStringInit( const command_t *command ) {
    recordValue = DatabaseRetrieve( recordName );
 
    if ( recordValue != NULL ) {
-      PrintMessage( "Starting string transmission for record: %s\n",
+      PrintDebug( "Starting string transmission for record: %s\n",
          recordName->value );
+      HandlerBeginStringTransmission( recordValue );
+   }
+   else {
+      PrintNotice( "Asked for a non-existant string record with key: %s\n", 
+         recordName->value );
+      ReplySetDataInt( 0 );
+      ReplySetResult( CMD_RETRIEVE_FAIL );
+      StatsCount( STATS_MISSES );
+   }
+}
 
-      /* If a previous transmission was not completed while another one is
-         activated, we remove the previous one. */
-      if ( st.isActive ) {
-         PrintWarning( "Terminating active string transmission to start "
-            " a new one\n" );
-         HandlerEndStringTransmission();
-      }
+void HandlerBeginStringTransmission( const Str *value ) {
+   int queriesNeeded;
+
+   /* If a previous transmission was not completed while another one is
+      activated, we remove the previous one. */
+   if ( st.isActive ) {
+      PrintWarning( "Terminating active string transmission to start "
+         " a new one\n" );
+      HandlerEndStringTransmission();
+   }
+
+   queriesNeeded = value->length / HANDLER_QUERY_MAX_CHARS;
+   /* The last query might not be a full query, meaning it won't transfer
+      the maximum possible characters allowed per query, but we still need
+      an extra query to transfer the remaining data. */
+   if ( value->length % HANDLER_QUERY_MAX_CHARS != 0 ) {
+      queriesNeeded += 1;
+   }
+
+   st.value = StrCopy( value );
+   st.queriesNeeded = queriesNeeded;
+   st.isActive = TRUE;
+   st.offset = 0;
+   st.charsLeft = value->length;
+
+   ReplySetDataInt( queriesNeeded );
+   ReplySetResult( CMD_RETRIEVE_OK );
+}
+
+/* The key listing commands send their results back as a string of keys
+   separated by spaces, using the string transmission, so the wad reads the
+   list the same way it reads a string record. A key with a space in it is
+   put in braces, like it's written in a command:
+
+      RETRIEVE_RANGE <first> <last> [page_size] [cursor]
+      RETRIEVE_PREFIX <prefix> [page_size] [cursor]
+
+   To get the next page, the wad passes the last key it received as the
+   cursor. */
+void HandlerRetrieveRange( const command_t *command ) {
+   Str *keys[ HANDLER_KEY_PAGE_MAX ];
+   int totalKeys;
+
+   if ( command->argsCount < 2 ) {
+      PrintNotice( "Missing range for RETRIEVE_RANGE command\n" );
+      return;
+   }
+
+   totalKeys = DatabaseListKeysInRange( command->args[ 0 ], 
+      command->args[ 1 ], command->argsCount > 3 ? command->args[ 3 ] : NULL,
+      keys, HandlerGetPageSize( command, 2 ) );
+   HandlerSendKeyList( keys, totalKeys );
+}
+
+void HandlerRetrievePrefix( const command_t *command ) {
+   Str *keys[ HANDLER_KEY_PAGE_MAX ];
+   int totalKeys;
+
+   if ( command->argsCount < 1 ) {
+      PrintNotice( "Missing prefix for RETRIEVE_PREFIX command\n" );
+      return;
+   }
 
-      queriesNeeded = recordValue->length / HANDLER_QUERY_MAX_CHARS;
-      /* The last query might not be a full query, meaning it won't transfer
-         the maximum possible characters allowed per query, but we still need
-         an extra query to transfer the remaining data. */
-      if ( recordValue->length % HANDLER_QUERY_MAX_CHARS != 0 ) {
-         queriesNeeded += 1;
+   totalKeys = DatabaseListKeysWithPrefix( command->args[ 0 ],
+      command->argsCount > 2 ? command->args[ 2 ] : NULL,
+      keys, HandlerGetPageSize( command, 1 ) );
+   HandlerSendKeyList( keys, totalKeys );
+}
+
+int HandlerGetPageSize( const command_t *command, int arg ) {
+   int pageSize = HANDLER_KEY_PAGE_DEFAULT;
+
+   if ( command->argsCount > arg ) {
+      pageSize = atoi( command->args[ arg ]->value );
+   }
+
+   if ( pageSize <= 0 ) {
+      pageSize = HANDLER_KEY_PAGE_DEFAULT;
+   }
+   else if ( pageSize > HANDLER_KEY_PAGE_MAX ) {
+      pageSize = HANDLER_KEY_PAGE_MAX;
+   }
+
+   return pageSize;
+}
+
+/* Sends the keys, and deletes them. */
+void HandlerSendKeyList( Str **keys, int totalKeys ) {
+   MemFile keyList;
+   Str *keyListText;
+   int keyNum;
+
+   if ( totalKeys == 0 ) {
+      ReplySetDataInt( 0 );
+      ReplySetResult( CMD_RETRIEVE_FAIL );
+      StatsCount( STATS_MISSES );
+      return;
+   }
+
+   MemFileInit( &keyList );
+   for ( keyNum = 0; keyNum < totalKeys; keyNum += 1 ) {
+      if ( keyNum > 0 ) {
+         MemFileAdd( &keyList, " ", 1 );
       }
 
-      st.value = StrCopy( recordValue );
-      st.queriesNeeded = queriesNeeded;
-      st.isActive = TRUE;
-      st.offset = 0;
-      st.charsLeft = recordValue->length;
+      CommandAddArgument( &keyList, keys[ keyNum ] );
+      StrDel( keys[ keyNum ] );
+   }
 
-      ReplySetDataInt( queriesNeeded );
+   keyListText = StrNewSub( ( const char * ) keyList.data, 
+      MemFileGetSize( &keyList ) );
+   MemFileClose( &keyList );
+
+   PrintDebug( "Starting string transmission for key list\n" );
+   HandlerBeginStringTransmission( keyListText );
+   StrDel( keyListText );
+}
+
+/* RETRIEVE_RANK <key>
+
+   Replies with the rank of the record in its ranking, 1 being the record 
+   with the highest value. */
+void HandlerRetrieveRank( const command_t *command ) {
+   unsigned int rank;
+
+   if ( command->argsCount < 1 ) {
+      PrintNotice( "Missing key for RETRIEVE_RANK command\n" );
+      return;
+   }
+
+   rank = DatabaseRetrieveRank( command->args[ 0 ] );
+   if ( rank > 0 ) {
+      ReplySetDataInt( ( int ) rank );
       ReplySetResult( CMD_RETRIEVE_OK );
    }
    else {
-      PrintNotice( "Asked for a non-existant string record with key: %s\n", 
-         recordName->value );
       ReplySetDataInt( 0 );
       ReplySetResult( CMD_RETRIEVE_FAIL );
+      StatsCount( STATS_MISSES );
+      PrintNotice( "Asked for the rank of an unranked record with key: %s\n",
+         command->args[ 0 ]->value );
+   }
+}
+
+/* RETRIEVE_TOP <pattern> [rank]
+
+   Sends back the key of the record at the given rank, the top one by 
+   default, using the string transmission. The pattern must be written the
+   same way as in the configuration file. */
+void HandlerRetrieveTop( const command_t *command ) {
+   const Str *key;
+   int rank = 1;
+
+   if ( command->argsCount < 1 ) {
+      PrintNotice( "Missing ranking pattern for RETRIEVE_TOP command\n" );
+      return;
+   }
+
+   if ( command->argsCount > 1 ) {
+      rank = atoi( command->args[ 1 ]->value );
+   }
+
+   key = rank > 0 ? DatabaseRetrieveRanked( command->args[ 0 ], rank ) : NULL;
+   if ( key != NULL ) {
+      HandlerBeginStringTransmission( key );
+   }
+   else {
+      ReplySetDataInt( 0 );
+      ReplySetResult( CMD_RETRIEVE_FAIL );
+      StatsCount( STATS_MISSES );
    }
 }
 
@@ -220,7 +472,7 @@ void HandlerRetrieveStringSegment( const command_t *command ) {
 
       ReplySetDataInt( asciiPackage );
       ReplySetResult( CMD_RETRIEVE_OK );
-      PrintMessage( "Sending string segment: %d\n", asciiPackage );
+      PrintDebug( "Sending string segment: %d\n", asciiPackage );
 
       /* End transmission when all segments have been sent. */
       st.queriesNeeded -= 1;
@@ -231,6 +483,7 @@ void HandlerRetrieveStringSegment( const command_t *command ) {
    else {
       ReplySetDataInt( 0 );
       ReplySetResult( CMD_RETRIEVE_FAIL );
+      StatsCount( STATS_MISSES );
       PrintNotice( 
          "A string transmission is not open. Failed to get segment\n" );
    }
@@ -238,7 +491,7 @@ void HandlerRetrieveStringSegment( const command_t *command ) {
 
 void HandlerEndStringTransmission( void ) {
    if ( st.isActive ) {
-      PrintMessage( "Closing string transmission\n" );
+      PrintDebug( "Closing string transmission\n" );
       StrDel( st.value );
       st.isActive = FALSE;
    }
@@ -263,6 +516,7 @@ int HandlerEncodeValueInAscii( const char *value, const int vLength ) {
 void HandlerExit( void ) {
    /* Close any string tranmission that might be active. */
    HandlerEndStringTransmission();
+   HandlerEndDump();
 }
 
 void HandlerPrint( const command_t *command ) {
@@ -271,12 +525,73 @@ void HandlerPrint( const command_t *command ) {
    }
 }
 
+/* STATS
+
+   Prints the counters and the latency figures gathered so far. */
+void HandlerPrintStats( const command_t *command ) {
+   ( void ) command;
+   StatsPrintReport();
+}
+
+/* PRINT_DATABASE [map] */
 void HandlerPrintDatabase( const command_t *command ) {
+   const char *path = ( dumpPath != NULL ) ? 
+      dumpPath->value : HANDLER_DUMP_FILE_PATH;
    const Str *map = NULL;
 
+   if ( dumpFile != NULL ) {
+      PrintNotice( "A database dump is already under way\n" );
+      return;
+   }
+
    if ( command->argsCount > 0 ) {
       map = command->args[ 0 ];
    }
 
-   DatabasePrint( map );
+   dumpFile = fopen( path, "w" );
+   if ( dumpFile == NULL ) {
+      PrintError( "Failed to create the database dump file at path: %s\n",
+         path );
+      return;
+   }
+
+   DatabaseStartDump( &dump, map );
+   PrintMessage( "Dumping the database to file at path: %s\n", path );
+}
+
+void HandlerSetDumpPath( const Str *path ) {
+   dumpPath = path;
+}
+
+Bool HandlerContinueDump( void ) {
+   MemFile output;
+   Bool isDumping;
+
+   if ( dumpFile == NULL ) {
+      return FALSE;
+   }
+
+   MemFileInit( &output );
+   isDumping = DatabaseContinueDump( &dump, &output, HANDLER_DUMP_STEP );
+   if ( MemFileGetSize( &output ) > 0 ) {
+      fwrite( output.data, 1, MemFileGetSize( &output ), dumpFile );
+   }
+
+   MemFileClose( &output );
+
+   if ( ! isDumping ) {
+      PrintMessage( "Database dump done. Records dumped: %u\n",
+         dump.totalRecords );
+      HandlerEndDump();
+   }
+
+   return isDumping;
+}
+
+void HandlerEndDump( void ) {
+   if ( dumpFile != NULL ) {
+      fclose( dumpFile );
+      dumpFile = NULL;
+      DatabaseEndDump( &dump );
+   }
 }
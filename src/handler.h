@@ -32,6 +32,16 @@
 /* The padding is used to make any ASCII value equal three digits
    in length for easier handling. */
 #define HANDLER_ASCII_PADDING 100
+/* Number of keys sent back by the key listing commands when no page size
+   is given, and the most keys they will send back in one go. */
+#define HANDLER_KEY_PAGE_DEFAULT 10
+#define HANDLER_KEY_PAGE_MAX 64
+/* PRINT_DATABASE writes the database to this file, unless another one is
+   configured. */
+#define HANDLER_DUMP_FILE_PATH "./database_dump.txt"
+/* Number of records a database dump writes on each pass of the main 
+   loop. */
+#define HANDLER_DUMP_STEP 256
  
 /* Structure for storing all necessary data for string retrieval. */
 typedef struct {
@@ -53,10 +63,22 @@ void HandlerRetrieve( const command_t *command );
 void HandlerRetrieveDate( const command_t *command );
 void HandlerRetrieveStringInit( const command_t *command );
 void HandlerRetrieveStringSegment( const command_t *command );
+void HandlerRetrieveRange( const command_t *command );
+void HandlerRetrievePrefix( const command_t *command );
+void HandlerRetrieveRank( const command_t *command );
+void HandlerRetrieveTop( const command_t *command );
 void HandlerStore( const command_t *command );
 void HandlerStoreDate( const command_t *command );
+void HandlerStorePlayer( const command_t *command );
+void HandlerRetrievePlayer( const command_t *command );
+void HandlerDeletePlayer( const command_t *command );
 void HandlerPrint( const command_t *command );
 void HandlerPrintDatabase( const command_t *command );
+void HandlerPrintStats( const command_t *command );
 void HandlerExit( void );
+void HandlerSetDumpPath( const Str *path );
+/* Writes the next records of a database dump that is under way. Returns
+   whether the dump has records left. */
+Bool HandlerContinueDump( void );
 
 #endif
@@ -31,6 +31,7 @@
 #include <string.h>
 #include <signal.h>
 #include <time.h>
+#include <ctype.h>
 
 #include "gentype.h"
 #include "strutil.h"
@@ -42,6 +43,10 @@
 #include "reply.h"
 #include "command.h"
 #include "server.h"
+#include "admin.h"
+#include "querylog.h"
+#include "stats.h"
+#include "platform.h"
 #include "database.h"
 #include "config.h"
 #include "print.h"
@@ -57,6 +62,7 @@ static void LukCloseDatabase( void );
 static void LukProcessResponse( const RconResponse *response );
 static void LukShutdownServer( void );
 static void LukProcessMessageResponse( const Str *message );
+static Str *LukExecuteQuery( query_id_t queryId, const Str *cargo );
 static void LukChangeMap( const Str *map );
 static void LukSaveDatabase( void );
 static void LukExit( int signal );
@@ -66,10 +72,23 @@ static void LukPrintHelpMenu( const char *programPath );
 static void LukGenerateNewConf( void );
 static void LukViewProgramType( void );
 static Bool LukDeleteMapEntry( void );
+static Bool LukReplayQueryLog( void );
+static void LukSetupRankings( void );
+static void LukSetupMemoryBudget( void );
+static void LukSetupFileCompression( void );
+static void LukSetupBackups( void );
+static void LukSetupLogLevel( void );
+static void LukSetupStats( void );
+static void LukInitAdmin( void );
+static void LukShutdownAdmin( void );
+static void LukInitQueryLog( void );
+static Bool LukWaitForInput( int seconds );
 
 static Bool lukIsRunning = TRUE;
 static LukMode runMode = LUK_MODE_NORMAL;
 static Bool saveDatabaseOnStore = FALSE;
+/* Seconds between the stats summary lines, or 0 for none. */
+static long statsInterval = 0;
 
 int main( int argc, char *argv[] ) {
    RconResponse response;
@@ -78,10 +97,18 @@ int main( int argc, char *argv[] ) {
 
    int replyStatus;
    time_t nextPongTime = 0;
+   time_t nextStatsTime = 0;
+   Bool isDumping;
 
    PROGA_Init( argv );
    ( void ) argc;
 
+   /* The writer is stopped last, so the messages printed while shutting
+      down make it out too. */
+   PrintStartWriter();
+   atexit( PrintStopWriter );
+   StatsInit();
+
    /* If the help argument was provided to the program, display
       the help menu and end execution. */
    if ( PROGA_FindArg( "-h" ) ) {
@@ -120,6 +147,9 @@ int main( int argc, char *argv[] ) {
       if ( PROGA_FindArg( "-d" ) ) {
          exit( ! LukDeleteMapEntry() );
       }
+      else if ( PROGA_FindArg( "-r" ) ) {
+         exit( ! LukReplayQueryLog() );
+      }
    }
    else {
       exit( EXIT_FAILURE );
@@ -130,7 +160,13 @@ int main( int argc, char *argv[] ) {
       exit( EXIT_FAILURE );
    }
 
+   /* The path is kept by the configuration until luk exits. */
+   HandlerSetDumpPath( ConfigGetValue( "database_dump_path" ) );
    atexit( HandlerExit );
+   LukInitAdmin();
+   LukInitQueryLog();
+   LukSetupStats();
+   nextStatsTime = time( 0 ) + statsInterval;
 
    /* Begin reading input from the server. */
    PrintMessage( "=====================================================\n" );
@@ -145,9 +181,23 @@ int main( int argc, char *argv[] ) {
          ServerSend( &pongResponse );
       }
 
-      replyStatus = ServerReceive( &response, LUK_REPLAY_WAIT_TIME );
-      if ( replyStatus > 0 ) {
-         LukProcessResponse( &response );
+      /* A database dump is written a step at a time, without waiting for
+         the server between steps. The admin clients are serviced while 
+         waiting. */
+      isDumping = HandlerContinueDump();
+      if ( LukWaitForInput( isDumping ? 0 : LUK_REPLAY_WAIT_TIME ) ) {
+         replyStatus = ServerReceive( &response, SERVER_REPLY_TIMEOUT );
+         if ( replyStatus > 0 ) {
+            LukProcessResponse( &response );
+         }
+      }
+
+      /* Get rid of the temporary records that have run out of time. */
+      DatabaseExpireRecords( time( 0 ) );
+
+      if ( statsInterval > 0 && time( 0 ) >= nextStatsTime ) {
+         StatsPrintSummary();
+         nextStatsTime = time( 0 ) + statsInterval;
       }
    }
 
@@ -205,6 +255,7 @@ Bool LukInitConfigSystem( Bool viewParams ) {
       }
       else {
          PrintMessage( "Configuration file successfully read\n" );
+         LukSetupLogLevel();
       }
 
       return TRUE;
@@ -215,6 +266,9 @@ Bool LukInitConfigSystem( Bool viewParams ) {
 }
 
 Bool LukInitDatabase() {
+   /* The rankings need to be in place before any records are loaded. */
+   LukSetupRankings();
+
    if ( runMode != LUK_MODE_SKIP ) {
       const Str *databasePath = ConfigGetValue( "database_path" );
       int dbInitResult;
@@ -229,10 +283,16 @@ Bool LukInitDatabase() {
             PrintMessage( "Will save the database after every STORE query\n" );
          }
 
+         LukSetupMemoryBudget();
+         LukSetupFileCompression();
+         LukSetupBackups();
          return TRUE;
       }
       else if ( dbInitResult == DB_INIT_RECORDS_LOAD_FAILED ) {
          PrintMessage( "   - Will proceed without loading previous data\n" );
+         LukSetupMemoryBudget();
+         LukSetupFileCompression();
+         LukSetupBackups();
          return TRUE;
       }
       else {
@@ -249,6 +309,124 @@ Bool LukInitDatabase() {
    }
 }
 
+void LukSetupMemoryBudget( void ) {
+   /* The budget is given in kilobytes. Without one, every map that was
+      played stays in memory. */
+   const Str *value = ConfigGetValue( "database_memory_budget" );
+   long budget;
+
+   if ( value == NULL ) {
+      return;
+   }
+
+   budget = atol( value->value );
+   if ( budget > 0 ) {
+      DatabaseSetMemoryBudget( ( size_t ) budget * 1024 );
+      PrintMessage( "Database memory budget: %ld KB\n", budget );
+   }
+   else {
+      PrintWarning( "Invalid database memory budget: %s\n", value->value );
+   }
+}
+
+void LukSetupFileCompression( void ) {
+   const Str *value = ConfigGetValue( "database_compression" );
+
+   if ( value != NULL && strcmp( value->value, "true" ) == 0 ) {
+      DatabaseSetFileCompression( TRUE );
+      PrintMessage( "Will compress the records of the database file\n" );
+   }
+}
+
+void LukSetupBackups( void ) {
+   /* A count of 0 turns the backups off. */
+   const Str *value = ConfigGetValue( "database_backups" );
+   char *valueEnd;
+   long totalBackups;
+
+   if ( value == NULL ) {
+      return;
+   }
+
+   totalBackups = strtol( value->value, &valueEnd, 10 );
+   if ( value->length > 0 && *valueEnd == '\0' && totalBackups >= 0 ) {
+      DatabaseSetBackupCount( ( unsigned int ) totalBackups );
+      PrintMessage( "Database backups kept: %ld\n", totalBackups );
+   }
+   else {
+      PrintWarning( "Invalid number of database backups: %s\n", 
+         value->value );
+   }
+}
+
+void LukSetupLogLevel( void ) {
+   const Str *value = ConfigGetValue( "log_level" );
+   int level;
+
+   if ( value == NULL ) {
+      return;
+   }
+
+   level = PrintFindLevel( value->value );
+   if ( level != -1 ) {
+      PrintSetLevel( level );
+   }
+   else {
+      PrintWarning( "Invalid log level: %s\n", value->value );
+   }
+}
+
+void LukSetupStats( void ) {
+   const Str *value = ConfigGetValue( "stats_interval" );
+
+   if ( value == NULL ) {
+      return;
+   }
+
+   statsInterval = atol( value->value );
+   if ( statsInterval > 0 ) {
+      PrintMessage( "Stats summary every %ld seconds\n", statsInterval );
+   }
+   else {
+      statsInterval = 0;
+      PrintWarning( "Invalid stats interval: %s\n", value->value );
+   }
+}
+
+void LukSetupRankings( void ) {
+   const Str *patterns = ConfigGetValue( "database_ranked_keys" );
+   const char *patternPos;
+
+   if ( patterns == NULL ) {
+      return;
+   }
+
+   /* The patterns are separated by spaces. */
+   patternPos = patterns->value;
+   while ( *patternPos != '\0' ) {
+      const char *patternStart;
+      Str *pattern;
+
+      while ( isspace( *patternPos ) ) {
+         patternPos += 1;
+      }
+
+      patternStart = patternPos;
+      while ( *patternPos != '\0' && ! isspace( *patternPos ) ) {
+         patternPos += 1;
+      }
+
+      if ( patternPos > patternStart ) {
+         pattern = StrNewSub( patternStart, patternPos - patternStart );
+         if ( DatabaseAddRanking( pattern ) ) {
+            PrintMessage( "Ranking records with keys: %s\n", 
+               pattern->value );
+         }
+         StrDel( pattern );
+      }
+   }
+}
+
 void LukCloseDatabase() {
    LukSaveDatabase();
    DatabaseShutdown();
@@ -326,6 +504,56 @@ Bool LukInitServer() {
    return isConnected;
 }
 
+void LukInitQueryLog( void ) {
+   const Str *logPath = ConfigGetValue( "query_log_path" );
+
+   if ( logPath != NULL && QueryLogOpen( logPath->value ) ) {
+      atexit( QueryLogClose );
+      PrintMessage( "Logging queries to file at path: %s\n", 
+         logPath->value );
+   }
+}
+
+void LukInitAdmin( void ) {
+   /* There is only an admin socket when a path is given for it. */
+   const Str *socketPath = ConfigGetValue( "admin_socket_path" );
+
+   if ( socketPath != NULL && AdminInit( socketPath->value ) ) {
+      atexit( LukShutdownAdmin );
+   }
+}
+
+void LukShutdownAdmin( void ) {
+   AdminShutdown();
+}
+
+/* Waits for the server or an admin client to have something for us, and
+   services the admin clients that are ready. Returns whether the server
+   has a reply waiting. */
+Bool LukWaitForInput( int seconds ) {
+   const Socket serverSocket = ServerGetSocket();
+   Socket maxSocket = serverSocket;
+   fd_set readSockets;
+   fd_set writeSockets;
+   struct timeval timeout;
+
+   FD_ZERO( &readSockets );
+   FD_ZERO( &writeSockets );
+   FD_SET( serverSocket, &readSockets );
+   AdminAddSockets( &readSockets, &writeSockets, &maxSocket );
+
+   timeout.tv_sec = seconds;
+   timeout.tv_usec = 0;
+
+   if ( select( maxSocket + 1, &readSockets, &writeSockets, NULL, 
+      &timeout ) <= 0 ) {
+      return FALSE;
+   }
+
+   AdminService( &readSockets, &writeSockets );
+   return FD_ISSET( serverSocket, &readSockets );
+}
+
 Bool LukProcessInitialReponse( const RconResponse *response ) {
    const Byte *body = response->body;
 
@@ -441,36 +669,66 @@ void LukProcessResponse( const RconResponse *response ) {
 
 void LukProcessMessageResponse( const Str *message ) {
    /* Execute the message if it's a valid luk query. */
-   if ( QueryIsValidCapsule( message ) && QueryUnpack( message ) ) {
-      command_t *command;
+   if ( QueryIsValidCapsule( message ) ) {
+      const unsigned long long startTime = getMicroseconds();
+      const Bool isUnpacked = QueryUnpack( message );
+      Str *serverCommand;
+
+      StatsAddStageTime( STATS_STAGE_PARSE, startTime );
+      if ( ! isUnpacked ) {
+         return;
+      }
 
-      /* Start a fresh reply to the query. */
-      ReplyReset();
-      ReplySetQueryId( QueryGetId() );
+      QueryLogAdd( time( 0 ), DatabaseGetCurrentMap(), QueryGetId(), 
+         QueryGetCargo() );
 
-      command = CommandCreate( QueryGetCargo() );
+      serverCommand = LukExecuteQuery( QueryGetId(), QueryGetCargo() );
       QueryDeleteCargo();
 
-      if ( command != NULL ) {
-         CommandExecute( command );
-         CommandDestroy( command );
+      if ( serverCommand != NULL ) {
+         ServerSendCommand( serverCommand );
+         StrDel( serverCommand );
+      }
 
-         /* Save the database if the database needs saving, but only if
-            the option is enabled. */
-         if ( saveDatabaseOnStore ) {
-            LukSaveDatabase();
-         }
+      StatsAddStageTime( STATS_STAGE_QUERY, startTime );
+   }
+}
 
-         /* Only send back a reply if we have any data. */
-         if ( ReplyGetDataSize() > 0 ) {
-            Str *serverCommand;
+/* Returns the command that sends the reply back to the server, or NULL if
+   there is nothing to send back. */
+Str *LukExecuteQuery( query_id_t queryId, const Str *cargo ) {
+   command_t *command;
 
-            serverCommand = ReplyBuildCommand();
-            ServerSendCommand( serverCommand );
+   StatsCount( STATS_QUERIES );
 
-            StrDel( serverCommand );
-         }
-      }
+   /* Start a fresh reply to the query. */
+   ReplyReset();
+   ReplySetQueryId( queryId );
+
+   command = CommandCreate( cargo );
+   if ( command == NULL ) {
+      return NULL;
+   }
+
+   CommandExecute( command );
+   CommandDestroy( command );
+
+   /* Save the database if the database needs saving, but only if
+      the option is enabled. */
+   if ( saveDatabaseOnStore ) {
+      LukSaveDatabase();
+   }
+
+   /* Only send back a reply if we have any data. */
+   if ( ReplyGetDataSize() > 0 ) {
+      const unsigned long long startTime = getMicroseconds();
+      Str *serverCommand = ReplyBuildCommand();
+
+      StatsAddStageTime( STATS_STAGE_REPLY, startTime );
+      return serverCommand;
+   }
+   else {
+      return NULL;
    }
 }
 
@@ -530,6 +788,8 @@ void LukPrintHelpMenu( const char *programPath ) {
           "     \t\t\tin present directory\n"
       "  -h\t\t\tDisplay this help menu\n"
       "  -p\t\t\tView loaded configuration parameters\n"
+      "  -r <path_to_log>\tReplay the queries of a query log against\n"
+      "  \t\t\tthe database, without saving it\n"
       "  -s\t\t\tSkip mode. Skip the loading and saving\n"
       "  \t\t\tof the database file\n\n"
 
@@ -566,6 +826,76 @@ void LukGenerateNewConf( void ) {
    }
 }
 
+/* Runs the queries of a query log against the loaded database, as fast as
+   they can be run, without a server. */
+Bool LukReplayQueryLog( void ) {
+   const char *logPath = PROGA_NextArg();
+   QueryLogReader reader;
+   QueryLogEntry entry;
+   QueryLogReadResult readResult;
+   unsigned long totalQueries = 0;
+   unsigned long totalMaps = 0;
+   clock_t startTime;
+   double replayTime;
+
+   if ( logPath == NULL ) {
+      PrintError( "No query log given.\n" );
+      return FALSE;
+   }
+
+   /* The database the queries are replayed against is left as it was,
+      even when maps are unloaded to stay within the memory budget. */
+   DatabaseSetReadOnly( TRUE );
+
+   if ( ! QueryLogOpenReader( &reader, logPath ) ) {
+      return FALSE;
+   }
+
+   HandlerSetDumpPath( ConfigGetValue( "database_dump_path" ) );
+   PrintMessage( "Replaying queries from log at path: %s\n", logPath );
+
+   startTime = clock();
+   while ( ( readResult = QueryLogRead( &reader, &entry ) ) == 
+      QUERYLOG_READ_ENTRY ) {
+      Str *text = StrNewSub( entry.text, entry.textLength );
+
+      if ( entry.type == QUERYLOG_ENTRY_MAP ) {
+         QueryResetId();
+         DatabaseChangeMap( text );
+         totalMaps += 1;
+      }
+      else {
+         /* The reply is built, like it would be for the server, and then
+            thrown away. */
+         Str *serverCommand = LukExecuteQuery( entry.queryId, text );
+         StrDel( serverCommand );
+
+         while ( HandlerContinueDump() ) {
+         }
+
+         totalQueries += 1;
+      }
+
+      StrDel( text );
+   }
+
+   replayTime = ( double ) ( clock() - startTime ) / CLOCKS_PER_SEC;
+   QueryLogCloseReader( &reader );
+
+   if ( readResult == QUERYLOG_READ_BROKEN ) {
+      PrintWarning( "The query log is broken after query: %lu\n", 
+         totalQueries );
+   }
+
+   PrintMessage( "Queries replayed: %lu, on maps: %lu\n", totalQueries, 
+      totalMaps );
+   PrintMessage( "Replay time: %.3f seconds, %.0f queries per second\n",
+      replayTime, ( replayTime > 0 ) ? totalQueries / replayTime : 0.0 );
+   StatsPrintReport();
+
+   return ( readResult == QUERYLOG_READ_END );
+}
+
 Bool LukDeleteMapEntry( void ) {
    const char *arg;
    Str *mapName;
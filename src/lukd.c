@@ -22,11 +22,19 @@
 
 */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#include "crc32c.h"
+#include "fileutil.h"
 #include "memfile.h"
+#include "mapfile.h"
+#include "outfile.h"
+#include "lzblock.h"
+#include "workpool.h"
 
 #include "lukd.h"
 #include "database.h"
@@ -34,57 +42,243 @@
 
 /* Import functions: */
 static Bool LukdImport( MemFile *dataFile );
-static Bool LukdImportMapEntries( MemFile *dataFile, 
-   const LukdMainTable *table, int *totalRecords );
-static Bool LukdImportRecords( MemFile *dataFile, const LukdMapEntry *entry,
-   int *totalRecords );
+static Bool LukdReadDirectory( LukdSource *source, MemFile *dataFile,
+   Bool isFilterCopied );
+static Bool LukdReadMapEntries( LukdSource *source, MemFile *dataFile,
+   Bool isFilterCopied );
+static void LukdReadMapEntryRun( void *directory, unsigned int firstEntry,
+   unsigned int lastEntry );
+static Bool LukdReadPlayerEntries( LukdSource *source, MemFile *dataFile,
+   size_t playerTableOffset, Bool isFilterCopied );
+static LukdDirectoryEntry *LukdAddDirectoryEntry( LukdSource *source );
+static void LukdDestroyDirectory( LukdSource *source );
+static void LukdInitSource( LukdSource *source );
+static Bool LukdReadFileHeader( MemFile *dataFile, LukdFileHeader *header );
+static Bool LukdReadMainTable( MemFile *dataFile, unsigned int version,
+   LukdMainTable *table );
+static Bool LukdReadMapEntry( MemFile *dataFile, unsigned int version,
+   LukdMapEntry *entry );
+static Bool LukdReadPlayerEntry( MemFile *dataFile, unsigned int version,
+   LukdPlayerEntry *entry );
+static Bool LukdReadSeries( MemFile *dataFile, unsigned int version,
+   LukdRecordSeries *series );
+static size_t LukdGetSeriesSize( unsigned int version );
+static size_t LukdGetMapEntrySize( unsigned int version );
+static void LukdSetSectionSeries( DatabaseFileSection *section,
+   const LukdRecordSeries *series, Byte *filter );
+static void LukdInitEntrySection( DatabaseFileSection *section,
+   const LukdDirectoryEntry *entry );
+static Byte *LukdCopyFilter( const MemFile *dataFile, 
+   const LukdRecordSeries *series );
+static Bool LukdImportRecords( const LukdSource *source, MemFile *dataFile,
+   size_t firstRecord, unsigned int recordCount, DatabaseMapEntry *dbEntry,
+   const Str *player, int *totalRecords );
+static Bool LukdImportBlocks( const LukdSource *source, 
+   const MemFile *dataFile, const DatabaseFileSection *section, 
+   DatabaseMapEntry *dbEntry, int *totalRecords );
+static Byte *LukdReadBlock( const LukdSource *source, 
+   const MemFile *dataFile, const DatabaseFileSection *section, 
+   unsigned int blockNum, LukdBlock *block );
+static void LukdGetBlock( const LukdSource *source, const MemFile *dataFile,
+   size_t firstBlock, unsigned int blockNum, LukdBlock *block );
+static void LukdGetIndexSlot( const LukdSource *source, 
+   const MemFile *dataFile, size_t firstIndexSlot, unsigned int slotNum, 
+   LukdIndexSlot *slot );
+static Bool LukdImportKeyTable( LukdSource *source, MemFile *dataFile, 
+   const LukdFileHeader *header );
+static Bool LukdReadSectionRecords( const LukdSource *source, 
+   MemFile *dataFile, DatabaseFileSection *section, 
+   LukdRecordHandler handler, void *context );
+static Bool LukdReadSeriesRecords( const LukdSource *source, MemFile *file,
+   size_t firstRecord, unsigned int recordCount, LukdRecordHandler handler,
+   void *context );
+static Bool LukdReadRecord( MemFile *file, const LukdKeyTable *keys,
+   LukdRecord *record );
+static Bool LukdReadVarint( MemFile *file, unsigned int *value );
+static time_t LukdReadExpiry( const Str *value );
+/* Key table functions: */
+static void LukdInitKeyTable( LukdKeyTable *table );
+static unsigned int LukdAddKey( LukdKeyTable *table, const Str *key );
+static unsigned int LukdFindKey( const LukdKeyTable *table, 
+   const Str *key );
+static Bool LukdGrowKeySlots( LukdKeyTable *table );
+static void LukdPlaceKey( LukdKeyTable *table, unsigned int keyId );
+static void LukdDestroyKeyTable( LukdKeyTable *table );
+static const LukdKeyTable *LukdGetSourceKeys( const LukdSource *source );
 /* Validation functions: */
-static Bool LukdIsValidMainTableOffset( LukdMainTableOffset offset,
-   const size_t fileSize );
+static Bool LukdIsValidMainTableOffset( LukdOffset offset,
+   size_t tableSize, const size_t fileSize );
 static Bool LukdIsValidMainTable( const LukdMainTable *table,
-   const size_t fileSize );
-static Bool LukdIsValidMapEntry( const LukdMapEntry *entry, 
-   const size_t fileSize );
+   size_t entrySize, const size_t fileSize );
+static Bool LukdIsValidSeries( const LukdSource *source, 
+   const LukdRecordSeries *series, const MemFile *dataFile );
+static Bool LukdIsValidRecordSeries( LukdOffset firstRecord, 
+   unsigned int recordCount, const size_t fileSize );
 static Bool LukdIsValidRecordHeader( const LukdRecordHeader *header, 
    const MemFile *file );
-static void LukdBackupFile( MemFile *dataFile, const char *dataFilePath );
+static Bool LukdIsValidIndex( const LukdSource *source, 
+   LukdOffset firstIndexSlot, unsigned int totalIndexSlots, 
+   const size_t fileSize );
+static Bool LukdIsValidFilter( LukdOffset firstFilterByte,
+   unsigned int filterSize, const size_t fileSize );
+static Bool LukdIsValidBlocks( const LukdSource *source, 
+   const LukdRecordSeries *series, const MemFile *dataFile );
+static Bool LukdIsIntactDirectory( const MemFile *dataFile, 
+   const LukdFileHeader *header, const LukdMainTable *table );
+static Bool LukdIsIntactSection( const MemFile *dataFile, 
+   DatabaseFileSection *section );
+/* Lookup functions: */
+static DatabaseFileSection *LukdFindSection( 
+   const DatabaseMapEntry *entry, const Str *player, 
+   const MemFile *dataFile );
+static Str *LukdFindRecord( const LukdSource *source, MemFile *dataFile, 
+   const DatabaseFileSection *section, const Str *key );
+static Str *LukdScanRecords( const LukdSource *source, MemFile *file, 
+   unsigned int recordCount, const Str *key, unsigned int keyId );
+static void LukdReadRecordAt( const LukdSource *source, MemFile *dataFile, 
+   const DatabaseFileSection *section, LukdOffset recordPosition, 
+   const Str *key, unsigned int keyId, Str **value );
+static unsigned int LukdFindBlock( const LukdSource *source, 
+   const MemFile *dataFile, const DatabaseFileSection *section, 
+   LukdOffset recordPosition );
+static Bool LukdReadRecordValue( const LukdSource *source, MemFile *file, 
+   const Str *key, unsigned int keyId, Str **value );
+static Bool LukdFilterHasKey( const Byte *filter, unsigned int filterSize,
+   const Str *key );
+static void LukdFilterAddKey( Byte *filter, unsigned int filterSize,
+   const Str *key );
+static Str *LukdMakeFilePath( const char *filePath, const char *extension );
+static Str *LukdMakeMapName( const char *name );
 static void LukdPrintFileInfo( const LukdMainTable *table, int totalRecords );
 /* Export functions */
-static int LukdExportEntries( MemFile *outFile, const Database *database,
-   size_t *firstMapEntry );
-static int LukdExportRecords( MemFile *outFile, DatabaseMapEntry *dbEntry );
-static void LukdExportMainTable( MemFile *outFile, 
-   unsigned int totalMapEntries, unsigned int firstMapEntry );
+static Bool LukdStartExport( OutFile *outFile, const Str *tempFilePath,
+   Bool isCompressed );
+static void LukdExportDirectory( OutFile *outFile, MemFile *entriesFile,
+   int entriesExported, MemFile *playersFile, int playersExported );
+static Bool LukdFinishExport( OutFile *outFile, const Str *tempFilePath,
+   const char *outFilePath, unsigned int totalBackups );
+static int LukdExportEntries( OutFile *outFile, const Database *database,
+   MemFile *entriesFile, MemFile *playersFile, int *playersExported );
+static int LukdExportPlayers( OutFile *outFile, MemFile *playersFile,
+   DatabaseMapEntry *dbEntry );
+static int LukdExportRecords( MemFile *outFile, 
+   const DatabaseRecordStore *store, time_t *nextExpiry );
+static int LukdExportStoredRecord( MemFile *outFile, 
+   const DatabaseRecord *record );
+static void LukdSeedExportKeys( void );
+static Bool LukdHasExpiryKeys( const LukdKeyTable *table );
+static int LukdExportFileSections( OutFile *outFile, MemFile *entriesFile,
+   MemFile *playersFile, DatabaseMapEntry *dbEntry, int *playersExported );
+static Bool LukdExportFileSection( OutFile *outFile, MemFile *dataFile,
+   const Str *map, DatabaseFileSection *section, time_t now, 
+   LukdRecordSeries *series, Byte **filter, time_t *nextExpiry,
+   Bool *isDamaged );
+static Bool LukdCanCopySeries( MemFile *dataFile, 
+   DatabaseFileSection *section, time_t now );
+static void LukdFindNextExpiry( MemFile *dataFile, 
+   DatabaseFileSection *section );
+static void LukdNoteExpiry( void *section, const Str *key, 
+   const Str *value );
+static Bool LukdCopySeries( OutFile *outFile, const MemFile *dataFile,
+   const DatabaseFileSection *section, LukdRecordSeries *series, 
+   Byte **filter );
+static Bool LukdIsInSection( const DatabaseFileSection *section, 
+   size_t firstByte, size_t size );
+static void LukdMoveBlocks( Byte *data, const DatabaseFileSection *section,
+   LukdOffset shift );
+static void LukdMoveIndex( Byte *data, const DatabaseFileSection *section,
+   LukdOffset shift );
+static void LukdAddEntry( MemFile *entriesFile, MemFile *playersFile,
+   const Str *map, const Str *player, const LukdRecordSeries *series );
+static void LukdInitRecordCopy( LukdRecordCopy *copy, MemFile *recordsFile,
+   time_t now );
+static Bool LukdCopyRecords( const LukdSource *source, LukdRecordCopy *copy,
+   MemFile *dataFile, DatabaseFileSection *section );
+static void LukdCopyRecord( void *copy, const Str *key, const Str *value );
+static DatabaseFileSection *LukdAddSavedSection( 
+   DatabaseMapEntry *dbEntry, const Str *player, 
+   const LukdRecordSeries *series, Byte *filter, time_t nextExpiry );
+static Byte *LukdExportSeries( OutFile *outFile, const MemFile *recordsFile,
+   unsigned int totalRecords, LukdRecordSeries *series );
+static void LukdExportBlocks( OutFile *outFile, const MemFile *recordsFile,
+   LukdRecordSeries *series );
+static void LukdExportIndex( OutFile *outFile, const MemFile *recordsFile,
+   LukdRecordSeries *series );
+static Byte *LukdExportFilter( OutFile *outFile, const MemFile *recordsFile,
+   LukdRecordSeries *series );
+static size_t LukdGetRecordKey( const MemFile *file, size_t recordPosition,
+   Str *key );
+static Bool LukdReplaceFile( const char *tempFilePath, 
+   const char *outFilePath, unsigned int totalBackups );
+static void LukdRotateBackups( const char *filePath, 
+   unsigned int totalBackups );
+static Str *LukdMakeBackupPath( const char *filePath, 
+   unsigned int backupNum );
+static unsigned int LukdExportRecord( MemFile *outFile, const Str *key, 
+   const Str *value );
+static void LukdAddVarint( MemFile *outFile, unsigned int value );
+static int LukdEncodeVarint( Byte *bytes, unsigned int value );
+static Str *LukdMakeExpiryKey( const Str *key );
+static void LukdMakeFileHeader( LukdFileHeader *header, 
+   LukdOffset mainTableOffset, LukdOffset firstKey, 
+   unsigned int directoryChecksum );
+static void LukdExportKeyTable( OutFile *outFile );
+static void LukdExportMainTable( OutFile *outFile, 
+   unsigned int totalMapEntries, LukdOffset firstMapEntry );
+static void LukdExportPlayerTable( OutFile *outFile, MemFile *playersFile,
+   unsigned int totalPlayerEntries );
+/* Merge functions: */
+static int LukdCompareMergeItems( const void *first, const void *second );
+static Bool LukdIsSameSeries( const LukdMergeItem *first, 
+   const LukdMergeItem *second );
+static unsigned int LukdMergeRecords( LukdSource *sources, 
+   const LukdMergeItem *items, unsigned int totalItems, 
+   MemFile *mergedFile, LukdKeyMarks *marks );
+static unsigned int LukdMergeSeries( MemFile *mergedFile, 
+   MemFile *recordsFile, LukdKeyMarks *marks, time_t now );
+static Bool LukdMarkKey( LukdKeyMarks *marks, unsigned int keyId );
+static Bool LukdIsExpiryKeyOf( const Str *expiryKey, const Str *key );
 /* Debug functions: */
 static void LukdPrintMainTable( const LukdMainTable *table );
 static void LukdPrintEntry( const LukdMapEntry *entry );
 
+/* The database file that the records of the maps that are not loaded yet
+   are read from. Its directory is only kept while it's imported. */
+static LukdSource databaseSource;
+/* Whether the records are compressed by the export that is running. */
+static Bool isCompressing = FALSE;
+/* Keys of the records of the file being exported. */
+static LukdKeyTable exportKeys;
+/* Whether any record of the database file has an expiry record. */
+static Bool hasExpiryKeys = FALSE;
+/* The database file is backed up once per run, when a save first replaces
+   it. */
+static Bool isFileBackedUp = FALSE;
+
 Bool LukdImportDatabase( const char *dataFilePath ) {
    Bool isImported = FALSE;
 
-   int bytesAdded;
+   int errorCode;
    MemFile dataFile;
-   MemFileInit( &dataFile );
 
    PrintMessage( "Importing database file at path: %s\n", dataFilePath );
-   bytesAdded = MemFileAddFile( &dataFile, dataFilePath );
-   if ( bytesAdded > 0 ) {
-      /* Then proceed to import the records. */
+   isFileBackedUp = FALSE;
+   LukdInitSource( &databaseSource );
+   errorCode = MapFileOpen( &databaseSource.file, dataFilePath );
+   if ( errorCode == 0 && databaseSource.file.size > 0 ) {
+      MemFileInitView( &dataFile, databaseSource.file.data, 
+         databaseSource.file.size );
+      /* Then proceed to import the map directory. */
       isImported = LukdImport( &dataFile );
-      /* If we imported the database file successfully, make a backup. */
-      if ( isImported ) {
-         LukdBackupFile( &dataFile, dataFilePath );
-      }
    }
    /* Bail out successfully if the database file is empty, meaning it
       must have been created by the user manually. */
-   else if ( bytesAdded == 0 ) {
+   else if ( errorCode == 0 ) {
       PrintNotice( "Database file is empty\n" );
       isImported = TRUE;
    }
    /* Trigger an error if the file was not read successfully. */
    else {
-      const int errorCode = bytesAdded;
       PrintWarning( "Failed to import database file at path: %s\n",
          dataFilePath );
       /* Print the reason for the error: */
@@ -92,382 +286,2943 @@ Bool LukdImportDatabase( const char *dataFilePath ) {
          MemFileGetErrorCodeMessage( errorCode ) );
    }
 
-   MemFileClose( &dataFile );
+   /* The map entries found before a failure can still be loaded, so the
+      file is kept open as long as it has any data. */
+   if ( errorCode < 0 || databaseSource.file.size == 0 ) {
+      MapFileClose( &databaseSource.file );
+   }
+
    return isImported;
 }
 
-Bool LukdImport( MemFile *dataFile ) {
-   Bool isImported = FALSE;
-
-   const size_t dataFileSize = MemFileGetSize( dataFile );
-   size_t bytesRead;
+Bool LukdLoadMapEntry( DatabaseMapEntry *dbEntry ) {
+   DatabaseFileSection *section = dbEntry->fileSections;
+   MemFile dataFile;
+   int totalRecords = 0;
+   Bool isLoaded = TRUE;
 
-   LukdMainTableOffset mainTableOffset;
-   LukdMainTable mainTable;
-   const size_t mainTableSize = sizeof( mainTable );
-   int totalRecords;
+   if ( section == NULL ) {
+      return TRUE;
+   }
 
-   /* Collect the main table offset and do some sanity checks on it. */
-   MemFileRewind( dataFile );
-   MemFileRead( dataFile, &mainTableOffset, sizeof( mainTableOffset ) );
-   if ( ! LukdIsValidMainTableOffset( mainTableOffset, dataFileSize ) ) {
-      PrintWarning( "Bad main table offset in file: %lu\n", mainTableOffset );
+   if ( ! MapFileIsOpen( &databaseSource.file ) ) {
+      PrintWarning( "Database file is not open. Cannot load records of "
+         "map: %s\n", dbEntry->name->value );
       return FALSE;
    }
 
-   /* Collect the main table. */
-   MemFileSetPosition( dataFile, mainTableOffset );
-   bytesRead = MemFileRead( dataFile, &mainTable, mainTableSize );
-   /* Bail out if the main table read is not of required size or is
-      an invalid one. */
-   if ( bytesRead != mainTableSize || 
-      ! LukdIsValidMainTable( &mainTable, dataFileSize ) ) {
-      PrintWarning( "Corrupt main table in database file detected\n" );
-      return FALSE;
+   MemFileInitView( &dataFile, databaseSource.file.data, 
+      databaseSource.file.size );
+
+   /* A damaged section is left out, and the other sections of the map are
+      still loaded. The damaged section stays in the file as it is. */
+   while ( section != NULL ) {
+      Bool isImported;
+
+      if ( ! LukdIsIntactSection( &dataFile, section ) ) {
+         isLoaded = FALSE;
+         section = section->nextSection;
+         continue;
+      }
+
+      isImported = section->isCompressed ? 
+         LukdImportBlocks( &databaseSource, &dataFile, section, dbEntry, 
+            &totalRecords ) :
+         LukdImportRecords( &databaseSource, &dataFile, 
+            section->firstRecord, section->totalRecords, dbEntry, 
+            section->player, &totalRecords );
+
+      /* Only the records of files without checksums can be found damaged
+         here. The records read before the damage stay loaded. */
+      if ( ! isImported ) {
+         section->isChecked = TRUE;
+         section->isDamaged = TRUE;
+         isLoaded = FALSE;
+      }
+
+      section = section->nextSection;
    }
 
-   /* Import the map entries and their records. */
-   if ( LukdImportMapEntries( dataFile, &mainTable, &totalRecords ) ) {
-      /* If all is well, print the information about the file. */
-      LukdPrintFileInfo( &mainTable, totalRecords );
-      isImported = TRUE;
+   return isLoaded;
+}
+
+Str *LukdRetrieveRecord( const DatabaseMapEntry *entry, const Str *player,
+   const Str *key ) {
+   DatabaseFileSection *section;
+   MemFile dataFile;
+   Str *value;
+   Str *expiryKey;
+   Str *expiresAt;
+
+   if ( ! MapFileIsOpen( &databaseSource.file ) ) {
+      return NULL;
    }
 
-   return isImported;
+   MemFileInitView( &dataFile, databaseSource.file.data, 
+      databaseSource.file.size );
+
+   section = LukdFindSection( entry, player, &dataFile );
+   if ( section == NULL ) {
+      return NULL;
+   }
+
+   /* Most keys that aren't there are turned away by the filter, which is
+      in memory, so the file isn't touched for them. */
+   if ( section->filter != NULL && ! LukdFilterHasKey( section->filter, 
+      section->filterSize, key ) ) {
+      return NULL;
+   }
+
+   if ( ! LukdIsIntactSection( &dataFile, section ) ) {
+      return NULL;
+   }
+
+   value = LukdFindRecord( &databaseSource, &dataFile, section, key );
+   if ( value == NULL ) {
+      return NULL;
+   }
+
+   /* A temporary record has its expiry time in a record of its own. */
+   expiryKey = LukdMakeExpiryKey( key );
+   expiresAt = LukdFindRecord( &databaseSource, &dataFile, section, 
+      expiryKey );
+   if ( expiresAt != NULL && 
+      ( time_t ) atol( expiresAt->value ) <= time( NULL ) ) {
+      StrDel( value );
+      value = NULL;
+   }
+
+   StrDel( expiryKey );
+   StrDel( expiresAt );
+   return value;
 }
 
-Bool LukdImportMapEntries( MemFile *dataFile, const LukdMainTable *table,
-   int *totalRecords ) {
-   const size_t dataFileSize = MemFileGetSize( dataFile );
+void LukdCloseDatabase( void ) {
+   LukdCloseSource( &databaseSource );
+}
 
-   size_t nextEntryPosition;
-   LukdMapEntry entry;
-   unsigned int entryNum;
+/* Files read on their own */
+
+void LukdInitSource( LukdSource *source ) {
+   MapFileInit( &source->file );
+   source->version = LUKD_VERSION;
+   LukdInitKeyTable( &source->keys );
+   source->hasKeys = FALSE;
+   memset( &source->mainTable, 0, sizeof( source->mainTable ) );
+   source->entries = NULL;
+   source->totalEntries = 0;
+   source->entriesAllocated = 0;
+}
 
-   /* Begin by moving to the position of the first map entry. */
-   MemFileSetPosition( dataFile, table->firstMapEntry );
-
-   *totalRecords = 0;
-   for ( entryNum = 0; entryNum < table->totalMapEntries; entryNum += 1 ) {
-      MemFileRead( dataFile, &entry, sizeof( LukdMapEntry ) );
-      /* Do some sanity checks on the map entry. */
-      if ( LukdIsValidMapEntry( &entry, dataFileSize ) ) {
-         /* Change to the appropriate map in the database: */
-         Str *mapName = StrNewSub( entry.name, LUKD_MAX_MAP_LENGTH );
-         DatabaseChangeMap( mapName );
-         StrDel( mapName );
-
-         /* Import the records, but remember the file position of the
-            next map entry. */
-         nextEntryPosition = MemFileGetPosition( dataFile );
-         if ( ! LukdImportRecords( dataFile, &entry, totalRecords ) ) {
-            return FALSE;
-         }
-         /* Restore the position of the next map entry. */
-         MemFileSetPosition( dataFile, nextEntryPosition );
-      }
-      else {
-         PrintWarning( 
-            "Corrupt map entry encountered in database file\n" );
-         return FALSE;
-      }
+Bool LukdOpenSource( LukdSource *source, const char *filePath ) {
+   MemFile dataFile;
+   int errorCode;
+
+   LukdInitSource( source );
+   errorCode = MapFileOpen( &source->file, filePath );
+   if ( errorCode < 0 ) {
+      PrintWarning( "Failed to open database file at path: %s\n", 
+         filePath );
+      PrintMessage( "Reason for failure: %s\n",
+         MemFileGetErrorCodeMessage( errorCode ) );
+      return FALSE;
    }
 
-   return TRUE;
+   /* An empty file has no map entries. */
+   if ( source->file.size == 0 ) {
+      return TRUE;
+   }
+
+   MemFileInitView( &dataFile, source->file.data, source->file.size );
+   return LukdReadDirectory( source, &dataFile, FALSE );
 }
 
-Bool LukdImportRecords( MemFile *dataFile, const LukdMapEntry *entry,
-   int *totalRecords ) {
-   LukdRecordHeader recordHeader;
-   unsigned int recordNum;
+void LukdCloseSource( LukdSource *source ) {
+   MapFileClose( &source->file );
+   LukdDestroyKeyTable( &source->keys );
+   source->hasKeys = FALSE;
+   LukdDestroyDirectory( source );
+}
 
-   /* Move to the first record in the record series of the map entry. */
-   MemFileSetPosition( dataFile, entry->firstRecord );
+Bool LukdReadEntryRecords( const LukdSource *source, unsigned int entryNum,
+   LukdRecordHandler handler, void *context ) {
+   DatabaseFileSection section;
+   MemFile dataFile;
 
-   for ( recordNum = 0; recordNum < entry->totalRecords; recordNum += 1 ) {
-      MemFileRead( dataFile, &recordHeader, sizeof( recordHeader ) );
-      if ( LukdIsValidRecordHeader( &recordHeader, dataFile ) ) {
-         Str *key = StrNewEmpty( recordHeader.keySize );
-         Str *value = StrNewEmpty( recordHeader.valueSize );
-         if ( key == NULL || value == NULL ) {
-            PrintWarning( 
-               "Failed to allocate enough memory for a record\n" );
-            StrDel( key );
-            StrDel( value );
-            return FALSE;
+   MemFileInitView( &dataFile, source->file.data, source->file.size );
+   LukdInitEntrySection( &section, &source->entries[ entryNum ] );
+   return LukdReadSectionRecords( source, &dataFile, &section, handler, 
+      context );
+}
+
+Bool LukdIsIntactEntry( const LukdSource *source, unsigned int entryNum ) {
+   DatabaseFileSection section;
+   MemFile dataFile;
+
+   MemFileInitView( &dataFile, source->file.data, source->file.size );
+   LukdInitEntrySection( &section, &source->entries[ entryNum ] );
+   return LukdIsIntactSection( &dataFile, &section );
+}
+
+/* Lookup functions */
+
+/* A map only has two sections for the same player when one of them is 
+   damaged, and was kept in the file as it is. Only then does the choice
+   need the checksum. */
+DatabaseFileSection *LukdFindSection( const DatabaseMapEntry *entry,
+   const Str *player, const MemFile *dataFile ) {
+   DatabaseFileSection *section = entry->fileSections;
+   DatabaseFileSection *foundSection = NULL;
+
+   while ( section != NULL ) {
+      if ( ! section->isDamaged && ( player == NULL ? 
+         section->player == NULL : ( section->player != NULL && 
+            StrIsEqual( section->player, player ) ) ) ) {
+         if ( foundSection != NULL ) {
+            return LukdIsIntactSection( dataFile, foundSection ) ? 
+               foundSection : section;
          }
 
-         MemFileRead( dataFile, key->value, key->length );
-         MemFileRead( dataFile, value->value, value->length );
+         foundSection = section;
+      }
 
-         /* Load the record into the database: */
-         DatabaseStore( key, value );
+      section = section->nextSection;
+   }
 
-         StrDel( key );
-         StrDel( value );
+   return foundSection;
+}
 
-         *totalRecords += 1;
+Str *LukdFindRecord( const LukdSource *source, MemFile *dataFile, 
+   const DatabaseFileSection *section, const Str *key ) {
+   const LukdKeyTable *keys = LukdGetSourceKeys( source );
+   unsigned int keyId = LUKD_NO_KEY;
+   Str *value = NULL;
+
+   /* A key that isn't in the key table isn't the key of any record. */
+   if ( keys != NULL ) {
+      keyId = LukdFindKey( keys, key );
+      if ( keyId == LUKD_NO_KEY ) {
+         return NULL;
+      }
+   }
+
+   /* Without an index, the records are searched one by one. */
+   if ( section->totalIndexSlots == 0 ) {
+      if ( section->isCompressed ) {
+         unsigned int blockNum;
+
+         for ( blockNum = 0; blockNum < section->totalBlocks && 
+            value == NULL; blockNum += 1 ) {
+            LukdBlock block;
+            MemFile blockFile;
+            Byte *records = LukdReadBlock( source, dataFile, section, 
+               blockNum, &block );
+            if ( records == NULL ) {
+               break;
+            }
+
+            MemFileInitView( &blockFile, records, block.size );
+            value = LukdScanRecords( source, &blockFile, block.totalRecords,
+               key, keyId );
+            free( ( void * ) records );
+         }
       }
-      /* Finish processing the records if we find an invalid
-         record. */
       else {
-         PrintWarning( "Malformed record found in database file\n" );
-         return FALSE;
+         MemFileSetPosition( dataFile, section->firstRecord );
+         value = LukdScanRecords( source, dataFile, section->totalRecords, 
+            key, keyId );
       }
    }
+   else {
+      const unsigned int hash = StrHash( key );
+      const unsigned int slotMask = section->totalIndexSlots - 1;
+      unsigned int slotNum = hash & slotMask;
+      unsigned int probes;
+
+      /* Keys with the same slot are placed in the slots that follow, up to
+         the first empty slot. */
+      for ( probes = 0; probes < section->totalIndexSlots && value == NULL;
+         probes += 1 ) {
+         LukdIndexSlot slot;
+
+         /* The index was checked to fit in the file when the file was
+            imported. */
+         LukdGetIndexSlot( source, dataFile, section->firstIndexSlot, 
+            slotNum, &slot );
+         if ( slot.record == 0 ) {
+            break;
+         }
 
-   return TRUE;
-}
+         if ( slot.hash == hash ) {
+            LukdReadRecordAt( source, dataFile, section, slot.record, key, 
+               keyId, &value );
+         }
 
-/* Validation functions */
+         slotNum = ( slotNum + 1 ) & slotMask;
+      }
+   }
 
-Bool LukdIsValidMainTableOffset( LukdMainTableOffset offset,
-   const size_t fileSize ) {
-   LukdMainTableOffset tableMaxOffset = fileSize - sizeof( LukdMainTable );
-   return ( offset <= tableMaxOffset );
+   return value;
 }
 
-Bool LukdIsValidMainTable( const LukdMainTable *table,
-   const size_t fileSize ) {
-   /* We only validate the other fields if there are actually map entries
-      present in the file. */
-   if ( table->totalMapEntries > 0 ) {
-      const size_t mapEntrySize = sizeof( LukdMapEntry );
+Str *LukdScanRecords( const LukdSource *source, MemFile *file, 
+   unsigned int recordCount, const Str *key, unsigned int keyId ) {
+   Str *value = NULL;
+   unsigned int recordNum;
 
-      /* Make sure that the first map entry is not off limits. */
-      unsigned int entryStartLowerLimit = sizeof( LukdMainTable );
-      unsigned entryStartUpperLimit = fileSize - mapEntrySize;
+   for ( recordNum = 0; recordNum < recordCount && value == NULL; 
+      recordNum += 1 ) {
+      if ( ! LukdReadRecordValue( source, file, key, keyId, &value ) ) {
+         break;
+      }
+   }
 
-      if ( table->firstMapEntry < entryStartLowerLimit ||
-         table->firstMapEntry > entryStartUpperLimit ) {
-         PrintWarning( "First map entry is NOT within valid limits\n" );
-         return FALSE;
+   return value;
+}
+
+/* The positions of compressed records are counted as if the records were
+   not compressed, so the block that holds the record is decompressed and
+   the record is read from there. */
+void LukdReadRecordAt( const LukdSource *source, MemFile *dataFile, 
+   const DatabaseFileSection *section, LukdOffset recordPosition, 
+   const Str *key, unsigned int keyId, Str **value ) {
+   if ( section->isCompressed ) {
+      LukdBlock block;
+      MemFile blockFile;
+      Byte *records = LukdReadBlock( source, dataFile, section, 
+         LukdFindBlock( source, dataFile, section, recordPosition ), 
+         &block );
+      if ( records == NULL ) {
+         return;
       }
 
-      /* Make sure the total map entries given is enough to fit in the
-         target file. */
-      if ( table->totalMapEntries * mapEntrySize >
-         fileSize - table->firstMapEntry ) {
-         PrintWarning( "Total size of entries is too big for given file\n" );
-         return FALSE;
+      MemFileInitView( &blockFile, records, block.size );
+      if ( recordPosition >= block.firstByte && 
+         recordPosition - block.firstByte <= block.size ) {
+         MemFileSetPosition( &blockFile, 
+            ( size_t ) ( recordPosition - block.firstByte ) );
+         LukdReadRecordValue( source, &blockFile, key, keyId, value );
       }
+
+      free( ( void * ) records );
+   }
+   else if ( recordPosition <= MemFileGetSize( dataFile ) ) {
+      MemFileSetPosition( dataFile, ( size_t ) recordPosition );
+      LukdReadRecordValue( source, dataFile, key, keyId, value );
    }
+}
 
-   return TRUE;
+/* Finds the last block that starts at or before the given position. The
+   blocks were checked to follow each other when the file was imported. */
+unsigned int LukdFindBlock( const LukdSource *source, 
+   const MemFile *dataFile, const DatabaseFileSection *section, 
+   LukdOffset recordPosition ) {
+   unsigned int low = 0;
+   unsigned int high = section->totalBlocks;
+
+   while ( high - low > 1 ) {
+      const unsigned int middle = low + ( high - low ) / 2;
+      LukdBlock block;
+
+      LukdGetBlock( source, dataFile, section->firstBlock, middle, 
+         &block );
+      if ( block.firstByte <= recordPosition ) {
+         low = middle;
+      }
+      else {
+         high = middle;
+      }
+   }
+
+   return low;
 }
 
-Bool LukdIsValidMapEntry( const LukdMapEntry *entry, const size_t fileSize ) {
-   if ( entry->totalRecords > 0 ) {
-      unsigned int RecordStartLowerLimit = sizeof( LukdMainTableOffset );
-      unsigned int RecordStartUpperLimit = fileSize - 
-         sizeof( LukdRecordHeader );
+/* Reads the record at the current position of the file, leaving the file
+   at the next record. The value of the record is only read if the record
+   has the given key. Records of files with a key table are told apart by
+   the number of their key alone. Returns false on a malformed record. */
+Bool LukdReadRecordValue( const LukdSource *source, MemFile *file, 
+   const Str *key, unsigned int keyId, Str **value ) {
+   LukdRecord record;
 
-      /* Make sure the start of the first record is not off limits. */
-      if ( entry->firstRecord < RecordStartLowerLimit ||
-         entry->firstRecord > RecordStartUpperLimit ) {
-         return FALSE;
+   if ( ! LukdReadRecord( file, LukdGetSourceKeys( source ), &record ) ) {
+      return FALSE;
+   }
+
+   if ( keyId != LUKD_NO_KEY ? record.keyId == keyId : 
+      ( record.key.length == key->length && 
+         memcmp( record.key.value, key->value, key->length ) == 0 ) ) {
+      *value = StrNewEmpty( record.value.length );
+      if ( *value != NULL ) {
+         memcpy( ( *value )->value, record.value.value, 
+            record.value.length );
       }
+   }
 
-      /* Make sure the total records is not beyond the file size. 
-         FIXME: This is bad and needs improving. */
-      if ( entry->totalRecords >= fileSize ) {
+   return TRUE;
+}
+
+/* The bit positions of a key are found by double hashing, with the second
+   hash made by rotating the first one. */
+Bool LukdFilterHasKey( const Byte *filter, unsigned int filterSize,
+   const Str *key ) {
+   const unsigned int totalBits = filterSize * 8;
+   unsigned int hash = StrHash( key );
+   const unsigned int delta = ( hash >> 17 ) | ( hash << 15 );
+   int probe;
+
+   for ( probe = 0; probe < LUKD_FILTER_HASHES; probe += 1 ) {
+      const unsigned int bit = hash % totalBits;
+      if ( ( filter[ bit / 8 ] & ( 1 << ( bit % 8 ) ) ) == 0 ) {
          return FALSE;
       }
+
+      hash += delta;
    }
 
    return TRUE;
 }
 
-Bool LukdIsValidRecordHeader( const LukdRecordHeader *header, 
-   const MemFile *file ) {
-   /* Find the maximum size of a record based on the current position
-      of the file and the file information. Then compare this value
-      with the current record information to see if it fits within
-      the current limit. */
-   const size_t currentMaxRecordBodySize = MemFileGetSize( file ) - 
-      sizeof( LukdMainTable ) - MemFileGetPosition( file );
-   const size_t currentRecordBodySize = header->keySize + header->valueSize;
-   return ( currentRecordBodySize <= currentMaxRecordBodySize );
+void LukdFilterAddKey( Byte *filter, unsigned int filterSize, 
+   const Str *key ) {
+   const unsigned int totalBits = filterSize * 8;
+   unsigned int hash = StrHash( key );
+   const unsigned int delta = ( hash >> 17 ) | ( hash << 15 );
+   int probe;
+
+   for ( probe = 0; probe < LUKD_FILTER_HASHES; probe += 1 ) {
+      const unsigned int bit = hash % totalBits;
+      filter[ bit / 8 ] |= ( Byte ) ( 1 << ( bit % 8 ) );
+      hash += delta;
+   }
 }
 
-void LukdPrintFileInfo( const LukdMainTable *table, int totalRecords ) {
-   char publishDate[ LUKD_PUBLISH_DATE_MAX_LENGTH ];
+/* The directory is read on its own first, and then the map entries are
+   added to the database, in the order they're in, followed by the player
+   entries. Only the location of the records is noted down. The records are
+   loaded when the map is first used. */
+Bool LukdImport( MemFile *dataFile ) {
+   LukdSource *source = &databaseSource;
+   const Bool isRead = LukdReadDirectory( source, dataFile, TRUE );
+   int totalRecords = 0;
+   unsigned int entryNum;
 
-   time_t time = ( time_t ) table->publishDate;
-   struct tm *localTime = localtime( &time );
+   /* The entries found before a corrupt one are kept. */
+   for ( entryNum = 0; entryNum < source->totalEntries; entryNum += 1 ) {
+      LukdDirectoryEntry *entry = &source->entries[ entryNum ];
+      Str *mapName = LukdMakeMapName( entry->map );
 
-   strftime( publishDate, LUKD_PUBLISH_DATE_MAX_LENGTH, 
-      LUKD_PUBLISH_DATE_FORMAT, localTime );
+      LukdSetSectionSeries( DatabaseAddFileSection( mapName, entry->player, 
+         ( size_t ) entry->series.firstRecord, entry->series.totalRecords ),
+         &entry->series, entry->filter );
+      entry->filter = NULL;
+      StrDel( mapName );
 
-   /* Print all the important information about the file to the user. */
-   PrintMessage( "Database file: \n" );
-   PrintMessage( "   - Published on: %s\n", publishDate );
-   PrintMessage( "   - Total map entries: %lu\n", table->totalMapEntries ); 
-   PrintMessage( "   - Total records: %lu\n", totalRecords ); 
+      totalRecords += entry->series.totalRecords;
+   }
+
+   /* If all is well, print the information about the file. */
+   if ( isRead ) {
+      LukdPrintFileInfo( &source->mainTable, totalRecords );
+   }
+
+   LukdDestroyDirectory( source );
+   return isRead;
 }
 
-void LukdBackupFile( MemFile *dataFile, const char *dataFilePath ) {
-   int bytesSaved;
+/* Reads the header, the main table, the key table and the entries of the
+   directory. The filters are only copied out of the file when asked for. */
+Bool LukdReadDirectory( LukdSource *source, MemFile *dataFile, 
+   Bool isFilterCopied ) {
+   const size_t dataFileSize = MemFileGetSize( dataFile );
 
-   const Str *backupFilePath = 
-      StrNewEmpty( strlen( dataFilePath ) + strlen( LUKD_BACKUP_EXT ) );
-   if ( backupFilePath == NULL ) {
-      return;
-   }
-   sprintf( backupFilePath->value, "%s%s", dataFilePath, LUKD_BACKUP_EXT );
+   LukdFileHeader header;
+   unsigned int version = 1;
+   LukdMainTableOffset versionMarker = 0;
+   LukdOffset mainTableOffset;
+   size_t mainTableSize;
 
-   PrintMessage( "Creating backup database file at path: %s\n",
-      backupFilePath->value );
+   /* Collect the main table offset and do some sanity checks on it. */
+   MemFileRewind( dataFile );
+   MemFileRead( dataFile, &versionMarker, sizeof( versionMarker ) );
+   mainTableOffset = versionMarker;
 
-   bytesSaved = MemFileSave( dataFile, backupFilePath->value );
-   if ( bytesSaved < 0 ) {
-      const int errorCode = bytesSaved;
-      PrintWarning( "Failed to create a backup of the database file\n" );
-      PrintMessage( "Reason for failure: %s\n", 
-         MemFileGetErrorCodeMessage( errorCode ) );
-   }
+   LukdDestroyKeyTable( &source->keys );
+   source->hasKeys = FALSE;
+   LukdDestroyDirectory( source );
 
-   StrDel( backupFilePath );
-}
+   /* Files with a version have the main table offset in their header. */
+   if ( versionMarker == 0 ) {
+      if ( ! LukdReadFileHeader( dataFile, &header ) ) {
+         PrintWarning( "Bad file header in database file\n" );
+         return FALSE;
+      }
 
-/* Functions to write the database to file. */
+      version = header.version;
+      if ( version < 2 || version > LUKD_VERSION ) {
+         PrintWarning( "Unsupported database file version: %u\n", 
+            version );
+         return FALSE;
+      }
 
-Bool LukdExportDatabase( const Database *database, const char *outFilePath ) {
-   size_t firstMapEntry;
-   int entriesExported;
-   int bytesWritten;
-   Bool isExported;
+      mainTableOffset = header.mainTableOffset;
+   }
 
-   LukdMainTableOffset mainTableOffset = 0;
-   const size_t mainTableOffsetSize = sizeof( mainTableOffset );
+   source->version = version;
+   mainTableSize = ( version >= 6 ) ? sizeof( LukdMainTable ) : 
+      sizeof( LukdMainTable32 );
+   if ( ! LukdIsValidMainTableOffset( mainTableOffset, mainTableSize, 
+      dataFileSize ) ) {
+      PrintWarning( "Bad main table offset in file: %llu\n", 
+         mainTableOffset );
+      return FALSE;
+   }
 
-   MemFile outFile;
-   MemFileInit( &outFile );
+   /* Collect the main table. */
+   MemFileSetPosition( dataFile, ( size_t ) mainTableOffset );
+   /* Bail out if the main table read is not of required size or is
+      an invalid one. */
+   if ( ! LukdReadMainTable( dataFile, version, &source->mainTable ) || 
+      ! LukdIsValidMainTable( &source->mainTable, 
+         LukdGetMapEntrySize( version ), dataFileSize ) ) {
+      PrintWarning( "Corrupt main table in database file detected\n" );
+      return FALSE;
+   }
 
-   PrintMessage( "Saving database to path: %s\n", outFilePath );
+   /* The directory is checked as a whole before any of it is used. The
+      records are only checked when they're first read. */
+   if ( version >= 7 && ! LukdIsIntactDirectory( dataFile, &header, 
+      &source->mainTable ) ) {
+      PrintWarning( "Checksum mismatch in directory of database file\n" );
+      return FALSE;
+   }
 
-   /* Prepare the space for the main table offset. */
-   MemFileAdd( &outFile, &mainTableOffset, mainTableOffsetSize );
+   /* Since version 5, the file has a key table. */
+   if ( version >= 5 && ! LukdImportKeyTable( source, dataFile, &header ) ) {
+      PrintWarning( "Corrupt key table in database file\n" );
+      return FALSE;
+   }
 
-   /* Export the map entries and their records. */
-   entriesExported = LukdExportEntries( &outFile, database, &firstMapEntry );
-   /* After we add the map entries and their records into the output file,
-      we need to collect the current position of the file because the next
-      item to be added will be the main table and we need the offset of 
-      the main table in the beginning of the lukd file. */
-   mainTableOffset = MemFileGetPosition( &outFile );
+   /* Read the map entries, and then the entries of the players, which 
+      come after the main table. */
+   return ( LukdReadMapEntries( source, dataFile, isFilterCopied ) && 
+      LukdReadPlayerEntries( source, dataFile, 
+         ( size_t ) mainTableOffset + mainTableSize, isFilterCopied ) );
+}
 
-   /* Export the main table with the map entries data collected above. */
-   LukdExportMainTable( &outFile, entriesExported, firstMapEntry );
+/* The map entries are read and checked, and their filters copied out of 
+   the file, by several threads at once. */
+Bool LukdReadMapEntries( LukdSource *source, MemFile *dataFile,
+   Bool isFilterCopied ) {
+   const unsigned int totalMapEntries = source->mainTable.totalMapEntries;
+   LukdDirectoryImport directory;
+   unsigned int entryNum;
 
-   /* Now record the main table offset. */
-   MemFileRewind( &outFile );
-   MemFileAdd( &outFile, &mainTableOffset, mainTableOffsetSize );
+   if ( totalMapEntries == 0 ) {
+      return TRUE;
+   }
 
-   /* Save the file contents into a permanent output file: */
-   bytesWritten = MemFileSave( &outFile, outFilePath );
-   if ( bytesWritten >= 0 ) {
-      isExported = TRUE;
+   source->entries = ( LukdDirectoryEntry * ) malloc( 
+      totalMapEntries * sizeof( LukdDirectoryEntry ) );
+   if ( source->entries == NULL ) {
+      PrintWarning( "Failed to allocate enough memory for the map "
+         "entries\n" );
+      return FALSE;
    }
-   else {
-      const int errorCode = bytesWritten;
-      PrintWarning( "Could not write to file at path: %s\n", outFilePath );
-      PrintMessage( "Reason for failure: %s\n", 
-         MemFileGetErrorCodeMessage( errorCode ) );
-      isExported = FALSE;
+   source->entriesAllocated = totalMapEntries;
+
+   directory.source = source;
+   directory.dataFile = dataFile;
+   directory.isFilterCopied = isFilterCopied;
+   WorkPoolRun( LukdReadMapEntryRun, &directory, totalMapEntries, 
+      LUKD_MIN_THREAD_ENTRIES );
+
+   /* The entries before a corrupt one are kept. */
+   while ( source->totalEntries < totalMapEntries && 
+      source->entries[ source->totalEntries ].isValid ) {
+      source->totalEntries += 1;
    }
 
-   MemFileClose( &outFile );
-   return isExported;
+   for ( entryNum = source->totalEntries; entryNum < totalMapEntries;
+      entryNum += 1 ) {
+      free( ( void * ) source->entries[ entryNum ].filter );
+   }
+
+   if ( source->totalEntries < totalMapEntries ) {
+      PrintWarning( "Corrupt map entry encountered in database file\n" );
+      return FALSE;
+   }
+
+   return TRUE;
 }
 
-int LukdExportEntries( MemFile *outFile, const Database *database,
-   size_t *firstMapEntry ) {   
-   LukdMapEntry lukdEntry;
-   DatabaseMapEntry *dbEntry = database->firstMap;
+/* Each thread reads its map entries through a view of the file of its 
+   own. The entries are all the same size, so the thread can go straight to
+   its first one. */
+void LukdReadMapEntryRun( void *directory, unsigned int firstEntry,
+   unsigned int lastEntry ) {
+   const LukdDirectoryImport *import = 
+      ( const LukdDirectoryImport * ) directory;
+   const LukdSource *source = import->source;
+   const size_t entrySize = LukdGetMapEntrySize( source->version );
+   MemFile dataFile;
+   unsigned int entryNum;
 
-   int entriesExported = 0;
-   int recordsExported;
+   MemFileInitView( &dataFile, import->dataFile->data, 
+      MemFileGetSize( import->dataFile ) );
+   MemFileSetPosition( &dataFile, ( size_t ) source->mainTable.firstMapEntry
+      + firstEntry * entrySize );
+
+   for ( entryNum = firstEntry; entryNum < lastEntry; entryNum += 1 ) {
+      LukdDirectoryEntry *dirEntry = &source->entries[ entryNum ];
+      LukdMapEntry entry;
+
+      dirEntry->isValid = ( LukdReadMapEntry( &dataFile, source->version, 
+         &entry ) && LukdIsValidSeries( source, &entry.records, 
+            &dataFile ) );
+      memcpy( dirEntry->map, entry.name, LUKD_MAX_MAP_LENGTH );
+      dirEntry->player = NULL;
+      dirEntry->series = entry.records;
+      dirEntry->filter = ( dirEntry->isValid && import->isFilterCopied ) ?
+         LukdCopyFilter( &dataFile, &entry.records ) : NULL;
+   }
+}
 
-   size_t firstRecordPosition;
+/* The player table is optional. Files written before players had records
+   of their own simply end with the main table. */
+Bool LukdReadPlayerEntries( LukdSource *source, MemFile *dataFile, 
+   size_t playerTableOffset, Bool isFilterCopied ) {
+   const size_t dataFileSize = MemFileGetSize( dataFile );
 
-   /* We will save the map entries into a separate memory file and then
-      append its contents into the output file. */
-   MemFile entriesFile;
-   MemFileInit( &entriesFile );
+   LukdPlayerTable table;
+   LukdPlayerEntry entry;
+   unsigned int entryNum;
 
-   while ( dbEntry != NULL ) {
-      firstRecordPosition = MemFileGetPosition( outFile );
-      recordsExported = LukdExportRecords( outFile, dbEntry );
+   MemFileSetPosition( dataFile, playerTableOffset );
+   if ( MemFileRead( dataFile, &table, sizeof( table ) ) != sizeof( table ) ||
+      memcmp( table.tag, LUKD_PLAYER_TABLE_TAG, 
+         LUKD_PLAYER_TABLE_TAG_LENGTH ) != 0 ) {
+      return TRUE;
+   }
 
-      /* Only add a map entry if it has any records. No point in storing
-         an empty map entry. */
-      if ( recordsExported > 0 ) {
-         memset( lukdEntry.name, 0, LUKD_MAX_MAP_LENGTH );
-         memcpy( lukdEntry.name, dbEntry->name->value, dbEntry->name->length );
+   for ( entryNum = 0; entryNum < table.totalPlayerEntries; entryNum += 1 ) {
+      LukdDirectoryEntry *dirEntry;
+      Str *player;
+
+      if ( ! LukdReadPlayerEntry( dataFile, source->version, &entry ) || 
+         entry.nameSize == 0 ||
+         entry.nameSize > dataFileSize - MemFileGetPosition( dataFile ) ||
+         ! LukdIsValidSeries( source, &entry.records, dataFile ) ) {
+         PrintWarning( 
+            "Corrupt player entry encountered in database file\n" );
+         return FALSE;
+      }
 
-         lukdEntry.totalRecords = recordsExported;
-         lukdEntry.firstRecord = firstRecordPosition;
+      player = StrNewEmpty( entry.nameSize );
+      dirEntry = ( player != NULL ) ? LukdAddDirectoryEntry( source ) : 
+         NULL;
+      if ( dirEntry == NULL ) {
+         PrintWarning( "Failed to allocate enough memory for a player\n" );
+         StrDel( player );
+         return FALSE;
+      }
+      MemFileRead( dataFile, player->value, player->length );
+
+      memcpy( dirEntry->map, entry.map, LUKD_MAX_MAP_LENGTH );
+      dirEntry->player = player;
+      dirEntry->series = entry.records;
+      dirEntry->filter = isFilterCopied ? 
+         LukdCopyFilter( dataFile, &entry.records ) : NULL;
+      dirEntry->isValid = TRUE;
+   }
 
-         MemFileAdd( &entriesFile, &lukdEntry, sizeof( lukdEntry ) );
-         entriesExported += 1;
+   return TRUE;
+}
+
+/* Returns a new entry at the end of the directory, or NULL if there's no
+   memory for it. */
+LukdDirectoryEntry *LukdAddDirectoryEntry( LukdSource *source ) {
+   LukdDirectoryEntry *entry;
+
+   if ( source->totalEntries == source->entriesAllocated ) {
+      const unsigned int entriesAllocated = 
+         ( source->entriesAllocated > 0 ) ? 
+         source->entriesAllocated * 2 : 16;
+      LukdDirectoryEntry *entries = ( LukdDirectoryEntry * ) realloc( 
+         source->entries, entriesAllocated * sizeof( LukdDirectoryEntry ) );
+      if ( entries == NULL ) {
+         return NULL;
       }
 
-      dbEntry = dbEntry->nextEntry;
+      source->entries = entries;
+      source->entriesAllocated = entriesAllocated;
    }
 
-   /* After we add the records, the next item that will come is the map
-      entry directory. The main table needs the start of this directory,
-      so we save it. */
-   *firstMapEntry = MemFileGetPosition( outFile );
+   entry = &source->entries[ source->totalEntries ];
+   source->totalEntries += 1;
+   return entry;
+}
 
-   /* Then we add the collected entries to the output file. */
-   MemFileAddMemFile( outFile, &entriesFile );
-   MemFileClose( &entriesFile );
+void LukdDestroyDirectory( LukdSource *source ) {
+   unsigned int entryNum;
 
-   return entriesExported;
+   for ( entryNum = 0; entryNum < source->totalEntries; entryNum += 1 ) {
+      StrDel( source->entries[ entryNum ].player );
+      free( ( void * ) source->entries[ entryNum ].filter );
+   }
+
+   free( ( void * ) source->entries );
+   source->entries = NULL;
+   source->totalEntries = 0;
+   source->entriesAllocated = 0;
 }
 
-int LukdExportRecords( MemFile *outFile, DatabaseMapEntry *dbEntry ) {
-   int recordsExported = 0;
+/* The header of files before version 6 is read into a header of the
+   current version. The fields before the main table offset are the same
+   in every version. */
+Bool LukdReadFileHeader( MemFile *dataFile, LukdFileHeader *header ) {
+   const size_t commonSize = offsetof( LukdFileHeader, totalKeys );
+   LukdFileHeader32 oldHeader;
+   size_t oldHeaderSize;
 
-   DatabaseRecord *record = dbEntry->firstRecord;
-   while ( record != NULL ) {
-      /* Write record header: */
-      LukdRecordHeader lukdRecordHeader;
+   memset( header, 0, sizeof( *header ) );
+   MemFileRewind( dataFile );
+   if ( MemFileRead( dataFile, header, commonSize ) != commonSize || 
+      memcmp( header->magic, LUKD_MAGIC, LUKD_MAGIC_LENGTH ) != 0 ) {
+      return FALSE;
+   }
 
-      lukdRecordHeader.keySize = record->key->length;
-      lukdRecordHeader.valueSize = record->value->length;
+   /* Files of later versions are turned away by the caller. */
+   if ( header->version > LUKD_VERSION ) {
+      return TRUE;
+   }
 
-      MemFileAdd( outFile, &lukdRecordHeader, sizeof( lukdRecordHeader ) );
+   /* Since version 7, the header can be checked on its own. */
+   if ( header->version >= 7 ) {
+      const size_t checkedSize = offsetof( LukdFileHeader, headerChecksum );
+      return ( MemFileRead( dataFile, &header->totalKeys, 
+         sizeof( *header ) - commonSize ) == sizeof( *header ) - commonSize &&
+         Crc32cUpdate( CRC32C_INITIAL, dataFile->data, checkedSize ) ==
+            header->headerChecksum );
+   }
 
-      /* Write record body: */
-      MemFileAdd( outFile, record->key->value, record->key->length );
-      MemFileAdd( outFile, record->value->value, record->value->length );
+   if ( header->version == 6 ) {
+      const size_t headerSize = offsetof( LukdFileHeader, 
+         directoryChecksum );
+      return ( MemFileRead( dataFile, &header->totalKeys, 
+         headerSize - commonSize ) == headerSize - commonSize );
+   }
 
-      record = record->nextRecord;
-      recordsExported += 1;
+   /* Files before version 5 have no key table, and their header ends
+      with the main table offset. */
+   oldHeaderSize = ( header->version >= 5 ) ? sizeof( oldHeader ) : 
+      offsetof( LukdFileHeader32, firstKey );
+   memset( &oldHeader, 0, sizeof( oldHeader ) );
+   MemFileRewind( dataFile );
+   if ( MemFileRead( dataFile, &oldHeader, oldHeaderSize ) != 
+      oldHeaderSize ) {
+      return FALSE;
    }
 
-   return recordsExported;
+   header->mainTableOffset = oldHeader.mainTableOffset;
+   header->firstKey = oldHeader.firstKey;
+   header->totalKeys = oldHeader.totalKeys;
+   return TRUE;
 }
 
-void LukdExportMainTable( MemFile *outFile, unsigned int totalMapEntries, 
-   unsigned int firstMapEntry ) {
-   LukdMainTable mainTable;
+Bool LukdReadMainTable( MemFile *dataFile, unsigned int version,
+   LukdMainTable *table ) {
+   LukdMainTable32 oldTable;
 
-   mainTable.totalMapEntries = totalMapEntries;
-   mainTable.firstMapEntry = firstMapEntry;
-   mainTable.publishDate = ( unsigned int ) time( NULL );
+   if ( version >= 6 ) {
+      return ( MemFileRead( dataFile, table, sizeof( *table ) ) == 
+         sizeof( *table ) );
+   }
+
+   if ( MemFileRead( dataFile, &oldTable, sizeof( oldTable ) ) != 
+      sizeof( oldTable ) ) {
+      return FALSE;
+   }
+
+   table->totalMapEntries = oldTable.totalMapEntries;
+   table->publishDate = oldTable.publishDate;
+   table->firstMapEntry = oldTable.firstMapEntry;
+   return TRUE;
+}
+
+Bool LukdReadMapEntry( MemFile *dataFile, unsigned int version,
+   LukdMapEntry *entry ) {
+   return ( MemFileRead( dataFile, entry->name, LUKD_MAX_MAP_LENGTH ) == 
+      LUKD_MAX_MAP_LENGTH && 
+      LukdReadSeries( dataFile, version, &entry->records ) );
+}
+
+Bool LukdReadPlayerEntry( MemFile *dataFile, unsigned int version,
+   LukdPlayerEntry *entry ) {
+   const size_t entryStartSize = ( version >= 6 ) ? 
+      offsetof( LukdPlayerEntry, records ) : 
+      offsetof( LukdPlayerEntry, unused );
+
+   memset( entry, 0, sizeof( *entry ) );
+   return ( MemFileRead( dataFile, entry, entryStartSize ) == 
+      entryStartSize && 
+      LukdReadSeries( dataFile, version, &entry->records ) );
+}
+
+/* The series of older files are shorter. The fields they leave out are
+   set to 0. */
+Bool LukdReadSeries( MemFile *dataFile, unsigned int version,
+   LukdRecordSeries *series ) {
+   const size_t seriesSize = LukdGetSeriesSize( version );
+   LukdRecordSeries32 oldSeries;
+
+   memset( series, 0, sizeof( *series ) );
+   if ( version >= 6 ) {
+      return ( MemFileRead( dataFile, series, seriesSize ) == seriesSize );
+   }
+
+   memset( &oldSeries, 0, sizeof( oldSeries ) );
+   if ( MemFileRead( dataFile, &oldSeries, seriesSize ) != seriesSize ) {
+      return FALSE;
+   }
+
+   series->firstRecord = oldSeries.firstRecord;
+   series->firstIndexSlot = oldSeries.firstIndexSlot;
+   series->firstFilterByte = oldSeries.firstFilterByte;
+   series->firstBlock = oldSeries.firstBlock;
+   series->totalRecords = oldSeries.totalRecords;
+   series->totalIndexSlots = oldSeries.totalIndexSlots;
+   series->filterSize = oldSeries.filterSize;
+   series->flags = oldSeries.flags;
+   series->totalBlocks = oldSeries.totalBlocks;
+   return TRUE;
+}
+
+size_t LukdGetSeriesSize( unsigned int version ) {
+   switch ( version ) {
+      case 1:
+         return offsetof( LukdRecordSeries32, firstIndexSlot );
+      case 2:
+         return offsetof( LukdRecordSeries32, firstFilterByte );
+      case 3:
+         return offsetof( LukdRecordSeries32, flags );
+      case 4:
+      case 5:
+         return sizeof( LukdRecordSeries32 );
+      case 6:
+         return offsetof( LukdRecordSeries, size );
+      default:
+         return sizeof( LukdRecordSeries );
+   }
+}
+
+size_t LukdGetMapEntrySize( unsigned int version ) {
+   return LUKD_MAX_MAP_LENGTH + LukdGetSeriesSize( version );
+}
+
+/* The section takes over the copy of the filter. */
+void LukdSetSectionSeries( DatabaseFileSection *section,
+   const LukdRecordSeries *series, Byte *filter ) {
+   if ( section == NULL ) {
+      free( ( void * ) filter );
+      return;
+   }
+
+   section->firstIndexSlot = ( size_t ) series->firstIndexSlot;
+   section->totalIndexSlots = series->totalIndexSlots;
+   section->isCompressed = ( ( series->flags & LUKD_SERIES_COMPRESSED ) != 0 );
+   section->firstBlock = ( size_t ) series->firstBlock;
+   section->totalBlocks = series->totalBlocks;
+   section->size = ( size_t ) series->size;
+   section->checksum = series->checksum;
+   section->firstFilterByte = ( size_t ) series->firstFilterByte;
+   section->filterSize = series->filterSize;
+
+   if ( filter != NULL ) {
+      section->filter = filter;
+   }
+}
+
+/* The filter is copied out of the file, so checking it never has to wait
+   for the file to be read in. A series without a filter, or whose filter
+   can't be copied, is looked up without one. */
+Byte *LukdCopyFilter( const MemFile *dataFile, 
+   const LukdRecordSeries *series ) {
+   Byte *filter;
+
+   if ( series->filterSize == 0 ) {
+      return NULL;
+   }
+
+   filter = ( Byte * ) malloc( series->filterSize );
+   if ( filter != NULL ) {
+      memcpy( filter, dataFile->data + series->firstFilterByte, 
+         series->filterSize );
+   }
+
+   return filter;
+}
+
+/* Sets up a section for the records of an entry of a file that is read on
+   its own. The section borrows the player of the entry, and has no 
+   filter. */
+void LukdInitEntrySection( DatabaseFileSection *section,
+   const LukdDirectoryEntry *entry ) {
+   memset( section, 0, sizeof( *section ) );
+   section->player = entry->player;
+   section->firstRecord = ( size_t ) entry->series.firstRecord;
+   section->totalRecords = entry->series.totalRecords;
+   LukdSetSectionSeries( section, &entry->series, NULL );
+}
+
+Bool LukdImportRecords( const LukdSource *source, MemFile *dataFile, 
+   size_t firstRecord, unsigned int recordCount, DatabaseMapEntry *dbEntry,
+   const Str *player, int *totalRecords ) {
+   const LukdKeyTable *keys = LukdGetSourceKeys( source );
+   LukdRecord record;
+   unsigned int recordNum;
+   Str *expiryPrefix = StrNew( LUKD_EXPIRY_KEY_PREFIX );
+
+   /* Move to the first record in the record series of the entry. */
+   MemFileSetPosition( dataFile, firstRecord );
+
+   for ( recordNum = 0; recordNum < recordCount; recordNum += 1 ) {
+      /* The key and the value are read where they are. The database makes
+         its own copies of them. */
+      if ( LukdReadRecord( dataFile, keys, &record ) ) {
+         /* Expiry records apply to the temporary record that was loaded
+            right before them. */
+         if ( StrHasPrefix( &record.key, expiryPrefix ) ) {
+            Str *recordKey = StrSub( &record.key, expiryPrefix->length, 0 );
+            DatabaseLoadExpiry( dbEntry, player, recordKey, 
+               LukdReadExpiry( &record.value ) );
+            StrDel( recordKey );
+         }
+         /* Load the record into the database: */
+         else {
+            DatabaseLoadRecord( dbEntry, player, &record.key, 
+               &record.value );
+            *totalRecords += 1;
+         }
+      }
+      /* Finish processing the records if we find an invalid
+         record. */
+      else {
+         PrintWarning( "Malformed record found in database file\n" );
+         StrDel( expiryPrefix );
+         return FALSE;
+      }
+   }
+
+   StrDel( expiryPrefix );
+   return TRUE;
+}
+
+/* The records of each block are imported from a view of the decompressed
+   block. */
+Bool LukdImportBlocks( const LukdSource *source, const MemFile *dataFile, 
+   const DatabaseFileSection *section, DatabaseMapEntry *dbEntry, 
+   int *totalRecords ) {
+   unsigned int blockNum;
+
+   for ( blockNum = 0; blockNum < section->totalBlocks; blockNum += 1 ) {
+      LukdBlock block;
+      MemFile blockFile;
+      Bool isImported;
+      Byte *records = LukdReadBlock( source, dataFile, section, blockNum, 
+         &block );
+      if ( records == NULL ) {
+         PrintWarning( "Corrupt block of records found in database file\n" );
+         return FALSE;
+      }
+
+      MemFileInitView( &blockFile, records, block.size );
+      isImported = LukdImportRecords( source, &blockFile, 0, 
+         block.totalRecords, dbEntry, section->player, totalRecords );
+      free( ( void * ) records );
+
+      if ( ! isImported ) {
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+/* Returns the records of a block in a buffer of their own, which the 
+   caller frees, or NULL if the block can't be decompressed. */
+Byte *LukdReadBlock( const LukdSource *source, const MemFile *dataFile, 
+   const DatabaseFileSection *section, unsigned int blockNum, 
+   LukdBlock *block ) {
+   Byte *records;
+
+   LukdGetBlock( source, dataFile, section->firstBlock, blockNum, block );
+
+   records = ( Byte * ) malloc( block->size );
+   if ( records == NULL ) {
+      return NULL;
+   }
+
+   /* Blocks that didn't get any smaller were stored as they are. */
+   if ( block->dataSize == block->size ) {
+      memcpy( records, dataFile->data + block->dataOffset, block->size );
+   }
+   else if ( ! LzBlockDecompress( dataFile->data + block->dataOffset, 
+      block->dataSize, records, block->size ) ) {
+      free( ( void * ) records );
+      return NULL;
+   }
+
+   return records;
+}
+
+/* The blocks and the index slots of files before version 6 are widened as
+   they're read. */
+void LukdGetBlock( const LukdSource *source, const MemFile *dataFile, 
+   size_t firstBlock, unsigned int blockNum, LukdBlock *block ) {
+   LukdBlock32 oldBlock;
+
+   if ( source->version >= 6 ) {
+      memcpy( block, dataFile->data + firstBlock + 
+         blockNum * sizeof( *block ), sizeof( *block ) );
+      return;
+   }
+
+   memcpy( &oldBlock, dataFile->data + firstBlock + 
+      blockNum * sizeof( oldBlock ), sizeof( oldBlock ) );
+   block->firstByte = oldBlock.firstByte;
+   block->dataOffset = oldBlock.dataOffset;
+   block->size = oldBlock.size;
+   block->dataSize = oldBlock.dataSize;
+   block->totalRecords = oldBlock.totalRecords;
+   block->unused = 0;
+}
+
+void LukdGetIndexSlot( const LukdSource *source, const MemFile *dataFile, 
+   size_t firstIndexSlot, unsigned int slotNum, LukdIndexSlot *slot ) {
+   LukdIndexSlot32 oldSlot;
+
+   if ( source->version >= 6 ) {
+      memcpy( slot, dataFile->data + firstIndexSlot + 
+         slotNum * sizeof( *slot ), sizeof( *slot ) );
+      return;
+   }
+
+   memcpy( &oldSlot, dataFile->data + firstIndexSlot + 
+      slotNum * sizeof( oldSlot ), sizeof( oldSlot ) );
+   slot->hash = oldSlot.hash;
+   slot->unused = 0;
+   slot->record = oldSlot.record;
+}
+
+/* The keys of the key table are in the order of their numbers. Each key
+   is its size, as a varint, followed by the key itself. */
+Bool LukdImportKeyTable( LukdSource *source, MemFile *dataFile, 
+   const LukdFileHeader *header ) {
+   const size_t dataFileSize = MemFileGetSize( dataFile );
+   unsigned int keyNum;
+
+   if ( header->firstKey > dataFileSize || 
+      header->totalKeys > dataFileSize - header->firstKey ) {
+      return FALSE;
+   }
+
+   MemFileSetPosition( dataFile, ( size_t ) header->firstKey );
+   source->hasKeys = TRUE;
+
+   for ( keyNum = 0; keyNum < header->totalKeys; keyNum += 1 ) {
+      unsigned int keySize;
+      Str key;
+
+      if ( ! LukdReadVarint( dataFile, &keySize ) || 
+         keySize > dataFileSize - MemFileGetPosition( dataFile ) ) {
+         return FALSE;
+      }
+
+      key.length = keySize;
+      key.value = ( char * ) dataFile->data + MemFileGetPosition( dataFile );
+
+      /* A key that is in the table twice would get the number of its 
+         first copy. */
+      if ( LukdAddKey( &source->keys, &key ) != keyNum ) {
+         return FALSE;
+      }
+
+      MemFileSetPosition( dataFile, MemFileGetPosition( dataFile ) + 
+         keySize );
+   }
+
+   return TRUE;
+}
+
+/* Calls the handler for every record of a section, after checking that 
+   the records aren't damaged. Compressed records are read from their 
+   decompressed blocks. */
+Bool LukdReadSectionRecords( const LukdSource *source, MemFile *dataFile, 
+   DatabaseFileSection *section, LukdRecordHandler handler, 
+   void *context ) {
+   if ( ! LukdIsIntactSection( dataFile, section ) ) {
+      return FALSE;
+   }
+
+   if ( section->isCompressed ) {
+      unsigned int blockNum;
+
+      for ( blockNum = 0; blockNum < section->totalBlocks; blockNum += 1 ) {
+         LukdBlock block;
+         MemFile blockFile;
+         Bool isRead;
+         Byte *records = LukdReadBlock( source, dataFile, section, 
+            blockNum, &block );
+         if ( records == NULL ) {
+            PrintWarning( 
+               "Corrupt block of records found in database file\n" );
+            return FALSE;
+         }
+
+         MemFileInitView( &blockFile, records, block.size );
+         isRead = LukdReadSeriesRecords( source, &blockFile, 0, 
+            block.totalRecords, handler, context );
+         free( ( void * ) records );
+
+         if ( ! isRead ) {
+            return FALSE;
+         }
+      }
+
+      return TRUE;
+   }
+
+   return LukdReadSeriesRecords( source, dataFile, section->firstRecord,
+      section->totalRecords, handler, context );
+}
+
+Bool LukdReadSeriesRecords( const LukdSource *source, MemFile *file,
+   size_t firstRecord, unsigned int recordCount, LukdRecordHandler handler,
+   void *context ) {
+   const LukdKeyTable *keys = LukdGetSourceKeys( source );
+   LukdRecord record;
+   unsigned int recordNum;
+
+   MemFileSetPosition( file, firstRecord );
+   for ( recordNum = 0; recordNum < recordCount; recordNum += 1 ) {
+      if ( ! LukdReadRecord( file, keys, &record ) ) {
+         PrintWarning( "Malformed record found in database file\n" );
+         return FALSE;
+      }
+
+      handler( context, &record.key, &record.value );
+   }
+
+   return TRUE;
+}
+
+/* Reads the record at the current position of the file, leaving the file
+   at the next record. Files without a key table, whose records have their
+   key in them, are read with no key table. Returns false on a malformed 
+   record. */
+Bool LukdReadRecord( MemFile *file, const LukdKeyTable *keys, 
+   LukdRecord *record ) {
+   if ( keys == NULL ) {
+      LukdRecordHeader recordHeader;
+
+      if ( MemFileRead( file, &recordHeader, sizeof( recordHeader ) ) != 
+         sizeof( recordHeader ) || 
+         ! LukdIsValidRecordHeader( &recordHeader, file ) ) {
+         return FALSE;
+      }
+
+      record->keyId = LUKD_NO_KEY;
+      record->key.length = recordHeader.keySize;
+      record->key.value = ( char * ) file->data + MemFileGetPosition( file );
+      record->value.length = recordHeader.valueSize;
+      record->value.value = record->key.value + recordHeader.keySize;
+   }
+   else {
+      if ( ! LukdReadVarint( file, &record->keyId ) || 
+         record->keyId >= keys->totalKeys ||
+         ! LukdReadVarint( file, &record->value.length ) ||
+         record->value.length > 
+            MemFileGetSize( file ) - MemFileGetPosition( file ) ) {
+         return FALSE;
+      }
+
+      record->key = *keys->keys[ record->keyId ];
+      record->value.value = ( char * ) file->data + 
+         MemFileGetPosition( file );
+   }
+
+   MemFileSetPosition( file, ( Byte * ) record->value.value - file->data + 
+      record->value.length );
+   return TRUE;
+}
+
+/* Varints hold 7 bits in each byte, lowest bits first. The high bit of a
+   byte is set when more bytes follow. */
+Bool LukdReadVarint( MemFile *file, unsigned int *value ) {
+   int byteNum;
+
+   *value = 0;
+   for ( byteNum = 0; byteNum < LUKD_VARINT_MAX_SIZE; byteNum += 1 ) {
+      Byte byte;
+      if ( MemFileRead( file, &byte, 1 ) != 1 ) {
+         return FALSE;
+      }
+
+      *value |= ( unsigned int ) ( byte & 0x7F ) << ( byteNum * 7 );
+      if ( ( byte & 0x80 ) == 0 ) {
+         return TRUE;
+      }
+   }
+
+   return FALSE;
+}
+
+/* The expiry time is kept in decimal digits, which aren't followed by a
+   null character in the file. */
+time_t LukdReadExpiry( const Str *value ) {
+   char digits[ 24 ];
+   const size_t length = ( value->length < sizeof( digits ) ) ?
+      value->length : sizeof( digits ) - 1;
+
+   memcpy( digits, value->value, length );
+   digits[ length ] = '\0';
+   return ( time_t ) atol( digits );
+}
+
+/* Key table functions */
+
+void LukdInitKeyTable( LukdKeyTable *table ) {
+   table->keys = NULL;
+   table->totalKeys = 0;
+   table->keysAllocated = 0;
+   table->slots = NULL;
+   table->totalSlots = 0;
+}
+
+/* Returns the number of the key, which is added to the table if it isn't
+   there yet, or LUKD_NO_KEY if there's no memory to add it. */
+unsigned int LukdAddKey( LukdKeyTable *table, const Str *key ) {
+   unsigned int keyId = LukdFindKey( table, key );
+   Str *newKey;
+
+   if ( keyId != LUKD_NO_KEY ) {
+      return keyId;
+   }
+
+   /* At least half of the slots are kept empty, like in the index. */
+   if ( ( table->totalKeys + 1 ) * 2 > table->totalSlots &&
+      ! LukdGrowKeySlots( table ) ) {
+      return LUKD_NO_KEY;
+   }
+
+   if ( table->totalKeys == table->keysAllocated ) {
+      const unsigned int keysAllocated = ( table->keysAllocated > 0 ) ?
+         table->keysAllocated * 2 : 16;
+      Str **keys = ( Str ** ) realloc( table->keys, 
+         keysAllocated * sizeof( Str * ) );
+      if ( keys == NULL ) {
+         return LUKD_NO_KEY;
+      }
+
+      table->keys = keys;
+      table->keysAllocated = keysAllocated;
+   }
+
+   newKey = StrNewEmpty( key->length );
+   if ( newKey == NULL ) {
+      return LUKD_NO_KEY;
+   }
+   memcpy( newKey->value, key->value, key->length );
+
+   keyId = table->totalKeys;
+   table->keys[ keyId ] = newKey;
+   table->totalKeys += 1;
+   LukdPlaceKey( table, keyId );
+
+   return keyId;
+}
+
+unsigned int LukdFindKey( const LukdKeyTable *table, const Str *key ) {
+   unsigned int slotMask;
+   unsigned int slotNum;
+
+   if ( table->totalSlots == 0 ) {
+      return LUKD_NO_KEY;
+   }
+
+   slotMask = table->totalSlots - 1;
+   slotNum = StrHash( key ) & slotMask;
+   while ( table->slots[ slotNum ] != 0 ) {
+      /* The key may point into a file, so it may not end with a null
+         character. */
+      const unsigned int keyId = table->slots[ slotNum ] - 1;
+      const Str *tableKey = table->keys[ keyId ];
+      if ( tableKey->length == key->length && 
+         memcmp( tableKey->value, key->value, key->length ) == 0 ) {
+         return keyId;
+      }
+
+      slotNum = ( slotNum + 1 ) & slotMask;
+   }
+
+   return LUKD_NO_KEY;
+}
+
+Bool LukdGrowKeySlots( LukdKeyTable *table ) {
+   const unsigned int totalSlots = ( table->totalSlots > 0 ) ? 
+      table->totalSlots * 2 : 32;
+   unsigned int *slots = ( unsigned int * ) calloc( totalSlots, 
+      sizeof( unsigned int ) );
+   unsigned int keyId;
+
+   if ( slots == NULL ) {
+      return FALSE;
+   }
+
+   free( ( void * ) table->slots );
+   table->slots = slots;
+   table->totalSlots = totalSlots;
+
+   for ( keyId = 0; keyId < table->totalKeys; keyId += 1 ) {
+      LukdPlaceKey( table, keyId );
+   }
+
+   return TRUE;
+}
+
+void LukdPlaceKey( LukdKeyTable *table, unsigned int keyId ) {
+   const unsigned int slotMask = table->totalSlots - 1;
+   unsigned int slotNum = StrHash( table->keys[ keyId ] ) & slotMask;
+
+   while ( table->slots[ slotNum ] != 0 ) {
+      slotNum = ( slotNum + 1 ) & slotMask;
+   }
+
+   table->slots[ slotNum ] = keyId + 1;
+}
+
+void LukdDestroyKeyTable( LukdKeyTable *table ) {
+   unsigned int keyId;
+
+   for ( keyId = 0; keyId < table->totalKeys; keyId += 1 ) {
+      StrDel( table->keys[ keyId ] );
+   }
+
+   free( ( void * ) table->keys );
+   free( ( void * ) table->slots );
+   LukdInitKeyTable( table );
+}
+
+/* Records of files without a key table are read with no key table. */
+const LukdKeyTable *LukdGetSourceKeys( const LukdSource *source ) {
+   return ( source->hasKeys ? &source->keys : NULL );
+}
+
+/* Validation functions */
+
+/* The checks are made on the sizes left in the file, so nothing can wrap
+   around. */
+Bool LukdIsValidMainTableOffset( LukdOffset offset, size_t tableSize,
+   const size_t fileSize ) {
+   return ( tableSize <= fileSize && offset <= fileSize - tableSize );
+}
+
+Bool LukdIsValidMainTable( const LukdMainTable *table, size_t entrySize,
+   const size_t fileSize ) {
+   /* We only validate the other fields if there are actually map entries
+      present in the file. */
+   if ( table->totalMapEntries > 0 ) {
+      /* Make sure that the first map entry is not off limits. */
+      if ( entrySize > fileSize ||
+         table->firstMapEntry < sizeof( LukdMainTable32 ) ||
+         table->firstMapEntry > fileSize - entrySize ) {
+         PrintWarning( "First map entry is NOT within valid limits\n" );
+         return FALSE;
+      }
+
+      /* Make sure the total map entries given is enough to fit in the
+         target file. */
+      if ( table->totalMapEntries > 
+         ( fileSize - table->firstMapEntry ) / entrySize ) {
+         PrintWarning( "Total size of entries is too big for given file\n" );
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+Bool LukdIsValidSeries( const LukdSource *source, 
+   const LukdRecordSeries *series, const MemFile *dataFile ) {
+   const size_t fileSize = MemFileGetSize( dataFile );
+   return ( LukdIsValidRecordSeries( series->firstRecord, 
+      series->totalRecords, fileSize ) && 
+      ( series->size == 0 || ( series->firstRecord <= fileSize && 
+         series->size <= fileSize - series->firstRecord ) ) &&
+      LukdIsValidIndex( source, series->firstIndexSlot, 
+         series->totalIndexSlots, fileSize ) &&
+      LukdIsValidFilter( series->firstFilterByte, series->filterSize, 
+         fileSize ) &&
+      LukdIsValidBlocks( source, series, dataFile ) );
+}
+
+Bool LukdIsValidRecordSeries( LukdOffset firstRecord, 
+   unsigned int recordCount, const size_t fileSize ) {
+   if ( recordCount > 0 ) {
+      /* Make sure the start of the first record is not off limits. */
+      if ( fileSize < sizeof( LukdRecordHeader ) ||
+         firstRecord < sizeof( LukdMainTableOffset ) ||
+         firstRecord > fileSize - sizeof( LukdRecordHeader ) ) {
+         return FALSE;
+      }
+
+      /* Make sure the total records is not beyond the file size. 
+         FIXME: This is bad and needs improving. */
+      if ( recordCount >= fileSize ) {
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+Bool LukdIsValidRecordHeader( const LukdRecordHeader *header, 
+   const MemFile *file ) {
+   /* Find the maximum size of a record based on the current position
+      of the file. Then compare this value with the current record 
+      information to see if it fits within the current limit. The records
+      of a compressed block are read from the block alone, so nothing can
+      be assumed to follow them. */
+   const size_t currentMaxRecordBodySize = MemFileGetSize( file ) - 
+      MemFileGetPosition( file );
+   return ( ( size_t ) header->keySize <= currentMaxRecordBodySize &&
+      ( size_t ) header->valueSize <= 
+         currentMaxRecordBodySize - header->keySize );
+}
+
+Bool LukdIsValidIndex( const LukdSource *source, LukdOffset firstIndexSlot, 
+   unsigned int totalIndexSlots, const size_t fileSize ) {
+   const size_t slotSize = ( source->version >= 6 ) ? 
+      sizeof( LukdIndexSlot ) : sizeof( LukdIndexSlot32 );
+
+   if ( totalIndexSlots > 0 ) {
+      /* The number of slots is a power of two, so the hash of a key can be
+         masked to find its slot. */
+      if ( ( totalIndexSlots & ( totalIndexSlots - 1 ) ) != 0 ) {
+         return FALSE;
+      }
+
+      if ( firstIndexSlot < sizeof( LukdFileHeader32 ) || 
+         firstIndexSlot > fileSize ||
+         totalIndexSlots > ( fileSize - firstIndexSlot ) / slotSize ) {
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+Bool LukdIsValidFilter( LukdOffset firstFilterByte, 
+   unsigned int filterSize, const size_t fileSize ) {
+   return ( filterSize == 0 || 
+      ( firstFilterByte >= sizeof( LukdFileHeader32 ) && 
+         firstFilterByte <= fileSize && 
+         filterSize <= fileSize - firstFilterByte ) );
+}
+
+/* The blocks of a series have to cover its records one after the other, 
+   so the block of a record can be found by binary search. */
+Bool LukdIsValidBlocks( const LukdSource *source, 
+   const LukdRecordSeries *series, const MemFile *dataFile ) {
+   const size_t fileSize = MemFileGetSize( dataFile );
+   const size_t blockSize = ( source->version >= 6 ) ? 
+      sizeof( LukdBlock ) : sizeof( LukdBlock32 );
+   LukdOffset nextByte = series->firstRecord;
+   unsigned int recordsLeft = series->totalRecords;
+   unsigned int blockNum;
+
+   if ( ( series->flags & LUKD_SERIES_COMPRESSED ) == 0 ) {
+      return TRUE;
+   }
+
+   if ( series->firstBlock < sizeof( LukdFileHeader32 ) || 
+      series->firstBlock > fileSize ||
+      series->totalBlocks > ( fileSize - series->firstBlock ) / 
+         blockSize ) {
+      return FALSE;
+   }
+
+   for ( blockNum = 0; blockNum < series->totalBlocks; blockNum += 1 ) {
+      LukdBlock block;
+
+      LukdGetBlock( source, dataFile, ( size_t ) series->firstBlock, 
+         blockNum, &block );
+      if ( block.firstByte != nextByte || block.size == 0 ||
+         block.size > ~( LukdOffset ) 0 - nextByte ||
+         block.totalRecords == 0 || block.totalRecords > recordsLeft ||
+         block.dataSize > block.size || block.dataOffset > fileSize || 
+         block.dataSize > fileSize - block.dataOffset ) {
+         return FALSE;
+      }
+
+      nextByte += block.size;
+      recordsLeft -= block.totalRecords;
+   }
+
+   return ( recordsLeft == 0 );
+}
+
+/* The directory takes up the end of the file, starting with the map 
+   entries, which come right before the main table. */
+Bool LukdIsIntactDirectory( const MemFile *dataFile, 
+   const LukdFileHeader *header, const LukdMainTable *table ) {
+   const size_t fileSize = MemFileGetSize( dataFile );
+
+   return ( table->firstMapEntry <= header->mainTableOffset &&
+      header->mainTableOffset <= fileSize &&
+      Crc32cUpdate( CRC32C_INITIAL, dataFile->data + table->firstMapEntry,
+         fileSize - ( size_t ) table->firstMapEntry ) == 
+         header->directoryChecksum );
+}
+
+/* The records of a section are checked the first time they're read, so
+   only the maps that are used are ever checked, and each of them once. */
+Bool LukdIsIntactSection( const MemFile *dataFile, 
+   DatabaseFileSection *section ) {
+   if ( section->isChecked || section->size == 0 ) {
+      return ! section->isDamaged;
+   }
+
+   /* The result is kept, so damaged records are only reported once. */
+   section->isChecked = TRUE;
+   if ( Crc32cUpdate( CRC32C_INITIAL, dataFile->data + section->firstRecord,
+      section->size ) != section->checksum ) {
+      section->isDamaged = TRUE;
+      PrintWarning( "Checksum mismatch in records at offset %lu of database "
+         "file\n", ( unsigned long ) section->firstRecord );
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+void LukdPrintFileInfo( const LukdMainTable *table, int totalRecords ) {
+   char publishDate[ LUKD_PUBLISH_DATE_MAX_LENGTH ];
+
+   time_t time = ( time_t ) table->publishDate;
+   struct tm *localTime = localtime( &time );
+
+   strftime( publishDate, LUKD_PUBLISH_DATE_MAX_LENGTH, 
+      LUKD_PUBLISH_DATE_FORMAT, localTime );
+
+   /* Print all the important information about the file to the user. */
+   PrintMessage( "Database file: \n" );
+   PrintMessage( "   - Published on: %s\n", publishDate );
+   PrintMessage( "   - Total map entries: %u\n", table->totalMapEntries ); 
+   PrintMessage( "   - Total records: %d\n", totalRecords ); 
+}
+
+Str *LukdMakeFilePath( const char *filePath, const char *extension ) {
+   Str *newFilePath = StrNewEmpty( strlen( filePath ) + strlen( extension ) );
+
+   if ( newFilePath != NULL ) {
+      sprintf( newFilePath->value, "%s%s", filePath, extension );
+   }
+
+   return newFilePath;
+}
+
+Str *LukdMakeMapName( const char *name ) {
+   /* Names of the full length are not terminated. */
+   const char *nameEnd = ( const char * ) memchr( name, '\0', 
+      LUKD_MAX_MAP_LENGTH );
+   const size_t nameLength = ( nameEnd != NULL ) ? 
+      ( size_t ) ( nameEnd - name ) : LUKD_MAX_MAP_LENGTH;
+   Str *mapName = StrNewEmpty( nameLength );
+
+   if ( mapName != NULL ) {
+      memcpy( mapName->value, name, nameLength );
+   }
+
+   return mapName;
+}
+
+/* Functions to write the database to file. */
+
+Bool LukdExportDatabase( const Database *database, const char *outFilePath ) {
+   int entriesExported;
+   int playersExported;
+   int errorCode;
+   Bool isExported;
+
+   /* The file is written out as it's put together, under a temporary name,
+      so the database file is never left half written and the whole file
+      never has to fit in memory. */
+   Str *tempFilePath = LukdMakeFilePath( outFilePath, LUKD_TEMP_EXT );
+   OutFile outFile;
+   MemFile entriesFile;
+   MemFile playersFile;
+
+   if ( tempFilePath == NULL ) {
+      return FALSE;
+   }
+
+   PrintMessage( "Saving database to path: %s\n", outFilePath );
+
+   if ( ! LukdStartExport( &outFile, tempFilePath, 
+      database->isFileCompressed ) ) {
+      StrDel( tempFilePath );
+      return FALSE;
+   }
+
+   MemFileInit( &entriesFile );
+   MemFileInit( &playersFile );
+   LukdSeedExportKeys();
+
+   /* Export the map entries and their records. */
+   entriesExported = LukdExportEntries( &outFile, database, &entriesFile,
+      &playersFile, &playersExported );
+   LukdExportDirectory( &outFile, &entriesFile, entriesExported, 
+      &playersFile, playersExported );
+
+   /* The records of the maps that are not loaded now point into the new 
+      file, so it replaces the file they're read from. */
+   isExported = LukdFinishExport( &outFile, tempFilePath, outFilePath,
+      database->totalBackups );
+   if ( isExported ) {
+      MapFileClose( &databaseSource.file );
+      errorCode = MapFileOpen( &databaseSource.file, outFilePath );
+      if ( errorCode < 0 ) {
+         PrintWarning( "Could not reopen database file at path: %s\n", 
+            outFilePath );
+      }
+   }
+
+   /* The map entries only switch over to the sections of the new file if
+      it was saved, and so do the keys. */
+   DatabaseCommitFileSections( isExported );
+   if ( isExported ) {
+      LukdDestroyKeyTable( &databaseSource.keys );
+      databaseSource.keys = exportKeys;
+      databaseSource.hasKeys = TRUE;
+      databaseSource.version = LUKD_VERSION;
+      LukdInitKeyTable( &exportKeys );
+   }
+   else {
+      LukdDestroyKeyTable( &exportKeys );
+   }
+
+   MemFileClose( &entriesFile );
+   MemFileClose( &playersFile );
+   StrDel( tempFilePath );
+   return isExported;
+}
+
+/* Opens the temporary file and makes room for the file header, which is 
+   written last. */
+Bool LukdStartExport( OutFile *outFile, const Str *tempFilePath,
+   Bool isCompressed ) {
+   LukdFileHeader header;
+   const int errorCode = OutFileOpen( outFile, tempFilePath->value );
+
+   if ( errorCode < 0 ) {
+      PrintWarning( "Could not write to file at path: %s\n", 
+         tempFilePath->value );
+      PrintMessage( "Reason for failure: %s\n", 
+         MemFileGetErrorCodeMessage( errorCode ) );
+      return FALSE;
+   }
+
+   isCompressing = isCompressed;
+   LukdInitKeyTable( &exportKeys );
+
+   LukdMakeFileHeader( &header, 0, 0, 0 );
+   OutFileAdd( outFile, &header, sizeof( header ) );
+   return TRUE;
+}
+
+/* Adds the directory after all the records, and then fills in the file
+   header. */
+void LukdExportDirectory( OutFile *outFile, MemFile *entriesFile,
+   int entriesExported, MemFile *playersFile, int playersExported ) {
+   /* The main table needs the start of the map entries, where the 
+      directory, which is checked as a whole, starts. */
+   const LukdOffset firstMapEntry = OutFileGetPosition( outFile );
+   LukdOffset mainTableOffset;
+   LukdOffset firstKey;
+   LukdFileHeader header;
+
+   OutFileResetChecksum( outFile );
+   OutFileAddMemFile( outFile, entriesFile );
+
+   /* The main table follows the map entries, and its offset goes in the
+      file header. */
+   mainTableOffset = OutFileGetPosition( outFile );
+   LukdExportMainTable( outFile, entriesExported, firstMapEntry );
+
+   /* The player entries go after the main table, so older versions of luk
+      can still read the file. */
+   if ( playersExported > 0 ) {
+      LukdExportPlayerTable( outFile, playersFile, playersExported );
+   }
+
+   /* The keys of all the records were collected as the records were
+      exported, so the key table goes last. */
+   firstKey = OutFileGetPosition( outFile );
+   LukdExportKeyTable( outFile );
+
+   /* Now record the main table offset. */
+   LukdMakeFileHeader( &header, mainTableOffset, firstKey, 
+      OutFileGetChecksum( outFile ) );
+   OutFileWriteAt( outFile, 0, &header, sizeof( header ) );
+}
+
+Bool LukdFinishExport( OutFile *outFile, const Str *tempFilePath,
+   const char *outFilePath, unsigned int totalBackups ) {
+   int errorCode;
+
+   /* The new file has to be on the disk before it takes the place of the
+      old one, or a crash could leave neither of them. */
+   OutFileSync( outFile );
+   errorCode = OutFileClose( outFile );
+   if ( errorCode < 0 ) {
+      PrintWarning( "Could not write to file at path: %s\n", 
+         tempFilePath->value );
+      PrintMessage( "Reason for failure: %s\n", 
+         MemFileGetErrorCodeMessage( errorCode ) );
+      remove( tempFilePath->value );
+      return FALSE;
+   }
+
+   return LukdReplaceFile( tempFilePath->value, outFilePath, totalBackups );
+}
+
+/* The map entries are collected in a separate memory file, and written
+   after all the records. */
+int LukdExportEntries( OutFile *outFile, const Database *database,
+   MemFile *entriesFile, MemFile *playersFile, int *playersExported ) {   
+   LukdMapEntry lukdEntry;
+   DatabaseMapEntry *dbEntry = database->firstMap;
+
+   int entriesExported = 0;
+   int recordsExported;
+   time_t nextExpiry;
+
+   /* The records of each map are put together on their own first, so they
+      can be compressed before they go into the output file. */
+   MemFile recordsFile;
+
+   *playersExported = 0;
+   while ( dbEntry != NULL ) {
+      /* The records of maps that were never loaded are copied over from
+         the database file without loading them. */
+      if ( ! dbEntry->isLoaded ) {
+         entriesExported += LukdExportFileSections( outFile, entriesFile,
+            playersFile, dbEntry, playersExported );
+         dbEntry = dbEntry->nextEntry;
+         continue;
+      }
+
+      MemFileInit( &recordsFile );
+      recordsExported = LukdExportRecords( &recordsFile, &dbEntry->records,
+         &nextExpiry );
+
+      /* Only add a map entry if it has any records. No point in storing
+         an empty map entry. */
+      if ( recordsExported > 0 ) {
+         Byte *filter;
+
+         memset( lukdEntry.name, 0, LUKD_MAX_MAP_LENGTH );
+         memcpy( lukdEntry.name, dbEntry->name->value, dbEntry->name->length );
+
+         filter = LukdExportSeries( outFile, &recordsFile, recordsExported,
+            &lukdEntry.records );
+
+         MemFileAdd( entriesFile, &lukdEntry, sizeof( lukdEntry ) );
+         entriesExported += 1;
+
+         LukdAddSavedSection( dbEntry, NULL, &lukdEntry.records, filter,
+            nextExpiry );
+      }
+      MemFileClose( &recordsFile );
+
+      /* The records of each player follow the records of the map. */
+      *playersExported += LukdExportPlayers( outFile, playersFile, dbEntry );
+
+      /* Damaged records that couldn't be loaded are kept as well. */
+      entriesExported += LukdExportFileSections( outFile, entriesFile,
+         playersFile, dbEntry, playersExported );
+
+      dbEntry = dbEntry->nextEntry;
+   }
+
+   return entriesExported;
+}
+
+int LukdExportPlayers( OutFile *outFile, MemFile *playersFile,
+   DatabaseMapEntry *dbEntry ) {
+   const DatabasePlayerEntry *player = dbEntry->firstPlayer;
+   int playersExported = 0;
+
+   while ( player != NULL ) {
+      LukdPlayerEntry lukdEntry;
+      MemFile recordsFile;
+      int recordsExported;
+      time_t nextExpiry;
+
+      MemFileInit( &recordsFile );
+      recordsExported = LukdExportRecords( &recordsFile, &player->records,
+         &nextExpiry );
+
+      if ( recordsExported > 0 ) {
+         Byte *filter;
+
+         memset( lukdEntry.map, 0, LUKD_MAX_MAP_LENGTH );
+         memcpy( lukdEntry.map, dbEntry->name->value, dbEntry->name->length );
+
+         lukdEntry.nameSize = player->name->length;
+         lukdEntry.unused = 0;
+         filter = LukdExportSeries( outFile, &recordsFile, recordsExported,
+            &lukdEntry.records );
+
+         MemFileAdd( playersFile, &lukdEntry, sizeof( lukdEntry ) );
+         MemFileAdd( playersFile, player->name->value, 
+            player->name->length );
+         playersExported += 1;
+
+         LukdAddSavedSection( dbEntry, player->name, &lukdEntry.records, 
+            filter, nextExpiry );
+      }
+      MemFileClose( &recordsFile );
+
+      player = player->nextEntry;
+   }
+
+   return playersExported;
+}
+
+/* Also finds out when the first of the temporary records expires. */
+int LukdExportRecords( MemFile *outFile, const DatabaseRecordStore *store,
+   time_t *nextExpiry ) {
+   int recordsExported = 0;
+   const time_t now = time( NULL );
+   const DatabaseRecordBlock *block = store->firstBlock;
+
+   *nextExpiry = 0;
+
+   while ( block != NULL ) {
+      unsigned int slot;
+
+      for ( slot = 0; slot < block->totalRecords; slot += 1 ) {
+         const DatabaseRecord *record = &block->records[ slot ];
+
+         /* Leave out the removed records, and the expired records that 
+            haven't been removed yet. */
+         if ( record->isUsed && ! DatabaseIsExpired( record, now ) ) {
+            recordsExported += LukdExportStoredRecord( outFile, record );
+
+            if ( record->expiresAt != 0 && ( *nextExpiry == 0 || 
+               record->expiresAt < *nextExpiry ) ) {
+               *nextExpiry = record->expiresAt;
+            }
+         }
+      }
+
+      block = block->nextBlock;
+   }
+
+   return recordsExported;
+}
+
+int LukdExportStoredRecord( MemFile *outFile, const DatabaseRecord *record ) {
+   LukdExportRecord( outFile, record->key->name, &record->value );
+
+   /* Follow a temporary record with its expiry time. */
+   if ( record->expiresAt != 0 ) {
+      char expiresAt[ 24 ];
+      Str *expiryKey = LukdMakeExpiryKey( record->key->name );
+      Str *expiryValue;
+
+      sprintf( expiresAt, "%ld", ( long ) record->expiresAt );
+      expiryValue = StrNew( expiresAt );
+
+      LukdExportRecord( outFile, expiryKey, expiryValue );
+
+      StrDel( expiryKey );
+      StrDel( expiryValue );
+      return 2;
+   }
+
+   return 1;
+}
+
+int LukdExportFileSections( OutFile *outFile, MemFile *entriesFile,
+   MemFile *playersFile, DatabaseMapEntry *dbEntry, int *playersExported ) {
+   DatabaseFileSection *section = dbEntry->fileSections;
+   int entriesExported = 0;
+   MemFile dataFile;
+   time_t now;
+
+   if ( ! MapFileIsOpen( &databaseSource.file ) ) {
+      return 0;
+   }
+
+   MemFileInitView( &dataFile, databaseSource.file.data, 
+      databaseSource.file.size );
+   now = time( NULL );
+
+   while ( section != NULL ) {
+      LukdRecordSeries series;
+      Byte *filter;
+      time_t nextExpiry;
+      Bool isDamaged;
+
+      /* The records of a loaded map are in memory, except for the damaged 
+         records of the current format, which couldn't be loaded. */
+      if ( dbEntry->isLoaded && ( ! section->isDamaged || 
+         databaseSource.version != LUKD_VERSION ) ) {
+         section = section->nextSection;
+         continue;
+      }
+
+      if ( LukdExportFileSection( outFile, &dataFile, dbEntry->name, section,
+         now, &series, &filter, &nextExpiry, &isDamaged ) ) {
+         DatabaseFileSection *savedSection;
+
+         LukdAddEntry( entriesFile, playersFile, dbEntry->name, 
+            section->player, &series );
+         if ( section->player != NULL ) {
+            *playersExported += 1;
+         }
+         else {
+            entriesExported += 1;
+         }
+
+         savedSection = LukdAddSavedSection( dbEntry, section->player, 
+            &series, filter, nextExpiry );
+
+         /* The copy of a damaged series is just as damaged, and is known
+            to be, so it isn't read again. */
+         if ( isDamaged && savedSection != NULL ) {
+            savedSection->isChecked = TRUE;
+            savedSection->isDamaged = TRUE;
+         }
+      }
+
+      section = section->nextSection;
+   }
+
+   return entriesExported;
+}
+
+/* The keys of the database file keep their numbers in the new file, so 
+   the records of the maps that aren't loaded can be copied over byte for
+   byte. New keys are added after them. Keys that no record uses anymore
+   stay in the table, until the file is merged with lukd-tool. */
+void LukdSeedExportKeys( void ) {
+   unsigned int keyId;
+
+   hasExpiryKeys = LukdHasExpiryKeys( &databaseSource.keys );
+   if ( ! databaseSource.hasKeys ) {
+      return;
+   }
+
+   for ( keyId = 0; keyId < databaseSource.keys.totalKeys; keyId += 1 ) {
+      LukdAddKey( &exportKeys, databaseSource.keys.keys[ keyId ] );
+   }
+}
+
+Bool LukdHasExpiryKeys( const LukdKeyTable *table ) {
+   const size_t prefixLength = sizeof( LUKD_EXPIRY_KEY_PREFIX ) - 1;
+   unsigned int keyId;
+
+   for ( keyId = 0; keyId < table->totalKeys; keyId += 1 ) {
+      const Str *key = table->keys[ keyId ];
+      if ( key->length > prefixLength && memcmp( key->value, 
+         LUKD_EXPIRY_KEY_PREFIX, prefixLength ) == 0 ) {
+         return TRUE;
+      }
+   }
+
+   return FALSE;
+}
+
+/* Writes the records of a section of a map that isn't loaded to the new 
+   file, copied as they are when that can be done, or read and written 
+   again otherwise. Returns false when no records were written. */
+Bool LukdExportFileSection( OutFile *outFile, MemFile *dataFile,
+   const Str *map, DatabaseFileSection *section, time_t now, 
+   LukdRecordSeries *series, Byte **filter, time_t *nextExpiry,
+   Bool *isDamaged ) {
+   MemFile recordsFile;
+   LukdRecordCopy copy;
+   Bool isRead;
+
+   *nextExpiry = 0;
+   *isDamaged = FALSE;
+   if ( section->totalRecords == 0 ) {
+      return FALSE;
+   }
+
+   /* A damaged series is copied as it is, with the checksum it came with,
+      so it's still found to be damaged, and the records that are left can
+      still be got at with lukd-tool. */
+   if ( ! LukdIsIntactSection( dataFile, section ) && 
+      databaseSource.version == LUKD_VERSION ) {
+      if ( ! LukdCopySeries( outFile, dataFile, section, series, filter ) ) {
+         PrintWarning( "Could not keep damaged records of map: %s\n",
+            map->value );
+         return FALSE;
+      }
+
+      PrintWarning( "Keeping damaged records of map as they are: %s\n",
+         map->value );
+      series->checksum = section->checksum;
+      *isDamaged = TRUE;
+      return TRUE;
+   }
+
+   if ( LukdCanCopySeries( dataFile, section, now ) && 
+      LukdCopySeries( outFile, dataFile, section, series, filter ) ) {
+      *nextExpiry = section->nextExpiry;
+      return TRUE;
+   }
+
+   MemFileInit( &recordsFile );
+   LukdInitRecordCopy( &copy, &recordsFile, now );
+
+   /* Records of files without checksums that turn out to be damaged are
+      saved as far as they could be read. */
+   isRead = LukdCopyRecords( &databaseSource, &copy, dataFile, section );
+   if ( ! isRead ) {
+      PrintWarning( "Saving only the records that could be read of damaged "
+         "map: %s\n", map->value );
+   }
+
+   if ( copy.totalRecords > 0 ) {
+      *filter = LukdExportSeries( outFile, &recordsFile, copy.totalRecords,
+         series );
+      *nextExpiry = copy.nextExpiry;
+   }
+
+   MemFileClose( &recordsFile );
+   return ( copy.totalRecords > 0 );
+}
+
+/* A series can be copied as it is when it's in the format of the new 
+   file, with the same compression, and none of its records have expired
+   since it was written. */
+Bool LukdCanCopySeries( MemFile *dataFile, DatabaseFileSection *section, 
+   time_t now ) {
+   if ( databaseSource.version != LUKD_VERSION || 
+      section->isCompressed != isCompressing ||
+      ! LukdIsIntactSection( dataFile, section ) ) {
+      return FALSE;
+   }
+
+   if ( ! section->isExpiryKnown ) {
+      LukdFindNextExpiry( dataFile, section );
+   }
+
+   return ( section->nextExpiry == 0 || section->nextExpiry > now );
+}
+
+/* The records of a section that was read from the file are looked through
+   once, the first time it's saved. After that, the expiry time goes from
+   section to section with each save. */
+void LukdFindNextExpiry( MemFile *dataFile, DatabaseFileSection *section ) {
+   section->nextExpiry = 0;
+   section->isExpiryKnown = TRUE;
+
+   if ( hasExpiryKeys ) {
+      LukdReadSectionRecords( &databaseSource, dataFile, section, 
+         LukdNoteExpiry, section );
+   }
+}
+
+void LukdNoteExpiry( void *context, const Str *key, const Str *value ) {
+   DatabaseFileSection *section = ( DatabaseFileSection * ) context;
+   const size_t prefixLength = sizeof( LUKD_EXPIRY_KEY_PREFIX ) - 1;
+
+   if ( key->length > prefixLength && 
+      memcmp( key->value, LUKD_EXPIRY_KEY_PREFIX, prefixLength ) == 0 ) {
+      const time_t expiresAt = LukdReadExpiry( value );
+      if ( section->nextExpiry == 0 || expiresAt < section->nextExpiry ) {
+         section->nextExpiry = expiresAt;
+      }
+   }
+}
+
+/* Copies the bytes of a series to the output file, with its blocks, its 
+   index and its filter. Only the positions in the block table and the
+   index change, by how far the series moved. The series was checked 
+   against its checksum before, so the new checksum doesn't vouch for bytes
+   that were damaged. Returns false if the series can't be copied. */
+Bool LukdCopySeries( OutFile *outFile, const MemFile *dataFile,
+   const DatabaseFileSection *section, LukdRecordSeries *series, 
+   Byte **filter ) {
+   const LukdOffset firstRecord = OutFileGetPosition( outFile );
+   /* Unsigned numbers wrap around, so this works for a series that moves
+      back as well. */
+   const LukdOffset shift = firstRecord - section->firstRecord;
+   Byte *data;
+
+   *filter = NULL;
+
+   /* The tables that get changed have to be part of the bytes that are
+      copied. */
+   if ( ! LukdIsInSection( section, section->firstBlock, 
+         section->totalBlocks * sizeof( LukdBlock ) ) ||
+      ! LukdIsInSection( section, section->firstIndexSlot,
+         section->totalIndexSlots * sizeof( LukdIndexSlot ) ) ||
+      ! LukdIsInSection( section, section->firstFilterByte, 
+         section->filterSize ) ) {
+      return FALSE;
+   }
+
+   data = ( Byte * ) malloc( section->size );
+   if ( data == NULL ) {
+      return FALSE;
+   }
+
+   if ( section->filter != NULL ) {
+      *filter = ( Byte * ) malloc( section->filterSize );
+      if ( *filter == NULL ) {
+         free( ( void * ) data );
+         return FALSE;
+      }
+
+      memcpy( *filter, section->filter, section->filterSize );
+   }
+
+   memcpy( data, dataFile->data + section->firstRecord, section->size );
+   LukdMoveBlocks( data, section, shift );
+   LukdMoveIndex( data, section, shift );
+
+   memset( series, 0, sizeof( *series ) );
+   series->firstRecord = firstRecord;
+   series->totalRecords = section->totalRecords;
+   if ( section->totalIndexSlots > 0 ) {
+      series->firstIndexSlot = section->firstIndexSlot + shift;
+      series->totalIndexSlots = section->totalIndexSlots;
+   }
+   if ( section->filterSize > 0 ) {
+      series->firstFilterByte = section->firstFilterByte + shift;
+      series->filterSize = section->filterSize;
+   }
+   if ( section->isCompressed ) {
+      series->flags |= LUKD_SERIES_COMPRESSED;
+      series->firstBlock = section->firstBlock + shift;
+      series->totalBlocks = section->totalBlocks;
+   }
+   series->size = section->size;
+
+   OutFileResetChecksum( outFile );
+   OutFileAdd( outFile, data, section->size );
+   series->checksum = OutFileGetChecksum( outFile );
+
+   free( ( void * ) data );
+   return TRUE;
+}
+
+/* Tables that are empty are always in the section. */
+Bool LukdIsInSection( const DatabaseFileSection *section, size_t firstByte,
+   size_t size ) {
+   return ( size == 0 || ( firstByte >= section->firstRecord && 
+      firstByte - section->firstRecord <= section->size &&
+      size <= section->size - ( firstByte - section->firstRecord ) ) );
+}
+
+/* The table entries aren't aligned in the data, so they're copied out 
+   and back in. */
+void LukdMoveBlocks( Byte *data, const DatabaseFileSection *section,
+   LukdOffset shift ) {
+   Byte *table = data + ( section->firstBlock - section->firstRecord );
+   unsigned int blockNum;
+
+   if ( ! section->isCompressed ) {
+      return;
+   }
+
+   for ( blockNum = 0; blockNum < section->totalBlocks; blockNum += 1 ) {
+      LukdBlock block;
+
+      memcpy( &block, table + blockNum * sizeof( block ), sizeof( block ) );
+      block.firstByte += shift;
+      block.dataOffset += shift;
+      memcpy( table + blockNum * sizeof( block ), &block, sizeof( block ) );
+   }
+}
+
+void LukdMoveIndex( Byte *data, const DatabaseFileSection *section,
+   LukdOffset shift ) {
+   Byte *table = data + ( section->firstIndexSlot - section->firstRecord );
+   unsigned int slotNum;
+
+   for ( slotNum = 0; slotNum < section->totalIndexSlots; slotNum += 1 ) {
+      LukdIndexSlot slot;
+
+      memcpy( &slot, table + slotNum * sizeof( slot ), sizeof( slot ) );
+      if ( slot.record != 0 ) {
+         slot.record += shift;
+         memcpy( table + slotNum * sizeof( slot ), &slot, sizeof( slot ) );
+      }
+   }
+}
+
+/* Adds a map entry for the series, or a player entry when the records 
+   belong to a player. */
+void LukdAddEntry( MemFile *entriesFile, MemFile *playersFile,
+   const Str *map, const Str *player, const LukdRecordSeries *series ) {
+   if ( player != NULL ) {
+      LukdPlayerEntry lukdEntry;
+
+      memset( lukdEntry.map, 0, LUKD_MAX_MAP_LENGTH );
+      memcpy( lukdEntry.map, map->value, map->length );
+      lukdEntry.nameSize = player->length;
+      lukdEntry.unused = 0;
+      lukdEntry.records = *series;
+
+      MemFileAdd( playersFile, &lukdEntry, sizeof( lukdEntry ) );
+      MemFileAdd( playersFile, player->value, player->length );
+   }
+   else {
+      LukdMapEntry lukdEntry;
+
+      memset( lukdEntry.name, 0, LUKD_MAX_MAP_LENGTH );
+      memcpy( lukdEntry.name, map->value, map->length );
+      lukdEntry.records = *series;
+
+      MemFileAdd( entriesFile, &lukdEntry, sizeof( lukdEntry ) );
+   }
+}
+
+void LukdInitRecordCopy( LukdRecordCopy *copy, MemFile *recordsFile,
+   time_t now ) {
+   copy->recordsFile = recordsFile;
+   copy->totalRecords = 0;
+   copy->now = now;
+   copy->lastRecord = 0;
+   copy->lastKeyId = LUKD_NO_KEY;
+   copy->nextExpiry = 0;
+}
+
+/* Records that fail their checksum aren't read, so they never get a good
+   checksum in the new file. Compressed records are copied over decompressed. They're 
+   compressed again if the export compresses records. This is how the 
+   series that can't be copied byte for byte are written again. */
+Bool LukdCopyRecords( const LukdSource *source, LukdRecordCopy *copy, 
+   MemFile *dataFile, DatabaseFileSection *section ) {
+   return LukdReadSectionRecords( source, dataFile, section, LukdCopyRecord,
+      copy );
+}
+
+/* The expiry record of a temporary record comes right after it. When the
+   record has expired, it's taken back out, and its expiry record is never
+   written. */
+void LukdCopyRecord( void *context, const Str *key, const Str *value ) {
+   LukdRecordCopy *copy = ( LukdRecordCopy * ) context;
+   const size_t recordPosition = MemFileGetSize( copy->recordsFile );
+   const Bool isExpiry = ( copy->lastKeyId != LUKD_NO_KEY && 
+      LukdIsExpiryKeyOf( key, exportKeys.keys[ copy->lastKeyId ] ) );
+   unsigned int keyId;
+
+   if ( isExpiry ) {
+      const time_t expiresAt = LukdReadExpiry( value );
+
+      if ( copy->now != 0 && expiresAt <= copy->now ) {
+         MemFileTruncate( copy->recordsFile, copy->lastRecord );
+         copy->totalRecords -= 1;
+         copy->lastKeyId = LUKD_NO_KEY;
+         return;
+      }
+
+      if ( copy->nextExpiry == 0 || expiresAt < copy->nextExpiry ) {
+         copy->nextExpiry = expiresAt;
+      }
+   }
+
+   keyId = LukdExportRecord( copy->recordsFile, key, value );
+   copy->totalRecords += 1;
+   copy->lastRecord = recordPosition;
+   /* An expiry record has no expiry record of its own. */
+   copy->lastKeyId = isExpiry ? LUKD_NO_KEY : keyId;
+}
+
+/* Remembers where the records went, so the map can be unloaded and read
+   back from the new file. The saved section takes over the filter. */
+DatabaseFileSection *LukdAddSavedSection( DatabaseMapEntry *dbEntry, 
+   const Str *player, const LukdRecordSeries *series, Byte *filter, 
+   time_t nextExpiry ) {
+   DatabaseFileSection *section = DatabaseAddSavedSection( dbEntry, player,
+      ( size_t ) series->firstRecord, series->totalRecords );
+
+   LukdSetSectionSeries( section, series, filter );
+   if ( section != NULL ) {
+      section->nextExpiry = nextExpiry;
+      section->isExpiryKnown = TRUE;
+   }
+
+   return section;
+}
+
+/* Adds a series of records to the output file, followed by its index and
+   its filter. The output file can't be read back, so the filter is also 
+   returned, for the caller to hand over to the saved section. */
+Byte *LukdExportSeries( OutFile *outFile, const MemFile *recordsFile,
+   unsigned int totalRecords, LukdRecordSeries *series ) {
+   Byte *filter;
+
+   memset( series, 0, sizeof( *series ) );
+   series->totalRecords = totalRecords;
+   series->firstRecord = OutFileGetPosition( outFile );
+   OutFileResetChecksum( outFile );
+
+   if ( isCompressing ) {
+      LukdExportBlocks( outFile, recordsFile, series );
+   }
+   else {
+      OutFileAddMemFile( outFile, recordsFile );
+   }
+
+   LukdExportIndex( outFile, recordsFile, series );
+   filter = LukdExportFilter( outFile, recordsFile, series );
+
+   series->size = OutFileGetPosition( outFile ) - series->firstRecord;
+   series->checksum = OutFileGetChecksum( outFile );
+   return filter;
+}
+
+/* Splits the records into blocks and compresses each block on its own. 
+   The compressed blocks are followed by the block table. */
+void LukdExportBlocks( OutFile *outFile, const MemFile *recordsFile,
+   LukdRecordSeries *series ) {
+   const size_t recordsSize = MemFileGetSize( recordsFile );
+   size_t blockStart = 0;
+   MemFile blocksFile;
+   MemFileInit( &blocksFile );
+
+   while ( blockStart < recordsSize ) {
+      LukdBlock block;
+      size_t blockEnd = blockStart;
+      size_t dataCapacity;
+      Byte *data;
+
+      /* Records never straddle two blocks. A record that is bigger than a
+         block gets a block of its own. */
+      block.totalRecords = 0;
+      while ( blockEnd < recordsSize && 
+         blockEnd - blockStart < LUKD_BLOCK_SIZE ) {
+         Str key;
+         blockEnd = LukdGetRecordKey( recordsFile, blockEnd, &key );
+         block.totalRecords += 1;
+      }
+
+      block.firstByte = series->firstRecord + blockStart;
+      block.size = blockEnd - blockStart;
+      block.dataOffset = OutFileGetPosition( outFile );
+      block.dataSize = 0;
+      block.unused = 0;
+
+      dataCapacity = LzBlockBound( block.size );
+      data = ( Byte * ) malloc( dataCapacity );
+      if ( data != NULL ) {
+         block.dataSize = LzBlockCompress( recordsFile->data + blockStart,
+            block.size, data, dataCapacity );
+      }
+
+      /* A block that doesn't get any smaller is stored as it is. */
+      if ( block.dataSize == 0 || block.dataSize >= block.size ) {
+         block.dataSize = block.size;
+         OutFileAdd( outFile, recordsFile->data + blockStart, block.size );
+      }
+      else {
+         OutFileAdd( outFile, data, block.dataSize );
+      }
+
+      free( ( void * ) data );
+      MemFileAdd( &blocksFile, &block, sizeof( block ) );
+      blockStart = blockEnd;
+   }
+
+   series->flags |= LUKD_SERIES_COMPRESSED;
+   series->firstBlock = OutFileGetPosition( outFile );
+   series->totalBlocks = MemFileGetSize( &blocksFile ) / sizeof( LukdBlock );
+   OutFileAddMemFile( outFile, &blocksFile );
+
+   MemFileClose( &blocksFile );
+}
+
+/* The index points at the records by their position in the series, as if
+   they were stored right at the start of it. */
+void LukdExportIndex( OutFile *outFile, const MemFile *recordsFile,
+   LukdRecordSeries *series ) {
+   /* At least half of the slots are kept empty, so a key that isn't there
+      is found out after a few slots. */
+   unsigned int totalSlots = 2;
+   unsigned int slotMask;
+   unsigned int recordNum;
+   size_t recordPosition = 0;
+   LukdIndexSlot *slots;
+
+   while ( totalSlots < series->totalRecords * 2 ) {
+      totalSlots *= 2;
+   }
+
+   /* A series of records without an index is still usable. It just has to
+      be searched one record at a time. */
+   series->firstIndexSlot = 0;
+   series->totalIndexSlots = 0;
+   slots = ( LukdIndexSlot * ) calloc( totalSlots, sizeof( LukdIndexSlot ) );
+   if ( slots == NULL ) {
+      return;
+   }
+
+   slotMask = totalSlots - 1;
+   for ( recordNum = 0; recordNum < series->totalRecords; recordNum += 1 ) {
+      Str key;
+      const size_t nextRecord = LukdGetRecordKey( recordsFile, 
+         recordPosition, &key );
+      const unsigned int hash = StrHash( &key );
+      unsigned int slotNum = hash & slotMask;
+
+      while ( slots[ slotNum ].record != 0 ) {
+         slotNum = ( slotNum + 1 ) & slotMask;
+      }
+
+      slots[ slotNum ].hash = hash;
+      slots[ slotNum ].record = series->firstRecord + recordPosition;
+      recordPosition = nextRecord;
+   }
+
+   series->firstIndexSlot = OutFileGetPosition( outFile );
+   series->totalIndexSlots = totalSlots;
+   OutFileAdd( outFile, slots, totalSlots * sizeof( LukdIndexSlot ) );
+
+   free( ( void * ) slots );
+}
+
+Byte *LukdExportFilter( OutFile *outFile, const MemFile *recordsFile,
+   LukdRecordSeries *series ) {
+   const unsigned int filterSize = 
+      ( series->totalRecords * LUKD_FILTER_BITS_PER_KEY + 7 ) / 8;
+   unsigned int recordNum;
+   size_t recordPosition = 0;
+   Byte *filter;
+
+   /* Without a filter, every lookup goes to the index. */
+   series->firstFilterByte = 0;
+   series->filterSize = 0;
+   filter = ( Byte * ) calloc( filterSize, 1 );
+   if ( filter == NULL ) {
+      return NULL;
+   }
+
+   for ( recordNum = 0; recordNum < series->totalRecords; recordNum += 1 ) {
+      Str key;
+      recordPosition = LukdGetRecordKey( recordsFile, recordPosition, 
+         &key );
+      LukdFilterAddKey( filter, filterSize, &key );
+   }
+
+   series->firstFilterByte = OutFileGetPosition( outFile );
+   series->filterSize = filterSize;
+   OutFileAdd( outFile, filter, filterSize );
+
+   return filter;
+}
+
+/* Points the key at the key of the record at the given position of a file
+   that was written by us. Returns the position of the next record. */
+size_t LukdGetRecordKey( const MemFile *file, size_t recordPosition,
+   Str *key ) {
+   LukdRecord record;
+   MemFile recordFile;
+
+   MemFileInitView( &recordFile, file->data, MemFileGetSize( file ) );
+   MemFileSetPosition( &recordFile, recordPosition );
+   LukdReadRecord( &recordFile, &exportKeys, &record );
+   *key = record.key;
+
+   return MemFileGetPosition( &recordFile );
+}
+
+Bool LukdReplaceFile( const char *tempFilePath, const char *outFilePath,
+   unsigned int totalBackups ) {
+   if ( ! isFileBackedUp && totalBackups > 0 ) {
+      LukdRotateBackups( outFilePath, totalBackups );
+      isFileBackedUp = TRUE;
+   }
+
+#if defined _WIN32 || defined _WIN64
+   /* Files can't be renamed over existing files on Windows. */
+   remove( outFilePath );
+#endif
+
+   if ( rename( tempFilePath, outFilePath ) != 0 ) {
+      PrintWarning( "Could not replace file at path: %s\n", outFilePath );
+      remove( tempFilePath );
+      return FALSE;
+   }
+
+   FileSyncDirectory( outFilePath );
+   return TRUE;
+}
+
+/* Makes the file the newest backup, and moves the older backups down one
+   place, dropping the oldest. Nothing is copied: the backups are only
+   renamed, and the file gets a second name that stays behind when the 
+   file is replaced. */
+void LukdRotateBackups( const char *filePath, unsigned int totalBackups ) {
+   FILE *file = fopen( filePath, "rb" );
+   Str *olderPath;
+   unsigned int backupNum;
+
+   /* A file that doesn't exist yet has nothing to back up. */
+   if ( file == NULL ) {
+      return;
+   }
+   fclose( file );
+
+   olderPath = LukdMakeBackupPath( filePath, totalBackups - 1 );
+   if ( olderPath == NULL ) {
+      return;
+   }
+
+   remove( olderPath->value );
+   for ( backupNum = totalBackups - 1; backupNum > 0; backupNum -= 1 ) {
+      Str *newerPath = LukdMakeBackupPath( filePath, backupNum - 1 );
+      if ( newerPath == NULL ) {
+         StrDel( olderPath );
+         return;
+      }
+
+      rename( newerPath->value, olderPath->value );
+      StrDel( olderPath );
+      olderPath = newerPath;
+   }
+
+   /* Where files can't have two names, the file is moved instead, and the
+      new file takes its place right after. */
+   PrintMessage( "Creating backup database file at path: %s\n",
+      olderPath->value );
+   if ( ! FileLink( filePath, olderPath->value ) && 
+      rename( filePath, olderPath->value ) != 0 ) {
+      PrintWarning( "Failed to create a backup of the database file\n" );
+   }
+
+   StrDel( olderPath );
+}
+
+/* The newest backup has the backup extension. Older backups also get their
+   number. */
+Str *LukdMakeBackupPath( const char *filePath, unsigned int backupNum ) {
+   char extension[ 32 ];
+
+   if ( backupNum == 0 ) {
+      return LukdMakeFilePath( filePath, LUKD_BACKUP_EXT );
+   }
+
+   sprintf( extension, "%s.%u", LUKD_BACKUP_EXT, backupNum );
+   return LukdMakeFilePath( filePath, extension );
+}
+
+/* Returns the number of the key of the record. */
+unsigned int LukdExportRecord( MemFile *outFile, const Str *key, 
+   const Str *value ) {
+   /* Write record header. The key goes into the key table, and the record
+      only gets its number. */
+   const unsigned int keyId = LukdAddKey( &exportKeys, key );
+   LukdAddVarint( outFile, keyId );
+   LukdAddVarint( outFile, value->length );
+
+   /* Write record body: */
+   MemFileAdd( outFile, value->value, value->length );
+   return keyId;
+}
+
+void LukdAddVarint( MemFile *outFile, unsigned int value ) {
+   Byte bytes[ LUKD_VARINT_MAX_SIZE ];
+   MemFileAdd( outFile, bytes, LukdEncodeVarint( bytes, value ) );
+}
+
+/* Returns the number of bytes used. */
+int LukdEncodeVarint( Byte *bytes, unsigned int value ) {
+   int size = 0;
+
+   while ( value >= 0x80 ) {
+      bytes[ size ] = ( Byte ) ( value | 0x80 );
+      size += 1;
+      value >>= 7;
+   }
+
+   bytes[ size ] = ( Byte ) value;
+   return size + 1;
+}
+
+Str *LukdMakeExpiryKey( const Str *key ) {
+   Str *prefix = StrNew( LUKD_EXPIRY_KEY_PREFIX );
+   Str *expiryKey = StrConcat( prefix, key );
+   StrDel( prefix );
+   return expiryKey;
+}
+
+void LukdMakeFileHeader( LukdFileHeader *header, 
+   LukdOffset mainTableOffset, LukdOffset firstKey, 
+   unsigned int directoryChecksum ) {
+   memset( header, 0, sizeof( *header ) );
+   memcpy( header->magic, LUKD_MAGIC, LUKD_MAGIC_LENGTH );
+   header->version = LUKD_VERSION;
+   header->mainTableOffset = mainTableOffset;
+   header->firstKey = firstKey;
+   header->totalKeys = exportKeys.totalKeys;
+   header->directoryChecksum = directoryChecksum;
+   header->headerChecksum = Crc32cUpdate( CRC32C_INITIAL, header, 
+      offsetof( LukdFileHeader, headerChecksum ) );
+}
+
+void LukdExportKeyTable( OutFile *outFile ) {
+   unsigned int keyId;
+
+   for ( keyId = 0; keyId < exportKeys.totalKeys; keyId += 1 ) {
+      const Str *key = exportKeys.keys[ keyId ];
+      Byte size[ LUKD_VARINT_MAX_SIZE ];
+
+      OutFileAdd( outFile, size, LukdEncodeVarint( size, key->length ) );
+      OutFileAdd( outFile, key->value, key->length );
+   }
+}
+
+void LukdExportMainTable( OutFile *outFile, unsigned int totalMapEntries, 
+   LukdOffset firstMapEntry ) {
+   LukdMainTable mainTable;
+
+   mainTable.totalMapEntries = totalMapEntries;
+   mainTable.firstMapEntry = firstMapEntry;
+   mainTable.publishDate = ( unsigned int ) time( NULL );
+
+   OutFileAdd( outFile, &mainTable, sizeof( mainTable ) );
+}
+
+void LukdExportPlayerTable( OutFile *outFile, MemFile *playersFile,
+   unsigned int totalPlayerEntries ) {
+   LukdPlayerTable playerTable;
+
+   memcpy( playerTable.tag, LUKD_PLAYER_TABLE_TAG, 
+      LUKD_PLAYER_TABLE_TAG_LENGTH );
+   playerTable.totalPlayerEntries = totalPlayerEntries;
+
+   OutFileAdd( outFile, &playerTable, sizeof( playerTable ) );
+   OutFileAddMemFile( outFile, playersFile );
+}
+
+/* Merge functions */
+
+/* The directory entries of all the files are sorted by map and player, so
+   the series that end up in the same series of the new file come one after
+   the other, and the new file is written in a single pass. */
+Bool LukdMergeSources( LukdSource *sources, unsigned int totalSources,
+   const char *outFilePath, const LukdMergeOptions *options ) {
+   unsigned int totalItems = 0;
+   unsigned int entriesMerged = 0;
+   unsigned int playersMerged = 0;
+   unsigned int sourceNum;
+   unsigned int itemNum;
+   Bool isMerged = FALSE;
+
+   Str *tempFilePath = LukdMakeFilePath( outFilePath, LUKD_TEMP_EXT );
+   LukdMergeItem *items;
+   LukdKeyMarks marks;
+   OutFile outFile;
+   MemFile entriesFile;
+   MemFile playersFile;
+
+   if ( options->newMapName != NULL && 
+      options->newMapName->length > LUKD_MAX_MAP_LENGTH ) {
+      PrintWarning( "Map name is too long: %s\n", 
+         options->newMapName->value );
+      StrDel( tempFilePath );
+      return FALSE;
+   }
+
+   for ( sourceNum = 0; sourceNum < totalSources; sourceNum += 1 ) {
+      totalItems += sources[ sourceNum ].totalEntries;
+   }
+
+   items = ( LukdMergeItem * ) malloc( 
+      ( totalItems + 1 ) * sizeof( LukdMergeItem ) );
+   if ( tempFilePath == NULL || items == NULL ) {
+      StrDel( tempFilePath );
+      free( ( void * ) items );
+      return FALSE;
+   }
+
+   totalItems = 0;
+   for ( sourceNum = 0; sourceNum < totalSources; sourceNum += 1 ) {
+      const LukdSource *source = &sources[ sourceNum ];
+      unsigned int entryNum;
+
+      for ( entryNum = 0; entryNum < source->totalEntries; entryNum += 1 ) {
+         LukdMergeItem *item = &items[ totalItems ];
+
+         item->map = LukdMakeMapName( source->entries[ entryNum ].map );
+         item->player = source->entries[ entryNum ].player;
+         item->sourceNum = sourceNum;
+         item->entryNum = entryNum;
+
+         if ( item->map == NULL || ( options->skippedMap != NULL && 
+            StrIsEqual( item->map, options->skippedMap ) ) ) {
+            StrDel( item->map );
+            continue;
+         }
+
+         if ( options->renamedMap != NULL && 
+            StrIsEqual( item->map, options->renamedMap ) ) {
+            StrDel( item->map );
+            item->map = StrCopy( options->newMapName );
+         }
+
+         totalItems += 1;
+      }
+   }
+
+   qsort( items, totalItems, sizeof( LukdMergeItem ), 
+      LukdCompareMergeItems );
+
+   marks.series = NULL;
+   marks.totalKeys = 0;
+   marks.seriesNum = 0;
+   MemFileInit( &entriesFile );
+   MemFileInit( &playersFile );
+
+   if ( LukdStartExport( &outFile, tempFilePath, options->isCompressed ) ) {
+      itemNum = 0;
+      while ( itemNum < totalItems ) {
+         unsigned int lastItem = itemNum + 1;
+         unsigned int recordsMerged;
+         MemFile mergedFile;
+
+         while ( lastItem < totalItems && 
+            LukdIsSameSeries( &items[ itemNum ], &items[ lastItem ] ) ) {
+            lastItem += 1;
+         }
+
+         MemFileInit( &mergedFile );
+         recordsMerged = LukdMergeRecords( sources, &items[ itemNum ], 
+            lastItem - itemNum, &mergedFile, &marks );
+
+         /* The file is never read back here, so the filter isn't kept. */
+         if ( recordsMerged > 0 ) {
+            LukdRecordSeries series;
+
+            free( ( void * ) LukdExportSeries( &outFile, &mergedFile, 
+               recordsMerged, &series ) );
+            LukdAddEntry( &entriesFile, &playersFile, items[ itemNum ].map,
+               items[ itemNum ].player, &series );
+            if ( items[ itemNum ].player != NULL ) {
+               playersMerged += 1;
+            }
+            else {
+               entriesMerged += 1;
+            }
+         }
+         MemFileClose( &mergedFile );
+
+         itemNum = lastItem;
+      }
+
+      LukdExportDirectory( &outFile, &entriesFile, entriesMerged, 
+         &playersFile, playersMerged );
+      isMerged = LukdFinishExport( &outFile, tempFilePath, outFilePath,
+         options->totalBackups );
+      LukdDestroyKeyTable( &exportKeys );
+   }
+
+   for ( itemNum = 0; itemNum < totalItems; itemNum += 1 ) {
+      StrDel( items[ itemNum ].map );
+   }
+
+   free( ( void * ) marks.series );
+   free( ( void * ) items );
+   MemFileClose( &entriesFile );
+   MemFileClose( &playersFile );
+   StrDel( tempFilePath );
+   return isMerged;
+}
+
+/* Sorts by map, then by player, with the records of the map before those 
+   of its players, and then by file and entry, so the later files come 
+   last. */
+int LukdCompareMergeItems( const void *first, const void *second ) {
+   const LukdMergeItem *firstItem = ( const LukdMergeItem * ) first;
+   const LukdMergeItem *secondItem = ( const LukdMergeItem * ) second;
+   int result = StrCompare( firstItem->map, secondItem->map );
+
+   if ( result != 0 ) {
+      return result;
+   }
+
+   if ( firstItem->player == NULL || secondItem->player == NULL ) {
+      result = ( firstItem->player != NULL ) - ( secondItem->player != NULL );
+   }
+   else {
+      result = StrCompare( firstItem->player, secondItem->player );
+   }
+
+   if ( result != 0 ) {
+      return result;
+   }
+
+   if ( firstItem->sourceNum != secondItem->sourceNum ) {
+      return ( firstItem->sourceNum < secondItem->sourceNum ) ? -1 : 1;
+   }
+
+   return ( firstItem->entryNum < secondItem->entryNum ) ? -1 : 
+      ( firstItem->entryNum > secondItem->entryNum );
+}
+
+Bool LukdIsSameSeries( const LukdMergeItem *first, 
+   const LukdMergeItem *second ) {
+   return ( StrIsEqual( first->map, second->map ) && 
+      ( first->player == NULL ? second->player == NULL : 
+         ( second->player != NULL && 
+            StrIsEqual( first->player, second->player ) ) ) );
+}
+
+/* The series are merged starting with the last file, so the first copy of
+   a key that is met is the one that is kept. Returns the number of records
+   merged. */
+unsigned int LukdMergeRecords( LukdSource *sources, 
+   const LukdMergeItem *items, unsigned int totalItems, 
+   MemFile *mergedFile, LukdKeyMarks *marks ) {
+   const time_t now = time( NULL );
+   unsigned int recordsMerged = 0;
+   unsigned int itemNum = totalItems;
+
+   marks->seriesNum += 1;
+   while ( itemNum > 0 ) {
+      const LukdSource *source;
+      DatabaseFileSection section;
+      MemFile dataFile;
+      MemFile recordsFile;
+      LukdRecordCopy copy;
+
+      itemNum -= 1;
+      source = &sources[ items[ itemNum ].sourceNum ];
+      MemFileInitView( &dataFile, source->file.data, source->file.size );
+      LukdInitEntrySection( &section, 
+         &source->entries[ items[ itemNum ].entryNum ] );
+
+      /* A damaged series is left out as a whole. The expired records are
+         left to the merge, which still has to mark their keys. */
+      MemFileInit( &recordsFile );
+      LukdInitRecordCopy( &copy, &recordsFile, 0 );
+      if ( LukdCopyRecords( source, &copy, &dataFile, &section ) ) {
+         recordsMerged += LukdMergeSeries( mergedFile, &recordsFile, marks,
+            now );
+      }
+      MemFileClose( &recordsFile );
+   }
+
+   return recordsMerged;
+}
+
+/* Adds the records whose keys aren't marked yet. The expiry record of a 
+   temporary record goes wherever the record goes. An expired record is 
+   dropped, but its key is still marked, so an older copy of it doesn't
+   come back. */
+unsigned int LukdMergeSeries( MemFile *mergedFile, MemFile *recordsFile, 
+   LukdKeyMarks *marks, time_t now ) {
+   const size_t recordsSize = MemFileGetSize( recordsFile );
+   unsigned int recordsMerged = 0;
+
+   MemFileRewind( recordsFile );
+   while ( MemFileGetPosition( recordsFile ) < recordsSize ) {
+      LukdRecord record;
+      LukdRecord expiry;
+      Bool hasExpiry = FALSE;
+      Bool isNewKey;
+
+      /* The records were written by us, so they're well formed. */
+      LukdReadRecord( recordsFile, &exportKeys, &record );
+      if ( MemFileGetPosition( recordsFile ) < recordsSize ) {
+         const size_t expiryPosition = MemFileGetPosition( recordsFile );
+
+         LukdReadRecord( recordsFile, &exportKeys, &expiry );
+         hasExpiry = LukdIsExpiryKeyOf( &expiry.key, &record.key );
+         if ( ! hasExpiry ) {
+            MemFileSetPosition( recordsFile, expiryPosition );
+         }
+      }
+
+      isNewKey = LukdMarkKey( marks, record.keyId );
+      if ( hasExpiry ) {
+         LukdMarkKey( marks, expiry.keyId );
+      }
+
+      if ( isNewKey && ! ( hasExpiry && 
+         LukdReadExpiry( &expiry.value ) <= now ) ) {
+         LukdExportRecord( mergedFile, &record.key, &record.value );
+         recordsMerged += 1;
+
+         if ( hasExpiry ) {
+            LukdExportRecord( mergedFile, &expiry.key, &expiry.value );
+            recordsMerged += 1;
+         }
+      }
+   }
+
+   return recordsMerged;
+}
+
+/* Marks the key as written to the current series. Returns false if it 
+   already was. A key that can't be marked is always taken. */
+Bool LukdMarkKey( LukdKeyMarks *marks, unsigned int keyId ) {
+   if ( keyId >= marks->totalKeys ) {
+      unsigned int totalKeys = ( marks->totalKeys > 0 ) ? 
+         marks->totalKeys * 2 : 256;
+      unsigned int *series;
+
+      while ( totalKeys <= keyId ) {
+         totalKeys *= 2;
+      }
+
+      series = ( unsigned int * ) realloc( marks->series, 
+         totalKeys * sizeof( unsigned int ) );
+      if ( series == NULL ) {
+         return TRUE;
+      }
+
+      memset( series + marks->totalKeys, 0, 
+         ( totalKeys - marks->totalKeys ) * sizeof( unsigned int ) );
+      marks->series = series;
+      marks->totalKeys = totalKeys;
+   }
+
+   if ( marks->series[ keyId ] == marks->seriesNum ) {
+      return FALSE;
+   }
+
+   marks->series[ keyId ] = marks->seriesNum;
+   return TRUE;
+}
+
+Bool LukdIsExpiryKeyOf( const Str *expiryKey, const Str *key ) {
+   const size_t prefixLength = sizeof( LUKD_EXPIRY_KEY_PREFIX ) - 1;
 
-   MemFileAdd( outFile, &mainTable, sizeof( mainTable ) );
+   return ( expiryKey->length == prefixLength + key->length &&
+      memcmp( expiryKey->value, LUKD_EXPIRY_KEY_PREFIX, 
+         prefixLength ) == 0 &&
+      memcmp( expiryKey->value + prefixLength, key->value, 
+         key->length ) == 0 );
 }
 
 /* Debug functions: */
 
 void LukdPrintMainTable( const LukdMainTable *table ) {
    printf( "Header:\n" );
-   printf( "First map entry: %d\n", table->firstMapEntry );
+   printf( "First map entry: %llu\n", table->firstMapEntry );
    printf( "Total map entries: %d\n", table->totalMapEntries );
    printf( "Publish date: %d\n", table->publishDate );
    printf( "\n" );
@@ -476,7 +3231,7 @@ void LukdPrintMainTable( const LukdMainTable *table ) {
 void LukdPrintEntry( const LukdMapEntry *entry ) {
    printf( "Map entry:\n" );
    printf( "name: %s\n", entry->name );
-   printf( "First record: %d\n", entry->firstRecord );
-   printf( "Total records: %d\n", entry->totalRecords );
+   printf( "First record: %llu\n", entry->records.firstRecord );
+   printf( "Total records: %d\n", entry->records.totalRecords );
    printf( "\n" );
 }
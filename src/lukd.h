@@ -32,52 +32,332 @@
 
 #include "gentype.h"
 #include "strutil.h"
+#include "memfile.h"
+#include "mapfile.h"
 
 #include "database.h"
 
+/* Files since version 2 start with a file header that holds the version
+   of the file. Version 1 files start with the main table offset instead. */
+#define LUKD_MAGIC "LUKD"
+#define LUKD_MAGIC_LENGTH 4
+#define LUKD_VERSION 7
 #define LUKD_BACKUP_EXT ".backup"
+/* The database is saved into a file with this extension first, which then
+   replaces the database file. */
+#define LUKD_TEMP_EXT ".tmp"
 #define LUKD_MAX_MAP_LENGTH 8  /* Like maximum lump name length. */
 #define LUKD_PUBLISH_DATE_MAX_LENGTH 64
 /* Make sure the final string, once expanded with arguments, doesn't go
    over the above limit. */
 #define LUKD_PUBLISH_DATE_FORMAT "%Y-%m-%d %X %Z"
+/* The expiry time of a temporary record is saved in a separate record that
+   follows it. The key of that record is the key of the temporary record with
+   this prefix. Keys sent by the wad always start with a letter, so they
+   can't clash with these. */
+#define LUKD_EXPIRY_KEY_PREFIX "~expires:"
+/* Tag of the player table, which follows the main table. */
+#define LUKD_PLAYER_TABLE_TAG "LUKP"
+#define LUKD_PLAYER_TABLE_TAG_LENGTH 4
+/* With 10 bits for each key and 7 bit positions tested, about 1 in 100
+   lookups of a missing key still has to look at the records. */
+#define LUKD_FILTER_BITS_PER_KEY 10
+#define LUKD_FILTER_HASHES 7
+/* Compressed records are split into blocks of about this size, so a single
+   record can be read without decompressing all the others. */
+#define LUKD_BLOCK_SIZE 16384
+/* Flags of a series of records: */
+#define LUKD_SERIES_COMPRESSED 0x1
+/* Key number of the records of files without a key table. */
+#define LUKD_NO_KEY 0xFFFFFFFFu
+/* A varint takes at most this many bytes, 7 bits in each. */
+#define LUKD_VARINT_MAX_SIZE 5
+/* The map entries are read by several threads when each thread gets at 
+   least this many. */
+#define LUKD_MIN_THREAD_ENTRIES 256
 
-/* Main table offset: */
+/* Main table offset of version 1 files, which start with it: */
 typedef unsigned int LukdMainTableOffset;
 
+/* Position in the file. Since version 6, positions take 8 bytes, so files
+   can grow past 4 GB. The fields of 8 bytes are placed on 8 byte 
+   boundaries, with unused fields where needed, so the structures are laid 
+   out the same way on every platform. Unused fields are always 0. */
+typedef unsigned long long LukdOffset;
+
+/* File header: */
+typedef struct {
+   /* Always 0, which is never a valid main table offset, so the header
+      can't be mistaken for the start of a version 1 file. */
+   LukdMainTableOffset versionMarker;
+   char magic[ LUKD_MAGIC_LENGTH ];
+   unsigned int version;
+   unsigned int totalKeys;
+   LukdOffset mainTableOffset;
+   LukdOffset firstKey;
+   /* Files before version 7 have no checksums, and their header ends 
+      here. The directory is the end of the file, from the first map 
+      entry: the map entries, the main table, the player table and the key
+      table. The header checksum is the checksum of the header up to that
+      field. */
+   unsigned int directoryChecksum;
+   unsigned int headerChecksum;
+} LukdFileHeader;
+
 /* Main table: */
 typedef struct {
    unsigned int totalMapEntries;
-   unsigned int firstMapEntry;
    int publishDate;
+   LukdOffset firstMapEntry;
 } LukdMainTable;
 
+/* Location of a series of records, and of the index and filter that
+   follow it. The checksum covers all the bytes of the series, from its 
+   first record on. Files before version 7 have no checksum, so their 
+   series end before the size, and their checksum is always 0. */
+typedef struct {
+   LukdOffset firstRecord;
+   LukdOffset firstIndexSlot;
+   LukdOffset firstFilterByte;
+   LukdOffset firstBlock;
+   unsigned int totalRecords;
+   unsigned int totalIndexSlots;
+   unsigned int filterSize;
+   unsigned int flags;
+   unsigned int totalBlocks;
+   unsigned int checksum;
+   LukdOffset size;
+} LukdRecordSeries;
+
 /* Map entry: */
 typedef struct {
    char name[ LUKD_MAX_MAP_LENGTH ];
+   LukdRecordSeries records;
+} LukdMapEntry;
+
+/* Player table: */
+typedef struct {
+   char tag[ LUKD_PLAYER_TABLE_TAG_LENGTH ];
+   unsigned int totalPlayerEntries;
+} LukdPlayerTable;
+
+/* Player entry, followed by the player name. Files before version 6 have
+   no unused field. */
+typedef struct {
+   char map[ LUKD_MAX_MAP_LENGTH ];
+   unsigned int nameSize;
+   unsigned int unused;
+   LukdRecordSeries records;
+} LukdPlayerEntry;
+
+/* Block of compressed records. The positions of compressed records are
+   counted as if the records were stored uncompressed from the start of the
+   series. A block whose data is as big as its records is not compressed. */
+typedef struct {
+   LukdOffset firstByte;
+   LukdOffset dataOffset;
+   unsigned int size;
+   unsigned int dataSize;
+   unsigned int totalRecords;
+   unsigned int unused;
+} LukdBlock;
+
+/* Index slot. The index of a series of records is a hash table with open
+   addressing. Empty slots have a record offset of 0. */
+typedef struct {
+   unsigned int hash;
+   unsigned int unused;
+   LukdOffset record;
+} LukdIndexSlot;
+
+/* The structures of files before version 6, whose positions take 4 bytes.
+   They're read into the structures above. */
+typedef struct {
+   LukdMainTableOffset versionMarker;
+   char magic[ LUKD_MAGIC_LENGTH ];
+   unsigned int version;
+   LukdMainTableOffset mainTableOffset;
+   /* Files before version 5 have no key table, and their header ends
+      here. */
+   unsigned int firstKey;
+   unsigned int totalKeys;
+} LukdFileHeader32;
+
+typedef struct {
+   unsigned int totalMapEntries;
+   unsigned int firstMapEntry;
+   int publishDate;
+} LukdMainTable32;
+
+/* Files of older versions leave out the fields at the end: version 1 
+   files have no index, version 2 files have no filter, and version 3 files
+   have no compressed records. */
+typedef struct {
    unsigned int totalRecords;
    unsigned int firstRecord;
-} LukdMapEntry;
+   unsigned int firstIndexSlot;
+   unsigned int totalIndexSlots;
+   unsigned int firstFilterByte;
+   unsigned int filterSize;
+   unsigned int flags;
+   unsigned int firstBlock;
+   unsigned int totalBlocks;
+} LukdRecordSeries32;
+
+typedef struct {
+   unsigned int firstByte;
+   unsigned int size;
+   unsigned int totalRecords;
+   unsigned int dataOffset;
+   unsigned int dataSize;
+} LukdBlock32;
 
-/* Record header: */
+typedef struct {
+   unsigned int hash;
+   unsigned int record;
+} LukdIndexSlot32;
+
+/* Record header of files before version 5. Since version 5, the header
+   is the number of the key in the key table followed by the size of the
+   value, both as varints. */
 typedef struct {
    unsigned int keySize;
    unsigned int valueSize;
 } LukdRecordHeader;
 
-/* Record body: */
+/* Record read from a file. The key and the value point into the file, or
+   the key points into the key table for files that have one. */
 typedef struct {
-   Byte *key;
-   Byte *value;
-} LukdRecordBody;
+   unsigned int keyId;
+   Str key;
+   Str value;
+} LukdRecord;
 
-/* Record: */
+/* Keys of the records of a file. Each key is stored once, and records 
+   refer to their key by its number. */
 typedef struct {
-   LukdRecordHeader header;
-   LukdRecordBody body;
-} LukdRecord;
+   Str **keys;
+   unsigned int totalKeys;
+   unsigned int keysAllocated;
+   /* Hash table with open addressing, holding the number of each key plus
+      one, so an empty slot is 0. */
+   unsigned int *slots;
+   unsigned int totalSlots;
+} LukdKeyTable;
+
+/* Series of records found in the directory of a file, with the map it
+   belongs to, and the player for the records of a player. The filter is 
+   a copy of the filter in the file, when one was asked for. */
+typedef struct {
+   char map[ LUKD_MAX_MAP_LENGTH ];
+   Str *player;
+   LukdRecordSeries series;
+   Byte *filter;
+   Bool isValid;
+} LukdDirectoryEntry;
+
+/* File that records are read from, with what it takes to read them. The
+   entries of the directory are the map entries, in the order they're in,
+   followed by the player entries. */
+typedef struct {
+   MapFile file;
+   unsigned int version;
+   LukdKeyTable keys;
+   Bool hasKeys;
+   LukdMainTable mainTable;
+   LukdDirectoryEntry *entries;
+   unsigned int totalEntries;
+   unsigned int entriesAllocated;
+} LukdSource;
+
+/* What the threads that read the map entries share. Each thread only 
+   writes to the entries it was given. */
+typedef struct {
+   LukdSource *source;
+   const MemFile *dataFile;
+   Bool isFilterCopied;
+} LukdDirectoryImport;
+
+/* Keys written to the series being merged. A key is marked with the number
+   of the series, so the marks never have to be cleared. */
+typedef struct {
+   unsigned int *series;
+   unsigned int totalKeys;
+   unsigned int seriesNum;
+} LukdKeyMarks;
 
+/* Records being copied out of a series, to be written again. */
+typedef struct {
+   MemFile *recordsFile;
+   unsigned int totalRecords;
+   /* Temporary records that expired by this time are left out, together
+      with their expiry records. Nothing is left out when it's 0. */
+   time_t now;
+   /* Position and key number of the last record that was copied, which an
+      expiry record would belong to. */
+   size_t lastRecord;
+   unsigned int lastKeyId;
+   /* Earliest expiry time of the records copied, or 0 if none of them are
+      temporary. */
+   time_t nextExpiry;
+} LukdRecordCopy;
+
+/* Series of records of a file that is being merged. */
+typedef struct {
+   Str *map;
+   const Str *player;
+   unsigned int sourceNum;
+   unsigned int entryNum;
+} LukdMergeItem;
+
+/* How files are merged. The records of a map can be left out, or moved to
+   a map of another name. */
+typedef struct {
+   Bool isCompressed;
+   unsigned int totalBackups;
+   const Str *skippedMap;
+   const Str *renamedMap;
+   const Str *newMapName;
+} LukdMergeOptions;
+
+/* Function called for each record read from a file. */
+typedef void ( *LukdRecordHandler )( void *context, const Str *key, 
+   const Str *value );
+
+/* Reads the map directory of the database file. The file is kept open, so
+   the records of a map can be loaded from it when the map is first used. */
 Bool LukdImportDatabase( const char *dataFilePath );
+/* Loads the records found in the file sections of the given map entry. */
+Bool LukdLoadMapEntry( DatabaseMapEntry *entry );
+/* Reads the value of a single record of a map, or of one of its players,
+   from the database file. Returns a new string with the value, or NULL if
+   the record is not in the file or has expired. */
+Str *LukdRetrieveRecord( const DatabaseMapEntry *entry, const Str *player,
+   const Str *key );
 Bool LukdExportDatabase( const Database *database, const char *outFilePath );
+void LukdCloseDatabase( void );
+
+/* Files can also be read on their own, apart from the database, to look 
+   at them or to merge them without loading them. */
+
+/* Opens the file and reads its directory. Returns false if the file can't
+   be read or its directory is corrupt. The entries found before a corrupt
+   entry are still there. */
+Bool LukdOpenSource( LukdSource *source, const char *filePath );
+void LukdCloseSource( LukdSource *source );
+/* Calls the handler for every record of an entry of the directory. Returns
+   false, after the records read so far, if the records are damaged. */
+Bool LukdReadEntryRecords( const LukdSource *source, unsigned int entryNum,
+   LukdRecordHandler handler, void *context );
+/* Returns false if the checksum of the records of an entry doesn't match.
+   Entries of files before version 7 have no checksum. */
+Bool LukdIsIntactEntry( const LukdSource *source, unsigned int entryNum );
+/* Writes the records of all the files into one file, in one pass. The 
+   records of a map, or of a player, found in more than one file are merged
+   into one series, where the records of the later files take the place of
+   the records of the earlier ones with the same key. Expired records and 
+   damaged series are left out. */
+Bool LukdMergeSources( LukdSource *sources, unsigned int totalSources,
+   const char *outFilePath, const LukdMergeOptions *options );
 
 #endif
@@ -26,6 +26,7 @@
    #include <windows.h>
 #else
    #include <unistd.h>
+   #include <time.h>
 #endif
 
 #include "platform.h"
@@ -37,3 +38,22 @@ void delay( int seconds ) {
       sleep( seconds );
    #endif
 }
+
+unsigned long long getMicroseconds( void ) {
+   #ifdef _WIN32
+      LARGE_INTEGER frequency;
+      LARGE_INTEGER counter;
+
+      QueryPerformanceFrequency( &frequency );
+      QueryPerformanceCounter( &counter );
+      return ( unsigned long long ) ( counter.QuadPart / frequency.QuadPart ) *
+         1000000 + ( unsigned long long ) ( counter.QuadPart % 
+         frequency.QuadPart ) * 1000000 / frequency.QuadPart;
+   #else
+      struct timespec now;
+
+      clock_gettime( CLOCK_MONOTONIC, &now );
+      return ( unsigned long long ) now.tv_sec * 1000000 + 
+         now.tv_nsec / 1000;
+   #endif
+}
@@ -26,4 +26,13 @@
 
 */
 
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
 void delay( int seconds );
+/* Time in microseconds since some point in the past. The clock never goes
+   back, so it's good for measuring how long something took, but not for 
+   telling the time. */
+unsigned long long getMicroseconds( void );
+
+#endif
@@ -22,50 +22,691 @@
 
 */
 
+
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
-#include "strutil.h"
+#if ! ( defined _WIN32 || defined _WIN64 )
+   #include <pthread.h>
+   #include <sys/time.h>
+
+   #define PRINT_HAS_WRITER
+#endif
 
 #include "print.h"
 
-static void Print( const char *format, va_list *arguments ) {
-   struct tm *timePieces;
-   time_t timeStamp = time( NULL );
+/* The function is always there, even when the calls to it are left out. */
+#undef PrintDebug
+
+/* Private prototypes: */
+static void PrintLog( int level, const char *format, va_list *arguments );
+static void PrintNow( int level, const char *format, va_list *arguments );
+static void PrintMakeStamp( time_t timeStamp, char *stamp );
+static const char *PrintReadSpec( const char *spec, 
+   PrintArgument *argument );
+#ifdef PRINT_HAS_WRITER
+static Bool PrintEnqueue( int level, const char *format, 
+   va_list *arguments );
+static void PrintPackArguments( PrintSlot *slot, va_list *arguments );
+static Bool PrintPackData( PrintSlot *slot, const void *data, size_t size );
+static void PrintFormatSlot( const PrintSlot *slot );
+static size_t PrintFormatArgument( const PrintSlot *slot, size_t dataPos,
+   const char *spec, size_t specLength, PrintArgument argument, 
+   char *text, size_t textSize );
+static void PrintAddText( const char *text, size_t length );
+static void PrintFlushBatch( void );
+static void *PrintWrite( void *unused );
+static Bool PrintHasWaiting( void );
+static void PrintWriteWaiting( void );
+static void PrintWaitForMessages( void );
+#endif
+
+static const char *const printLevelNames[ PRINT_TOTAL_LEVELS ] = {
+   "debug", "message", "notice", "warning", "error"
+};
+
+static const char *const printLabels[ PRINT_TOTAL_LEVELS ] = {
+   "", "", "Notice: ", "Warning: ", "Error: "
+};
+
+static int printLevel = PRINT_LEVEL_DEBUG;
+
+#ifdef PRINT_HAS_WRITER
+static PrintRing ring;
+static pthread_t writerThread;
+static pthread_mutex_t writerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writerWake = PTHREAD_COND_INITIALIZER;
+/* Text on its way to stdout. Only the writer uses it. */
+static char batch[ PRINT_BATCH_SIZE ];
+static size_t batchSize = 0;
+#endif
+
+void PrintStartWriter( void ) {
+#ifdef PRINT_HAS_WRITER
+   unsigned long slot;
+
+   if ( ring.isRunning ) {
+      return;
+   }
 
-   timePieces = localtime( &timeStamp );
-   printf( "[%02d:%02d:%02d] ", timePieces->tm_hour, timePieces->tm_min,
-      timePieces->tm_sec );
+   for ( slot = 0; slot < PRINT_RING_SLOTS; slot += 1 ) {
+      ring.slots[ slot ].sequence = slot;
+   }
 
+   ring.enqueuePos = 0;
+   ring.dequeuePos = 0;
+   ring.totalDropped = 0;
+   ring.isStopping = FALSE;
+   ring.isWriterWaiting = FALSE;
+   ring.stampTime = 0;
+
+   /* Without the writer, messages keep being written right away. */
+   if ( pthread_create( &writerThread, NULL, PrintWrite, NULL ) == 0 ) {
+      __atomic_store_n( &ring.isRunning, TRUE, __ATOMIC_SEQ_CST );
+   }
+#endif
+}
+
+void PrintStopWriter( void ) {
+#ifdef PRINT_HAS_WRITER
+   if ( ! ring.isRunning ) {
+      return;
+   }
+
+   pthread_mutex_lock( &writerMutex );
+   __atomic_store_n( &ring.isStopping, TRUE, __ATOMIC_SEQ_CST );
+   pthread_cond_signal( &writerWake );
+   pthread_mutex_unlock( &writerMutex );
+
+   pthread_join( writerThread, NULL );
+   __atomic_store_n( &ring.isRunning, FALSE, __ATOMIC_SEQ_CST );
+#endif
+}
+
+void PrintSetLevel( int level ) {
+   printLevel = level;
+}
+
+int PrintFindLevel( const char *name ) {
+   int level;
+
+   for ( level = 0; level < PRINT_TOTAL_LEVELS; level += 1 ) {
+      if ( strcmp( name, printLevelNames[ level ] ) == 0 ) {
+         return level;
+      }
+   }
+
+   return -1;
+}
+
+void PrintLog( int level, const char *format, va_list *arguments ) {
+   if ( level < printLevel ) {
+      return;
+   }
+
+#ifdef PRINT_HAS_WRITER
+   if ( __atomic_load_n( &ring.isRunning, __ATOMIC_SEQ_CST ) ) {
+      PrintEnqueue( level, format, arguments );
+      return;
+   }
+#endif
+
+   PrintNow( level, format, arguments );
+}
+
+void PrintNow( int level, const char *format, va_list *arguments ) {
+   char stamp[ 16 ];
+
+   PrintMakeStamp( time( NULL ), stamp );
+   printf( "%s%s", stamp, printLabels[ level ] );
    vprintf( format, *arguments );
    fflush( stdout );
 }
 
-void PrintMessage( const char *format, ... ) {
+void PrintMakeStamp( time_t timeStamp, char *stamp ) {
+   const struct tm *timePieces = localtime( &timeStamp );
+
+   sprintf( stamp, "[%02d:%02d:%02d] ", timePieces->tm_hour, 
+      timePieces->tm_min, timePieces->tm_sec );
+}
+
+/* Finds the kind of argument the conversion specification takes. Returns 
+   the end of the specification. */
+const char *PrintReadSpec( const char *spec, PrintArgument *argument ) {
+   const char *specPos = spec + 1;
+   int longs = 0;
+   Bool isSize = FALSE;
+
+   /* Flags, width and precision: */
+   while ( *specPos != '\0' && strchr( "-+ #0123456789.", *specPos ) ) {
+      specPos += 1;
+   }
+
+   /* Length: */
+   while ( *specPos == 'h' || *specPos == 'l' || *specPos == 'z' ) {
+      longs += ( *specPos == 'l' );
+      isSize = isSize || ( *specPos == 'z' );
+      specPos += 1;
+   }
+
+   switch ( *specPos ) {
+      case 'd':
+      case 'i':
+         *argument = isSize ? PRINT_ARG_SIZE : 
+            ( longs == 0 ) ? PRINT_ARG_INT : 
+            ( longs == 1 ) ? PRINT_ARG_LONG : PRINT_ARG_LONG_LONG;
+         break;
+
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o':
+         *argument = isSize ? PRINT_ARG_SIZE : 
+            ( longs == 0 ) ? PRINT_ARG_UNSIGNED : 
+            ( longs == 1 ) ? PRINT_ARG_UNSIGNED_LONG : 
+            PRINT_ARG_UNSIGNED_LONG_LONG;
+         break;
+
+      case 'c':
+         *argument = PRINT_ARG_INT;
+         break;
+
+      case 'f':
+      case 'e':
+      case 'g':
+         *argument = PRINT_ARG_DOUBLE;
+         break;
+
+      case 's':
+         *argument = PRINT_ARG_STRING;
+         break;
+
+      case 'p':
+         *argument = PRINT_ARG_POINTER;
+         break;
+
+      case '%':
+         *argument = PRINT_ARG_NONE;
+         break;
+
+      default:
+         *argument = PRINT_ARG_UNKNOWN;
+         return specPos;
+   }
+
+   if ( specPos - spec + 1 > PRINT_SPEC_MAX_LENGTH ) {
+      *argument = PRINT_ARG_UNKNOWN;
+   }
+
+   return specPos + 1;
+}
+
+#ifdef PRINT_HAS_WRITER
+
+/* Any number of threads can put messages in the ring buffer at once. Each
+   takes the next message number, and with it the slot of the message, 
+   and then lets the writer know the slot is filled. */
+Bool PrintEnqueue( int level, const char *format, va_list *arguments ) {
+   unsigned long pos = __atomic_load_n( &ring.enqueuePos, __ATOMIC_RELAXED );
+   PrintSlot *slot;
+
+   for ( ;; ) {
+      long difference;
+
+      slot = &ring.slots[ pos & PRINT_RING_MASK ];
+      difference = ( long ) ( __atomic_load_n( &slot->sequence, 
+         __ATOMIC_ACQUIRE ) - pos );
+
+      /* The slot is free for this message number. */
+      if ( difference == 0 ) {
+         if ( __atomic_compare_exchange_n( &ring.enqueuePos, &pos, pos + 1,
+            TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ) {
+            break;
+         }
+      }
+      /* The writer hasn't gotten to the message in the slot yet. */
+      else if ( difference < 0 ) {
+         __atomic_add_fetch( &ring.totalDropped, 1, __ATOMIC_RELAXED );
+         return FALSE;
+      }
+      /* Another thread took the number first. */
+      else {
+         pos = __atomic_load_n( &ring.enqueuePos, __ATOMIC_RELAXED );
+      }
+   }
+
+   slot->level = level;
+   slot->time = time( NULL );
+   slot->format = format;
+   PrintPackArguments( slot, arguments );
+
+   __atomic_store_n( &slot->sequence, pos + 1, __ATOMIC_SEQ_CST );
+
+   /* The writer only needs waking when it's waiting. */
+   if ( __atomic_load_n( &ring.isWriterWaiting, __ATOMIC_SEQ_CST ) ) {
+      pthread_mutex_lock( &writerMutex );
+      pthread_cond_signal( &writerWake );
+      pthread_mutex_unlock( &writerMutex );
+   }
+
+   return TRUE;
+}
+
+void PrintPackArguments( PrintSlot *slot, va_list *arguments ) {
+   const char *formatPos = slot->format;
+
+   slot->dataSize = 0;
+
+   while ( ( formatPos = strchr( formatPos, '%' ) ) != NULL ) {
+      PrintArgument argument;
+      Bool isPacked = TRUE;
+
+      formatPos = PrintReadSpec( formatPos, &argument );
+
+      if ( argument == PRINT_ARG_INT ) {
+         const int value = va_arg( *arguments, int );
+         isPacked = PrintPackData( slot, &value, sizeof( value ) );
+      }
+      else if ( argument == PRINT_ARG_UNSIGNED ) {
+         const unsigned int value = va_arg( *arguments, unsigned int );
+         isPacked = PrintPackData( slot, &value, sizeof( value ) );
+      }
+      else if ( argument == PRINT_ARG_LONG ) {
+         const long value = va_arg( *arguments, long );
+         isPacked = PrintPackData( slot, &value, sizeof( value ) );
+      }
+      else if ( argument == PRINT_ARG_UNSIGNED_LONG ) {
+         const unsigned long value = va_arg( *arguments, unsigned long );
+         isPacked = PrintPackData( slot, &value, sizeof( value ) );
+      }
+      else if ( argument == PRINT_ARG_LONG_LONG ) {
+         const long long value = va_arg( *arguments, long long );
+         isPacked = PrintPackData( slot, &value, sizeof( value ) );
+      }
+      else if ( argument == PRINT_ARG_UNSIGNED_LONG_LONG ) {
+         const unsigned long long value = 
+            va_arg( *arguments, unsigned long long );
+         isPacked = PrintPackData( slot, &value, sizeof( value ) );
+      }
+      else if ( argument == PRINT_ARG_SIZE ) {
+         const size_t value = va_arg( *arguments, size_t );
+         isPacked = PrintPackData( slot, &value, sizeof( value ) );
+      }
+      else if ( argument == PRINT_ARG_DOUBLE ) {
+         const double value = va_arg( *arguments, double );
+         isPacked = PrintPackData( slot, &value, sizeof( value ) );
+      }
+      else if ( argument == PRINT_ARG_POINTER ) {
+         const void *value = va_arg( *arguments, const void * );
+         isPacked = PrintPackData( slot, &value, sizeof( value ) );
+      }
+      else if ( argument == PRINT_ARG_STRING ) {
+         /* Strings are copied, as they might be gone by the time the 
+            message is written. The end of a string that doesn't fit is 
+            left out. */
+         const char *value = va_arg( *arguments, const char * );
+         const size_t room = PRINT_SLOT_DATA_SIZE - slot->dataSize;
+         size_t length;
+
+         if ( value == NULL ) {
+            value = "(null)";
+         }
+
+         length = strlen( value );
+         if ( room == 0 ) {
+            isPacked = FALSE;
+         }
+         else {
+            if ( length >= room ) {
+               length = room - 1;
+            }
+
+            memcpy( slot->data + slot->dataSize, value, length );
+            slot->data[ slot->dataSize + length ] = '\0';
+            slot->dataSize += length + 1;
+         }
+      }
+      else if ( argument == PRINT_ARG_UNKNOWN ) {
+         return;
+      }
+
+      if ( ! isPacked ) {
+         return;
+      }
+   }
+}
+
+Bool PrintPackData( PrintSlot *slot, const void *data, size_t size ) {
+   if ( slot->dataSize + size > PRINT_SLOT_DATA_SIZE ) {
+      return FALSE;
+   }
+
+   memcpy( slot->data + slot->dataSize, data, size );
+   slot->dataSize += size;
+   return TRUE;
+}
+
+/* Turns the message into text, which goes into the batch. */
+void PrintFormatSlot( const PrintSlot *slot ) {
+   const char *formatPos = slot->format;
+   size_t dataPos = 0;
+
+   /* Only a new second needs a new timestamp. */
+   if ( slot->time != ring.stampTime || ring.stamp[ 0 ] == '\0' ) {
+      PrintMakeStamp( slot->time, ring.stamp );
+      ring.stampTime = slot->time;
+   }
+
+   PrintAddText( ring.stamp, strlen( ring.stamp ) );
+   PrintAddText( printLabels[ slot->level ], 
+      strlen( printLabels[ slot->level ] ) );
+
+   while ( *formatPos != '\0' ) {
+      const char *spec = strchr( formatPos, '%' );
+      char text[ PRINT_SLOT_DATA_SIZE + 64 ];
+      PrintArgument argument;
+      size_t dataSize;
+
+      if ( spec == NULL ) {
+         PrintAddText( formatPos, strlen( formatPos ) );
+         break;
+      }
+
+      PrintAddText( formatPos, spec - formatPos );
+      formatPos = PrintReadSpec( spec, &argument );
+
+      if ( argument == PRINT_ARG_NONE ) {
+         PrintAddText( "%", 1 );
+         continue;
+      }
+
+      if ( argument == PRINT_ARG_UNKNOWN ) {
+         PrintAddText( spec, strlen( spec ) );
+         break;
+      }
+
+      dataSize = PrintFormatArgument( slot, dataPos, spec, formatPos - spec,
+         argument, text, sizeof( text ) );
+
+      /* The arguments that didn't fit end the message. */
+      if ( dataSize == 0 ) {
+         PrintAddText( "...\n", 4 );
+         break;
+      }
+
+      PrintAddText( text, strlen( text ) );
+      dataPos += dataSize;
+   }
+}
+
+/* Formats an argument copied into the slot. Returns the number of bytes 
+   the argument takes up in the slot, or 0 if it isn't there. */
+size_t PrintFormatArgument( const PrintSlot *slot, size_t dataPos,
+   const char *spec, size_t specLength, PrintArgument argument, 
+   char *text, size_t textSize ) {
+   const Byte *data = slot->data + dataPos;
+   const size_t dataLeft = slot->dataSize - dataPos;
+   char specText[ PRINT_SPEC_MAX_LENGTH + 1 ];
+   size_t dataSize = 0;
+
+   memcpy( specText, spec, specLength );
+   specText[ specLength ] = '\0';
+
+   switch ( argument ) {
+      case PRINT_ARG_INT: {
+         int value;
+         dataSize = sizeof( value );
+         if ( dataSize <= dataLeft ) {
+            memcpy( &value, data, dataSize );
+            snprintf( text, textSize, specText, value );
+         }
+         break;
+      }
+
+      case PRINT_ARG_UNSIGNED: {
+         unsigned int value;
+         dataSize = sizeof( value );
+         if ( dataSize <= dataLeft ) {
+            memcpy( &value, data, dataSize );
+            snprintf( text, textSize, specText, value );
+         }
+         break;
+      }
+
+      case PRINT_ARG_LONG: {
+         long value;
+         dataSize = sizeof( value );
+         if ( dataSize <= dataLeft ) {
+            memcpy( &value, data, dataSize );
+            snprintf( text, textSize, specText, value );
+         }
+         break;
+      }
+
+      case PRINT_ARG_UNSIGNED_LONG: {
+         unsigned long value;
+         dataSize = sizeof( value );
+         if ( dataSize <= dataLeft ) {
+            memcpy( &value, data, dataSize );
+            snprintf( text, textSize, specText, value );
+         }
+         break;
+      }
+
+      case PRINT_ARG_LONG_LONG: {
+         long long value;
+         dataSize = sizeof( value );
+         if ( dataSize <= dataLeft ) {
+            memcpy( &value, data, dataSize );
+            snprintf( text, textSize, specText, value );
+         }
+         break;
+      }
+
+      case PRINT_ARG_UNSIGNED_LONG_LONG: {
+         unsigned long long value;
+         dataSize = sizeof( value );
+         if ( dataSize <= dataLeft ) {
+            memcpy( &value, data, dataSize );
+            snprintf( text, textSize, specText, value );
+         }
+         break;
+      }
+
+      case PRINT_ARG_SIZE: {
+         size_t value;
+         dataSize = sizeof( value );
+         if ( dataSize <= dataLeft ) {
+            memcpy( &value, data, dataSize );
+            snprintf( text, textSize, specText, value );
+         }
+         break;
+      }
+
+      case PRINT_ARG_DOUBLE: {
+         double value;
+         dataSize = sizeof( value );
+         if ( dataSize <= dataLeft ) {
+            memcpy( &value, data, dataSize );
+            snprintf( text, textSize, specText, value );
+         }
+         break;
+      }
+
+      case PRINT_ARG_POINTER: {
+         const void *value;
+         dataSize = sizeof( value );
+         if ( dataSize <= dataLeft ) {
+            memcpy( &value, data, dataSize );
+            snprintf( text, textSize, specText, value );
+         }
+         break;
+      }
+
+      case PRINT_ARG_STRING: {
+         const char *value = ( const char * ) data;
+         const Byte *valueEnd = ( const Byte * ) memchr( data, '\0', 
+            dataLeft );
+         dataSize = ( valueEnd != NULL ) ? valueEnd - data + 1 : 0;
+         if ( dataSize > 0 ) {
+            snprintf( text, textSize, specText, value );
+         }
+         break;
+      }
+
+      default:
+         break;
+   }
+
+   return ( dataSize <= dataLeft ) ? dataSize : 0;
+}
+
+void PrintAddText( const char *text, size_t length ) {
+   while ( length > 0 ) {
+      size_t room = PRINT_BATCH_SIZE - batchSize;
+
+      if ( room == 0 ) {
+         PrintFlushBatch();
+         room = PRINT_BATCH_SIZE;
+      }
+
+      if ( room > length ) {
+         room = length;
+      }
+
+      memcpy( batch + batchSize, text, room );
+      batchSize += room;
+      text += room;
+      length -= room;
+   }
+}
+
+void PrintFlushBatch( void ) {
+   if ( batchSize > 0 ) {
+      fwrite( batch, 1, batchSize, stdout );
+      batchSize = 0;
+   }
+}
+
+void *PrintWrite( void *unused ) {
+   ( void ) unused;
+
+   for ( ;; ) {
+      /* The buffer is emptied once more after the writer is told to 
+         stop. */
+      const Bool isStopping = 
+         __atomic_load_n( &ring.isStopping, __ATOMIC_SEQ_CST );
+
+      if ( PrintHasWaiting() ) {
+         PrintWriteWaiting();
+      }
+      else if ( isStopping ) {
+         break;
+      }
+      else {
+         PrintWaitForMessages();
+      }
+   }
+
+   return NULL;
+}
+
+Bool PrintHasWaiting( void ) {
+   const PrintSlot *slot = &ring.slots[ ring.dequeuePos & PRINT_RING_MASK ];
+
+   return ( __atomic_load_n( &slot->sequence, __ATOMIC_ACQUIRE ) == 
+      ring.dequeuePos + 1 ||
+      __atomic_load_n( &ring.totalDropped, __ATOMIC_RELAXED ) > 0 );
+}
+
+/* Writes all the messages in the buffer, and flushes stdout once for all
+   of them. */
+void PrintWriteWaiting( void ) {
+   unsigned long totalDropped;
+
+   for ( ;; ) {
+      PrintSlot *slot = &ring.slots[ ring.dequeuePos & PRINT_RING_MASK ];
+
+      if ( __atomic_load_n( &slot->sequence, __ATOMIC_ACQUIRE ) != 
+         ring.dequeuePos + 1 ) {
+         break;
+      }
+
+      PrintFormatSlot( slot );
+
+      /* The slot is free again for the message that comes one turn of the
+         ring later. */
+      __atomic_store_n( &slot->sequence, ring.dequeuePos + PRINT_RING_SLOTS,
+         __ATOMIC_RELEASE );
+      ring.dequeuePos += 1;
+   }
+
+   totalDropped = __atomic_exchange_n( &ring.totalDropped, 0, 
+      __ATOMIC_RELAXED );
+   if ( totalDropped > 0 ) {
+      char text[ 96 ];
+
+      sprintf( text, "%sMessages dropped with the print buffer full: %lu\n",
+         printLabels[ PRINT_LEVEL_WARNING ], totalDropped );
+      PrintAddText( ring.stamp, strlen( ring.stamp ) );
+      PrintAddText( text, strlen( text ) );
+   }
+
+   PrintFlushBatch();
+   fflush( stdout );
+}
+
+void PrintWaitForMessages( void ) {
+   struct timeval now;
+   struct timespec until;
+
+   gettimeofday( &now, NULL );
+   until.tv_sec = now.tv_sec + PRINT_WRITER_IDLE_TIME / 1000;
+   until.tv_nsec = ( now.tv_usec + ( PRINT_WRITER_IDLE_TIME % 1000 ) * 1000 )
+      * 1000;
+   if ( until.tv_nsec >= 1000000000 ) {
+      until.tv_sec += 1;
+      until.tv_nsec -= 1000000000;
+   }
+
+   /* A message put in after the writer says it's waiting wakes it up, and
+      one put in before is seen by the check below. */
+   pthread_mutex_lock( &writerMutex );
+   __atomic_store_n( &ring.isWriterWaiting, TRUE, __ATOMIC_SEQ_CST );
+
+   if ( ! PrintHasWaiting() && 
+      ! __atomic_load_n( &ring.isStopping, __ATOMIC_SEQ_CST ) ) {
+      pthread_cond_timedwait( &writerWake, &writerMutex, &until );
+   }
+
+   __atomic_store_n( &ring.isWriterWaiting, FALSE, __ATOMIC_SEQ_CST );
+   pthread_mutex_unlock( &writerMutex );
+}
+
+#endif
+
+void PrintDebug( const char *format, ... ) {
    va_list arguments;
 
    va_start( arguments, format );
-   Print( format, &arguments );
+   PrintLog( PRINT_LEVEL_DEBUG, format, &arguments );
    va_end( arguments );
 }
 
-void PrintLabel( const char *labelName, const char *format, va_list *args ) {
-   Str *label = StrNew( labelName );
-   Str *formatString = StrNew( format );
-   Str *messageString = StrConcat( label, formatString );
-
-   Print( messageString->value, args );
+void PrintMessage( const char *format, ... ) {
+   va_list arguments;
 
-   StrDel( label );
-   StrDel( formatString );
-   StrDel( messageString );
+   va_start( arguments, format );
+   PrintLog( PRINT_LEVEL_MESSAGE, format, &arguments );
+   va_end( arguments );
 }
 
 void PrintNotice( const char *format, ... ) {
    va_list arguments;
 
    va_start( arguments, format );
-   PrintLabel( "Notice: ", format, &arguments );
+   PrintLog( PRINT_LEVEL_NOTICE, format, &arguments );
    va_end( arguments );
 }
 
@@ -73,7 +714,7 @@ void PrintWarning( const char *format, ... ) {
    va_list arguments;
 
    va_start( arguments, format );
-   PrintLabel( "Warning: ", format, &arguments );
+   PrintLog( PRINT_LEVEL_WARNING, format, &arguments );
    va_end( arguments );
 }
 
@@ -81,7 +722,7 @@ void PrintError( const char *format, ... ) {
    va_list arguments;
 
    va_start( arguments, format );
-   PrintLabel( "Error: ", format, &arguments );
+   PrintLog( PRINT_LEVEL_ERROR, format, &arguments );
    va_end( arguments );
 }
 
@@ -90,7 +731,5 @@ void PrintHeader( const char *title ) {
 }
 
 void PrintConfError( const char *const errorMsg ) {
-   va_list noArguments;
-   Print( errorMsg, &noArguments );
-   printf( "\n" );
+   PrintMessage( "%s\n", errorMsg );
 }
@@ -2,6 +2,13 @@
 
    Functions for displaying information on screen.
 
+   Once the writer is started, messages are put in a ring buffer and 
+   written out by a thread of their own, so printing doesn't wait on the
+   terminal or whatever else stdout goes to. The arguments are copied into
+   the buffer as they are, and only the writer turns them into text. Until
+   the writer is started, or where there are no POSIX threads, messages are
+   written right away.
+
    ==========================================================================
 
    Copyright (c) 2012 Daniel Baimiachkine
@@ -30,13 +37,118 @@
 #define PRINT_H
 
 #include <stdarg.h>
+#include <time.h>
+
+#include "gentype.h"
+
+/* Levels of the messages, from the least important up. Messages below the
+   level set with PrintSetLevel() are dropped before anything is done with
+   their arguments. */
+#define PRINT_LEVEL_DEBUG 0
+#define PRINT_LEVEL_MESSAGE 1
+#define PRINT_LEVEL_NOTICE 2
+#define PRINT_LEVEL_WARNING 3
+#define PRINT_LEVEL_ERROR 4
+#define PRINT_TOTAL_LEVELS 5
+
+/* Building with this raised above the debug level leaves the debug 
+   messages out of the program altogether. */
+#ifndef PRINT_COMPILED_LEVEL
+   #define PRINT_COMPILED_LEVEL PRINT_LEVEL_DEBUG
+#endif
+
+/* Number of messages the ring buffer holds, which must be a power of two.
+   Messages that come in while the buffer is full are dropped and 
+   counted. */
+#define PRINT_RING_SLOTS 1024
+#define PRINT_RING_MASK ( PRINT_RING_SLOTS - 1 )
+/* Room for the arguments of a message. Strings that don't fit are cut
+   short. */
+#define PRINT_SLOT_DATA_SIZE 1000
+/* Most text written out at a time by the writer. */
+#define PRINT_BATCH_SIZE 16384
+/* Longest time, in milliseconds, the writer sleeps while it has nothing
+   to write, in case it missed a wake up. */
+#define PRINT_WRITER_IDLE_TIME 100
+
+/* Longest conversion specification in a format string that can be used
+   with the ring buffer, like "%-10lu". */
+#define PRINT_SPEC_MAX_LENGTH 15
 
-void PrintLabel( const char *labelName, const char *format, va_list *args );
-void PrintNotice( const char *format, ... );
-void PrintMessage( const char *format, ... );
-void PrintWarning( const char *format, ... );
-void PrintError( const char *format, ... );
+/* GCC checks the arguments of the print functions against their format
+   strings, which the ring buffer relies on. */
+#if defined __GNUC__
+   #define PRINT_FORMAT __attribute__( ( format( printf, 1, 2 ) ) )
+#else
+   #define PRINT_FORMAT
+#endif
+
+/* Kinds of arguments a format string can take. */
+typedef enum {
+   PRINT_ARG_NONE,
+   PRINT_ARG_INT,
+   PRINT_ARG_UNSIGNED,
+   PRINT_ARG_LONG,
+   PRINT_ARG_UNSIGNED_LONG,
+   PRINT_ARG_LONG_LONG,
+   PRINT_ARG_UNSIGNED_LONG_LONG,
+   PRINT_ARG_SIZE,
+   PRINT_ARG_DOUBLE,
+   PRINT_ARG_STRING,
+   PRINT_ARG_POINTER,
+   /* Conversions the ring buffer can't copy. The message is written up to
+      the conversion, and the rest of the format string is written as it
+      is. */
+   PRINT_ARG_UNKNOWN
+} PrintArgument;
+
+/* A message waiting in the ring buffer. */
+typedef struct {
+   /* Number of the message the slot is ready for. The slot holds a
+      message when it's one more than that. */
+   unsigned long sequence;
+   int level;
+   time_t time;
+   /* Format strings are string literals, so only the pointer is kept. */
+   const char *format;
+   Byte data[ PRINT_SLOT_DATA_SIZE ];
+   unsigned int dataSize;
+} PrintSlot;
+
+typedef struct {
+   PrintSlot slots[ PRINT_RING_SLOTS ];
+   /* Number of the next message to be put in, which is shared by all the
+      threads printing. */
+   unsigned long enqueuePos;
+   /* Number of the next message to be written. Only the writer uses it. */
+   unsigned long dequeuePos;
+   unsigned long totalDropped;
+   Bool isRunning;
+   Bool isStopping;
+   Bool isWriterWaiting;
+   /* The timestamp is only made again when the second changes. */
+   time_t stampTime;
+   char stamp[ 16 ];
+} PrintRing;
+
+void PrintStartWriter( void );
+/* Writes out the messages left in the buffer, then stops the writer. */
+void PrintStopWriter( void );
+void PrintSetLevel( int level );
+/* Returns the level with the given name, or -1 if there is none. */
+int PrintFindLevel( const char *name );
+void PrintDebug( const char *format, ... ) PRINT_FORMAT;
+void PrintNotice( const char *format, ... ) PRINT_FORMAT;
+void PrintMessage( const char *format, ... ) PRINT_FORMAT;
+void PrintWarning( const char *format, ... ) PRINT_FORMAT;
+void PrintError( const char *format, ... ) PRINT_FORMAT;
 void PrintHeader( const char *title );
 void PrintConfError( const char *const errorMsg );
 
+/* Debug calls that are left out are never made, and their arguments are
+   never evaluated. */
+#if PRINT_COMPILED_LEVEL > PRINT_LEVEL_DEBUG
+   #define PrintDebug 1 ? ( void ) 0 : PrintDebug
+#endif
+
 #endif
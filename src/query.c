@@ -26,6 +26,7 @@
 #include <ctype.h>
 
 #include "query.h"
+#include "stats.h"
 #include "print.h"
 
 /* Private prototypes: */
@@ -78,6 +79,7 @@ Bool QueryUnpack( const Str *capsule ) {
    }
    else {
       StrDel( cleanedQuery );
+      StatsCount( STATS_DROPS );
       return FALSE;
    }
 
@@ -116,10 +118,12 @@ Bool QueryUnpack( const Str *capsule ) {
          PrintWarning( 
             "Query with an older query ID received: new( %d ), old( %d )\n", 
             newQueryId, QueryGetId() );
+         StatsCount( STATS_STALE_IDS );
       }
    }
    else {
       PrintNotice( "Invalid query ID given in received query\n" );
+      StatsCount( STATS_DROPS );
    }
 
    StrDel( cleanedQuery );
@@ -0,0 +1,279 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "querylog.h"
+#include "print.h"
+
+/* Private prototypes: */
+static Bool QueryLogAddHeader( FILE *file );
+static Bool QueryLogHasHeader( FILE *file );
+static void QueryLogAddEntry( QueryLogEntryType type, 
+   const unsigned int *numbers, int totalNumbers, const Str *text );
+static int QueryLogEncodeVarint( Byte *bytes, unsigned int value );
+static Bool QueryLogReadVarint( MemFile *file, unsigned int *value );
+static Bool QueryLogReadHeader( MemFile *file );
+
+static QueryLog queryLog = { NULL, NULL, 0 };
+
+Bool QueryLogOpen( const char *path ) {
+   FILE *file = fopen( path, "a+b" );
+   Bool isReady;
+
+   if ( file == NULL ) {
+      PrintError( "Failed to open the query log at path: %s\n", path );
+      return FALSE;
+   }
+
+   /* A new log gets a header. An existing log is only added to when it's
+      a log of this version. */
+   fseek( file, 0, SEEK_END );
+   if ( ftell( file ) == 0 ) {
+      isReady = QueryLogAddHeader( file );
+   }
+   else {
+      isReady = QueryLogHasHeader( file );
+      if ( ! isReady ) {
+         PrintError( "File at path is not a query log of version %d: %s\n",
+            QUERYLOG_VERSION, path );
+      }
+   }
+
+   if ( ! isReady ) {
+      fclose( file );
+      return FALSE;
+   }
+
+   QueryLogClose();
+   queryLog.file = file;
+   return TRUE;
+}
+
+Bool QueryLogAddHeader( FILE *file ) {
+   const Byte version = QUERYLOG_VERSION;
+
+   return ( fwrite( QUERYLOG_MAGIC, QUERYLOG_MAGIC_SIZE, 1, file ) == 1 &&
+      fwrite( &version, 1, 1, file ) == 1 && fflush( file ) == 0 );
+}
+
+Bool QueryLogHasHeader( FILE *file ) {
+   Byte header[ QUERYLOG_HEADER_SIZE ];
+   MemFile headerFile;
+
+   fseek( file, 0, SEEK_SET );
+   if ( fread( header, sizeof( header ), 1, file ) != 1 ) {
+      return FALSE;
+   }
+
+   MemFileInitView( &headerFile, header, sizeof( header ) );
+   return QueryLogReadHeader( &headerFile );
+}
+
+void QueryLogAdd( time_t queryTime, const Str *map, query_id_t queryId,
+   const Str *cargo ) {
+   unsigned int numbers[ 2 ];
+
+   if ( queryLog.file == NULL ) {
+      return;
+   }
+
+   /* A map entry starts the time over, so one is also added when the clock
+      was turned back. */
+   if ( queryLog.map == NULL || ! StrIsEqual( queryLog.map, map ) || 
+      queryTime < queryLog.time ) {
+      numbers[ 0 ] = ( unsigned int ) queryTime;
+      QueryLogAddEntry( QUERYLOG_ENTRY_MAP, numbers, 1, map );
+
+      StrDel( queryLog.map );
+      queryLog.map = StrCopy( map );
+      queryLog.time = queryTime;
+   }
+
+   numbers[ 0 ] = ( unsigned int ) ( queryTime - queryLog.time );
+   numbers[ 1 ] = queryId;
+   QueryLogAddEntry( QUERYLOG_ENTRY_QUERY, numbers, 2, cargo );
+   queryLog.time = queryTime;
+
+   /* Every query is on the disk before it's executed, in case luk doesn't
+      get to shut down properly. */
+   if ( fflush( queryLog.file ) != 0 || ferror( queryLog.file ) ) {
+      PrintError( "Failed to write to the query log. "
+         "No more queries will be logged\n" );
+      QueryLogClose();
+   }
+}
+
+void QueryLogAddEntry( QueryLogEntryType type, 
+   const unsigned int *numbers, int totalNumbers, const Str *text ) {
+   /* Room for the type, the numbers and the length of the text. */
+   Byte entry[ 1 + QUERYLOG_VARINT_MAX_SIZE * 3 ];
+   int entrySize = 1;
+   int number;
+
+   entry[ 0 ] = ( Byte ) type;
+   for ( number = 0; number < totalNumbers; number += 1 ) {
+      entrySize += QueryLogEncodeVarint( entry + entrySize, 
+         numbers[ number ] );
+   }
+
+   entrySize += QueryLogEncodeVarint( entry + entrySize, text->length );
+
+   fwrite( entry, entrySize, 1, queryLog.file );
+   fwrite( text->value, text->length, 1, queryLog.file );
+}
+
+void QueryLogClose( void ) {
+   if ( queryLog.file != NULL ) {
+      fclose( queryLog.file );
+      queryLog.file = NULL;
+   }
+
+   if ( queryLog.map != NULL ) {
+      StrDel( queryLog.map );
+      queryLog.map = NULL;
+   }
+
+   queryLog.time = 0;
+}
+
+int QueryLogEncodeVarint( Byte *bytes, unsigned int value ) {
+   int totalBytes = 0;
+
+   while ( value >= 0x80 ) {
+      bytes[ totalBytes ] = ( Byte ) ( ( value & 0x7F ) | 0x80 );
+      value >>= 7;
+      totalBytes += 1;
+   }
+
+   bytes[ totalBytes ] = ( Byte ) value;
+   return totalBytes + 1;
+}
+
+Bool QueryLogOpenReader( QueryLogReader *reader, const char *path ) {
+   const int errorCode = MapFileOpen( &reader->file, path );
+
+   if ( errorCode != 0 ) {
+      PrintError( "Failed to open the query log at path: %s\n", path );
+      PrintMessage( "Reason for failure: %s\n",
+         MemFileGetErrorCodeMessage( errorCode ) );
+      return FALSE;
+   }
+
+   MemFileInitView( &reader->data, reader->file.data, reader->file.size );
+   reader->time = 0;
+
+   if ( ! QueryLogReadHeader( &reader->data ) ) {
+      PrintError( "File at path is not a query log of version %d: %s\n",
+         QUERYLOG_VERSION, path );
+      MapFileClose( &reader->file );
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+Bool QueryLogReadHeader( MemFile *file ) {
+   Byte header[ QUERYLOG_HEADER_SIZE ];
+
+   return ( MemFileRead( file, header, sizeof( header ) ) == 
+      sizeof( header ) &&
+      memcmp( header, QUERYLOG_MAGIC, QUERYLOG_MAGIC_SIZE ) == 0 &&
+      header[ QUERYLOG_MAGIC_SIZE ] == QUERYLOG_VERSION );
+}
+
+QueryLogReadResult QueryLogRead( QueryLogReader *reader, 
+   QueryLogEntry *entry ) {
+   MemFile *data = &reader->data;
+   unsigned int number;
+   size_t textPos;
+   Byte type;
+
+   if ( MemFileRead( data, &type, 1 ) != 1 ) {
+      return QUERYLOG_READ_END;
+   }
+
+   entry->type = ( QueryLogEntryType ) type;
+   entry->queryId = 0;
+
+   if ( type == QUERYLOG_ENTRY_MAP ) {
+      if ( ! QueryLogReadVarint( data, &number ) ) {
+         return QUERYLOG_READ_BROKEN;
+      }
+
+      reader->time = ( time_t ) number;
+   }
+   else if ( type == QUERYLOG_ENTRY_QUERY ) {
+      if ( ! QueryLogReadVarint( data, &number ) ||
+         ! QueryLogReadVarint( data, &entry->queryId ) ) {
+         return QUERYLOG_READ_BROKEN;
+      }
+
+      reader->time += number;
+   }
+   else {
+      return QUERYLOG_READ_BROKEN;
+   }
+
+   /* The text is left where it is in the log. */
+   if ( ! QueryLogReadVarint( data, &entry->textLength ) ) {
+      return QUERYLOG_READ_BROKEN;
+   }
+
+   textPos = MemFileGetPosition( data );
+   if ( entry->textLength > MemFileGetSize( data ) - textPos ) {
+      return QUERYLOG_READ_BROKEN;
+   }
+
+   entry->text = ( const char * ) reader->file.data + textPos;
+   entry->time = reader->time;
+   MemFileSetPosition( data, textPos + entry->textLength );
+
+   return QUERYLOG_READ_ENTRY;
+}
+
+Bool QueryLogReadVarint( MemFile *file, unsigned int *value ) {
+   int byteNum;
+
+   *value = 0;
+   for ( byteNum = 0; byteNum < QUERYLOG_VARINT_MAX_SIZE; byteNum += 1 ) {
+      Byte byte;
+      if ( MemFileRead( file, &byte, 1 ) != 1 ) {
+         return FALSE;
+      }
+
+      *value |= ( unsigned int ) ( byte & 0x7F ) << ( byteNum * 7 );
+      if ( ( byte & 0x80 ) == 0 ) {
+         return TRUE;
+      }
+   }
+
+   return FALSE;
+}
+
+void QueryLogCloseReader( QueryLogReader *reader ) {
+   MapFileClose( &reader->file );
+}
@@ -0,0 +1,104 @@
+/*
+
+   Query log, to which every query luk accepts from the server can be 
+   appended, so the load of a server can be replayed later and the changes
+   made to the records can be traced back to the queries that made them.
+
+   The log starts with a small header, which is followed by the entries. An
+   entry starts with a byte telling its type. A map entry holds the time in
+   seconds and the name of the map the following queries were made on. A
+   query entry holds the seconds since the entry before it, the query ID and
+   the cargo of the query. Numbers are written as varints, and names and 
+   cargo are written after their length.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef QUERYLOG_H
+#define QUERYLOG_H
+
+#include <stdio.h>
+#include <time.h>
+
+#include "gentype.h"
+#include "strutil.h"
+#include "mapfile.h"
+#include "memfile.h"
+#include "query.h"
+
+#define QUERYLOG_MAGIC "LUKQ"
+#define QUERYLOG_MAGIC_SIZE 4
+#define QUERYLOG_VERSION 1
+#define QUERYLOG_HEADER_SIZE ( QUERYLOG_MAGIC_SIZE + 1 )
+#define QUERYLOG_VARINT_MAX_SIZE 5
+
+typedef enum {
+   QUERYLOG_ENTRY_MAP = 1,
+   QUERYLOG_ENTRY_QUERY
+} QueryLogEntryType;
+
+typedef enum {
+   QUERYLOG_READ_ENTRY,
+   QUERYLOG_READ_END,
+   QUERYLOG_READ_BROKEN
+} QueryLogReadResult;
+
+typedef struct {
+   FILE *file;
+   /* Copy of the map of the last map entry. */
+   Str *map;
+   time_t time;
+} QueryLog;
+
+typedef struct {
+   QueryLogEntryType type;
+   time_t time;
+   query_id_t queryId;
+   /* The map of a map entry, or the cargo of a query. It points into the
+      log, so it's only good until the log is closed. */
+   const char *text;
+   unsigned int textLength;
+} QueryLogEntry;
+
+typedef struct {
+   MapFile file;
+   MemFile data;
+   time_t time;
+} QueryLogReader;
+
+/* Opens the query log at the given path for appending. The log is created
+   if it doesn't exist yet. */
+Bool QueryLogOpen( const char *path );
+/* Appends a query made on the given map. A map entry goes in first when the
+   map isn't the one of the last map entry. */
+void QueryLogAdd( time_t queryTime, const Str *map, query_id_t queryId,
+   const Str *cargo );
+void QueryLogClose( void );
+
+Bool QueryLogOpenReader( QueryLogReader *reader, const char *path );
+QueryLogReadResult QueryLogRead( QueryLogReader *reader, 
+   QueryLogEntry *entry );
+void QueryLogCloseReader( QueryLogReader *reader );
+
+#endif
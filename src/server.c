@@ -30,6 +30,7 @@
 #include "md5.h"
 
 #include "server.h"
+#include "stats.h"
 #include "print.h"
 #include "platform.h"
 
@@ -190,6 +191,7 @@ Bool ServerWaitForReply( int seconds ) {
 }
 
 void ServerSend( RconResponse *response ) {
+   const unsigned long long startTime = getMicroseconds();
    unsigned char encoded[ MAX_RESPONSE_LENGTH ];
    int encodedLen = MAX_RESPONSE_LENGTH;
 
@@ -198,6 +200,8 @@ void ServerSend( RconResponse *response ) {
 
    sendto( server.socket, ( const char * ) encoded, encodedLen, 0,
       ( struct sockaddr * ) &server.address, sizeof( server.address ) );
+
+   StatsAddStageTime( STATS_STAGE_SEND, startTime );
 }
 
 void ServerSendCommand( const Str *consoleCommand ) {
@@ -208,7 +212,7 @@ void ServerSendCommand( const Str *consoleCommand ) {
    response.bodyLength = consoleCommand->length + 1;
 
    ServerSend( &response );
-   PrintMessage( "   -> %s\n", consoleCommand->value );
+   PrintDebug( "   -> %s\n", consoleCommand->value );
 }
 
 void ServerSendCommandC( const char *consoleCommand ) {
@@ -219,6 +223,8 @@ void ServerSendCommandC( const char *consoleCommand ) {
 
 Bool ServerReceive( RconResponse *response, int timeout ) {
    if ( ServerWaitForReply( timeout ) ) {
+      /* Only the time spent on a packet that is already there counts. */
+      const unsigned long long startTime = getMicroseconds();
       unsigned char encoded[ MAX_RESPONSE_LENGTH ];
       struct sockaddr_in remoteAddr;
       socklen_t remoteAddrLen = sizeof( remoteAddr );
@@ -253,6 +259,7 @@ Bool ServerReceive( RconResponse *response, int timeout ) {
          the response in case the data became malformed during transmission. */
       response->body[ responseLen ] = 0;
 
+      StatsAddStageTime( STATS_STAGE_RECEIVE, startTime );
       return TRUE;
    }
    else {
@@ -269,6 +276,10 @@ void ServerDisconnect( void ) {
    ServerSend( &response );
 }
 
+Socket ServerGetSocket( void ) {
+   return server.socket;
+}
+
 void ServerShutdown( void ) {
    if ( server.isLoggedIn ) {
       ServerDisconnect();
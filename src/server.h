@@ -103,5 +103,8 @@ void ServerSendCommandC( const char *consoleCommand );
 Bool ServerReceive( RconResponse *response, int timeout );
 void ServerDisconnect( void );
 void ServerShutdown( void );
+/* The socket can be waited on together with other sockets, before 
+   receiving from the server without a timeout. */
+Socket ServerGetSocket( void );
 
 #endif
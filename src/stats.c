@@ -0,0 +1,177 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+#include "platform.h"
+#include "print.h"
+
+/* Private prototypes: */
+static StatsCommand *StatsFindCommand( const char *action );
+static void StatsFormatLatency( const Histogram *latency, char *text );
+static void StatsPrintLine( void *context, const char *name, 
+   const char *text );
+
+static const char *const stageNames[ STATS_TOTAL_STAGES ] = {
+   "receive", "parse", "reply", "send", "query"
+};
+
+static const char *const counterNames[ STATS_TOTAL_COUNTERS ] = {
+   "queries", "misses", "drops", "stale_ids"
+};
+
+static Stats stats;
+
+void StatsInit( void ) {
+   int stage;
+   int counter;
+
+   for ( stage = 0; stage < STATS_TOTAL_STAGES; stage += 1 ) {
+      HistogramInit( &stats.stages[ stage ] );
+   }
+
+   for ( counter = 0; counter < STATS_TOTAL_COUNTERS; counter += 1 ) {
+      stats.counters[ counter ] = 0;
+   }
+
+   stats.totalCommands = 0;
+   HistogramInit( &stats.summaryLatency );
+   stats.summaryQueries = 0;
+   stats.summaryTime = getMicroseconds();
+}
+
+void StatsAddStageTime( StatsStage stage, unsigned long long startTime ) {
+   const unsigned long latency = 
+      ( unsigned long ) ( getMicroseconds() - startTime );
+
+   HistogramAdd( &stats.stages[ stage ], latency );
+   if ( stage == STATS_STAGE_QUERY ) {
+      HistogramAdd( &stats.summaryLatency, latency );
+   }
+}
+
+void StatsAddCommandTime( const char *action, unsigned long long startTime ) {
+   StatsCommand *command = StatsFindCommand( action );
+
+   if ( command != NULL ) {
+      HistogramAdd( &command->latency, 
+         ( unsigned long ) ( getMicroseconds() - startTime ) );
+   }
+}
+
+/* The actions come from the command table, so the same action always has
+   the same pointer. */
+StatsCommand *StatsFindCommand( const char *action ) {
+   StatsCommand *command;
+   int position;
+
+   for ( position = 0; position < stats.totalCommands; position += 1 ) {
+      if ( stats.commands[ position ].action == action ) {
+         return &stats.commands[ position ];
+      }
+   }
+
+   if ( stats.totalCommands == STATS_MAX_COMMANDS ) {
+      return NULL;
+   }
+
+   command = &stats.commands[ stats.totalCommands ];
+   command->action = action;
+   HistogramInit( &command->latency );
+   stats.totalCommands += 1;
+
+   return command;
+}
+
+void StatsCount( StatsCounter counter ) {
+   stats.counters[ counter ] += 1;
+}
+
+void StatsReport( StatsLineHandler handler, void *context ) {
+   char name[ STATS_LINE_SIZE ];
+   char text[ STATS_LINE_SIZE ];
+   int position;
+
+   for ( position = 0; position < STATS_TOTAL_COUNTERS; position += 1 ) {
+      sprintf( text, "%lu", stats.counters[ position ] );
+      handler( context, counterNames[ position ], text );
+   }
+
+   for ( position = 0; position < STATS_TOTAL_STAGES; position += 1 ) {
+      sprintf( name, "latency.%s", stageNames[ position ] );
+      StatsFormatLatency( &stats.stages[ position ], text );
+      handler( context, name, text );
+   }
+
+   for ( position = 0; position < stats.totalCommands; position += 1 ) {
+      const StatsCommand *command = &stats.commands[ position ];
+
+      sprintf( name, "latency.command.%.64s", command->action );
+      StatsFormatLatency( &command->latency, text );
+      handler( context, name, text );
+   }
+}
+
+void StatsFormatLatency( const Histogram *latency, char *text ) {
+   sprintf( text, "count=%lu p50=%lu p99=%lu p999=%lu max=%lu mean=%.0f",
+      HistogramGetCount( latency ), HistogramGetPercentile( latency, 50 ),
+      HistogramGetPercentile( latency, 99 ), 
+      HistogramGetPercentile( latency, 99.9 ), HistogramGetMax( latency ),
+      HistogramGetMean( latency ) );
+}
+
+void StatsPrintReport( void ) {
+   PrintHeader( "Stats" );
+   StatsReport( StatsPrintLine, NULL );
+}
+
+void StatsPrintLine( void *context, const char *name, const char *text ) {
+   ( void ) context;
+   PrintMessage( "%s: %s\n", name, text );
+}
+
+void StatsPrintSummary( void ) {
+   const unsigned long long now = getMicroseconds();
+   const unsigned long newQueries = 
+      stats.counters[ STATS_QUERIES ] - stats.summaryQueries;
+   const double seconds = ( now - stats.summaryTime ) / 1000000.0;
+   const Histogram *latency = &stats.summaryLatency;
+
+   PrintMessage( "Queries: %lu (%.1f per second), misses: %lu, drops: %lu, "
+      "stale IDs: %lu, latency p50: %lu us, p99: %lu us, p99.9: %lu us, "
+      "max: %lu us\n", stats.counters[ STATS_QUERIES ], 
+      ( seconds > 0 ) ? newQueries / seconds : 0.0, 
+      stats.counters[ STATS_MISSES ], stats.counters[ STATS_DROPS ],
+      stats.counters[ STATS_STALE_IDS ], 
+      HistogramGetPercentile( latency, 50 ), 
+      HistogramGetPercentile( latency, 99 ), 
+      HistogramGetPercentile( latency, 99.9 ), HistogramGetMax( latency ) );
+
+   HistogramInit( &stats.summaryLatency );
+   stats.summaryQueries = stats.counters[ STATS_QUERIES ];
+   stats.summaryTime = now;
+}
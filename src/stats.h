@@ -0,0 +1,97 @@
+/*
+
+   Counters and latency histograms of the work luk does for the queries of
+   the server. Each stage a query goes through is timed: receiving and 
+   decoding the packet, parsing the query capsule, running the command, 
+   building the reply, and encoding and sending it. The commands are timed
+   apart from each other, by action. The times are kept in microseconds.
+
+   ==========================================================================
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "gentype.h"
+#include "histogram.h"
+
+/* Most actions that are timed apart. */
+#define STATS_MAX_COMMANDS 32
+#define STATS_LINE_SIZE 160
+
+typedef enum {
+   STATS_STAGE_RECEIVE,
+   STATS_STAGE_PARSE,
+   STATS_STAGE_REPLY,
+   STATS_STAGE_SEND,
+   /* The whole time luk spent on a query, from the parse to the send. */
+   STATS_STAGE_QUERY,
+   STATS_TOTAL_STAGES
+} StatsStage;
+
+typedef enum {
+   /* Queries that were accepted. */
+   STATS_QUERIES,
+   /* Retrieving queries that found nothing. */
+   STATS_MISSES,
+   /* Queries that were thrown away as invalid or unknown. */
+   STATS_DROPS,
+   /* Queries thrown away for having an older query ID than the last. */
+   STATS_STALE_IDS,
+   STATS_TOTAL_COUNTERS
+} StatsCounter;
+
+typedef struct {
+   const char *action;
+   Histogram latency;
+} StatsCommand;
+
+typedef struct {
+   Histogram stages[ STATS_TOTAL_STAGES ];
+   StatsCommand commands[ STATS_MAX_COMMANDS ];
+   int totalCommands;
+   unsigned long counters[ STATS_TOTAL_COUNTERS ];
+   /* The summary line shows the queries since the last summary. */
+   Histogram summaryLatency;
+   unsigned long summaryQueries;
+   unsigned long long summaryTime;
+} Stats;
+
+/* Function that is given each line of a report, as a name and a text. */
+typedef void ( *StatsLineHandler )( void *context, const char *name,
+   const char *text );
+
+void StatsInit( void );
+/* Adds the time since the start time, taken from getMicroseconds(). */
+void StatsAddStageTime( StatsStage stage, unsigned long long startTime );
+void StatsAddCommandTime( const char *action, unsigned long long startTime );
+void StatsCount( StatsCounter counter );
+/* Reports the counters, then the latency of each stage and command. */
+void StatsReport( StatsLineHandler handler, void *context );
+void StatsPrintReport( void );
+/* Prints one line with the counters and the latency of the queries since
+   the last summary. */
+void StatsPrintSummary( void );
+
+#endif
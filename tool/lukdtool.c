@@ -0,0 +1,462 @@
+/*
+
+   Copyright (c) 2012 Daniel Baimiachkine
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "gentype.h"
+#include "strutil.h"
+
+#include "lukd.h"
+#include "print.h"
+#include "lukdtool.h"
+
+/* Private prototypes: */
+static Bool LukdToolStats( const char *filePath );
+static Bool LukdToolDump( const char *filePath, const char *mapArg );
+static Bool LukdToolDelete( const char *filePath, const char *mapArg );
+static Bool LukdToolRename( const char *filePath, const char *mapArg, 
+   const char *newMapArg );
+static Bool LukdToolCompact( const char *filePath, Bool isCompressed );
+static Bool LukdToolMerge( const char *outFilePath, char **inFilePaths,
+   unsigned int totalInFiles, Bool isCompressed );
+static Bool LukdToolOpen( LukdSource *source, const char *filePath );
+static void LukdToolInitOptions( LukdMergeOptions *options, 
+   Bool isCompressed );
+static Str *LukdToolMakeMapName( const char *mapArg );
+static Bool LukdToolIsMapEntry( const LukdDirectoryEntry *entry, 
+   const Str *map );
+static Bool LukdToolHasMap( const LukdSource *source, const Str *map );
+static Bool LukdToolIsCompressed( const LukdSource *sources, 
+   unsigned int totalSources );
+static void LukdToolPrintRecord( void *context, const Str *key, 
+   const Str *value );
+static void LukdToolPrintHelpMenu( const char *programPath );
+
+int main( int argc, char *argv[] ) {
+   const char *command = ( argc > 1 ) ? argv[ 1 ] : "";
+   /* Files that are written can be asked to have their records 
+      compressed. */
+   const Bool isCompressed = ( argc > 2 && strcmp( argv[ 2 ], "-z" ) == 0 );
+   const int firstFileArg = isCompressed ? 3 : 2;
+   Bool isDone;
+
+   if ( strcmp( command, "stats" ) == 0 && argc == 3 ) {
+      isDone = LukdToolStats( argv[ 2 ] );
+   }
+   else if ( strcmp( command, "dump" ) == 0 && argc == 4 ) {
+      isDone = LukdToolDump( argv[ 2 ], argv[ 3 ] );
+   }
+   else if ( strcmp( command, "delete" ) == 0 && argc == 4 ) {
+      isDone = LukdToolDelete( argv[ 2 ], argv[ 3 ] );
+   }
+   else if ( strcmp( command, "rename" ) == 0 && argc == 5 ) {
+      isDone = LukdToolRename( argv[ 2 ], argv[ 3 ], argv[ 4 ] );
+   }
+   else if ( strcmp( command, "compact" ) == 0 && 
+      argc == firstFileArg + 1 ) {
+      isDone = LukdToolCompact( argv[ firstFileArg ], isCompressed );
+   }
+   else if ( strcmp( command, "merge" ) == 0 && argc > firstFileArg + 1 ) {
+      isDone = LukdToolMerge( argv[ firstFileArg ], 
+         &argv[ firstFileArg + 1 ], argc - firstFileArg - 1, isCompressed );
+   }
+   else {
+      LukdToolPrintHelpMenu( argv[ 0 ] );
+      exit( EXIT_FAILURE );
+   }
+
+   return ( isDone ? EXIT_SUCCESS : EXIT_FAILURE );
+}
+
+/* Prints what the file holds, followed by a line for each series of 
+   records in its directory. */
+Bool LukdToolStats( const char *filePath ) {
+   char publishDate[ LUKD_PUBLISH_DATE_MAX_LENGTH ];
+   time_t publishTime;
+   unsigned int totalPlayerEntries = 0;
+   unsigned int totalRecords = 0;
+   unsigned int totalDamaged = 0;
+   unsigned int entryNum;
+   Bool *isIntact;
+   LukdSource source;
+
+   if ( ! LukdToolOpen( &source, filePath ) ) {
+      return FALSE;
+   }
+
+   isIntact = ( Bool * ) malloc( ( source.totalEntries + 1 ) * 
+      sizeof( Bool ) );
+   if ( isIntact == NULL ) {
+      LukdCloseSource( &source );
+      return FALSE;
+   }
+
+   /* Checking the series reads all of the records, one series at a 
+      time. */
+   for ( entryNum = 0; entryNum < source.totalEntries; entryNum += 1 ) {
+      const LukdDirectoryEntry *entry = &source.entries[ entryNum ];
+
+      isIntact[ entryNum ] = LukdIsIntactEntry( &source, entryNum );
+      if ( ! isIntact[ entryNum ] ) {
+         totalDamaged += 1;
+      }
+
+      if ( entry->player != NULL ) {
+         totalPlayerEntries += 1;
+      }
+
+      totalRecords += entry->series.totalRecords;
+   }
+
+   publishTime = ( time_t ) source.mainTable.publishDate;
+   strftime( publishDate, LUKD_PUBLISH_DATE_MAX_LENGTH, 
+      LUKD_PUBLISH_DATE_FORMAT, localtime( &publishTime ) );
+
+   printf( "Database file: %s\n", filePath );
+   printf( "   - Version: %u\n", source.version );
+   printf( "   - Size: %lu bytes\n", ( unsigned long ) source.file.size );
+   printf( "   - Published on: %s\n", publishDate );
+   printf( "   - Total map entries: %u\n", 
+      source.totalEntries - totalPlayerEntries );
+   printf( "   - Total player entries: %u\n", totalPlayerEntries );
+   printf( "   - Total records: %u\n", totalRecords );
+   printf( "   - Total keys: %u\n", source.keys.totalKeys );
+   printf( "   - Damaged series: %u\n\n", totalDamaged );
+
+   /* Files before version 7 don't have the size of their series. */
+   printf( "%-8s  %-16s  %8s  %10s  %s\n", "Map", "Player", "Records", 
+      "Size", "Flags" );
+   for ( entryNum = 0; entryNum < source.totalEntries; entryNum += 1 ) {
+      const LukdDirectoryEntry *entry = &source.entries[ entryNum ];
+
+      printf( "%-8.8s  %-16s  %8u  %10llu  %s%s\n", entry->map, 
+         ( entry->player != NULL ) ? entry->player->value : "-",
+         entry->series.totalRecords, entry->series.size,
+         ( entry->series.flags & LUKD_SERIES_COMPRESSED ) ? 
+            "compressed " : "",
+         isIntact[ entryNum ] ? "" : "damaged" );
+   }
+
+   free( ( void * ) isIntact );
+   LukdCloseSource( &source );
+   return ( totalDamaged == 0 );
+}
+
+/* Prints the records of the map, followed by the records of each of its 
+   players. */
+Bool LukdToolDump( const char *filePath, const char *mapArg ) {
+   Str *map = LukdToolMakeMapName( mapArg );
+   Bool isDumped = TRUE;
+   Bool isFound = FALSE;
+   unsigned int entryNum;
+   LukdSource source;
+
+   if ( map == NULL || ! LukdToolOpen( &source, filePath ) ) {
+      StrDel( map );
+      return FALSE;
+   }
+
+   for ( entryNum = 0; entryNum < source.totalEntries; entryNum += 1 ) {
+      const LukdDirectoryEntry *entry = &source.entries[ entryNum ];
+
+      if ( ! LukdToolIsMapEntry( entry, map ) ) {
+         continue;
+      }
+
+      if ( entry->player != NULL ) {
+         printf( "[%s %s]\n", map->value, entry->player->value );
+      }
+      else {
+         printf( "[%s]\n", map->value );
+      }
+
+      if ( ! LukdReadEntryRecords( &source, entryNum, LukdToolPrintRecord,
+         NULL ) ) {
+         isDumped = FALSE;
+      }
+
+      isFound = TRUE;
+   }
+
+   if ( ! isFound ) {
+      PrintError( "Failed to locate map entry with name: %s\n", 
+         map->value );
+   }
+
+   LukdCloseSource( &source );
+   StrDel( map );
+   return ( isFound && isDumped );
+}
+
+/* The file is written again without the map, in place of the old file,
+   which is kept as a backup. */
+Bool LukdToolDelete( const char *filePath, const char *mapArg ) {
+   Str *map = LukdToolMakeMapName( mapArg );
+   Bool isDeleted = FALSE;
+   LukdMergeOptions options;
+   LukdSource source;
+
+   if ( map == NULL || ! LukdToolOpen( &source, filePath ) ) {
+      StrDel( map );
+      return FALSE;
+   }
+
+   if ( LukdToolHasMap( &source, map ) ) {
+      LukdToolInitOptions( &options, LukdToolIsCompressed( &source, 1 ) );
+      options.skippedMap = map;
+      isDeleted = LukdMergeSources( &source, 1, filePath, &options );
+      if ( isDeleted ) {
+         printf( "Successfully deleted map entry: %s\n", map->value );
+      }
+   }
+   else {
+      PrintError( "Failed to locate map entry with name: %s\n", 
+         map->value );
+   }
+
+   LukdCloseSource( &source );
+   StrDel( map );
+   return isDeleted;
+}
+
+/* The records of a map can't be moved to a map that already has 
+   records. */
+Bool LukdToolRename( const char *filePath, const char *mapArg, 
+   const char *newMapArg ) {
+   Str *map = LukdToolMakeMapName( mapArg );
+   Str *newMap = LukdToolMakeMapName( newMapArg );
+   Bool isRenamed = FALSE;
+   LukdMergeOptions options;
+   LukdSource source;
+
+   if ( map == NULL || newMap == NULL ) {
+      StrDel( map );
+      StrDel( newMap );
+      return FALSE;
+   }
+
+   if ( newMap->length == 0 || newMap->length > LUKD_MAX_MAP_LENGTH ) {
+      PrintError( "Map name must be 1 to %d characters long: %s\n", 
+         LUKD_MAX_MAP_LENGTH, newMap->value );
+      StrDel( map );
+      StrDel( newMap );
+      return FALSE;
+   }
+
+   if ( ! LukdToolOpen( &source, filePath ) ) {
+      StrDel( map );
+      StrDel( newMap );
+      return FALSE;
+   }
+
+   if ( ! LukdToolHasMap( &source, map ) ) {
+      PrintError( "Failed to locate map entry with name: %s\n", 
+         map->value );
+   }
+   else if ( LukdToolHasMap( &source, newMap ) ) {
+      PrintError( "Map entry already exists: %s\n", newMap->value );
+   }
+   else {
+      LukdToolInitOptions( &options, LukdToolIsCompressed( &source, 1 ) );
+      options.renamedMap = map;
+      options.newMapName = newMap;
+      isRenamed = LukdMergeSources( &source, 1, filePath, &options );
+      if ( isRenamed ) {
+         printf( "Successfully renamed map entry %s to: %s\n", map->value,
+            newMap->value );
+      }
+   }
+
+   LukdCloseSource( &source );
+   StrDel( map );
+   StrDel( newMap );
+   return isRenamed;
+}
+
+/* Writing the file again leaves out the expired records, and gives each
+   map and player a single series. */
+Bool LukdToolCompact( const char *filePath, Bool isCompressed ) {
+   LukdMergeOptions options;
+   LukdSource source;
+   Bool isCompacted;
+
+   if ( ! LukdToolOpen( &source, filePath ) ) {
+      return FALSE;
+   }
+
+   LukdToolInitOptions( &options, 
+      isCompressed || LukdToolIsCompressed( &source, 1 ) );
+   isCompacted = LukdMergeSources( &source, 1, filePath, &options );
+   if ( isCompacted ) {
+      printf( "Successfully compacted database file: %s\n", filePath );
+   }
+
+   LukdCloseSource( &source );
+   return isCompacted;
+}
+
+/* The records of the later files take the place of those of the earlier
+   ones. The new file can also be one of the files being merged. */
+Bool LukdToolMerge( const char *outFilePath, char **inFilePaths,
+   unsigned int totalInFiles, Bool isCompressed ) {
+   LukdSource *sources = ( LukdSource * ) malloc( 
+      totalInFiles * sizeof( LukdSource ) );
+   unsigned int totalOpened = 0;
+   Bool isMerged = FALSE;
+   LukdMergeOptions options;
+
+   if ( sources == NULL ) {
+      return FALSE;
+   }
+
+   while ( totalOpened < totalInFiles && LukdToolOpen( 
+      &sources[ totalOpened ], inFilePaths[ totalOpened ] ) ) {
+      totalOpened += 1;
+   }
+
+   if ( totalOpened == totalInFiles ) {
+      LukdToolInitOptions( &options, 
+         isCompressed || LukdToolIsCompressed( sources, totalInFiles ) );
+      isMerged = LukdMergeSources( sources, totalInFiles, outFilePath, 
+         &options );
+      if ( isMerged ) {
+         printf( "Successfully merged %u database files into: %s\n", 
+            totalInFiles, outFilePath );
+      }
+   }
+
+   while ( totalOpened > 0 ) {
+      totalOpened -= 1;
+      LukdCloseSource( &sources[ totalOpened ] );
+   }
+
+   free( ( void * ) sources );
+   return isMerged;
+}
+
+/* A file whose directory is only partly readable is left alone, so none
+   of its records get lost by writing it again. */
+Bool LukdToolOpen( LukdSource *source, const char *filePath ) {
+   if ( ! LukdOpenSource( source, filePath ) ) {
+      PrintError( "Cannot read database file at path: %s\n", filePath );
+      LukdCloseSource( source );
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+void LukdToolInitOptions( LukdMergeOptions *options, Bool isCompressed ) {
+   options->isCompressed = isCompressed;
+   options->totalBackups = LUKDTOOL_TOTAL_BACKUPS;
+   options->skippedMap = NULL;
+   options->renamedMap = NULL;
+   options->newMapName = NULL;
+}
+
+/* Map names are kept in lowercase, like luk does. */
+Str *LukdToolMakeMapName( const char *mapArg ) {
+   Str *name = StrNew( mapArg );
+   Str *map = ( name != NULL ) ? StrDown( name ) : NULL;
+
+   StrDel( name );
+   return map;
+}
+
+/* Names of the full length are not terminated. */
+Bool LukdToolIsMapEntry( const LukdDirectoryEntry *entry, const Str *map ) {
+   return ( map->length <= LUKD_MAX_MAP_LENGTH && 
+      strncmp( entry->map, map->value, LUKD_MAX_MAP_LENGTH ) == 0 );
+}
+
+Bool LukdToolHasMap( const LukdSource *source, const Str *map ) {
+   unsigned int entryNum;
+
+   for ( entryNum = 0; entryNum < source->totalEntries; entryNum += 1 ) {
+      if ( LukdToolIsMapEntry( &source->entries[ entryNum ], map ) ) {
+         return TRUE;
+      }
+   }
+
+   return FALSE;
+}
+
+/* The new file is compressed if any of the files it's made from has 
+   compressed records. */
+Bool LukdToolIsCompressed( const LukdSource *sources, 
+   unsigned int totalSources ) {
+   unsigned int sourceNum;
+
+   for ( sourceNum = 0; sourceNum < totalSources; sourceNum += 1 ) {
+      const LukdSource *source = &sources[ sourceNum ];
+      unsigned int entryNum;
+
+      for ( entryNum = 0; entryNum < source->totalEntries; entryNum += 1 ) {
+         if ( source->entries[ entryNum ].series.flags & 
+            LUKD_SERIES_COMPRESSED ) {
+            return TRUE;
+         }
+      }
+   }
+
+   return FALSE;
+}
+
+/* The values point into the file, so they aren't terminated. */
+void LukdToolPrintRecord( void *context, const Str *key, const Str *value ) {
+   ( void ) context;
+   printf( "%.*s = %.*s\n", ( int ) key->length, key->value, 
+      ( int ) value->length, value->value );
+}
+
+void LukdToolPrintHelpMenu( const char *programPath ) {
+   printf( 
+      "lukd-tool works on luk database files while luk isn't using them.\n\n"
+
+      /* Usage information. */
+      "Usage: \n"
+      "  %s <command> [ arguments ]\n\n", 
+      programPath 
+   );
+
+   printf(
+      /* Commands. */
+      "Commands: \n"
+      "  stats <file>\t\t\tShow what the file holds\n"
+      "  dump <file> <map>\t\tPrint the records of <map>\n"
+      "  delete <file> <map>\t\tDelete the records of <map>\n"
+      "  rename <file> <map> <new>\tMove the records of <map> to <new>\n"
+      "  compact [ -z ] <file>\t\tWrite the file again without the\n"
+      "  \t\t\t\texpired records\n"
+      "  merge [ -z ] <out> <in>...\tMerge the files into <out>. Records\n"
+      "  \t\t\t\tof later files replace those of earlier\n"
+      "  \t\t\t\tfiles\n\n"
+      "  -z compresses the records of the new file. Files written from\n"
+      "  compressed files are always compressed. The file being changed\n"
+      "  is kept as a backup.\n"
+   );
+}